@@ -0,0 +1,293 @@
+﻿
+# pragma once
+# include <chrono>
+# include <ctime>
+# include <thread>
+# include <Siv3D.hpp>
+# if SIV3D_PLATFORM(WINDOWS)
+#	include <Siv3D/Windows/Windows.hpp>
+#	include <psapi.h>
+#	pragma comment (lib, "psapi")
+# else
+#	include <sys/resource.h>
+# endif
+# include "../NetworkSystem.hpp"
+# include "../NetworkLinkSimulator.hpp"
+
+// ベンチマークとテストのプログラムで共通して使う計測・設定・ルームへの参加の処理
+
+namespace Benchmark
+{
+	/// @brief プロセスが使った CPU 時間 (秒)
+	[[nodiscard]]
+	inline double ProcessCPUSeconds()
+	{
+# if SIV3D_PLATFORM(WINDOWS)
+
+		FILETIME creationTime, exitTime, kernelTime, userTime;
+		::GetProcessTimes(::GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime);
+
+		const auto toSeconds = [](const FILETIME& t) { return ((static_cast<uint64>(t.dwHighDateTime) << 32) | t.dwLowDateTime) * 1e-7; };
+		return (toSeconds(kernelTime) + toSeconds(userTime));
+
+# else
+
+		return (static_cast<double>(std::clock()) / CLOCKS_PER_SEC);
+
+# endif
+	}
+
+	/// @brief プロセスの最大メモリ使用量 (メガバイト)
+	[[nodiscard]]
+	inline double PeakMemoryMegabytes()
+	{
+# if SIV3D_PLATFORM(WINDOWS)
+
+		PROCESS_MEMORY_COUNTERS counters{};
+		::GetProcessMemoryInfo(::GetCurrentProcess(), &counters, sizeof(counters));
+		return (counters.PeakWorkingSetSize / (1024.0 * 1024.0));
+
+# else
+
+		rusage usage{};
+		::getrusage(RUSAGE_SELF, &usage);
+
+	# if SIV3D_PLATFORM(MACOS)
+		// macOS ではバイト単位
+		return (usage.ru_maxrss / (1024.0 * 1024.0));
+	# else
+		// Linux ではキロバイト単位
+		return (usage.ru_maxrss / 1024.0);
+	# endif
+
+# endif
+	}
+
+	/// @brief 区間のプロセスの CPU 時間と経過時間を計測する
+	class CPUTimer
+	{
+	public:
+
+		CPUTimer()
+			: m_cpuStart{ ProcessCPUSeconds() }
+			, m_wallStart{ std::chrono::steady_clock::now() } {}
+
+		/// @brief 計測を始めてからのプロセスの CPU 時間 (秒)
+		[[nodiscard]]
+		double cpuSeconds() const
+		{
+			return (ProcessCPUSeconds() - m_cpuStart);
+		}
+
+		/// @brief 計測を始めてからの経過時間 (秒)
+		[[nodiscard]]
+		double wallSeconds() const
+		{
+			return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_wallStart).count();
+		}
+
+		/// @brief 1 ティックあたりのプロセスの CPU 時間 (ミリ秒)
+		[[nodiscard]]
+		double cpuMillisecPerTick(const int64 ticks) const
+		{
+			return (cpuSeconds() * 1000.0 / Max<int64>(ticks, 1));
+		}
+
+		[[nodiscard]]
+		std::chrono::steady_clock::time_point wallStart() const noexcept
+		{
+			return m_wallStart;
+		}
+
+	private:
+
+		double m_cpuStart = 0.0;
+
+		std::chrono::steady_clock::time_point m_wallStart;
+	};
+
+	/// @brief 昇順に並べた遅延 (マイクロ秒) のパーセンタイル (ミリ秒)
+	/// @param sorted 昇順に並べた遅延 (マイクロ秒)
+	/// @param p 0.0 以上 1.0 以下の割合
+	[[nodiscard]]
+	inline double Percentile(const Array<uint32>& sorted, const double p)
+	{
+		if (not sorted)
+		{
+			return 0.0;
+		}
+
+		const size_t index = Min(static_cast<size_t>(p * (sorted.size() - 1) + 0.5), (sorted.size() - 1));
+		return (sorted[index] / 1000.0);
+	}
+
+	/// @brief 遅延の集計
+	struct LatencySummary
+	{
+		/// @brief CSV の見出し
+		static constexpr StringView Header = U"samples,p50_ms,p90_ms,p99_ms,max_ms";
+
+		size_t samples = 0;
+
+		double p50 = 0.0;
+
+		double p90 = 0.0;
+
+		double p99 = 0.0;
+
+		double max = 0.0;
+
+		/// @brief Header に対応する CSV の値
+		[[nodiscard]]
+		String toCSV() const
+		{
+			return U"{},{:.3f},{:.3f},{:.3f},{:.3f}"_fmt(samples, p50, p90, p99, max);
+		}
+	};
+
+	/// @brief 遅延 (マイクロ秒) を集計します。
+	[[nodiscard]]
+	inline LatencySummary SummarizeLatencies(Array<uint32> latencies)
+	{
+		std::sort(latencies.begin(), latencies.end());
+
+		LatencySummary summary;
+		summary.samples = latencies.size();
+		summary.p50 = Percentile(latencies, 0.50);
+		summary.p90 = Percentile(latencies, 0.90);
+		summary.p99 = Percentile(latencies, 0.99);
+		summary.max = Percentile(latencies, 1.0);
+		return summary;
+	}
+
+	/// @brief INI の [Link] セクションで指定する通信状態
+	struct LinkConfig
+	{
+		/// @brief 各クライアントの通信路で再現する通信状態 (無い場合は何もしない)
+		Optional<NetworkLinkSimulator::LinkCondition> condition;
+
+		/// @brief 乱数のシード (クライアントごとに番号を加える)
+		uint64 seed = 0;
+	};
+
+	/// @brief INI の [Link] セクションを読み込みます。
+	/// @remark セクションが無い場合は通信状態を再現しません。
+	[[nodiscard]]
+	inline LinkConfig LoadLinkConfig(const INI& ini)
+	{
+		LinkConfig config;
+
+		if (ini.hasSection(U"Link"))
+		{
+			NetworkLinkSimulator::LinkCondition link;
+			link.latencyMillisec = Max(ParseOr<double>(ini[U"Link.latency"], link.latencyMillisec), 0.0);
+			link.jitterMillisec = Max(ParseOr<double>(ini[U"Link.jitter"], link.jitterMillisec), 0.0);
+			link.lossRate = Clamp(ParseOr<double>(ini[U"Link.loss"], link.lossRate), 0.0, 1.0);
+			link.bandwidthKbps = Max(ParseOr<double>(ini[U"Link.bandwidth"], link.bandwidthKbps), 0.0);
+			config.condition = link;
+			config.seed = ParseOr<uint64>(ini[U"Link.seed"], config.seed);
+		}
+
+		return config;
+	}
+
+	/// @brief 接続の成否を記録するクライアント
+	class Client : public SivPhoton
+	{
+	public:
+
+		using SivPhoton::SivPhoton;
+
+		[[nodiscard]]
+		bool isConnected() const noexcept
+		{
+			return m_connected;
+		}
+
+		void connectReturn(const int32 errorCode, const String&, const String&, const String&) override
+		{
+			m_connected = (errorCode == 0);
+		}
+
+	private:
+
+		bool m_connected = false;
+	};
+
+	/// @brief condition() が true を返すまで update() を繰り返します。
+	/// @param update すべてのクライアントを 1 回更新する関数
+	/// @param condition 待つ条件
+	/// @param maxUpdates update() を呼ぶ最大の回数
+	/// @return 最後に condition() が返した値
+	template <class Update, class Condition>
+	[[nodiscard]]
+	bool WaitUntil(Update&& update, Condition&& condition, const int32 maxUpdates)
+	{
+		for (int32 i = 0; (i < maxUpdates) && (not condition()); ++i)
+		{
+			update();
+		}
+
+		return condition();
+	}
+
+	/// @brief すべてのクライアントを接続し、先頭のクライアントが作成したルームに全員で参加します。
+	/// @param clients Client を指すポインタの配列
+	/// @param userName 接続に使うユーザ名
+	/// @param roomName 作成するルームの名前
+	/// @param update すべてのクライアントを 1 回更新する関数
+	/// @param maxUpdates 接続・作成・参加の各段階で update() を呼ぶ最大の回数
+	/// @return 全員が同じルームに参加できた場合 true, それ以外の場合は false
+	template <class Clients, class Update>
+	[[nodiscard]]
+	bool JoinRoom(Clients& clients, const StringView userName, const StringView roomName, Update&& update, const int32 maxUpdates = 1000)
+	{
+		if (not clients)
+		{
+			return false;
+		}
+
+		const int32 numPlayers = static_cast<int32>(clients.size());
+
+		for (auto& client : clients)
+		{
+			client->connect(userName);
+		}
+
+		if (not WaitUntil(update, [&]() { return std::all_of(clients.begin(), clients.end(), [](const auto& client) { return client->isConnected(); }); }, maxUpdates))
+		{
+			return false;
+		}
+
+		clients.front()->opCreateRoom(roomName, numPlayers);
+
+		if (not WaitUntil(update, [&]() { return clients.front()->isInRoom(); }, maxUpdates))
+		{
+			return false;
+		}
+
+		for (size_t i = 1; i < clients.size(); ++i)
+		{
+			clients[i]->opJoinRoom(roomName);
+		}
+
+		return WaitUntil(update, [&]() { return std::all_of(clients.begin(), clients.end(), [&](const auto& client) { return (client->getPlayerCountInCurrentRoom() == numPlayers); }); }, maxUpdates);
+	}
+
+	/// @brief すべてのクライアントを 1 回更新し、1 ミリ秒待つ関数を返します。
+	/// @remark 実時間で動くトランスポートでルームへの参加を待つときに使います。
+	template <class Clients>
+	[[nodiscard]]
+	auto UpdateAndSleep(Clients& clients)
+	{
+		return [&clients]()
+		{
+			for (auto& client : clients)
+			{
+				client->update();
+			}
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		};
+	}
+}
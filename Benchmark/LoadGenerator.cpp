@@ -0,0 +1,431 @@
+﻿
+# include <Siv3D.hpp> // OpenSiv3D v0.6.3
+# include <atomic>
+# include "../NetworkSystem.hpp"
+# include "../NetworkClientPool.hpp"
+# include "../NetworkLoopbackTransport.hpp"
+# include "../NetworkLinkSimulator.hpp"
+# include "../NetworkRelayTransport.hpp"
+# include "BenchmarkCommon.hpp"
+# if __has_include("../ENCRYPTED_PHOTON_APP_ID.SECRET")
+#	include "../ENCRYPTED_PHOTON_APP_ID.SECRET"
+# endif
+
+// 多数のボットでルームに参加し、設定したイベントを送り合って、スループット・遅延・ボットあたりの CPU 時間を計測する負荷生成ツール
+//
+// 設定は LoadGenerator.ini から読み込みます (無い場合は既定値)。
+//
+// [General]
+// bots = 50           ; ボットの数
+// roomSize = 10       ; 1 ルームあたりの最大人数
+// threads = 0         ; ワーカースレッドの数 (0 の場合はハードウェアスレッドの数)
+// tickRate = 30       ; 1 秒あたりの更新回数
+// duration = 30       ; 計測する時間 (秒)
+// log = false         ; SivPhoton のログを出力するか
+// photon = false      ; Photon サーバを使うか (false の場合はプロセス内の NetworkLoopbackHub を使い、Photon アプリケーション ID は不要)
+// relay =             ; リレーサーバ (RelayServer) のホスト名 (空でない場合は NetworkLoopbackHub の代わりに使う)
+// relayPort = 5056    ; リレーサーバのポート番号
+//
+// [Event0]            ; Event0, Event1, ... と続けて複数の種類のイベントを送信できる
+// code = 1            ; イベントコード
+// size = 32           ; 1 イベントのバイト数 (12 バイト以上)
+// rate = 10           ; 1 ボットが 1 秒あたりに送信する数
+// reliable = false    ; 確実に届ける (再送する) か
+//
+// [Link]              ; Photon サーバを使わない場合に、各ボットの通信路で再現する通信状態 (両方向に適用)
+// latency = 0         ; 片道の遅延 (ミリ秒)
+// jitter = 0          ; 遅延のばらつき (ミリ秒)
+// loss = 0            ; パケットが失われる確率
+// bandwidth = 0       ; 帯域 (キロビット毎秒, 0 の場合は無制限)
+// seed = 0            ; 乱数のシード (ボットごとに番号を加える)
+
+namespace
+{
+	struct EventSpec
+	{
+		uint8 code = 1;
+
+		size_t size = 32;
+
+		double rate = 10.0;
+
+		bool reliable = false;
+	};
+
+	struct Config
+	{
+		size_t bots = 50;
+
+		int32 roomSize = 10;
+
+		size_t threads = 0;
+
+		double tickRate = 30.0;
+
+		double duration = 30.0;
+
+		bool log = false;
+
+		bool photon = false;
+
+		String relay;
+
+		uint16 relayPort = NetworkRelayProtocol::DefaultPort;
+
+		Benchmark::LinkConfig link;
+
+		Array<EventSpec> events;
+	};
+
+	/// @brief 送信時刻とボットの番号を書き込むヘッダのバイト数
+	constexpr size_t PayloadHeaderBytes = (sizeof(uint64) + sizeof(uint32));
+
+	[[nodiscard]]
+	uint64 NowMicrosec()
+	{
+		return static_cast<uint64>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+	[[nodiscard]]
+	Config LoadConfig(const FilePathView path)
+	{
+		Config config;
+		const INI ini{ path };
+
+		if (ini)
+		{
+			config.bots = ParseOr<size_t>(ini[U"General.bots"], config.bots);
+			config.roomSize = Clamp(ParseOr<int32>(ini[U"General.roomSize"], config.roomSize), 2, 255);
+			config.threads = ParseOr<size_t>(ini[U"General.threads"], config.threads);
+			config.tickRate = Max(ParseOr<double>(ini[U"General.tickRate"], config.tickRate), 1.0);
+			config.duration = Max(ParseOr<double>(ini[U"General.duration"], config.duration), 1.0);
+			config.log = ParseOr<bool>(ini[U"General.log"], config.log);
+			config.photon = ParseOr<bool>(ini[U"General.photon"], config.photon);
+			config.relay = ini[U"General.relay"];
+			config.relayPort = ParseOr<uint16>(ini[U"General.relayPort"], config.relayPort);
+
+			for (size_t i = 0; ini.hasSection(U"Event{}"_fmt(i)); ++i)
+			{
+				const String section = U"Event{}."_fmt(i);
+				EventSpec spec;
+				spec.code = static_cast<uint8>(Clamp(ParseOr<int32>(ini[section + U"code"], spec.code), 1, 199));
+				spec.size = Max(ParseOr<size_t>(ini[section + U"size"], spec.size), PayloadHeaderBytes);
+				spec.rate = Max(ParseOr<double>(ini[section + U"rate"], spec.rate), 0.0);
+				spec.reliable = ParseOr<bool>(ini[section + U"reliable"], spec.reliable);
+				config.events << spec;
+			}
+
+			config.link = Benchmark::LoadLinkConfig(ini);
+		}
+
+		if (not config.events)
+		{
+			config.events << EventSpec{};
+		}
+
+		return config;
+	}
+
+	/// @brief 負荷を生成するボット
+	class LoadBot : public SivPhoton
+	{
+	public:
+
+		/// @brief ボットの統計 (ワーカースレッドで書き込み、メインスレッドで読み込む)
+		struct Counters
+		{
+			std::atomic<uint64> sentEvents{ 0 };
+
+			std::atomic<uint64> sentBytes{ 0 };
+
+			std::atomic<uint64> receivedEvents{ 0 };
+
+			std::atomic<uint64> receivedBytes{ 0 };
+
+			std::atomic<bool> inRoom{ false };
+		};
+
+		LoadBot(const StringView appID, const uint32 index, const Config& config)
+			: SivPhoton{ appID, U"LoadGenerator" }
+			, m_index{ index }
+			, m_config{ config }
+			, m_accumulators(config.events.size(), 0.0)
+		{
+			init();
+		}
+
+		LoadBot(std::unique_ptr<NetworkTransport> transport, const uint32 index, const Config& config)
+			: SivPhoton{ std::move(transport) }
+			, m_index{ index }
+			, m_config{ config }
+			, m_accumulators(config.events.size(), 0.0)
+		{
+			init();
+		}
+
+		void tick(const double deltaTime)
+		{
+			if (not m_counters.inRoom.load(std::memory_order_relaxed))
+			{
+				return;
+			}
+
+			for (size_t i = 0; i < m_config.events.size(); ++i)
+			{
+				const EventSpec& spec = m_config.events[i];
+				m_accumulators[i] += (spec.rate * deltaTime);
+
+				while (1.0 <= m_accumulators[i])
+				{
+					m_accumulators[i] -= 1.0;
+					send(spec);
+				}
+			}
+		}
+
+		[[nodiscard]]
+		const Counters& getCounters() const noexcept
+		{
+			return m_counters;
+		}
+
+		/// @brief 受信したイベントの遅延 (マイクロ秒)
+		/// @remark ワーカースレッドの停止後に読み込んでください。
+		[[nodiscard]]
+		const Array<uint32>& getLatencies() const noexcept
+		{
+			return m_latencies;
+		}
+
+		void connectReturn(const int32 errorCode, const String&, const String&, const String&) override
+		{
+			if (errorCode == 0)
+			{
+				opJoinRandomRoom(m_config.roomSize);
+			}
+		}
+
+		void joinRandomRoomReturn(const int32, const int32 errorCode, const String&) override
+		{
+			if (errorCode == NetworkSystem::NoRandomMatchFound)
+			{
+				opCreateRoom(U"load_{}"_fmt(m_index), m_config.roomSize);
+			}
+			else if (errorCode == 0)
+			{
+				m_counters.inRoom = true;
+			}
+			else
+			{
+				// 満室などで失敗した場合はもう一度探す
+				opJoinRandomRoom(m_config.roomSize);
+			}
+		}
+
+		void createRoomReturn(const int32, const int32 errorCode, const String&) override
+		{
+			if (errorCode == 0)
+			{
+				m_counters.inRoom = true;
+			}
+			else
+			{
+				opJoinRandomRoom(m_config.roomSize);
+			}
+		}
+
+		void leaveRoomReturn(const int32, const String&) override
+		{
+			m_counters.inRoom = false;
+		}
+
+	private:
+
+		uint32 m_index = 0;
+
+		const Config& m_config;
+
+		Array<double> m_accumulators;
+
+		Blob m_payload;
+
+		Array<uint32> m_latencies;
+
+		Counters m_counters;
+
+		void init()
+		{
+			for (const auto& spec : m_config.events)
+			{
+				setEventHandler(spec.code, [this](const int32, const Blob& data) { onReceive(data); });
+			}
+
+			m_latencies.reserve(1 << 16);
+		}
+
+		void send(const EventSpec& spec)
+		{
+			m_payload.resize(spec.size);
+
+			const uint64 now = NowMicrosec();
+			std::memcpy(m_payload.data(), &now, sizeof(now));
+			std::memcpy((m_payload.data() + sizeof(now)), &m_index, sizeof(m_index));
+
+			NetworkSystem::EventOption option;
+			option.reliable = spec.reliable;
+
+			opRaiseEvent(spec.code, m_payload, option);
+			m_counters.sentEvents.fetch_add(1, std::memory_order_relaxed);
+			m_counters.sentBytes.fetch_add(spec.size, std::memory_order_relaxed);
+		}
+
+		void onReceive(const Blob& data)
+		{
+			m_counters.receivedEvents.fetch_add(1, std::memory_order_relaxed);
+			m_counters.receivedBytes.fetch_add(data.size(), std::memory_order_relaxed);
+
+			if (data.size() < PayloadHeaderBytes)
+			{
+				return;
+			}
+
+			uint64 sentTime = 0;
+			std::memcpy(&sentTime, data.data(), sizeof(sentTime));
+
+			// 同じプロセス内のボット同士なので、送信時刻との差がそのまま片道の遅延になる
+			m_latencies << static_cast<uint32>(Min<uint64>((NowMicrosec() - sentTime), UINT32_MAX));
+		}
+	};
+}
+
+void Main()
+{
+	Console.open();
+
+	const Config config = LoadConfig(U"LoadGenerator.ini");
+	NetworkSystem::SetLogEnabled(config.log);
+
+	String appID;
+
+	if (config.photon)
+	{
+# ifdef ENCRYPTED_PHOTON_APP_ID
+		const std::string encryptedAppID{ SIV3D_OBFUSCATE(ENCRYPTED_PHOTON_APP_ID) };
+		appID = Unicode::WidenAscii(encryptedAppID);
+# else
+		Console << U"ENCRYPTED_PHOTON_APP_ID.SECRET が見つかりません。";
+		return;
+# endif
+	}
+
+	// ボットより先に破棄されないように、プールより前に作る
+	NetworkLoopbackHub hub;
+
+	const auto createTransport = [&]() -> std::unique_ptr<NetworkTransport>
+	{
+		if (config.relay)
+		{
+			return std::make_unique<NetworkRelayTransport>(config.relay, config.relayPort);
+		}
+
+		return hub.createTransport();
+	};
+
+	NetworkClientPool pool{ config.threads, config.tickRate };
+	Array<LoadBot*> bots;
+
+	for (uint32 i = 0; i < config.bots; ++i)
+	{
+		std::unique_ptr<LoadBot> bot;
+
+		if (config.photon)
+		{
+			bot = std::make_unique<LoadBot>(appID, i, config);
+		}
+		else if (config.link.condition)
+		{
+			auto simulator = std::make_unique<NetworkLinkSimulator>(createTransport(), (config.link.seed + i));
+			simulator->setCondition(*config.link.condition);
+			bot = std::make_unique<LoadBot>(std::move(simulator), i, config);
+		}
+		else
+		{
+			bot = std::make_unique<LoadBot>(createTransport(), i, config);
+		}
+
+		LoadBot* p = bot.get();
+		pool.add(std::move(bot), [p](SivPhoton&, const double deltaTime) { p->tick(deltaTime); });
+		bots << p;
+	}
+
+	Console << U"bots: {}, roomSize: {}, threads: {}, tickRate: {}, events: {}, transport: {}"_fmt(config.bots, config.roomSize, pool.num_threads(), config.tickRate, config.events.size(), (config.photon ? U"photon" : config.relay ? U"relay" : U"loopback"));
+
+	for (auto* bot : bots)
+	{
+		bot->connect(U"bot");
+	}
+
+	pool.start();
+
+	Console << U"time_s,bots_in_room,sent_events_per_s,received_events_per_s,sent_kbps,received_kbps";
+
+	const Benchmark::CPUTimer timer;
+	uint64 lastSentEvents = 0, lastReceivedEvents = 0, lastSentBytes = 0, lastReceivedBytes = 0;
+
+	for (int32 second = 1; second <= static_cast<int32>(config.duration); ++second)
+	{
+		std::this_thread::sleep_until(timer.wallStart() + std::chrono::seconds(second));
+
+		uint64 sentEvents = 0, receivedEvents = 0, sentBytes = 0, receivedBytes = 0;
+		size_t botsInRoom = 0;
+
+		for (const auto* bot : bots)
+		{
+			const auto& counters = bot->getCounters();
+			sentEvents += counters.sentEvents.load(std::memory_order_relaxed);
+			receivedEvents += counters.receivedEvents.load(std::memory_order_relaxed);
+			sentBytes += counters.sentBytes.load(std::memory_order_relaxed);
+			receivedBytes += counters.receivedBytes.load(std::memory_order_relaxed);
+			botsInRoom += counters.inRoom.load(std::memory_order_relaxed);
+		}
+
+		Console << U"{},{},{},{},{:.1f},{:.1f}"_fmt(second, botsInRoom,
+			(sentEvents - lastSentEvents), (receivedEvents - lastReceivedEvents),
+			((sentBytes - lastSentBytes) * 8 / 1000.0), ((receivedBytes - lastReceivedBytes) * 8 / 1000.0));
+
+		lastSentEvents = sentEvents;
+		lastReceivedEvents = receivedEvents;
+		lastSentBytes = sentBytes;
+		lastReceivedBytes = receivedBytes;
+	}
+
+	pool.stop();
+
+	const double cpuSec = timer.cpuSeconds();
+	const double wallSec = timer.wallSeconds();
+
+	Array<uint32> latencies;
+
+	for (const auto* bot : bots)
+	{
+		latencies.append(bot->getLatencies());
+	}
+
+	Console << U"";
+	Console << U"latency ({}): {}"_fmt(Benchmark::LatencySummary::Header, Benchmark::SummarizeLatencies(std::move(latencies)).toCSV());
+	Console << U"throughput: sent_events_per_s={:.1f}, received_events_per_s={:.1f}"_fmt((lastSentEvents / wallSec), (lastReceivedEvents / wallSec));
+	Console << U"cpu: total={:.1f}%, per_bot={:.3f}% of one core"_fmt((cpuSec / wallSec * 100.0), (cpuSec / wallSec * 100.0 / Max<size_t>(config.bots, 1)));
+
+	for (const auto& [i, stats] : Indexed(pool.getStats()))
+	{
+		Console << U"thread {}: ticks={}, overruns={}, avg_tick_ms={:.3f}, max_tick_ms={:.3f}"_fmt(i, stats.ticks, stats.overruns, stats.averageTickMillisec, stats.maxTickMillisec);
+	}
+
+	for (auto* bot : bots)
+	{
+		bot->disconnect();
+	}
+
+	Console << U"Press Enter to exit.";
+	(void)std::getchar();
+}
@@ -0,0 +1,187 @@
+﻿
+# include <Siv3D.hpp> // OpenSiv3D v0.6.3
+# include "../NetworkSystem.hpp"
+# include "../NetworkLockstep.hpp"
+# include "../NetworkLoopbackTransport.hpp"
+# include "../NetworkLinkSimulator.hpp"
+# include "BenchmarkCommon.hpp"
+
+// 複数のクライアントを 1 つのプロセス内で NetworkLockstep で同期させ、全員が同じ状態になるかを確かめるプログラム
+//
+// すべてのクライアントは NetworkLoopbackHub と NetworkLinkSimulator (遅延・ジッター・ロスあり) を介して同じルームに参加し、
+// 開始するティックをずらして start() を呼びます。各クライアントは毎フレームの全員の入力から状態のハッシュを計算し、
+// チェックサムを交換します。NetworkLinkSimulator の時刻は 1 ティックごとに TickMillisec ずつ進めるため、結果は実行速度によらず毎回同じです。
+//
+// 以下のすべてを満たす場合に PASS を出力します:
+// - 全員が TargetFrames フレームまで進む (デッドロックしない)
+// - チェックサムの不一致が無い
+// - 最終的な状態のハッシュが全員で一致する
+
+namespace
+{
+	constexpr uint8 LockstepEventCode = 1;
+
+	constexpr size_t NumPlayers = 4;
+
+	constexpr uint32 TargetFrames = 600;
+
+	/// @brief 各クライアントが start() を呼ぶまでの間隔 (ティック)
+	constexpr int32 StartIntervalTicks = 7;
+
+	constexpr int32 MaxTicks = 20000;
+
+	/// @brief 1 ティックで進める NetworkLinkSimulator の時刻 (ミリ秒)
+	constexpr double TickMillisec = 16.0;
+
+	[[nodiscard]]
+	uint64 HashBytes(uint64 hash, const void* data, const size_t size)
+	{
+		const Byte* p = static_cast<const Byte*>(data);
+
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= static_cast<uint8>(p[i]);
+			hash *= 1099511628211ull;
+		}
+
+		return hash;
+	}
+
+	struct Peer
+	{
+		std::unique_ptr<Benchmark::Client> client;
+
+		std::unique_ptr<NetworkLockstep> lockstep;
+
+		DefaultRNG rng;
+
+		uint64 state = 14695981039346656037ull;
+	};
+}
+
+void Main()
+{
+	Console.open();
+	NetworkSystem::SetLogEnabled(false);
+
+	NetworkLinkSimulator::LinkCondition condition;
+	condition.latencyMillisec = 20.0;
+	condition.jitterMillisec = 10.0;
+	condition.lossRate = 0.05;
+
+	double simulatedMillisec = 0.0;
+	NetworkLoopbackHub hub;
+	Array<Peer> peers(NumPlayers);
+
+	for (size_t i = 0; i < NumPlayers; ++i)
+	{
+		auto link = std::make_unique<NetworkLinkSimulator>(hub.createTransport(), i);
+		link->setCondition(condition);
+		link->setClock([&simulatedMillisec]() { return simulatedMillisec; });
+
+		peers[i].client = std::make_unique<Benchmark::Client>(std::move(link));
+		peers[i].rng.seed(1000 + i);
+	}
+
+	const auto updateAll = [&]()
+	{
+		simulatedMillisec += TickMillisec;
+
+		for (auto& peer : peers)
+		{
+			peer.client->update();
+		}
+	};
+
+	Array<Benchmark::Client*> clients;
+
+	for (auto& peer : peers)
+	{
+		clients << peer.client.get();
+	}
+
+	// 時刻はティックごとに進むため、待たずに更新を繰り返す
+	if (not Benchmark::JoinRoom(clients, U"lockstep", U"lockstep", updateAll, 5000))
+	{
+		Console << U"FAIL: could not join the room";
+		return;
+	}
+
+	Array<int32> playerIDs;
+
+	for (auto& peer : peers)
+	{
+		playerIDs << *peer.client->localPlayerID();
+		peer.lockstep = std::make_unique<NetworkLockstep>(*peer.client, LockstepEventCode, 3);
+	}
+
+	for (auto& peer : peers)
+	{
+		peer.lockstep->setChecksum(30, [&peer]() { return peer.state; });
+	}
+
+	int32 ticks = 0;
+
+	for (; ticks < MaxTicks; ++ticks)
+	{
+		for (size_t i = 0; i < peers.size(); ++i)
+		{
+			Peer& peer = peers[i];
+
+			// 開始するティックをずらす
+			if ((not peer.lockstep->isRunning()) && ((static_cast<int32>(i) * StartIntervalTicks) <= ticks))
+			{
+				peer.lockstep->start(playerIDs);
+			}
+
+			if ((not peer.lockstep->isRunning()) || (TargetFrames <= peer.lockstep->getStats().frame))
+			{
+				continue;
+			}
+
+			const uint32 input = static_cast<uint32>(peer.rng());
+			const Blob localInput{ &input, sizeof(input) };
+
+			peer.lockstep->step(localInput, [&peer](const NetworkLockstep::InputBundle& bundle)
+			{
+				peer.state = HashBytes(peer.state, &bundle.frame, sizeof(bundle.frame));
+
+				for (size_t k = 0; k < bundle.inputs.size(); ++k)
+				{
+					peer.state = HashBytes(peer.state, &bundle.playerIDs[k], sizeof(int32));
+					peer.state = HashBytes(peer.state, bundle.inputs[k].data(), bundle.inputs[k].size());
+				}
+			});
+		}
+
+		updateAll();
+
+		if (peers.all([](const Peer& peer) { return (TargetFrames <= peer.lockstep->getStats().frame); }))
+		{
+			break;
+		}
+	}
+
+	bool passed = true;
+
+	Console << U"player,frame,stalled_ticks,desyncs,state";
+
+	for (const auto& peer : peers)
+	{
+		const auto& stats = peer.lockstep->getStats();
+		Console << U"{},{},{},{},{:016X}"_fmt(*peer.client->localPlayerID(), stats.frame, stats.stalledTicks, stats.desyncs, peer.state);
+
+		passed &= (stats.frame == TargetFrames);
+		passed &= (stats.desyncs == 0);
+		passed &= (peer.state == peers.front().state);
+	}
+
+	Console << U"ticks: {}"_fmt(ticks);
+	Console << (passed ? U"PASS" : U"FAIL");
+
+	for (auto& peer : peers)
+	{
+		peer.lockstep.reset();
+		peer.client->disconnect();
+	}
+}
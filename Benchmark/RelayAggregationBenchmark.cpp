@@ -0,0 +1,216 @@
+﻿
+# include <Siv3D.hpp> // OpenSiv3D v0.6.3
+# include "../NetworkSystem.hpp"
+# include "../NetworkRelayAggregator.hpp"
+# include "../NetworkLoopbackTransport.hpp"
+# include "../NetworkLinkSimulator.hpp"
+# include "BenchmarkCommon.hpp"
+
+// 全員が全員に送信する場合と、マスタークライアントで集約する場合の
+// 1 ティックあたりのイベント数とバイト数を比較するベンチマーク
+//
+// すべてのクライアントは 1 つのプロセス内で NetworkLoopbackHub と NetworkLinkSimulator を介して同じルームに参加し、
+// 全員が全員に送信する場合は各クライアントが Vec2 を opRaiseEvent() で、集約する場合は NetworkRelayAggregator<Vec2> で送受信します。
+//
+// 出力 (CSV, 1 行 1 計測, 値はすべて 1 ティックあたりの平均):
+// uplink_events, uplink_bytes     : クライアントからルームへ送信されたイベントの数とバイト数 (NetworkLinkSimulator の送信方向)
+// downlink_events, downlink_bytes : ルームからクライアントへ配信されたイベントの数とバイト数 (NetworkLinkSimulator の受信方向)
+// decode_us                       : 1 クライアントが受信したイベントの復元と処理にかかった時間 (NetworkStatistics)
+// cpu_ms_per_tick                 : 1 ティックあたりのプロセスの CPU 時間 (全クライアントの合計)
+
+namespace
+{
+	/// @brief 状態の送受信に使うイベントコード
+	constexpr uint8 StateEventCode = 1;
+
+	/// @brief 計測を始める前に実行するティックの数
+	constexpr int32 WarmupTicks = 10;
+
+	/// @brief 計測するティックの数
+	constexpr int32 MeasureTicks = 120;
+
+	class BenchmarkClient : public Benchmark::Client
+	{
+	public:
+
+		using Benchmark::Client::Client;
+
+		using SivPhoton::customEventAction;
+
+		// 全員が全員に送信する場合の受信
+		void customEventAction(const int32, const int32, const Blob& eventContent) override
+		{
+			NetworkPacketReader reader{ eventContent };
+			Vec2 state;
+			reader.read(state);
+		}
+	};
+
+	struct Result
+	{
+		double uplinkEvents = 0.0;
+
+		double downlinkEvents = 0.0;
+
+		double uplinkBytes = 0.0;
+
+		double downlinkBytes = 0.0;
+
+		double decodeMicrosec = 0.0;
+
+		double cpuMillisecPerTick = 0.0;
+	};
+
+	/// @brief ルームに参加し、1 ティックごとに全員の状態を送る
+	[[nodiscard]]
+	Optional<Result> Run(const size_t numPlayers, const bool aggregated)
+	{
+		NetworkLoopbackHub hub;
+		Array<std::unique_ptr<BenchmarkClient>> clients;
+		Array<NetworkLinkSimulator*> links;
+
+		for (size_t i = 0; i < numPlayers; ++i)
+		{
+			auto link = std::make_unique<NetworkLinkSimulator>(hub.createTransport(), i);
+			links << link.get();
+			clients << std::make_unique<BenchmarkClient>(std::move(link));
+		}
+
+		const auto updateAll = [&]()
+		{
+			for (auto& client : clients)
+			{
+				client->update();
+			}
+		};
+
+		if (not Benchmark::JoinRoom(clients, U"bench", U"aggregation{}"_fmt(numPlayers), Benchmark::UpdateAndSleep(clients)))
+		{
+			return none;
+		}
+
+		Array<std::unique_ptr<NetworkRelayAggregator<Vec2>>> aggregators;
+
+		if (aggregated)
+		{
+			for (auto& client : clients)
+			{
+				aggregators.push_back(std::make_unique<NetworkRelayAggregator<Vec2>>(*client, StateEventCode));
+			}
+		}
+
+		NetworkPacketWriter writer;
+
+		// どちらの場合も同じ unreliable の Blob のイベントで送る
+		const auto tick = [&]()
+		{
+			for (size_t i = 0; i < clients.size(); ++i)
+			{
+				const Vec2 state = RandomVec2(Scene::Rect());
+
+				if (aggregated)
+				{
+					aggregators[i]->setState(state);
+					aggregators[i]->update();
+				}
+				else
+				{
+					writer.clear();
+					writer.write(state);
+					clients[i]->opRaiseEvent(StateEventCode, writer.getBlob(), { .reliable = false });
+				}
+			}
+
+			updateAll();
+		};
+
+		for (int32 i = 0; i < WarmupTicks; ++i)
+		{
+			tick();
+		}
+
+		const auto sumLinkStats = [&]()
+		{
+			NetworkLinkSimulator::Stats sum;
+
+			for (const auto* link : links)
+			{
+				const auto& stats = link->getStats();
+				sum.outgoing.packets += stats.outgoing.packets;
+				sum.outgoing.bytes += stats.outgoing.bytes;
+				sum.incoming.packets += stats.incoming.packets;
+				sum.incoming.bytes += stats.incoming.bytes;
+			}
+
+			return sum;
+		};
+
+		const NetworkLinkSimulator::Stats start = sumLinkStats();
+
+		for (auto& client : clients)
+		{
+			client->resetStatistics();
+		}
+
+		const Benchmark::CPUTimer timer;
+
+		for (int32 i = 0; i < MeasureTicks; ++i)
+		{
+			tick();
+		}
+
+		const double cpuMillisecPerTick = timer.cpuMillisecPerTick(MeasureTicks);
+		const NetworkLinkSimulator::Stats end = sumLinkStats();
+		double decodeMicrosec = 0.0;
+
+		for (const auto& client : clients)
+		{
+			decodeMicrosec += client->getStatistics().getTotal().total.received.microsec;
+		}
+
+		aggregators.clear();
+
+		for (auto& client : clients)
+		{
+			client->disconnect();
+		}
+
+		Result result;
+		result.uplinkEvents = (static_cast<double>(end.outgoing.packets - start.outgoing.packets) / MeasureTicks);
+		result.downlinkEvents = (static_cast<double>(end.incoming.packets - start.incoming.packets) / MeasureTicks);
+		result.uplinkBytes = (static_cast<double>(end.outgoing.bytes - start.outgoing.bytes) / MeasureTicks);
+		result.downlinkBytes = (static_cast<double>(end.incoming.bytes - start.incoming.bytes) / MeasureTicks);
+		result.decodeMicrosec = (decodeMicrosec / MeasureTicks / numPlayers);
+		result.cpuMillisecPerTick = cpuMillisecPerTick;
+		return result;
+	}
+}
+
+void Main()
+{
+	Console.open();
+	NetworkSystem::SetLogEnabled(false);
+
+	Console << U"mode,players,uplink_events,downlink_events,uplink_bytes,downlink_bytes,decode_us,cpu_ms_per_tick";
+
+	for (const size_t numPlayers : { 2, 4, 8, 16, 32, 64 })
+	{
+		for (const bool aggregated : { false, true })
+		{
+			const StringView mode = (aggregated ? U"aggregated" : U"naive");
+
+			if (const auto result = Run(numPlayers, aggregated))
+			{
+				Console << U"{},{},{:.1f},{:.1f},{:.1f},{:.1f},{:.3f},{:.3f}"_fmt(mode, numPlayers,
+					result->uplinkEvents, result->downlinkEvents, result->uplinkBytes, result->downlinkBytes, result->decodeMicrosec, result->cpuMillisecPerTick);
+			}
+			else
+			{
+				Console << U"{},{},join_failed"_fmt(mode, numPlayers);
+			}
+		}
+	}
+
+	Console << U"Press Enter to exit.";
+	(void)std::getchar();
+}
@@ -0,0 +1,333 @@
+﻿
+# include <Siv3D.hpp> // OpenSiv3D v0.6.3
+# include "../NetworkSystem.hpp"
+# include "../NetworkLoopbackTransport.hpp"
+# include "../NetworkLinkSimulator.hpp"
+# include "BenchmarkCommon.hpp"
+
+// 決まった通信パターン (シナリオ) を実行し、送信から受信側の customEventAction() までの遅延・スループット・CPU 時間・メモリ使用量を計測するベンチマーク
+//
+// すべてのクライアントは 1 つのプロセス内で NetworkLoopbackHub と NetworkLinkSimulator を介して通信するため、
+// Photon サーバやネットワークの状態に左右されずに、最適化の前後を同じ条件で比較できます。
+//
+// シナリオ:
+// players : 16 人が 60 Hz で Vec2 を送り合う (5 秒間)
+// grid    : 1 MB の Grid<Color> を 1 秒ごとに 5 回送る
+// burst   : 1 ティックで reliable の int32 を 1000 個送る
+//
+// 設定は ScenarioBenchmark.ini から読み込みます (無い場合は既定値)。
+//
+// [General]
+// log = false         ; SivPhoton のログを出力するか
+//
+// [Link]              ; 各クライアントの通信路で再現する通信状態 (両方向に適用)
+// latency = 0         ; 片道の遅延 (ミリ秒)
+// jitter = 0          ; 遅延のばらつき (ミリ秒)
+// loss = 0            ; パケットが失われる確率
+// bandwidth = 0       ; 帯域 (キロビット毎秒, 0 の場合は無制限)
+// seed = 0            ; 乱数のシード (クライアントごとに番号を加える)
+//
+// 出力 (CSV, 1 シナリオ 1 行):
+// expected, samples  : すべて届いた場合のイベントの数と、受信したイベントの数
+// p50_ms ... max_ms   : 送信から受信側の customEventAction() までの遅延
+// events_per_s, kbps  : 受信したイベントの数と、直列化後のバイト数 (トランスポートのヘッダを除く) の毎秒の値
+// cpu_ms_per_tick     : 1 ティックあたりのプロセスの CPU 時間 (全クライアントの合計)
+// peak_memory_mb      : それまでのプロセスの最大メモリ使用量
+
+namespace
+{
+	struct Config
+	{
+		bool log = false;
+
+		Benchmark::LinkConfig link;
+	};
+
+	[[nodiscard]]
+	Config LoadConfig(const FilePathView path)
+	{
+		Config config;
+		const INI ini{ path };
+
+		if (ini)
+		{
+			config.log = ParseOr<bool>(ini[U"General.log"], config.log);
+			config.link = Benchmark::LoadLinkConfig(ini);
+		}
+
+		return config;
+	}
+
+	/// @brief 送信時刻を通し番号で記録し、受信時に遅延を求める
+	/// @remark イベントの内容に通し番号を埋め込み、受信側で取り出します。
+	class LatencyRecorder
+	{
+	public:
+
+		/// @brief 送信時刻を記録します。
+		/// @return イベントに埋め込む通し番号
+		[[nodiscard]]
+		uint32 send()
+		{
+			m_sentAt << m_stopwatch.us64();
+			return static_cast<uint32>(m_sentAt.size() - 1);
+		}
+
+		void receive(const uint32 sequence)
+		{
+			if (sequence < m_sentAt.size())
+			{
+				m_latencies << static_cast<uint32>(Min<uint64>((m_stopwatch.us64() - m_sentAt[sequence]), UINT32_MAX));
+			}
+		}
+
+		/// @brief 受信したイベントの遅延 (マイクロ秒)
+		[[nodiscard]]
+		const Array<uint32>& getLatencies() const noexcept
+		{
+			return m_latencies;
+		}
+
+	private:
+
+		Stopwatch m_stopwatch{ StartImmediately::Yes };
+
+		Array<uint64> m_sentAt;
+
+		Array<uint32> m_latencies;
+	};
+
+	[[nodiscard]]
+	Color EncodeSequence(const uint32 sequence)
+	{
+		return Color{ static_cast<uint8>(sequence), static_cast<uint8>(sequence >> 8), static_cast<uint8>(sequence >> 16), static_cast<uint8>(sequence >> 24) };
+	}
+
+	[[nodiscard]]
+	uint32 DecodeSequence(const Color& color)
+	{
+		return (color.r | (color.g << 8) | (color.b << 16) | (static_cast<uint32>(color.a) << 24));
+	}
+
+	/// @brief シナリオで使うイベントを受信するクライアント
+	class ScenarioClient : public Benchmark::Client
+	{
+	public:
+
+		ScenarioClient(std::unique_ptr<NetworkTransport> transport, LatencyRecorder& recorder)
+			: Benchmark::Client{ std::move(transport) }
+			, m_recorder{ recorder } {}
+
+		using SivPhoton::customEventAction;
+
+		void customEventAction(const int32, const int32, const int32 eventContent) override
+		{
+			m_recorder.receive(static_cast<uint32>(eventContent));
+		}
+
+		void customEventAction(const int32, const int32, const Vec2& eventContent) override
+		{
+			m_recorder.receive(static_cast<uint32>(eventContent.x));
+		}
+
+		void customEventAction(const int32, const int32, const Grid<Color>& eventContent) override
+		{
+			if (not eventContent.isEmpty())
+			{
+				m_recorder.receive(DecodeSequence(eventContent[0][0]));
+			}
+		}
+
+	private:
+
+		LatencyRecorder& m_recorder;
+	};
+
+	struct Scenario
+	{
+		String name;
+
+		size_t players = 2;
+
+		double tickRate = 60.0;
+
+		/// @brief 送信を行うティックの数
+		int32 sendTicks = 1;
+
+		/// @brief 送信を終えてから、すべてのイベントが届くのを待つ最大の時間 (秒)
+		double drainSeconds = 10.0;
+
+		/// @brief すべて届いた場合に受信されるイベントの数
+		size_t expected = 0;
+
+		/// @brief 各ティックの送信処理
+		std::function<void(Array<std::unique_ptr<ScenarioClient>>& clients, LatencyRecorder& recorder, int32 tick)> send;
+	};
+
+	/// @brief シナリオを実行して結果を 1 行出力します。
+	void Run(const Scenario& scenario, const Config& config)
+	{
+		NetworkLoopbackHub hub;
+		LatencyRecorder recorder;
+		Array<std::unique_ptr<ScenarioClient>> clients;
+		Array<NetworkLinkSimulator*> links;
+
+		for (size_t i = 0; i < scenario.players; ++i)
+		{
+			auto link = std::make_unique<NetworkLinkSimulator>(hub.createTransport(), (config.link.seed + i));
+
+			if (config.link.condition)
+			{
+				link->setCondition(*config.link.condition);
+			}
+
+			links << link.get();
+			clients << std::make_unique<ScenarioClient>(std::move(link), recorder);
+		}
+
+		const auto updateAll = [&]()
+		{
+			for (auto& client : clients)
+			{
+				client->update();
+			}
+		};
+
+		// 全員が同じルームに参加するまで待つ
+		if (not Benchmark::JoinRoom(clients, U"scenario", scenario.name, Benchmark::UpdateAndSleep(clients)))
+		{
+			Console << U"{},join_failed"_fmt(scenario.name);
+			return;
+		}
+
+		const auto sumReceivedBytes = [&]()
+		{
+			uint64 bytes = 0;
+
+			for (const auto* link : links)
+			{
+				bytes += link->getStats().incoming.bytes;
+			}
+
+			return bytes;
+		};
+
+		const uint64 receivedBytesStart = sumReceivedBytes();
+
+		// 計測
+		const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / scenario.tickRate));
+		const int32 maxTicks = (scenario.sendTicks + static_cast<int32>(scenario.drainSeconds * scenario.tickRate));
+		const Benchmark::CPUTimer timer;
+		int32 ticks = 0;
+
+		for (; ticks < maxTicks; ++ticks)
+		{
+			if (ticks < scenario.sendTicks)
+			{
+				scenario.send(clients, recorder, ticks);
+			}
+			else if (scenario.expected <= recorder.getLatencies().size())
+			{
+				break;
+			}
+
+			updateAll();
+
+			std::this_thread::sleep_until(timer.wallStart() + (period * (ticks + 1)));
+		}
+
+		const double cpuMillisecPerTick = timer.cpuMillisecPerTick(ticks);
+		const double wallSec = timer.wallSeconds();
+
+		const uint64 receivedBytes = (sumReceivedBytes() - receivedBytesStart);
+
+		const Benchmark::LatencySummary latency = Benchmark::SummarizeLatencies(recorder.getLatencies());
+
+		Console << U"{},{},{},{},{:.1f},{:.1f},{:.3f},{:.1f}"_fmt(scenario.name, scenario.players, scenario.expected, latency.toCSV(),
+			(latency.samples / wallSec), (receivedBytes * 8 / 1000.0 / wallSec),
+			cpuMillisecPerTick, Benchmark::PeakMemoryMegabytes());
+
+		for (auto& client : clients)
+		{
+			client->disconnect();
+		}
+	}
+}
+
+void Main()
+{
+	const Config config = LoadConfig(U"ScenarioBenchmark.ini");
+	NetworkSystem::SetLogEnabled(config.log);
+
+	Array<Scenario> scenarios;
+
+	// 16 人が 60 Hz で Vec2 を送り合う
+	{
+		constexpr size_t Players = 16;
+		constexpr int32 Ticks = (60 * 5);
+
+		scenarios << Scenario{
+			.name = U"players",
+			.players = Players,
+			.tickRate = 60.0,
+			.sendTicks = Ticks,
+			.expected = (Players * (Players - 1) * Ticks),
+			.send = [](Array<std::unique_ptr<ScenarioClient>>& clients, LatencyRecorder& recorder, const int32 tick)
+			{
+				for (auto& client : clients)
+				{
+					// x に通し番号を埋め込む
+					client->opRaiseEvent(1, Vec2{ recorder.send(), tick });
+				}
+			} };
+	}
+
+	// 1 MB の Grid<Color> を 1 秒ごとに 5 回送る
+	{
+		constexpr int32 Transfers = 5;
+		constexpr int32 Interval = 60;
+
+		scenarios << Scenario{
+			.name = U"grid",
+			.players = 2,
+			.tickRate = 60.0,
+			.sendTicks = (Interval * (Transfers - 1) + 1),
+			.expected = Transfers,
+			.send = [grid = Grid<Color>(512, 512, Palette::Orange)](Array<std::unique_ptr<ScenarioClient>>& clients, LatencyRecorder& recorder, const int32 tick) mutable
+			{
+				if ((tick % Interval) == 0)
+				{
+					// 先頭の要素に通し番号を埋め込む
+					grid[0][0] = EncodeSequence(recorder.send());
+					clients.front()->opRaiseEvent(2, grid);
+				}
+			} };
+	}
+
+	// 1 ティックで reliable の int32 を 1000 個送る
+	{
+		constexpr int32 Events = 1000;
+
+		scenarios << Scenario{
+			.name = U"burst",
+			.players = 2,
+			.tickRate = 60.0,
+			.sendTicks = 1,
+			.expected = Events,
+			.send = [](Array<std::unique_ptr<ScenarioClient>>& clients, LatencyRecorder& recorder, int32)
+			{
+				for (int32 i = 0; i < Events; ++i)
+				{
+					clients.front()->opRaiseEvent(3, static_cast<int32>(recorder.send()));
+				}
+			} };
+	}
+
+	Console << U"transport: loopback{}"_fmt(config.link.condition ? U" + link simulator" : U"");
+	Console << U"scenario,players,expected,{},events_per_s,kbps,cpu_ms_per_tick,peak_memory_mb"_fmt(Benchmark::LatencySummary::Header);
+
+	for (const auto& scenario : scenarios)
+	{
+		Run(scenario, config);
+	}
+}
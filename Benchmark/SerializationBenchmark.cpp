@@ -0,0 +1,237 @@
+﻿
+# include <Siv3D.hpp> // OpenSiv3D v0.6.3
+# include <atomic>
+# include <cstdlib>
+# include <new>
+# include "../NetworkSystem.hpp"
+# include "../NetworkLoopbackTransport.hpp"
+# include "../NetworkLinkSimulator.hpp"
+
+// opRaiseEvent() で送信できるすべての型について、直列化 (送信) と復元 (受信) のコストを計測するベンチマーク
+//
+// 2 つの SivPhoton を、通信状態を再現しない NetworkLinkSimulator と NetworkLoopbackHub で同じルームに参加させ、
+// 基本型 (int32, double, float, bool, String) と Siv3D の 19 個の型のそれぞれについて、単体・Array・Grid を複数の要素数で送受信します。
+//
+// 出力 (CSV):
+// encode_us  : 1 イベントあたりの opRaiseEvent() の時間 (Photon の直列化とトランスポートへの受け渡し)
+// decode_us  : 1 イベントあたりの受信側の update() の時間 (Photon の復元と Siv3D の型への変換)
+// encode_allocs, decode_allocs : 1 イベントあたりのメモリ確保の回数
+// wire_bytes : 1 イベントあたりの直列化後のバイト数 (NetworkLinkSimulator の統計, トランスポートのヘッダを除く)
+
+namespace
+{
+	std::atomic<uint64> AllocationCount{ 0 };
+
+	constexpr uint8 EventCode = 1;
+
+	/// @brief Array の要素数
+	constexpr std::array<size_t, 3> ArraySizes = { 16, 256, 4096 };
+
+	/// @brief Grid の幅と高さ
+	constexpr std::array<size_t, 3> GridSizes = { 4, 16, 64 };
+
+	/// @brief 1 つの計測で送信するイベントの数の上限
+	constexpr size_t MaxIterations = 4096;
+
+	/// @brief 1 つの計測で送信する要素の合計の目安
+	constexpr size_t ElementBudget = (1 << 16);
+
+	struct BenchClient
+	{
+		std::unique_ptr<SivPhoton> photon;
+
+		/// @brief photon が所有する NetworkLinkSimulator
+		NetworkLinkSimulator* link = nullptr;
+	};
+
+	[[nodiscard]]
+	BenchClient CreateClient(NetworkLoopbackHub& hub)
+	{
+		auto link = std::make_unique<NetworkLinkSimulator>(hub.createTransport());
+		NetworkLinkSimulator* p = link.get();
+		return{ std::make_unique<SivPhoton>(std::move(link)), p };
+	}
+
+	template <class Value>
+	void Send(SivPhoton& photon, const Value& value)
+	{
+		// String は StringView のオーバーロードで送信する
+		if constexpr (std::is_same_v<Value, String>)
+		{
+			photon.opRaiseEvent(EventCode, StringView{ value });
+		}
+		else
+		{
+			photon.opRaiseEvent(EventCode, value);
+		}
+	}
+
+	class SerializationBenchmark
+	{
+	public:
+
+		SerializationBenchmark()
+			: m_sender{ CreateClient(m_hub) }
+			, m_receiver{ CreateClient(m_hub) }
+		{
+			m_sender.photon->connect(U"sender");
+			m_receiver.photon->connect(U"receiver");
+			update();
+
+			m_sender.photon->opCreateRoom(U"serialization", 2);
+			update();
+
+			m_receiver.photon->opJoinRoom(U"serialization");
+
+			for (int32 i = 0; (i < 100) && (not isReady()); ++i)
+			{
+				update();
+			}
+		}
+
+		[[nodiscard]]
+		bool isReady() const
+		{
+			return (m_sender.photon->isInRoom() && m_receiver.photon->isInRoom());
+		}
+
+		template <class Type>
+		void run(StringView typeName, const Type& sample)
+		{
+			measure(typeName, U"scalar", 1, sample);
+
+			for (const size_t n : ArraySizes)
+			{
+				measure(typeName, U"Array", n, Array<Type>(n, sample));
+			}
+
+			for (const size_t n : GridSizes)
+			{
+				measure(typeName, U"Grid", (n * n), Grid<Type>(n, n, sample));
+			}
+		}
+
+	private:
+
+		NetworkLoopbackHub m_hub;
+
+		BenchClient m_sender;
+
+		BenchClient m_receiver;
+
+		void update()
+		{
+			m_sender.photon->update();
+			m_receiver.photon->update();
+		}
+
+		template <class Value>
+		void measure(const StringView typeName, const StringView shape, const size_t elements, const Value& value)
+		{
+			const size_t iterations = Clamp<size_t>((ElementBudget / elements), 16, MaxIterations);
+			const uint64 sentBytes = m_sender.link->getStats().outgoing.bytes;
+			const uint64 receivedPackets = m_receiver.link->getStats().incoming.packets;
+
+			// 直列化
+			const uint64 encodeAllocations = AllocationCount.load(std::memory_order_relaxed);
+			const Stopwatch encodeStopwatch{ StartImmediately::Yes };
+
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				Send(*m_sender.photon, value);
+			}
+
+			const double encodeMicrosec = encodeStopwatch.usF();
+			const uint64 encodeAllocated = (AllocationCount.load(std::memory_order_relaxed) - encodeAllocations);
+
+			// 送信側のキューから受信側のキューへ移す
+			m_sender.photon->update();
+
+			// 復元
+			const uint64 decodeAllocations = AllocationCount.load(std::memory_order_relaxed);
+			const Stopwatch decodeStopwatch{ StartImmediately::Yes };
+
+			for (int32 i = 0; (i < 100) && ((m_receiver.link->getStats().incoming.packets - receivedPackets) < iterations); ++i)
+			{
+				m_receiver.photon->update();
+			}
+
+			const double decodeMicrosec = decodeStopwatch.usF();
+			const uint64 decodeAllocated = (AllocationCount.load(std::memory_order_relaxed) - decodeAllocations);
+
+			const uint64 received = (m_receiver.link->getStats().incoming.packets - receivedPackets);
+			const uint64 wireBytes = (m_sender.link->getStats().outgoing.bytes - sentBytes);
+
+			Console << U"{},{},{},{},{:.3f},{:.3f},{:.1f},{:.1f},{:.1f}{}"_fmt(typeName, shape, elements, iterations,
+				(encodeMicrosec / iterations), (decodeMicrosec / iterations),
+				(static_cast<double>(encodeAllocated) / iterations), (static_cast<double>(decodeAllocated) / iterations),
+				(static_cast<double>(wireBytes) / iterations),
+				((received == iterations) ? U"" : U",incomplete"));
+		}
+	};
+}
+
+void* operator new(const std::size_t size)
+{
+	AllocationCount.fetch_add(1, std::memory_order_relaxed);
+
+	if (void* p = std::malloc(size ? size : 1))
+	{
+		return p;
+	}
+
+	throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+void Main()
+{
+	NetworkSystem::SetLogEnabled(false);
+
+	SerializationBenchmark benchmark;
+
+	if (not benchmark.isReady())
+	{
+		Console << U"ルームに参加できませんでした。";
+		return;
+	}
+
+	Console << U"type,shape,elements,iterations,encode_us,decode_us,encode_allocs,decode_allocs,wire_bytes";
+
+	// 基本型
+	benchmark.run<int32>(U"int32", 123456789);
+	benchmark.run<double>(U"double", 3.14159);
+	benchmark.run<float>(U"float", 2.5f);
+	benchmark.run<bool>(U"bool", true);
+	benchmark.run<String>(U"String", U"SivPhoton");
+
+	// Siv3D の型
+	benchmark.run<ColorF>(U"ColorF", ColorF{ 0.1, 0.2, 0.3, 0.4 });
+	benchmark.run<Color>(U"Color", Color{ 10, 20, 30, 40 });
+	benchmark.run<HSV>(U"HSV", HSV{ 120.0, 0.5, 0.75 });
+	benchmark.run<Point>(U"Point", Point{ 12, 34 });
+	benchmark.run<Vec2>(U"Vec2", Vec2{ 1.5, 2.5 });
+	benchmark.run<Rect>(U"Rect", Rect{ 1, 2, 30, 40 });
+	benchmark.run<Circle>(U"Circle", Circle{ 1.5, 2.5, 10.0 });
+	benchmark.run<Line>(U"Line", Line{ 1.0, 2.0, 30.0, 40.0 });
+	benchmark.run<Triangle>(U"Triangle", Triangle{ 0.0, 0.0, 10.0, 0.0, 0.0, 10.0 });
+	benchmark.run<RectF>(U"RectF", RectF{ 1.5, 2.5, 30.0, 40.0 });
+	benchmark.run<Quad>(U"Quad", Quad{ Vec2{ 0, 0 }, Vec2{ 10, 0 }, Vec2{ 10, 10 }, Vec2{ 0, 10 } });
+	benchmark.run<Ellipse>(U"Ellipse", Ellipse{ 1.5, 2.5, 10.0, 20.0 });
+	benchmark.run<RoundRect>(U"RoundRect", RoundRect{ 1.5, 2.5, 30.0, 40.0, 5.0 });
+	benchmark.run<Vec3>(U"Vec3", Vec3{ 1.0, 2.0, 3.0 });
+	benchmark.run<Vec4>(U"Vec4", Vec4{ 1.0, 2.0, 3.0, 4.0 });
+	benchmark.run<Float2>(U"Float2", Float2{ 1.0f, 2.0f });
+	benchmark.run<Float3>(U"Float3", Float3{ 1.0f, 2.0f, 3.0f });
+	benchmark.run<Float4>(U"Float4", Float4{ 1.0f, 2.0f, 3.0f, 4.0f });
+	benchmark.run<Mat3x2>(U"Mat3x2", Mat3x2::Rotate(1.0));
+}
@@ -1,6 +1,7 @@
 ﻿
 # include <Siv3D.hpp> // OpenSiv3D v0.6.3
 # include "NetworkSystem.hpp"
+# include "NetworkDiagnosticsOverlay.hpp"
 # include "ENCRYPTED_PHOTON_APP_ID.SECRET"
 
 class MyNetwork : public SivPhoton
@@ -135,6 +136,9 @@ void Main()
 
 	const Font font{ 18 };
 
+	// F3 キーで通信の状態を表示する
+	NetworkDiagnosticsOverlay overlay;
+
 	while (System::Update())
 	{
 		font(U"getRoomNameList: {}"_fmt(network.getRoomNameList())).draw(520, 270);
@@ -170,7 +174,7 @@ void Main()
 
 		if (not network.isInRoom())
 		{
-			const Array<String> roomList = network.getRoomNameList();
+			const Array<String>& roomList = network.getRoomNameList();
 
 			for (auto [i, roomName] : Indexed(roomList))
 			{
@@ -192,5 +196,8 @@ void Main()
 		}
 
 		network.update();
+
+		overlay.update(network);
+		overlay.draw();
 	}
 }
@@ -0,0 +1,250 @@
+﻿
+# include "NetworkCapture.hpp"
+
+namespace s3d
+{
+	namespace detail
+	{
+		/// @brief 本体のファイルの先頭の識別子
+		inline constexpr std::array<char, 4> CaptureMagic{ 'S', 'P', 'C', 'P' };
+
+		inline constexpr uint32 CaptureVersion = 1;
+
+		/// @brief 本体のファイルの先頭のヘッダのバイト数 (識別子とバージョン)
+		inline constexpr size_t CaptureFileHeaderSize = (sizeof(CaptureMagic) + sizeof(uint32));
+
+		/// @brief イベントごとのヘッダのバイト数
+		/// @remark 時刻 (int64), プレイヤー ID (int32), 内容のバイト数 (uint32), イベントコード, 向き, 形式, 予約 (各 uint8)
+		inline constexpr size_t CaptureRecordHeaderSize = 20;
+
+		[[nodiscard]]
+		inline FilePath CaptureIndexPath(const FilePathView path)
+		{
+			return (FilePath{ path } + U".idx");
+		}
+
+		template <class Type>
+		inline void WriteValue(Byte*& p, const Type& value) noexcept
+		{
+			std::memcpy(p, &value, sizeof(Type));
+			p += sizeof(Type);
+		}
+
+		template <class Type>
+		[[nodiscard]]
+		inline Type ReadValue(const Byte* p) noexcept
+		{
+			Type value;
+			std::memcpy(&value, p, sizeof(Type));
+			return value;
+		}
+	}
+
+	NetworkCaptureWriter::NetworkCaptureWriter(const FilePathView path)
+		: m_data{ path }
+		, m_index{ detail::CaptureIndexPath(path) }
+	{
+		if (not isOpen())
+		{
+			return;
+		}
+
+		m_data.write(detail::CaptureMagic.data(), detail::CaptureMagic.size());
+		m_data.write(&detail::CaptureVersion, sizeof(detail::CaptureVersion));
+		m_offset = detail::CaptureFileHeaderSize;
+	}
+
+	bool NetworkCaptureWriter::isOpen() const
+	{
+		return (m_data.isOpen() && m_index.isOpen());
+	}
+
+	void NetworkCaptureWriter::write(const NetworkCaptureDirection direction, const int32 playerID, const uint8 eventCode, const NetworkSystem::EventFormat format, const void* data, const size_t size)
+	{
+		if (not isOpen())
+		{
+			return;
+		}
+
+		const int64 timeMicrosec = m_stopwatch.us64();
+
+		// 本体には、ヘッダと内容を 1 回で書き込む
+		m_buffer.resize(detail::CaptureRecordHeaderSize + size);
+		Byte* p = m_buffer.data();
+		detail::WriteValue(p, timeMicrosec);
+		detail::WriteValue(p, playerID);
+		detail::WriteValue(p, static_cast<uint32>(size));
+		detail::WriteValue(p, eventCode);
+		detail::WriteValue(p, FromEnum(direction));
+		detail::WriteValue(p, FromEnum(format));
+		detail::WriteValue(p, uint8{ 0 });
+
+		if (size)
+		{
+			std::memcpy(p, data, size);
+		}
+
+		m_data.write(m_buffer.data(), m_buffer.size());
+
+		// 索引は、本体を書き込んだ後に追記する
+		m_index.write(&timeMicrosec, sizeof(timeMicrosec));
+		m_index.write(&m_offset, sizeof(m_offset));
+
+		m_offset += m_buffer.size();
+		++m_numRecords;
+	}
+
+	size_t NetworkCaptureWriter::num_records() const noexcept
+	{
+		return m_numRecords;
+	}
+
+	void NetworkCaptureWriter::flush()
+	{
+		m_data.flush();
+		m_index.flush();
+	}
+
+	NetworkCaptureReader::NetworkCaptureReader(const FilePathView path)
+	{
+		open(path);
+	}
+
+	bool NetworkCaptureReader::open(const FilePathView path)
+	{
+		close();
+
+		if (not m_dataFile.open(path))
+		{
+			return false;
+		}
+
+		m_data = m_dataFile.mapAll();
+
+		if ((m_data.size < detail::CaptureFileHeaderSize)
+			|| (std::memcmp(m_data.data, detail::CaptureMagic.data(), detail::CaptureMagic.size()) != 0)
+			|| (detail::ReadValue<uint32>(m_data.data + detail::CaptureMagic.size()) != detail::CaptureVersion))
+		{
+			close();
+			return false;
+		}
+
+		// 索引の最後のイベントが本体の末尾と一致する場合のみ、索引を使う
+		bool indexValid = false;
+
+		if (m_indexFile.open(detail::CaptureIndexPath(path)))
+		{
+			const MemoryMappedFileView::MappedMemory index = m_indexFile.mapAll();
+			const size_t numRecords = (index.size / sizeof(IndexEntry));
+
+			if ((index.size % sizeof(IndexEntry)) == 0)
+			{
+				if (numRecords == 0)
+				{
+					indexValid = (m_data.size == detail::CaptureFileHeaderSize);
+				}
+				else
+				{
+					const IndexEntry* entries = reinterpret_cast<const IndexEntry*>(index.data);
+					const uint64 lastOffset = entries[numRecords - 1].offset;
+
+					if ((lastOffset + detail::CaptureRecordHeaderSize) <= m_data.size)
+					{
+						const uint32 lastSize = detail::ReadValue<uint32>(m_data.data + lastOffset + sizeof(int64) + sizeof(int32));
+						indexValid = ((lastOffset + detail::CaptureRecordHeaderSize + lastSize) == m_data.size);
+					}
+				}
+			}
+
+			if (indexValid)
+			{
+				m_index = reinterpret_cast<const IndexEntry*>(index.data);
+				m_numRecords = numRecords;
+			}
+			else
+			{
+				m_indexFile.close();
+			}
+		}
+
+		if (not indexValid)
+		{
+			rebuildIndex();
+		}
+
+		return true;
+	}
+
+	void NetworkCaptureReader::close()
+	{
+		m_indexFile.close();
+		m_dataFile.close();
+		m_data = {};
+		m_index = nullptr;
+		m_numRecords = 0;
+		m_rebuiltIndex.clear();
+	}
+
+	bool NetworkCaptureReader::isOpen() const noexcept
+	{
+		return (m_data.data != nullptr);
+	}
+
+	size_t NetworkCaptureReader::size() const noexcept
+	{
+		return m_numRecords;
+	}
+
+	int64 NetworkCaptureReader::durationMicrosec() const noexcept
+	{
+		return (m_numRecords ? m_index[m_numRecords - 1].timeMicrosec : 0);
+	}
+
+	NetworkCaptureRecord NetworkCaptureReader::operator [](const size_t index) const
+	{
+		assert(index < m_numRecords);
+
+		const Byte* p = (m_data.data + m_index[index].offset);
+
+		NetworkCaptureRecord record;
+		record.timeMicrosec = detail::ReadValue<int64>(p);
+		record.playerID = detail::ReadValue<int32>(p + 8);
+		record.size = detail::ReadValue<uint32>(p + 12);
+		record.eventCode = detail::ReadValue<uint8>(p + 16);
+		record.direction = ToEnum<NetworkCaptureDirection>(detail::ReadValue<uint8>(p + 17));
+		record.format = ToEnum<NetworkSystem::EventFormat>(detail::ReadValue<uint8>(p + 18));
+		record.data = (p + detail::CaptureRecordHeaderSize);
+		return record;
+	}
+
+	size_t NetworkCaptureReader::lowerBound(const int64 timeMicrosec) const
+	{
+		const IndexEntry* it = std::lower_bound(m_index, (m_index + m_numRecords), timeMicrosec,
+			[](const IndexEntry& entry, const int64 t) { return (entry.timeMicrosec < t); });
+
+		return static_cast<size_t>(it - m_index);
+	}
+
+	void NetworkCaptureReader::rebuildIndex()
+	{
+		uint64 offset = detail::CaptureFileHeaderSize;
+
+		// 途中で切れているイベントは含めない
+		while ((offset + detail::CaptureRecordHeaderSize) <= m_data.size)
+		{
+			const Byte* p = (m_data.data + offset);
+			const uint64 recordSize = (detail::CaptureRecordHeaderSize + detail::ReadValue<uint32>(p + 12));
+
+			if (m_data.size < (offset + recordSize))
+			{
+				break;
+			}
+
+			m_rebuiltIndex.push_back(IndexEntry{ detail::ReadValue<int64>(p), offset });
+			offset += recordSize;
+		}
+
+		m_index = m_rebuiltIndex.data();
+		m_numRecords = m_rebuiltIndex.size();
+	}
+}
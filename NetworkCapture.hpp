@@ -0,0 +1,166 @@
+﻿
+# pragma once
+# include <Siv3D.hpp>
+# include "NetworkSystem.hpp"
+
+namespace s3d
+{
+	/// @brief キャプチャしたイベントの向き
+	enum class NetworkCaptureDirection : uint8
+	{
+		/// @brief 受信したイベント
+		Inbound,
+
+		/// @brief 送信したイベント
+		Outbound,
+	};
+
+	/// @brief キャプチャした 1 つのイベント
+	struct NetworkCaptureRecord
+	{
+		/// @brief キャプチャを開始してからの時間 (マイクロ秒)
+		int64 timeMicrosec = 0;
+
+		/// @brief 送信者のプレイヤー ID (自分が送信したイベントは自分の ID, ルームに参加していない場合は -1)
+		int32 playerID = 0;
+
+		/// @brief イベントコード
+		uint8 eventCode = 0;
+
+		NetworkCaptureDirection direction = NetworkCaptureDirection::Inbound;
+
+		/// @brief 内容の形式
+		NetworkSystem::EventFormat format = NetworkSystem::EventFormat::Blob;
+
+		/// @brief 直列化された内容の先頭 (NetworkCaptureReader が開いている間のみ有効)
+		const Byte* data = nullptr;
+
+		/// @brief 直列化された内容のバイト数
+		size_t size = 0;
+	};
+
+	/// @brief 送受信したイベントを、追記のみのバイナリファイルに書き込むクラスです。
+	/// @remark 本体のファイルには 20 バイトのヘッダと直列化された内容を、イベントごとに追記します。
+	/// 同時に、パスの末尾に ".idx" を付けたファイルに、イベントごとの時刻と本体での位置 (16 バイト) を追記します。
+	/// 内容は Photon またはトランスポートで送受信されたバイト列そのもので、NetworkReplay で再生すると受信時と同じ customEventAction() に復元されます。
+	class NetworkCaptureWriter
+	{
+	public:
+
+		/// @brief ファイルを作成して、キャプチャを開始します。
+		/// @param path 本体のファイルのパス
+		explicit NetworkCaptureWriter(FilePathView path);
+
+		/// @brief ファイルを作成できたかを返します。
+		/// @return 作成できた場合 true, それ以外の場合は false
+		[[nodiscard]]
+		bool isOpen() const;
+
+		/// @brief イベントを 1 つ書き込みます。
+		/// @param direction イベントの向き
+		/// @param playerID 送信者のプレイヤー ID
+		/// @param eventCode イベントコード
+		/// @param format 内容の形式
+		/// @param data 直列化された内容の先頭
+		/// @param size 直列化された内容のバイト数
+		void write(NetworkCaptureDirection direction, int32 playerID, uint8 eventCode, NetworkSystem::EventFormat format, const void* data, size_t size);
+
+		/// @brief 書き込んだイベントの数を返します。
+		/// @return イベントの数
+		[[nodiscard]]
+		size_t num_records() const noexcept;
+
+		/// @brief バッファされている内容をファイルに書き出します。
+		void flush();
+
+	private:
+
+		BinaryWriter m_data;
+
+		BinaryWriter m_index;
+
+		Stopwatch m_stopwatch{ StartImmediately::Yes };
+
+		/// @brief 次に書き込む位置
+		uint64 m_offset = 0;
+
+		size_t m_numRecords = 0;
+
+		/// @brief ヘッダと内容をまとめて書き込むためのバッファ
+		Array<Byte> m_buffer;
+	};
+
+	/// @brief NetworkCaptureWriter で書き込んだファイルを読み込むクラスです。
+	/// @remark 本体と索引のファイルをメモリマップし、イベントの内容をコピーせずに参照します。
+	/// 索引のファイルが無い、または本体より短い場合 (書き込み中に終了した場合など) は、本体を先頭から読んで索引を作り直します。
+	class NetworkCaptureReader
+	{
+	public:
+
+		NetworkCaptureReader() = default;
+
+		/// @brief ファイルを開きます。
+		/// @param path 本体のファイルのパス
+		explicit NetworkCaptureReader(FilePathView path);
+
+		/// @brief ファイルを開きます。
+		/// @param path 本体のファイルのパス
+		/// @return 開けた場合 true, それ以外の場合は false
+		bool open(FilePathView path);
+
+		/// @brief ファイルを閉じます。
+		void close();
+
+		/// @brief ファイルを開いているかを返します。
+		/// @return 開いている場合 true, それ以外の場合は false
+		[[nodiscard]]
+		bool isOpen() const noexcept;
+
+		/// @brief イベントの数を返します。
+		/// @return イベントの数
+		[[nodiscard]]
+		size_t size() const noexcept;
+
+		/// @brief 最後のイベントの時刻を返します。
+		/// @return 時刻 (マイクロ秒), イベントが無い場合は 0
+		[[nodiscard]]
+		int64 durationMicrosec() const noexcept;
+
+		/// @brief イベントを返します。
+		/// @param index イベントの番号
+		/// @return イベント
+		[[nodiscard]]
+		NetworkCaptureRecord operator [](size_t index) const;
+
+		/// @brief 指定した時刻以降の最初のイベントの番号を返します。
+		/// @param timeMicrosec 時刻 (マイクロ秒)
+		/// @return イベントの番号, 該当するイベントが無い場合は size()
+		/// @remark 索引を二分探索します。
+		[[nodiscard]]
+		size_t lowerBound(int64 timeMicrosec) const;
+
+	private:
+
+		struct IndexEntry
+		{
+			int64 timeMicrosec;
+
+			uint64 offset;
+		};
+
+		MemoryMappedFileView m_dataFile;
+
+		MemoryMappedFileView m_indexFile;
+
+		MemoryMappedFileView::MappedMemory m_data;
+
+		const IndexEntry* m_index = nullptr;
+
+		size_t m_numRecords = 0;
+
+		/// @brief 索引を作り直した場合の索引
+		Array<IndexEntry> m_rebuiltIndex;
+
+		void rebuildIndex();
+	};
+}
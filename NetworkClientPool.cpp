@@ -0,0 +1,117 @@
+﻿
+# include "NetworkClientPool.hpp"
+
+namespace s3d
+{
+	NetworkClientPool::NetworkClientPool(size_t numThreads, const double tickRate)
+	{
+		if (numThreads == 0)
+		{
+			numThreads = Max<size_t>(std::thread::hardware_concurrency(), 1);
+		}
+
+		for (size_t i = 0; i < numThreads; ++i)
+		{
+			m_runners.push_back(std::make_unique<NetworkHeadlessRunner>(tickRate));
+		}
+	}
+
+	NetworkClientPool::~NetworkClientPool()
+	{
+		stop();
+
+		// SivPhoton の破棄はカスタム型の登録を解除することがあるため、スレッドの終了後に行う
+		m_clients.clear();
+	}
+
+	SivPhoton& NetworkClientPool::add(std::unique_ptr<SivPhoton> client, std::function<void(SivPhoton& client, double deltaTime)> onTick)
+	{
+		assert(client);
+		assert(not isRunning());
+
+		SivPhoton& network = *client;
+		NetworkHeadlessRunner& runner = *m_runners[m_clients.size() % m_runners.size()];
+
+		if (onTick)
+		{
+			runner.add(network, [&network, onTick = std::move(onTick)](const double deltaTime) { onTick(network, deltaTime); });
+		}
+		else
+		{
+			runner.add(network);
+		}
+
+		m_clients.push_back(std::move(client));
+		return network;
+	}
+
+	void NetworkClientPool::start()
+	{
+		if (isRunning())
+		{
+			return;
+		}
+
+		for (auto& runner : m_runners)
+		{
+			m_threads.emplace_back([&runner = *runner]() { runner.run(); });
+		}
+
+		// run() は開始時に停止の要求を取り消すため、すべてのスレッドが run() に入るまで待つ。
+		// そうしないと、直後の stop() が取り消されて join() が終わらなくなる
+		for (const auto& runner : m_runners)
+		{
+			while (not runner->isRunning())
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	void NetworkClientPool::stop()
+	{
+		if (not isRunning())
+		{
+			return;
+		}
+
+		for (auto& runner : m_runners)
+		{
+			runner->stop();
+		}
+
+		for (auto& thread : m_threads)
+		{
+			thread.join();
+		}
+
+		m_threads.clear();
+	}
+
+	bool NetworkClientPool::isRunning() const noexcept
+	{
+		return (not m_threads.isEmpty());
+	}
+
+	size_t NetworkClientPool::num_clients() const noexcept
+	{
+		return m_clients.size();
+	}
+
+	size_t NetworkClientPool::num_threads() const noexcept
+	{
+		return m_runners.size();
+	}
+
+	Array<NetworkHeadlessRunner::Stats> NetworkClientPool::getStats() const
+	{
+		Array<NetworkHeadlessRunner::Stats> stats;
+
+		for (const auto& runner : m_runners)
+		{
+			stats << runner->getStats();
+		}
+
+		return stats;
+	}
+}
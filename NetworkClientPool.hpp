@@ -0,0 +1,89 @@
+﻿
+# pragma once
+# include <thread>
+# include <Siv3D.hpp>
+# include "NetworkSystem.hpp"
+# include "NetworkHeadlessRunner.hpp"
+
+namespace s3d
+{
+	/// @brief 1 つのプロセスで多数の SivPhoton を動かすためのクラスです。
+	/// @remark SivPhoton はワーカースレッドに均等に割り当てられ、それぞれのスレッドで一定の間隔で更新されます。
+	/// 1 つの SivPhoton は常に同じスレッドから更新されるため、SivPhoton を継承したクラスの仮想関数もそのスレッドから呼ばれます。
+	class NetworkClientPool
+	{
+	public:
+
+		/// @brief NetworkClientPool を作成します。
+		/// @param numThreads ワーカースレッドの数, 0 の場合はハードウェアスレッドの数
+		/// @param tickRate 1 秒あたりの更新回数
+		explicit NetworkClientPool(size_t numThreads = 0, double tickRate = 30.0);
+
+		~NetworkClientPool();
+
+		NetworkClientPool(const NetworkClientPool&) = delete;
+
+		NetworkClientPool& operator =(const NetworkClientPool&) = delete;
+
+		/// @brief SivPhoton を追加します。
+		/// @param client SivPhoton
+		/// @param onTick SivPhoton::update() の後にワーカースレッドから呼び出される関数
+		/// @return 追加した SivPhoton
+		/// @remark start() の前に呼んでください。
+		SivPhoton& add(std::unique_ptr<SivPhoton> client, std::function<void(SivPhoton& client, double deltaTime)> onTick = {});
+
+		/// @brief SivPhoton を作成して追加します。
+		/// @tparam ClientType SivPhoton を継承したクラス
+		/// @param args コンストラクタの引数
+		/// @return 追加した SivPhoton
+		/// @remark start() の前に呼んでください。
+		template <class ClientType, class... Args>
+		ClientType& emplace(Args&&... args);
+
+		/// @brief ワーカースレッドを開始します。
+		void start();
+
+		/// @brief ワーカースレッドを停止し、終了を待ちます。
+		void stop();
+
+		/// @brief ワーカースレッドが動いているかを返します。
+		/// @return 動いている場合 true, それ以外の場合は false
+		[[nodiscard]]
+		bool isRunning() const noexcept;
+
+		/// @brief SivPhoton の数を返します。
+		/// @return SivPhoton の数
+		[[nodiscard]]
+		size_t num_clients() const noexcept;
+
+		/// @brief ワーカースレッドの数を返します。
+		/// @return ワーカースレッドの数
+		[[nodiscard]]
+		size_t num_threads() const noexcept;
+
+		/// @brief ワーカースレッドごとの更新の統計を返します。
+		/// @return 更新の統計の一覧
+		/// @remark stop() の後に呼んでください。
+		[[nodiscard]]
+		Array<NetworkHeadlessRunner::Stats> getStats() const;
+
+	private:
+
+		Array<std::unique_ptr<SivPhoton>> m_clients;
+
+		Array<std::unique_ptr<NetworkHeadlessRunner>> m_runners;
+
+		Array<std::thread> m_threads;
+	};
+}
+
+namespace s3d
+{
+	template <class ClientType, class... Args>
+	ClientType& NetworkClientPool::emplace(Args&&... args)
+	{
+		static_assert(std::is_base_of_v<SivPhoton, ClientType>);
+
+		return static_cast<ClientType&>(add(std::make_unique<ClientType>(std::forward<Args>(args)...)));
+	}
+}
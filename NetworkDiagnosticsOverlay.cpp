@@ -0,0 +1,236 @@
+﻿
+# include "NetworkDiagnosticsOverlay.hpp"
+
+namespace s3d
+{
+	namespace detail
+	{
+		inline constexpr double OverlayWidth = 340.0;
+
+		inline constexpr double OverlayPadding = 8.0;
+
+		inline constexpr double GraphHeight = 44.0;
+
+		inline constexpr double GraphSpacing = 6.0;
+
+		/// @brief 文字の表示を更新する間隔 (秒)
+		inline constexpr double TextIntervalSeconds = 0.25;
+
+		/// @brief 文字で表示するイベントコードの最大数
+		inline constexpr size_t MaxEventCodes = 6;
+
+		/// @brief 累計の増加分 (統計が消去された場合は現在の値)
+		[[nodiscard]]
+		inline uint64 Increase(const uint64 current, const uint64 last) noexcept
+		{
+			return ((last <= current) ? (current - last) : current);
+		}
+	}
+
+	void NetworkDiagnosticsOverlay::History::push(const double value)
+	{
+		values[head] = value;
+		head = ((head + 1) % values.size());
+	}
+
+	void NetworkDiagnosticsOverlay::History::clear()
+	{
+		values.fill(0.0);
+		head = 0;
+	}
+
+	double NetworkDiagnosticsOverlay::History::latest() const
+	{
+		return values[(head + values.size() - 1) % values.size()];
+	}
+
+	double NetworkDiagnosticsOverlay::History::max() const
+	{
+		return *std::max_element(values.begin(), values.end());
+	}
+
+	NetworkDiagnosticsOverlay::NetworkDiagnosticsOverlay(const Input& toggleKey, const size_t historyLength)
+		: m_toggleKey{ toggleKey }
+		, m_font{ 14 }
+	{
+		for (History* history : { &m_roundTripTime, &m_receivedKbps, &m_sentKbps, &m_dispatchMillisec, &m_backlog })
+		{
+			history->values.resize(Max<size_t>(historyLength, 2), 0.0);
+		}
+	}
+
+	void NetworkDiagnosticsOverlay::update(const SivPhoton& network)
+	{
+		if (m_toggleKey.down())
+		{
+			setVisible(not m_visible);
+		}
+
+		if (not m_visible)
+		{
+			return;
+		}
+
+		const NetworkStatistics& statistics = network.getStatistics();
+		const NetworkStatistics::Report total = statistics.getTotal();
+		const NetworkStatistics::ConnectionStats& connection = statistics.getConnectionStats();
+
+		if (m_hasBaseline)
+		{
+			const double deltaTime = Max(Scene::DeltaTime(), 1e-6);
+			const uint64 receivedBytes = detail::Increase(total.total.received.bytes, m_lastReceivedBytes);
+			const uint64 sentBytes = detail::Increase(total.total.sent.bytes, m_lastSentBytes);
+			const double receivedMicrosec = ((m_lastReceivedMicrosec <= total.total.received.microsec) ? (total.total.received.microsec - m_lastReceivedMicrosec) : total.total.received.microsec);
+
+			m_roundTripTime.push(connection.roundTripTimeMillisec);
+			m_receivedKbps.push(receivedBytes * 8 / 1000.0 / deltaTime);
+			m_sentKbps.push(sentBytes * 8 / 1000.0 / deltaTime);
+			m_dispatchMillisec.push(receivedMicrosec / 1000.0);
+			m_backlog.push(static_cast<double>(connection.queuedIncoming + connection.queuedOutgoing));
+		}
+
+		m_hasBaseline = true;
+		m_lastReceivedBytes = total.total.received.bytes;
+		m_lastSentBytes = total.total.sent.bytes;
+		m_lastReceivedMicrosec = total.total.received.microsec;
+
+		// 文字は読める速さで更新すれば十分なので、一定の間隔でまとめて作る
+		m_textCooldown -= Scene::DeltaTime();
+
+		if (0.0 < m_textCooldown)
+		{
+			return;
+		}
+
+		m_textCooldown = detail::TextIntervalSeconds;
+
+		m_graphLabels[0] = MakeGraphLabel(U"RTT ms", m_roundTripTime);
+		m_graphLabels[1] = MakeGraphLabel(U"kbps in/out", m_receivedKbps, &m_sentKbps);
+		m_graphLabels[2] = MakeGraphLabel(U"dispatch ms/frame", m_dispatchMillisec);
+		m_graphLabels[3] = MakeGraphLabel(U"queue", m_backlog);
+
+		const NetworkStatistics::Report window = statistics.getWindow();
+		const double seconds = Max(window.seconds, 1e-3);
+
+		Array<std::pair<uint8, NetworkStatistics::Entry>> codes(window.eventCodes.begin(), window.eventCodes.end());
+		codes.sort_by([](const auto& a, const auto& b)
+			{
+				return ((b.second.sent.bytes + b.second.received.bytes) < (a.second.sent.bytes + a.second.received.bytes));
+			});
+
+		m_text = U"Network [{}]\n"_fmt(m_toggleKey.name());
+		m_text += U"RTT {} ms (±{})  queue in {} / out {}\n"_fmt(connection.roundTripTimeMillisec, connection.roundTripTimeVarianceMillisec, connection.queuedIncoming, connection.queuedOutgoing);
+		m_text += U"last {:.0f} s: resent {}  lost {}\n"_fmt(seconds, window.resent, window.lost);
+		m_text += U"code  sent/s  recv/s  kbps  decode us\n";
+
+		for (const auto& [eventCode, entry] : codes.take(detail::MaxEventCodes))
+		{
+			m_text += U"{:>4}  {:>6.1f}  {:>6.1f}  {:>5.1f}  {:>6.1f}\n"_fmt(eventCode,
+				(entry.sent.messages / seconds), (entry.received.messages / seconds),
+				((entry.sent.bytes + entry.received.bytes) * 8 / 1000.0 / seconds), entry.received.averageMicrosec());
+		}
+
+		// draw() で毎フレーム文字を配置し直さないように、大きさを記録しておく
+		m_textSize = m_font(m_text).region().size;
+	}
+
+	void NetworkDiagnosticsOverlay::draw(const Vec2& pos) const
+	{
+		if (not m_visible)
+		{
+			return;
+		}
+
+		const double graphWidth = (detail::OverlayWidth - detail::OverlayPadding * 2);
+		const Vec2 textPos{ (pos.x + detail::OverlayPadding), (pos.y + detail::OverlayPadding + (detail::GraphHeight + detail::GraphSpacing) * 4) };
+
+		RectF{ pos, detail::OverlayWidth, (textPos.y + m_textSize.y - pos.y + detail::OverlayPadding) }.draw(ColorF{ 0.0, 0.75 });
+
+		RectF graph{ pos.movedBy(detail::OverlayPadding, detail::OverlayPadding), graphWidth, detail::GraphHeight };
+		drawGraph(graph, m_graphLabels[0], m_roundTripTime, Palette::Orange);
+
+		graph.y += (detail::GraphHeight + detail::GraphSpacing);
+		drawGraph(graph, m_graphLabels[1], m_receivedKbps, Palette::Skyblue, &m_sentKbps, Palette::Lightgreen);
+
+		graph.y += (detail::GraphHeight + detail::GraphSpacing);
+		drawGraph(graph, m_graphLabels[2], m_dispatchMillisec, Palette::Yellow);
+
+		graph.y += (detail::GraphHeight + detail::GraphSpacing);
+		drawGraph(graph, m_graphLabels[3], m_backlog, Palette::Hotpink);
+
+		m_font(m_text).draw(textPos, Palette::White);
+	}
+
+	void NetworkDiagnosticsOverlay::setVisible(const bool visible)
+	{
+		if (visible && (not m_visible))
+		{
+			for (History* history : { &m_roundTripTime, &m_receivedKbps, &m_sentKbps, &m_dispatchMillisec, &m_backlog })
+			{
+				history->clear();
+			}
+
+			m_hasBaseline = false;
+			m_textCooldown = 0.0;
+			m_text.clear();
+			m_textSize.set(0.0, 0.0);
+
+			for (String& label : m_graphLabels)
+			{
+				label.clear();
+			}
+		}
+
+		m_visible = visible;
+	}
+
+	bool NetworkDiagnosticsOverlay::isVisible() const noexcept
+	{
+		return m_visible;
+	}
+
+	void NetworkDiagnosticsOverlay::drawGraph(const RectF& rect, const String& label, const History& history, const ColorF& color, const History* second, const ColorF& secondColor) const
+	{
+		rect.draw(ColorF{ 1.0, 0.08 });
+
+		const double scale = GetGraphScale(history, second);
+
+		const auto drawLine = [&](const History& h, const ColorF& c)
+		{
+			const size_t n = h.values.size();
+			m_line.resize(n);
+
+			for (size_t i = 0; i < n; ++i)
+			{
+				const double value = h.values[(h.head + i) % n];
+				m_line[i].set((rect.x + rect.w * i / (n - 1)), (rect.bottomY() - rect.h * Min((value / scale), 1.0)));
+			}
+
+			m_line.draw(1.5, c);
+		};
+
+		drawLine(history, color);
+
+		if (second)
+		{
+			drawLine(*second, secondColor);
+		}
+
+		m_font(label).draw(rect.pos.movedBy(4, 0), ColorF{ 1.0, 0.85 });
+	}
+
+	double NetworkDiagnosticsOverlay::GetGraphScale(const History& history, const History* second)
+	{
+		// 縦軸は表示している範囲の最大値に合わせる
+		return Max(Max(history.max(), (second ? second->max() : 0.0)), 1e-6);
+	}
+
+	String NetworkDiagnosticsOverlay::MakeGraphLabel(const StringView label, const History& history, const History* second)
+	{
+		const double scale = GetGraphScale(history, second);
+
+		return (second
+			? U"{} {:.1f} / {:.1f}  (max {:.1f})"_fmt(label, history.latest(), second->latest(), scale)
+			: U"{} {:.1f}  (max {:.1f})"_fmt(label, history.latest(), scale));
+	}
+}
@@ -0,0 +1,111 @@
+﻿
+# pragma once
+# include <Siv3D.hpp>
+# include "NetworkSystem.hpp"
+
+namespace s3d
+{
+	/// @brief SivPhoton の通信の状態を、グラフと文字で画面に重ねて表示するクラスです。
+	/// @remark 往復の遅延・受信と送信の kbps・1 フレームあたりの受信処理の時間・キューの長さをグラフで、イベントコードごとの毎秒のイベント数を文字で表示します。
+	/// ホットキーで表示を切り替えます。表示していない間は統計を読み取らず、何も描画しません。
+	/// 毎フレーム、SivPhoton::update() の後に update() を、シーンの描画の最後に draw() を呼んでください。
+	class NetworkDiagnosticsOverlay
+	{
+	public:
+
+		/// @brief NetworkDiagnosticsOverlay を作成します。
+		/// @param toggleKey 表示を切り替えるキー
+		/// @param historyLength グラフに表示するフレーム数
+		explicit NetworkDiagnosticsOverlay(const Input& toggleKey = KeyF3, size_t historyLength = 240);
+
+		/// @brief ホットキーを確認し、表示している場合は統計を記録します。
+		/// @param network 統計を読み取る SivPhoton
+		void update(const SivPhoton& network);
+
+		/// @brief 表示している場合、パネルを描画します。
+		/// @param pos パネルの左上の位置
+		/// @remark 文字は update() で一定の間隔で作成したものを描画し、図形は Siv3D の 2D 描画でまとめて送られます。
+		void draw(const Vec2& pos = Vec2{ 10, 10 }) const;
+
+		/// @brief 表示するかを設定します。
+		/// @param visible 表示する場合 true, それ以外の場合は false
+		/// @remark 表示を始めるとグラフの履歴を消去します。
+		void setVisible(bool visible);
+
+		/// @brief 表示しているかを返します。
+		/// @return 表示している場合 true, それ以外の場合は false
+		[[nodiscard]]
+		bool isVisible() const noexcept;
+
+	private:
+
+		/// @brief グラフ 1 本分の履歴
+		struct History
+		{
+			/// @brief 古い順の値 (リングバッファ)
+			Array<double> values;
+
+			/// @brief 次に書き込む位置
+			size_t head = 0;
+
+			void push(double value);
+
+			void clear();
+
+			[[nodiscard]]
+			double latest() const;
+
+			[[nodiscard]]
+			double max() const;
+		};
+
+		Input m_toggleKey;
+
+		bool m_visible = false;
+
+		/// @brief 前のフレームの累計を記録済みの場合 true
+		bool m_hasBaseline = false;
+
+		uint64 m_lastSentBytes = 0;
+
+		uint64 m_lastReceivedBytes = 0;
+
+		double m_lastReceivedMicrosec = 0.0;
+
+		History m_roundTripTime;
+
+		History m_receivedKbps;
+
+		History m_sentKbps;
+
+		History m_dispatchMillisec;
+
+		History m_backlog;
+
+		/// @brief 文字の表示を次に更新するまでの時間 (秒)
+		double m_textCooldown = 0.0;
+
+		String m_text;
+
+		/// @brief m_text を描画したときの大きさ
+		SizeF m_textSize{ 0.0, 0.0 };
+
+		/// @brief グラフに重ねる文字 (上から順)
+		std::array<String, 4> m_graphLabels;
+
+		Font m_font;
+
+		/// @brief draw() で使い回す頂点のバッファ
+		mutable LineString m_line;
+
+		void drawGraph(const RectF& rect, const String& label, const History& history, const ColorF& color, const History* second = nullptr, const ColorF& secondColor = Palette::White) const;
+
+		/// @brief グラフの縦軸の最大値
+		[[nodiscard]]
+		static double GetGraphScale(const History& history, const History* second);
+
+		/// @brief グラフに重ねる文字を作成します。
+		[[nodiscard]]
+		static String MakeGraphLabel(StringView label, const History& history, const History* second = nullptr);
+	};
+}
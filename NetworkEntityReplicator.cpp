@@ -0,0 +1,724 @@
+﻿
+# include "NetworkEntityReplicator.hpp"
+
+namespace s3d
+{
+	namespace detail
+	{
+		inline constexpr size_t InvalidIndex = static_cast<size_t>(-1);
+	}
+
+	NetworkEntityReplicator::NetworkEntityReplicator(SivPhoton& network, const uint8 eventCode)
+		: m_network{ network }
+		, m_eventCode{ eventCode }
+	{
+		m_network.setEventHandler(m_eventCode, [this](const int32 playerID, const Blob& data) { onReceive(playerID, data); });
+	}
+
+	NetworkEntityReplicator::~NetworkEntityReplicator()
+	{
+		m_network.removeEventHandler(m_eventCode);
+	}
+
+	NetworkEntityID NetworkEntityReplicator::spawn(const uint16 kind)
+	{
+		const auto localPlayerID = m_network.localPlayerID();
+
+		if (not localPlayerID)
+		{
+			return NetworkSystem::InvalidEntityID;
+		}
+
+		uint16 serial = 0;
+
+		if (m_freeSerials)
+		{
+			serial = m_freeSerials.back();
+			m_freeSerials.pop_back();
+		}
+		else if (m_nextSerial != 0)
+		{
+			serial = m_nextSerial++;
+		}
+		else
+		{
+			// 通し番号を使い切った
+			return NetworkSystem::InvalidEntityID;
+		}
+
+		const NetworkEntityID id = NetworkSystem::MakeEntityID(*localPlayerID, serial);
+		addEntity(id, *localPlayerID, kind);
+		m_pendingSpawns << id;
+
+		return id;
+	}
+
+	bool NetworkEntityReplicator::despawn(const NetworkEntityID id)
+	{
+		if (not isMine(id))
+		{
+			return false;
+		}
+
+		if (const auto it = std::find(m_pendingSpawns.begin(), m_pendingSpawns.end(), id);
+			it != m_pendingSpawns.end())
+		{
+			// まだ誰にも通知していないので、通し番号をすぐに再利用できる
+			m_pendingSpawns.erase(it);
+			removeEntity(id);
+			releaseSerial(id);
+		}
+		else
+		{
+			// 通し番号は削除を送信するまで再利用しない
+			m_pendingDespawns << id;
+			removeEntity(id);
+		}
+
+		return true;
+	}
+
+	bool NetworkEntityReplicator::transferOwnership(const NetworkEntityID id, const int32 newOwnerID)
+	{
+		const auto index = indexOf(id);
+
+		if ((not index) || (not m_network.localPlayerID()))
+		{
+			return false;
+		}
+
+		if ((m_ownerIDs[*index] != *m_network.localPlayerID()) && (not m_network.isMasterClient()))
+		{
+			return false;
+		}
+
+		if (m_ownerIDs[*index] == newOwnerID)
+		{
+			return true;
+		}
+
+		changeOwner(*index, newOwnerID);
+		m_pendingOwnerships.emplace_back(id, newOwnerID);
+		return true;
+	}
+
+	void NetworkEntityReplicator::setDespawnOnOwnerLeave(const bool despawn) noexcept
+	{
+		m_despawnOnOwnerLeave = despawn;
+	}
+
+	void NetworkEntityReplicator::setSpawnCallback(std::function<void(NetworkEntityID id, int32 ownerID, uint16 kind)> callback)
+	{
+		m_spawnCallback = std::move(callback);
+	}
+
+	void NetworkEntityReplicator::setDespawnCallback(std::function<void(NetworkEntityID id)> callback)
+	{
+		m_despawnCallback = std::move(callback);
+	}
+
+	void NetworkEntityReplicator::setOwnershipCallback(std::function<void(NetworkEntityID id, int32 oldOwnerID, int32 newOwnerID)> callback)
+	{
+		m_ownershipCallback = std::move(callback);
+	}
+
+	bool NetworkEntityReplicator::contains(const NetworkEntityID id) const
+	{
+		return m_indices.contains(id);
+	}
+
+	Optional<size_t> NetworkEntityReplicator::indexOf(const NetworkEntityID id) const
+	{
+		if (const auto it = m_indices.find(id); it != m_indices.end())
+		{
+			return it->second;
+		}
+
+		return none;
+	}
+
+	Optional<int32> NetworkEntityReplicator::getOwnerID(const NetworkEntityID id) const
+	{
+		if (const auto index = indexOf(id))
+		{
+			return m_ownerIDs[*index];
+		}
+
+		return none;
+	}
+
+	bool NetworkEntityReplicator::isMine(const NetworkEntityID id) const
+	{
+		const auto ownerID = getOwnerID(id);
+
+		return (ownerID && (ownerID == m_network.localPlayerID()));
+	}
+
+	const Array<NetworkEntityID>& NetworkEntityReplicator::ids() const noexcept
+	{
+		return m_ids;
+	}
+
+	const Array<int32>& NetworkEntityReplicator::ownerIDs() const noexcept
+	{
+		return m_ownerIDs;
+	}
+
+	const Array<uint16>& NetworkEntityReplicator::kinds() const noexcept
+	{
+		return m_kinds;
+	}
+
+	size_t NetworkEntityReplicator::num_entities() const noexcept
+	{
+		return m_ids.size();
+	}
+
+	size_t NetworkEntityReplicator::getStateSize() const noexcept
+	{
+		size_t size = sizeof(NetworkEntityID);
+
+		for (const auto& column : m_columns)
+		{
+			size += column.stride;
+		}
+
+		return size;
+	}
+
+	void NetworkEntityReplicator::update()
+	{
+		if (not m_network.isInRoom())
+		{
+			return;
+		}
+
+		NetworkPacketWriter writer;
+
+		// 削除を先に送る (作成と同じ ID が削除より先に届くことを防ぐ)
+		if (m_pendingDespawns)
+		{
+			writer.write(MessageType::Despawn);
+			writer.write(m_pendingDespawns);
+
+			m_network.opRaiseEvent(m_eventCode, writer.getBlob());
+
+			// 削除を送信したので、自分が作成したエンティティの通し番号を再利用できる
+			for (const auto id : m_pendingDespawns)
+			{
+				releaseSerial(id);
+			}
+
+			m_pendingDespawns.clear();
+		}
+
+		if (m_pendingSpawns)
+		{
+			m_indexBuffer.clear();
+
+			for (const auto id : m_pendingSpawns)
+			{
+				m_indexBuffer << m_indices.at(id);
+			}
+
+			writeEntities(writer, MessageType::Spawn, m_indexBuffer);
+			m_network.opRaiseEvent(m_eventCode, writer.getBlob());
+			m_pendingSpawns.clear();
+		}
+
+		if (m_pendingOwnerships)
+		{
+			writer.clear();
+			writer.write(MessageType::Ownership);
+			writer.write(static_cast<uint32>(m_pendingOwnerships.size()));
+
+			for (const auto& [id, ownerID] : m_pendingOwnerships)
+			{
+				writer.write(id);
+				writer.write(ownerID);
+			}
+
+			m_network.opRaiseEvent(m_eventCode, writer.getBlob());
+			m_pendingOwnerships.clear();
+		}
+	}
+
+	void NetworkEntityReplicator::sendState(const NetworkSystem::EventOption& option)
+	{
+		const auto localPlayerID = m_network.localPlayerID();
+
+		if (not localPlayerID)
+		{
+			return;
+		}
+
+		m_indexBuffer.clear();
+
+		for (size_t i = 0; i < m_ownerIDs.size(); ++i)
+		{
+			if (m_ownerIDs[i] == *localPlayerID)
+			{
+				m_indexBuffer << i;
+			}
+		}
+
+		if (not m_indexBuffer)
+		{
+			return;
+		}
+
+		NetworkPacketWriter writer;
+		writeEntities(writer, MessageType::State, m_indexBuffer);
+		m_network.opRaiseEvent(m_eventCode, writer.getBlob(), option);
+	}
+
+	void NetworkEntityReplicator::sendState(const Array<NetworkEntityID>& ids, const NetworkSystem::EventOption& option)
+	{
+		const auto localPlayerID = m_network.localPlayerID();
+
+		if (not localPlayerID)
+		{
+			return;
+		}
+
+		m_indexBuffer.clear();
+
+		for (const auto id : ids)
+		{
+			if (const auto index = indexOf(id);
+				index && (m_ownerIDs[*index] == *localPlayerID))
+			{
+				m_indexBuffer << *index;
+			}
+		}
+
+		if (not m_indexBuffer)
+		{
+			return;
+		}
+
+		NetworkPacketWriter writer;
+		writeEntities(writer, MessageType::State, m_indexBuffer);
+		m_network.opRaiseEvent(m_eventCode, writer.getBlob(), option);
+	}
+
+	void NetworkEntityReplicator::onPlayerJoined(const int32 playerID)
+	{
+		const auto localPlayerID = m_network.localPlayerID();
+
+		if ((not localPlayerID) || (playerID == *localPlayerID))
+		{
+			return;
+		}
+
+		m_indexBuffer.clear();
+
+		for (size_t i = 0; i < m_ownerIDs.size(); ++i)
+		{
+			if (m_ownerIDs[i] == *localPlayerID)
+			{
+				m_indexBuffer << i;
+			}
+		}
+
+		if (not m_indexBuffer)
+		{
+			return;
+		}
+
+		NetworkPacketWriter writer;
+		writeEntities(writer, MessageType::Spawn, m_indexBuffer);
+
+		NetworkSystem::EventOption option;
+		option.targetPlayers = { playerID };
+		m_network.opRaiseEvent(m_eventCode, writer.getBlob(), option);
+	}
+
+	void NetworkEntityReplicator::onPlayerLeft(const int32 playerID)
+	{
+		Array<NetworkEntityID> orphans;
+
+		for (size_t i = 0; i < m_ownerIDs.size(); ++i)
+		{
+			if (m_ownerIDs[i] == playerID)
+			{
+				orphans << m_ids[i];
+			}
+		}
+
+		if (m_despawnOnOwnerLeave)
+		{
+			for (const auto id : orphans)
+			{
+				removeEntity(id);
+				releaseSerial(id);
+
+				if (m_despawnCallback)
+				{
+					m_despawnCallback(id);
+				}
+			}
+
+			return;
+		}
+
+		// 全員が同じ結果になるので、通知せずにマスタークライアントへ所有権を移す
+		if (const auto masterClientID = m_network.getMasterClientID())
+		{
+			for (const auto id : orphans)
+			{
+				changeOwner(m_indices.at(id), *masterClientID);
+			}
+		}
+	}
+
+	void NetworkEntityReplicator::clear()
+	{
+		m_ids.clear();
+		m_ownerIDs.clear();
+		m_kinds.clear();
+		m_indices.clear();
+
+		for (auto& column : m_columns)
+		{
+			column.bytes.clear();
+		}
+
+		m_nextSerial = 1;
+		m_freeSerials.clear();
+		m_pendingSpawns.clear();
+		m_pendingDespawns.clear();
+		m_pendingOwnerships.clear();
+	}
+
+	size_t NetworkEntityReplicator::addEntity(const NetworkEntityID id, const int32 ownerID, const uint16 kind)
+	{
+		const size_t index = m_ids.size();
+
+		m_ids << id;
+		m_ownerIDs << ownerID;
+		m_kinds << kind;
+
+		for (auto& column : m_columns)
+		{
+			column.bytes.resize(column.bytes.size() + column.stride);
+		}
+
+		m_indices.emplace(id, index);
+		return index;
+	}
+
+	void NetworkEntityReplicator::removeEntity(const NetworkEntityID id)
+	{
+		const auto it = m_indices.find(id);
+
+		if (it == m_indices.end())
+		{
+			return;
+		}
+
+		const size_t index = it->second;
+		const size_t last = (m_ids.size() - 1);
+		m_indices.erase(it);
+
+		// 末尾の要素を削除した位置に移動する
+		if (index != last)
+		{
+			m_ids[index] = m_ids[last];
+			m_ownerIDs[index] = m_ownerIDs[last];
+			m_kinds[index] = m_kinds[last];
+
+			for (auto& column : m_columns)
+			{
+				std::memcpy((column.bytes.data() + index * column.stride), (column.bytes.data() + last * column.stride), column.stride);
+			}
+
+			m_indices[m_ids[index]] = index;
+		}
+
+		m_ids.pop_back();
+		m_ownerIDs.pop_back();
+		m_kinds.pop_back();
+
+		for (auto& column : m_columns)
+		{
+			column.bytes.resize(column.bytes.size() - column.stride);
+		}
+	}
+
+	void NetworkEntityReplicator::releaseSerial(const NetworkEntityID id)
+	{
+		if (NetworkSystem::GetEntityCreatorID(id) == m_network.localPlayerID())
+		{
+			m_freeSerials << NetworkSystem::GetEntitySerial(id);
+		}
+	}
+
+	void NetworkEntityReplicator::changeOwner(const size_t index, const int32 newOwnerID)
+	{
+		const int32 oldOwnerID = m_ownerIDs[index];
+
+		if (oldOwnerID == newOwnerID)
+		{
+			return;
+		}
+
+		m_ownerIDs[index] = newOwnerID;
+
+		if (m_ownershipCallback)
+		{
+			m_ownershipCallback(m_ids[index], oldOwnerID, newOwnerID);
+		}
+	}
+
+	void NetworkEntityReplicator::writeEntities(NetworkPacketWriter& writer, const MessageType type, const Array<size_t>& indices) const
+	{
+		const uint32 count = static_cast<uint32>(indices.size());
+
+		writer.clear();
+		writer.write(type);
+		writer.write(count);
+
+		for (const auto index : indices)
+		{
+			writer.write(m_ids[index]);
+		}
+
+		if (type == MessageType::Spawn)
+		{
+			for (const auto index : indices)
+			{
+				writer.write(m_ownerIDs[index]);
+			}
+
+			for (const auto index : indices)
+			{
+				writer.write(m_kinds[index]);
+			}
+		}
+
+		// すべてのエンティティを格納順に送る場合のみ、配列をそのまま書き込める
+		bool inStorageOrder = (count == m_ids.size());
+
+		for (size_t i = 0; inStorageOrder && (i < count); ++i)
+		{
+			inStorageOrder = (indices[i] == i);
+		}
+
+		writer.write(static_cast<uint8>(m_columns.size()));
+
+		for (const auto& column : m_columns)
+		{
+			writer.write(static_cast<uint32>(column.stride));
+
+			if (inStorageOrder)
+			{
+				writer.writeBytes(column.bytes.data(), column.bytes.size());
+				continue;
+			}
+
+			for (const auto index : indices)
+			{
+				writer.writeBytes((column.bytes.data() + index * column.stride), column.stride);
+			}
+		}
+	}
+
+	void NetworkEntityReplicator::onReceive(const int32 playerID, const Blob& data)
+	{
+		NetworkPacketReader reader{ data };
+		MessageType type;
+
+		if (not reader.read(type))
+		{
+			return;
+		}
+
+		switch (type)
+		{
+		case MessageType::Spawn:
+		case MessageType::State:
+			receiveEntities(playerID, type, reader);
+			return;
+		case MessageType::Despawn:
+			receiveDespawn(playerID, reader);
+			return;
+		case MessageType::Ownership:
+			receiveOwnership(playerID, reader);
+			return;
+		default:
+			return;
+		}
+	}
+
+	void NetworkEntityReplicator::receiveEntities(const int32 playerID, const MessageType type, NetworkPacketReader& reader)
+	{
+		uint32 count = 0;
+
+		if ((not reader.read(count)) || (reader.remaining() < (count * sizeof(NetworkEntityID))))
+		{
+			return;
+		}
+
+		const Byte* ids = reader.current();
+		reader.skip(count * sizeof(NetworkEntityID));
+
+		const Byte* ownerIDs = nullptr;
+		const Byte* kinds = nullptr;
+
+		if (type == MessageType::Spawn)
+		{
+			ownerIDs = reader.current();
+
+			if (not reader.skip(count * sizeof(int32)))
+			{
+				return;
+			}
+
+			kinds = reader.current();
+
+			if (not reader.skip(count * sizeof(uint16)))
+			{
+				return;
+			}
+		}
+
+		uint8 numColumns = 0;
+
+		if ((not reader.read(numColumns)) || (numColumns != m_columns.size()))
+		{
+			return;
+		}
+
+		Array<NetworkEntityID> spawned;
+		m_indexBuffer.resize(count);
+
+		for (uint32 i = 0; i < count; ++i)
+		{
+			NetworkEntityID id;
+			std::memcpy(&id, (ids + i * sizeof(NetworkEntityID)), sizeof(NetworkEntityID));
+
+			const auto index = indexOf(id);
+
+			if (type == MessageType::State)
+			{
+				// 所有者以外からの状態は無視する
+				m_indexBuffer[i] = ((index && (m_ownerIDs[*index] == playerID)) ? *index : detail::InvalidIndex);
+				continue;
+			}
+
+			int32 ownerID;
+			uint16 kind;
+			std::memcpy(&ownerID, (ownerIDs + i * sizeof(int32)), sizeof(int32));
+			std::memcpy(&kind, (kinds + i * sizeof(uint16)), sizeof(uint16));
+
+			if (ownerID != playerID)
+			{
+				m_indexBuffer[i] = detail::InvalidIndex;
+			}
+			else if (index)
+			{
+				m_indexBuffer[i] = *index;
+			}
+			else
+			{
+				m_indexBuffer[i] = addEntity(id, ownerID, kind);
+				spawned << id;
+			}
+		}
+
+		for (auto& column : m_columns)
+		{
+			uint32 stride = 0;
+
+			if ((not reader.read(stride)) || (stride != column.stride))
+			{
+				break;
+			}
+
+			const Byte* src = reader.current();
+
+			if (not reader.skip(count * column.stride))
+			{
+				break;
+			}
+
+			for (uint32 i = 0; i < count; ++i)
+			{
+				if (const size_t index = m_indexBuffer[i]; index != detail::InvalidIndex)
+				{
+					std::memcpy((column.bytes.data() + index * column.stride), (src + i * column.stride), column.stride);
+				}
+			}
+		}
+
+		if (m_spawnCallback)
+		{
+			for (const auto id : spawned)
+			{
+				const size_t index = m_indices.at(id);
+				m_spawnCallback(id, m_ownerIDs[index], m_kinds[index]);
+			}
+		}
+	}
+
+	void NetworkEntityReplicator::receiveDespawn(const int32 playerID, NetworkPacketReader& reader)
+	{
+		Array<NetworkEntityID> ids;
+
+		if (not reader.read(ids))
+		{
+			return;
+		}
+
+		for (const auto id : ids)
+		{
+			const auto index = indexOf(id);
+
+			if ((not index) || (not hasAuthority(playerID, *index)))
+			{
+				continue;
+			}
+
+			removeEntity(id);
+			releaseSerial(id);
+
+			if (m_despawnCallback)
+			{
+				m_despawnCallback(id);
+			}
+		}
+	}
+
+	void NetworkEntityReplicator::receiveOwnership(const int32 playerID, NetworkPacketReader& reader)
+	{
+		uint32 count = 0;
+
+		if (not reader.read(count))
+		{
+			return;
+		}
+
+		for (uint32 i = 0; i < count; ++i)
+		{
+			NetworkEntityID id;
+			int32 newOwnerID;
+
+			if ((not reader.read(id)) || (not reader.read(newOwnerID)))
+			{
+				return;
+			}
+
+			if (const auto index = indexOf(id);
+				index && hasAuthority(playerID, *index))
+			{
+				changeOwner(*index, newOwnerID);
+			}
+		}
+	}
+
+	bool NetworkEntityReplicator::hasAuthority(const int32 playerID, const size_t index) const
+	{
+		return ((m_ownerIDs[index] == playerID) || (m_network.getMasterClientID() == playerID));
+	}
+}
@@ -0,0 +1,341 @@
+﻿
+# pragma once
+# include <Siv3D.hpp>
+# include "NetworkSystem.hpp"
+# include "NetworkPacket.hpp"
+
+namespace s3d
+{
+	/// @brief ネットワークで同期されるエンティティの ID
+	/// @remark 上位 16 ビットが作成したプレイヤーの ID, 下位 16 ビットがプレイヤーごとの通し番号です。
+	using NetworkEntityID = uint32;
+
+	namespace NetworkSystem
+	{
+		/// @brief 無効なエンティティ ID
+		inline constexpr NetworkEntityID InvalidEntityID = 0;
+
+		/// @brief エンティティ ID を作成します。
+		/// @param creatorID エンティティを作成したプレイヤーの ID
+		/// @param serial プレイヤーごとの通し番号
+		/// @return エンティティ ID
+		[[nodiscard]]
+		inline constexpr NetworkEntityID MakeEntityID(const int32 creatorID, const uint16 serial) noexcept
+		{
+			return ((static_cast<uint32>(creatorID) << 16) | serial);
+		}
+
+		/// @brief エンティティを作成したプレイヤーの ID を返します。
+		/// @param id エンティティ ID
+		/// @return エンティティを作成したプレイヤーの ID
+		[[nodiscard]]
+		inline constexpr int32 GetEntityCreatorID(const NetworkEntityID id) noexcept
+		{
+			return static_cast<int32>(id >> 16);
+		}
+
+		/// @brief エンティティのプレイヤーごとの通し番号を返します。
+		/// @param id エンティティ ID
+		/// @return プレイヤーごとの通し番号
+		[[nodiscard]]
+		inline constexpr uint16 GetEntitySerial(const NetworkEntityID id) noexcept
+		{
+			return static_cast<uint16>(id & 0xFFFF);
+		}
+	}
+
+	/// @brief エンティティの作成・削除・所有権と状態をルーム内で同期するクラスです。
+	/// @remark コンポーネントの状態はコンポーネントごとの連続した配列 (SoA) で保持され、
+	/// 複数のエンティティの状態を 1 つのイベントでまとめて送信します。
+	class NetworkEntityReplicator
+	{
+	public:
+
+		/// @brief NetworkEntityReplicator を作成します。
+		/// @param network 送受信に使う SivPhoton
+		/// @param eventCode 同期に使うイベントコード
+		/// @remark eventCode は network.setEventHandler() で登録されます。
+		NetworkEntityReplicator(SivPhoton& network, uint8 eventCode);
+
+		~NetworkEntityReplicator();
+
+		NetworkEntityReplicator(const NetworkEntityReplicator&) = delete;
+
+		NetworkEntityReplicator& operator =(const NetworkEntityReplicator&) = delete;
+
+		/// @brief 同期するコンポーネントを追加します。
+		/// @tparam Component トリビアルコピー可能なコンポーネントの型
+		/// @return コンポーネントのインデックス
+		/// @remark ルーム内のすべてのプレイヤーで同じ順番に追加する必要があります。
+		template <class Component, std::enable_if_t<std::is_trivially_copyable_v<Component>>* = nullptr>
+		size_t addComponent();
+
+		/// @brief 自分が所有するエンティティを作成します。
+		/// @param kind エンティティの種類 (アプリケーションで意味を持たせる値)
+		/// @return 作成したエンティティの ID, ルームに参加していない場合は NetworkSystem::InvalidEntityID
+		/// @remark 他のプレイヤーへの通知は次の update() でまとめて送信されます。
+		NetworkEntityID spawn(uint16 kind = 0);
+
+		/// @brief 自分が所有するエンティティを削除します。
+		/// @param id エンティティ ID
+		/// @return 削除した場合 true, それ以外の場合は false
+		/// @remark 他のプレイヤーへの通知は次の update() でまとめて送信されます。
+		bool despawn(NetworkEntityID id);
+
+		/// @brief 自分が所有するエンティティの所有権を他のプレイヤーに譲渡します。
+		/// @param id エンティティ ID
+		/// @param newOwnerID 新しい所有者のプレイヤー ID
+		/// @return 譲渡した場合 true, それ以外の場合は false
+		/// @remark マスタークライアントは他のプレイヤーが所有するエンティティも譲渡できます。
+		bool transferOwnership(NetworkEntityID id, int32 newOwnerID);
+
+		/// @brief 所有者が退室したエンティティを削除するかを設定します。
+		/// @param despawn 削除する場合 true, マスタークライアントに所有権を移す場合 false
+		void setDespawnOnOwnerLeave(bool despawn) noexcept;
+
+		/// @brief 他のプレイヤーがエンティティを作成した際に呼び出される関数を設定します。
+		/// @param callback 呼び出される関数
+		void setSpawnCallback(std::function<void(NetworkEntityID id, int32 ownerID, uint16 kind)> callback);
+
+		/// @brief 他のプレイヤーによってエンティティが削除された際に呼び出される関数を設定します。
+		/// @param callback 呼び出される関数
+		void setDespawnCallback(std::function<void(NetworkEntityID id)> callback);
+
+		/// @brief エンティティの所有者が変わった際に呼び出される関数を設定します。
+		/// @param callback 呼び出される関数
+		void setOwnershipCallback(std::function<void(NetworkEntityID id, int32 oldOwnerID, int32 newOwnerID)> callback);
+
+		/// @brief エンティティが存在するかを返します。
+		/// @param id エンティティ ID
+		/// @return 存在する場合 true, それ以外の場合は false
+		[[nodiscard]]
+		bool contains(NetworkEntityID id) const;
+
+		/// @brief エンティティの配列上のインデックスを返します。
+		/// @param id エンティティ ID
+		/// @return インデックス, 存在しない場合は none
+		/// @remark インデックスはエンティティの削除によって変わります。
+		[[nodiscard]]
+		Optional<size_t> indexOf(NetworkEntityID id) const;
+
+		/// @brief エンティティの所有者のプレイヤー ID を返します。
+		/// @param id エンティティ ID
+		/// @return 所有者のプレイヤー ID, 存在しない場合は none
+		[[nodiscard]]
+		Optional<int32> getOwnerID(NetworkEntityID id) const;
+
+		/// @brief エンティティを自分が所有しているかを返します。
+		/// @param id エンティティ ID
+		/// @return 自分が所有している場合 true, それ以外の場合は false
+		[[nodiscard]]
+		bool isMine(NetworkEntityID id) const;
+
+		/// @brief エンティティのコンポーネントを返します。
+		/// @tparam Component コンポーネントの型
+		/// @param component コンポーネントのインデックス
+		/// @param id エンティティ ID
+		/// @return コンポーネントの参照
+		template <class Component>
+		[[nodiscard]]
+		Component& get(size_t component, NetworkEntityID id);
+
+		/// @brief エンティティのコンポーネントを返します。
+		/// @tparam Component コンポーネントの型
+		/// @param component コンポーネントのインデックス
+		/// @param id エンティティ ID
+		/// @return コンポーネントの参照
+		template <class Component>
+		[[nodiscard]]
+		const Component& get(size_t component, NetworkEntityID id) const;
+
+		/// @brief コンポーネントの配列の先頭ポインタを返します。
+		/// @tparam Component コンポーネントの型
+		/// @param component コンポーネントのインデックス
+		/// @return コンポーネントの配列の先頭ポインタ
+		/// @remark 配列の並びは ids() と同じです。
+		template <class Component>
+		[[nodiscard]]
+		Component* data(size_t component);
+
+		/// @brief コンポーネントの配列の先頭ポインタを返します。
+		/// @tparam Component コンポーネントの型
+		/// @param component コンポーネントのインデックス
+		/// @return コンポーネントの配列の先頭ポインタ
+		/// @remark 配列の並びは ids() と同じです。
+		template <class Component>
+		[[nodiscard]]
+		const Component* data(size_t component) const;
+
+		/// @brief すべてのエンティティの ID を返します。
+		/// @return エンティティの ID の配列
+		[[nodiscard]]
+		const Array<NetworkEntityID>& ids() const noexcept;
+
+		/// @brief すべてのエンティティの所有者を返します。
+		/// @return 所有者のプレイヤー ID の配列
+		[[nodiscard]]
+		const Array<int32>& ownerIDs() const noexcept;
+
+		/// @brief すべてのエンティティの種類を返します。
+		/// @return エンティティの種類の配列
+		[[nodiscard]]
+		const Array<uint16>& kinds() const noexcept;
+
+		/// @brief エンティティの数を返します。
+		/// @return エンティティの数
+		[[nodiscard]]
+		size_t num_entities() const noexcept;
+
+		/// @brief 1 エンティティあたりの状態の送信に使うバイト数を返します。
+		/// @return 1 エンティティあたりのバイト数
+		/// @remark NetworkReplicationScheduler に渡す大きさの目安になります。
+		[[nodiscard]]
+		size_t getStateSize() const noexcept;
+
+		/// @brief 溜まっている作成・削除・所有権の変更をまとめて送信します。
+		/// @remark SivPhoton::update() と同じ頻度で呼んでください。
+		void update();
+
+		/// @brief 自分が所有するすべてのエンティティの状態を 1 つのイベントで送信します。
+		/// @param option 送信オプション
+		void sendState(const NetworkSystem::EventOption& option = { .reliable = false });
+
+		/// @brief 指定したエンティティの状態を 1 つのイベントで送信します。
+		/// @param ids 送信するエンティティの ID (自分が所有していないものは無視されます)
+		/// @param option 送信オプション
+		void sendState(const Array<NetworkEntityID>& ids, const NetworkSystem::EventOption& option = { .reliable = false });
+
+		/// @brief プレイヤーがルームに参加したことを通知します。
+		/// @param playerID 参加したプレイヤーの ID
+		/// @remark SivPhoton::joinRoomEventAction() から呼んでください。自分が所有するエンティティをそのプレイヤーに送信します。
+		void onPlayerJoined(int32 playerID);
+
+		/// @brief プレイヤーがルームから退室したことを通知します。
+		/// @param playerID 退室したプレイヤーの ID
+		/// @remark SivPhoton::leaveRoomEventAction() から呼んでください。
+		void onPlayerLeft(int32 playerID);
+
+		/// @brief すべてのエンティティを消去します。
+		/// @remark ルームから退室した際に呼んでください。
+		void clear();
+
+	private:
+
+		enum class MessageType : uint8
+		{
+			Spawn,
+
+			Despawn,
+
+			State,
+
+			Ownership,
+		};
+
+		struct Column
+		{
+			size_t stride = 0;
+
+			Array<uint8> bytes;
+		};
+
+		SivPhoton& m_network;
+
+		uint8 m_eventCode = 0;
+
+		Array<NetworkEntityID> m_ids;
+
+		Array<int32> m_ownerIDs;
+
+		Array<uint16> m_kinds;
+
+		Array<Column> m_columns;
+
+		HashTable<NetworkEntityID, size_t> m_indices;
+
+		uint16 m_nextSerial = 1;
+
+		/// @brief 再利用できる通し番号 (自分が削除したものは、削除を送信した後に追加される)
+		Array<uint16> m_freeSerials;
+
+		Array<NetworkEntityID> m_pendingSpawns;
+
+		Array<NetworkEntityID> m_pendingDespawns;
+
+		Array<std::pair<NetworkEntityID, int32>> m_pendingOwnerships;
+
+		Array<size_t> m_indexBuffer;
+
+		bool m_despawnOnOwnerLeave = false;
+
+		std::function<void(NetworkEntityID, int32, uint16)> m_spawnCallback;
+
+		std::function<void(NetworkEntityID)> m_despawnCallback;
+
+		std::function<void(NetworkEntityID, int32, int32)> m_ownershipCallback;
+
+		size_t addEntity(NetworkEntityID id, int32 ownerID, uint16 kind);
+
+		void removeEntity(NetworkEntityID id);
+
+		/// @brief 自分が作成したエンティティの通し番号を、再利用できるようにします。
+		void releaseSerial(NetworkEntityID id);
+
+		void changeOwner(size_t index, int32 newOwnerID);
+
+		void writeEntities(NetworkPacketWriter& writer, MessageType type, const Array<size_t>& indices) const;
+
+		void onReceive(int32 playerID, const Blob& data);
+
+		void receiveEntities(int32 playerID, MessageType type, NetworkPacketReader& reader);
+
+		void receiveDespawn(int32 playerID, NetworkPacketReader& reader);
+
+		void receiveOwnership(int32 playerID, NetworkPacketReader& reader);
+
+		[[nodiscard]]
+		bool hasAuthority(int32 playerID, size_t index) const;
+	};
+}
+
+namespace s3d
+{
+	template <class Component, std::enable_if_t<std::is_trivially_copyable_v<Component>>*>
+	size_t NetworkEntityReplicator::addComponent()
+	{
+		Column column;
+		column.stride = sizeof(Component);
+		column.bytes.resize(m_ids.size() * sizeof(Component));
+
+		m_columns << std::move(column);
+		return (m_columns.size() - 1);
+	}
+
+	template <class Component>
+	Component& NetworkEntityReplicator::get(const size_t component, const NetworkEntityID id)
+	{
+		return data<Component>(component)[m_indices.at(id)];
+	}
+
+	template <class Component>
+	const Component& NetworkEntityReplicator::get(const size_t component, const NetworkEntityID id) const
+	{
+		return data<Component>(component)[m_indices.at(id)];
+	}
+
+	template <class Component>
+	Component* NetworkEntityReplicator::data(const size_t component)
+	{
+		assert(m_columns[component].stride == sizeof(Component));
+
+		return reinterpret_cast<Component*>(m_columns[component].bytes.data());
+	}
+
+	template <class Component>
+	const Component* NetworkEntityReplicator::data(const size_t component) const
+	{
+		assert(m_columns[component].stride == sizeof(Component));
+
+		return reinterpret_cast<const Component*>(m_columns[component].bytes.data());
+	}
+}
@@ -0,0 +1,131 @@
+﻿
+# include "NetworkHeadlessRunner.hpp"
+# include <chrono>
+# include <thread>
+
+namespace s3d
+{
+	NetworkHeadlessRunner::NetworkHeadlessRunner(const double tickRate)
+		: m_tickRate{ tickRate }
+	{
+		assert(0.0 < tickRate);
+	}
+
+	void NetworkHeadlessRunner::add(SivPhoton& network, std::function<void(double deltaTime)> onTick)
+	{
+		m_clients.push_back({ &network, std::move(onTick) });
+	}
+
+	void NetworkHeadlessRunner::remove(const SivPhoton& network)
+	{
+		if (m_ticking)
+		{
+			// 走査中は要素を詰めずに印だけ付け、tick() の終わりに取り除く
+			for (auto& client : m_clients)
+			{
+				if (client.network == &network)
+				{
+					client.network = nullptr;
+				}
+			}
+
+			return;
+		}
+
+		m_clients.remove_if([&](const Client& client) { return (client.network == &network); });
+	}
+
+	size_t NetworkHeadlessRunner::num_clients() const noexcept
+	{
+		return m_clients.count_if([](const Client& client) { return (client.network != nullptr); });
+	}
+
+	double NetworkHeadlessRunner::getTickRate() const noexcept
+	{
+		return m_tickRate;
+	}
+
+	void NetworkHeadlessRunner::tick()
+	{
+		const auto start = std::chrono::steady_clock::now();
+		const double deltaTime = (1.0 / m_tickRate);
+
+		// onTick の中で add() されても参照が無効にならないように添字で回す
+		m_ticking = true;
+
+		for (size_t i = 0; i < m_clients.size(); ++i)
+		{
+			if (m_clients[i].network)
+			{
+				m_clients[i].network->update();
+			}
+
+			// update() の中から remove() されている場合がある
+			if (m_clients[i].network && m_clients[i].onTick)
+			{
+				m_clients[i].onTick(deltaTime);
+			}
+		}
+
+		m_ticking = false;
+		m_clients.remove_if([](const Client& client) { return (client.network == nullptr); });
+
+		const double elapsedMillisec = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		++m_stats.ticks;
+		m_stats.averageTickMillisec += ((elapsedMillisec - m_stats.averageTickMillisec) / m_stats.ticks);
+		m_stats.maxTickMillisec = Max(m_stats.maxTickMillisec, elapsedMillisec);
+	}
+
+	void NetworkHeadlessRunner::run(const std::function<bool()>& keepRunning)
+	{
+		using Clock = std::chrono::steady_clock;
+
+		const auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / m_tickRate));
+		auto next = Clock::now();
+
+		// 以前の run() の外で呼ばれた stop() は無視する
+		m_stopRequested.store(false);
+		m_running.store(true);
+
+		while (not m_stopRequested.load())
+		{
+			tick();
+
+			if (keepRunning && (not keepRunning()))
+			{
+				break;
+			}
+
+			next += period;
+			const auto now = Clock::now();
+
+			if (next < now)
+			{
+				// 間に合わなかった分は取り戻さずに、現在の時刻から数え直す
+				++m_stats.overruns;
+				next = now;
+				continue;
+			}
+
+			std::this_thread::sleep_until(next);
+		}
+
+		m_running.store(false);
+	}
+
+	void NetworkHeadlessRunner::stop() noexcept
+	{
+		m_stopRequested.store(true);
+	}
+
+	bool NetworkHeadlessRunner::isRunning() const noexcept
+	{
+		return m_running.load();
+	}
+
+	const NetworkHeadlessRunner::Stats& NetworkHeadlessRunner::getStats() const noexcept
+	{
+		return m_stats;
+	}
+}
@@ -0,0 +1,105 @@
+﻿
+# pragma once
+# include <atomic>
+# include <Siv3D.hpp>
+# include "NetworkSystem.hpp"
+
+namespace s3d
+{
+	/// @brief System::Update() によるメインループを使わずに、SivPhoton を一定の間隔で更新するクラスです。
+	/// @remark 権威を持つマスタークライアントやボットを、描画をせずに動かすためのものです。
+	/// 1 つのスレッドで多数の SivPhoton を更新できます。SIVPHOTON_HEADLESS を定義してビルドすると、ログは Print ではなく標準エラー出力に出力されます。
+	/// SivPhoton は Siv3D に依存するため、プログラムは通常の Siv3D アプリケーション (Main()) として起動します。ウィンドウを作らない実行形態を提供するものではありません。
+	class NetworkHeadlessRunner
+	{
+	public:
+
+		/// @brief 更新の統計
+		struct Stats
+		{
+			/// @brief 更新した回数
+			uint64 ticks = 0;
+
+			/// @brief 更新が間に合わなかった回数
+			uint64 overruns = 0;
+
+			/// @brief 1 回の更新にかかった時間の平均 (ミリ秒)
+			double averageTickMillisec = 0.0;
+
+			/// @brief 1 回の更新にかかった時間の最大 (ミリ秒)
+			double maxTickMillisec = 0.0;
+		};
+
+		/// @brief NetworkHeadlessRunner を作成します。
+		/// @param tickRate 1 秒あたりの更新回数
+		explicit NetworkHeadlessRunner(double tickRate = 30.0);
+
+		NetworkHeadlessRunner(const NetworkHeadlessRunner&) = delete;
+
+		NetworkHeadlessRunner& operator =(const NetworkHeadlessRunner&) = delete;
+
+		/// @brief 更新する SivPhoton を追加します。
+		/// @param network SivPhoton
+		/// @param onTick SivPhoton::update() の後に呼び出される関数 (引数は 1 回の更新の経過時間 (秒))
+		void add(SivPhoton& network, std::function<void(double deltaTime)> onTick = {});
+
+		/// @brief 更新する SivPhoton を削除します。
+		/// @param network SivPhoton
+		/// @remark tick() の onTick の中から呼ぶこともできます。その場合は tick() の終わりに削除されます。
+		void remove(const SivPhoton& network);
+
+		/// @brief 更新する SivPhoton の数を返します。
+		/// @return SivPhoton の数
+		[[nodiscard]]
+		size_t num_clients() const noexcept;
+
+		/// @brief 1 秒あたりの更新回数を返します。
+		/// @return 1 秒あたりの更新回数
+		[[nodiscard]]
+		double getTickRate() const noexcept;
+
+		/// @brief すべての SivPhoton を 1 回更新します。
+		/// @remark run() を使わずに、独自のループから呼ぶこともできます。
+		void tick();
+
+		/// @brief stop() が呼ばれるまで、一定の間隔で tick() を呼び続けます。
+		/// @param keepRunning 毎回の更新の後に呼ばれ、false を返すと終了する関数
+		void run(const std::function<bool()>& keepRunning = {});
+
+		/// @brief run() を終了させます。
+		/// @remark 別のスレッドやシグナルハンドラから呼ぶことができます。run() が動いていない間に呼んでも、次の run() には影響しません。
+		void stop() noexcept;
+
+		/// @brief run() が動いているかを返します。
+		/// @return 動いている場合 true, それ以外の場合は false
+		[[nodiscard]]
+		bool isRunning() const noexcept;
+
+		/// @brief 更新の統計を返します。
+		/// @return 更新の統計
+		[[nodiscard]]
+		const Stats& getStats() const noexcept;
+
+	private:
+
+		struct Client
+		{
+			SivPhoton* network = nullptr;
+
+			std::function<void(double)> onTick;
+		};
+
+		double m_tickRate = 30.0;
+
+		Array<Client> m_clients;
+
+		/// @brief tick() の中で m_clients を走査している場合 true
+		bool m_ticking = false;
+
+		std::atomic<bool> m_stopRequested{ false };
+
+		std::atomic<bool> m_running{ false };
+
+		Stats m_stats;
+	};
+}
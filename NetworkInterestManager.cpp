@@ -0,0 +1,157 @@
+﻿
+# include "NetworkInterestManager.hpp"
+
+namespace s3d
+{
+	NetworkInterestManager::NetworkInterestManager(SivPhoton& network, const double cellSize, const uint8 numGroups)
+		: m_network{ network }
+		, m_cellSize{ cellSize }
+		, m_numGroups{ Max<uint8>(numGroups, 1) }
+	{
+		assert(0.0 < cellSize);
+	}
+
+	Point NetworkInterestManager::getCell(const Vec2& pos) const noexcept
+	{
+		return{ static_cast<int32>(std::floor(pos.x / m_cellSize)), static_cast<int32>(std::floor(pos.y / m_cellSize)) };
+	}
+
+	uint8 NetworkInterestManager::getGroup(const Point& cell) const noexcept
+	{
+		const uint32 hash = ((static_cast<uint32>(cell.x) * 73856093u) ^ (static_cast<uint32>(cell.y) * 19349663u));
+
+		// グループ 0 はルーム全体を表すので使わない
+		return static_cast<uint8>(1 + (hash % m_numGroups));
+	}
+
+	uint8 NetworkInterestManager::getGroup(const Vec2& pos) const noexcept
+	{
+		return getGroup(getCell(pos));
+	}
+
+	void NetworkInterestManager::setViewpoint(const Vec2& center, const double radius)
+	{
+		const Point minCell = getCell(Vec2{ (center.x - radius), (center.y - radius) });
+		const Point maxCell = getCell(Vec2{ (center.x + radius), (center.y + radius) });
+		const int64 numCells = ((static_cast<int64>(maxCell.x) - minCell.x + 1) * (static_cast<int64>(maxCell.y) - minCell.y + 1));
+
+		std::bitset<256> next;
+
+		if (MaxCellsPerViewpoint < numCells)
+		{
+			// 範囲が広すぎる場合はすべてのグループを受信する
+			for (uint32 group = 1; group <= m_numGroups; ++group)
+			{
+				next.set(group);
+			}
+		}
+		else
+		{
+			const double radiusSq = (radius * radius);
+
+			for (int32 y = minCell.y; y <= maxCell.y; ++y)
+			{
+				for (int32 x = minCell.x; x <= maxCell.x; ++x)
+				{
+					// 円とセルが重なるかを、セル上の最も近い点との距離で判定する
+					const double nearestX = Clamp(center.x, (x * m_cellSize), ((x + 1) * m_cellSize));
+					const double nearestY = Clamp(center.y, (y * m_cellSize), ((y + 1) * m_cellSize));
+					const double dx = (center.x - nearestX);
+					const double dy = (center.y - nearestY);
+
+					if (((dx * dx) + (dy * dy)) <= radiusSq)
+					{
+						next.set(getGroup(Point{ x, y }));
+					}
+				}
+			}
+		}
+
+		if ((next == m_subscribed) || (not m_network.isInRoom()))
+		{
+			return;
+		}
+
+		Array<uint8> groupsToRemove;
+		Array<uint8> groupsToAdd;
+
+		for (uint32 group = 1; group < 256; ++group)
+		{
+			if (m_subscribed[group] && (not next[group]))
+			{
+				groupsToRemove << static_cast<uint8>(group);
+			}
+			else if ((not m_subscribed[group]) && next[group])
+			{
+				groupsToAdd << static_cast<uint8>(group);
+			}
+		}
+
+		m_network.opChangeGroups(groupsToRemove, groupsToAdd);
+		m_subscribed = next;
+	}
+
+	bool NetworkInterestManager::isSubscribed(const Vec2& pos) const noexcept
+	{
+		return m_subscribed[getGroup(pos)];
+	}
+
+	Array<uint8> NetworkInterestManager::getSubscribedGroups() const
+	{
+		Array<uint8> groups;
+
+		for (uint32 group = 1; group < 256; ++group)
+		{
+			if (m_subscribed[group])
+			{
+				groups << static_cast<uint8>(group);
+			}
+		}
+
+		return groups;
+	}
+
+	void NetworkInterestManager::sendState(NetworkEntityReplicator& replicator, const size_t positionComponent, const bool reliable)
+	{
+		const auto localPlayerID = m_network.localPlayerID();
+
+		if (not localPlayerID)
+		{
+			return;
+		}
+
+		const Array<NetworkEntityID>& ids = replicator.ids();
+		const Array<int32>& ownerIDs = replicator.ownerIDs();
+		const Vec2* positions = replicator.data<Vec2>(positionComponent);
+
+		for (size_t i = 0; i < ids.size(); ++i)
+		{
+			if (ownerIDs[i] == *localPlayerID)
+			{
+				m_buckets[getGroup(positions[i])] << ids[i];
+			}
+		}
+
+		for (uint32 group = 1; group < 256; ++group)
+		{
+			auto& bucket = m_buckets[group];
+
+			if (not bucket)
+			{
+				continue;
+			}
+
+			NetworkSystem::EventOption option;
+			option.reliable = reliable;
+			option.interestGroup = static_cast<uint8>(group);
+
+			replicator.sendState(bucket, option);
+			bucket.clear();
+		}
+	}
+
+	void NetworkInterestManager::clear() noexcept
+	{
+		m_subscribed.reset();
+	}
+}
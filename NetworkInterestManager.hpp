@@ -0,0 +1,83 @@
+﻿
+# pragma once
+# include <bitset>
+# include <Siv3D.hpp>
+# include "NetworkSystem.hpp"
+# include "NetworkEntityReplicator.hpp"
+
+namespace s3d
+{
+	/// @brief 空間を一様なセルに分割し、各セルを Photon のインタレストグループに割り当てるクラスです。
+	/// @remark 視点の近くのセルのグループだけを受信し、エンティティの状態はそのエンティティがいるセルのグループに送信します。
+	/// セルの数がグループの数より多い場合、離れたセルが同じグループを共有します。
+	class NetworkInterestManager
+	{
+	public:
+
+		/// @brief NetworkInterestManager を作成します。
+		/// @param network 送受信に使う SivPhoton
+		/// @param cellSize セルの一辺の長さ
+		/// @param numGroups 使用するインタレストグループの数 (1 ～ 255)
+		NetworkInterestManager(SivPhoton& network, double cellSize, uint8 numGroups = 255);
+
+		/// @brief 座標が含まれるセルを返します。
+		/// @param pos 座標
+		/// @return セルの位置
+		[[nodiscard]]
+		Point getCell(const Vec2& pos) const noexcept;
+
+		/// @brief セルに割り当てられたインタレストグループを返します。
+		/// @param cell セルの位置
+		/// @return インタレストグループ (1 ～ numGroups)
+		[[nodiscard]]
+		uint8 getGroup(const Point& cell) const noexcept;
+
+		/// @brief 座標が含まれるセルに割り当てられたインタレストグループを返します。
+		/// @param pos 座標
+		/// @return インタレストグループ (1 ～ numGroups)
+		[[nodiscard]]
+		uint8 getGroup(const Vec2& pos) const noexcept;
+
+		/// @brief 視点を設定し、その周囲のセルのグループを受信するように変更します。
+		/// @param center 視点の位置
+		/// @param radius 受信する範囲の半径
+		/// @remark 受信するグループが変わった場合のみ SivPhoton::opChangeGroups() を呼びます。
+		void setViewpoint(const Vec2& center, double radius);
+
+		/// @brief 座標が受信中のグループに含まれるかを返します。
+		/// @param pos 座標
+		/// @return 受信中のグループに含まれる場合 true, それ以外の場合は false
+		[[nodiscard]]
+		bool isSubscribed(const Vec2& pos) const noexcept;
+
+		/// @brief 受信中のグループの一覧を返します。
+		/// @return 受信中のグループの一覧
+		[[nodiscard]]
+		Array<uint8> getSubscribedGroups() const;
+
+		/// @brief 自分が所有するエンティティの状態を、それぞれがいるセルのグループに送信します。
+		/// @param replicator エンティティを管理する NetworkEntityReplicator
+		/// @param positionComponent 位置 (Vec2) のコンポーネントのインデックス
+		/// @param reliable 確実に届ける (再送する) 場合 true, それ以外の場合は false
+		void sendState(NetworkEntityReplicator& replicator, size_t positionComponent, bool reliable = false);
+
+		/// @brief 受信中のグループを忘れます。
+		/// @remark ルームから退室した際に呼んでください。
+		void clear() noexcept;
+
+	private:
+
+		/// @brief 1 回の setViewpoint() で調べるセルの最大数
+		static constexpr int64 MaxCellsPerViewpoint = 4096;
+
+		SivPhoton& m_network;
+
+		double m_cellSize = 1.0;
+
+		uint8 m_numGroups = 255;
+
+		std::bitset<256> m_subscribed;
+
+		std::array<Array<NetworkEntityID>, 256> m_buckets;
+	};
+}
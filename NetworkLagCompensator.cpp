@@ -0,0 +1,134 @@
+﻿
+# include "NetworkLagCompensator.hpp"
+
+namespace s3d
+{
+	NetworkLagCompensator::NetworkLagCompensator(const size_t historySize, const int32 maxRewindMillisec)
+		: m_historySize{ Max<size_t>(historySize, 1) }
+		, m_maxRewindMillisec{ Max(maxRewindMillisec, 0) } {}
+
+	void NetworkLagCompensator::record(const NetworkEntityID id, const int32 serverTimeMillisec, const Shape& shape)
+	{
+		History& history = m_histories[id];
+
+		if (not history.samples)
+		{
+			history.samples.resize(m_historySize);
+		}
+
+		history.samples[history.head] = Sample{ serverTimeMillisec, shape };
+		history.head = ((history.head + 1) % m_historySize);
+		history.count = Min((history.count + 1), m_historySize);
+
+		if ((not m_latestTime) || (0 < Elapsed(*m_latestTime, serverTimeMillisec)))
+		{
+			m_latestTime = serverTimeMillisec;
+		}
+	}
+
+	void NetworkLagCompensator::remove(const NetworkEntityID id)
+	{
+		m_histories.erase(id);
+	}
+
+	Optional<NetworkLagCompensator::Shape> NetworkLagCompensator::getState(const NetworkEntityID id, const int32 serverTimeMillisec) const
+	{
+		const auto it = m_histories.find(id);
+
+		if (it == m_histories.end())
+		{
+			return none;
+		}
+
+		return rewind(it->second, serverTimeMillisec);
+	}
+
+	size_t NetworkLagCompensator::num_entities() const noexcept
+	{
+		return m_histories.size();
+	}
+
+	void NetworkLagCompensator::clear()
+	{
+		m_histories.clear();
+		m_latestTime.reset();
+	}
+
+	NetworkLagCompensator::Shape NetworkLagCompensator::Lerp(const Shape& a, const Shape& b, const double t)
+	{
+		if (a.index() != b.index())
+		{
+			return ((t < 0.5) ? a : b);
+		}
+
+		if (const auto pa = std::get_if<Vec2>(&a))
+		{
+			return pa->lerp(std::get<Vec2>(b), t);
+		}
+		else if (const auto ca = std::get_if<Circle>(&a))
+		{
+			const Circle& cb = std::get<Circle>(b);
+			return Circle{ ca->center.lerp(cb.center, t), (ca->r + (cb.r - ca->r) * t) };
+		}
+		else if (const auto ra = std::get_if<RectF>(&a))
+		{
+			const RectF& rb = std::get<RectF>(b);
+			return RectF{ ra->pos.lerp(rb.pos, t), ra->size.lerp(rb.size, t) };
+		}
+		else
+		{
+			const Quad& qa = std::get<Quad>(a);
+			const Quad& qb = std::get<Quad>(b);
+			return Quad{ qa.p0.lerp(qb.p0, t), qa.p1.lerp(qb.p1, t), qa.p2.lerp(qb.p2, t), qa.p3.lerp(qb.p3, t) };
+		}
+	}
+
+	Optional<NetworkLagCompensator::Shape> NetworkLagCompensator::rewind(const History& history, int32 serverTimeMillisec) const
+	{
+		if (history.count == 0)
+		{
+			return none;
+		}
+
+		// 巻き戻せる最大の時間より古い時刻は切り詰める
+		if (m_latestTime && (m_maxRewindMillisec < Elapsed(serverTimeMillisec, *m_latestTime)))
+		{
+			serverTimeMillisec = static_cast<int32>(static_cast<uint32>(*m_latestTime) - static_cast<uint32>(m_maxRewindMillisec));
+		}
+
+		const auto sampleAt = [&](const size_t age) -> const Sample&
+		{
+			return history.samples[(history.head + m_historySize - 1 - age) % m_historySize];
+		};
+
+		const Sample* newer = &sampleAt(0);
+
+		if (0 <= Elapsed(newer->time, serverTimeMillisec))
+		{
+			return newer->shape;
+		}
+
+		for (size_t age = 1; age < history.count; ++age)
+		{
+			const Sample& older = sampleAt(age);
+
+			if (0 <= Elapsed(older.time, serverTimeMillisec))
+			{
+				const int32 span = Elapsed(older.time, newer->time);
+				const double t = ((0 < span) ? (static_cast<double>(Elapsed(older.time, serverTimeMillisec)) / span) : 1.0);
+				return Lerp(older.shape, newer->shape, t);
+			}
+
+			newer = &older;
+		}
+
+		// 履歴より古い時刻は最も古い状態とする
+		return newer->shape;
+	}
+
+	int32 NetworkLagCompensator::Elapsed(const int32 from, const int32 to) noexcept
+	{
+		// サーバの時刻は int32 の範囲で一周するため、差で比較する
+		return static_cast<int32>(static_cast<uint32>(to) - static_cast<uint32>(from));
+	}
+}
@@ -0,0 +1,164 @@
+﻿
+# pragma once
+# include <variant>
+# include <Siv3D.hpp>
+# include "NetworkEntityReplicator.hpp"
+
+namespace s3d
+{
+	/// @brief エンティティの位置や形の履歴をサーバの時刻とともに保持し、過去の時刻の状態で当たり判定を行うクラスです。
+	/// @remark マスタークライアントは、撃った側が見ていた時刻まで巻き戻した状態で命中を判定できます。
+	/// 時刻には SivPhoton::getServerTimeMillisec() を使います。
+	class NetworkLagCompensator
+	{
+	public:
+
+		/// @brief 履歴に保持できる形
+		using Shape = std::variant<Vec2, Circle, RectF, Quad>;
+
+		/// @brief NetworkLagCompensator を作成します。
+		/// @param historySize エンティティごとに保持する履歴の数
+		/// @param maxRewindMillisec 巻き戻せる最大の時間 (ミリ秒)
+		explicit NetworkLagCompensator(size_t historySize = 64, int32 maxRewindMillisec = 500);
+
+		/// @brief エンティティの状態を履歴に追加します。
+		/// @param id エンティティの ID
+		/// @param serverTimeMillisec サーバの時刻 (ミリ秒)
+		/// @param shape エンティティの形
+		/// @remark 時刻は同じエンティティについて増加していく必要があります。
+		void record(NetworkEntityID id, int32 serverTimeMillisec, const Shape& shape);
+
+		/// @brief NetworkEntityReplicator の全エンティティの状態を履歴に追加します。
+		/// @tparam ShapeType コンポーネントの型 (Vec2, Circle, RectF, Quad)
+		/// @param replicator エンティティを管理する NetworkEntityReplicator
+		/// @param shapeComponent 形のコンポーネントのインデックス
+		/// @param serverTimeMillisec サーバの時刻 (ミリ秒)
+		template <class ShapeType>
+		void recordAll(const NetworkEntityReplicator& replicator, size_t shapeComponent, int32 serverTimeMillisec);
+
+		/// @brief エンティティの履歴を削除します。
+		/// @param id エンティティの ID
+		void remove(NetworkEntityID id);
+
+		/// @brief 指定した時刻のエンティティの状態を返します。
+		/// @param id エンティティの ID
+		/// @param serverTimeMillisec サーバの時刻 (ミリ秒)
+		/// @return 前後の履歴を補間した状態, 履歴が無い場合は none
+		/// @remark 巻き戻せる最大の時間より古い時刻は、その範囲に切り詰められます。
+		[[nodiscard]]
+		Optional<Shape> getState(NetworkEntityID id, int32 serverTimeMillisec) const;
+
+		/// @brief 指定した時刻のエンティティの状態が図形と交差するかを返します。
+		/// @param id エンティティの ID
+		/// @param serverTimeMillisec サーバの時刻 (ミリ秒)
+		/// @param shape 図形
+		/// @return 交差する場合 true, それ以外の場合は false
+		template <class Shape2DType>
+		[[nodiscard]]
+		bool intersects(NetworkEntityID id, int32 serverTimeMillisec, const Shape2DType& shape) const;
+
+		/// @brief 指定した時刻の状態が図形と交差するエンティティの一覧を返します。
+		/// @param serverTimeMillisec サーバの時刻 (ミリ秒)
+		/// @param shape 図形
+		/// @return 交差するエンティティの ID の一覧
+		template <class Shape2DType>
+		[[nodiscard]]
+		Array<NetworkEntityID> findIntersections(int32 serverTimeMillisec, const Shape2DType& shape) const;
+
+		/// @brief 履歴があるエンティティの数を返します。
+		/// @return エンティティの数
+		[[nodiscard]]
+		size_t num_entities() const noexcept;
+
+		/// @brief すべての履歴を削除します。
+		void clear();
+
+		/// @brief 2 つの状態を補間します。
+		/// @param a 状態
+		/// @param b 状態
+		/// @param t 補間の割合 (0.0 ～ 1.0)
+		/// @return 補間した状態, 種類が異なる場合は t に近い方の状態
+		[[nodiscard]]
+		static Shape Lerp(const Shape& a, const Shape& b, double t);
+
+	private:
+
+		struct Sample
+		{
+			int32 time = 0;
+
+			Shape shape;
+		};
+
+		struct History
+		{
+			Array<Sample> samples;
+
+			// 次に書き込む位置
+			size_t head = 0;
+
+			size_t count = 0;
+		};
+
+		size_t m_historySize = 64;
+
+		int32 m_maxRewindMillisec = 500;
+
+		// 記録された最新の時刻
+		Optional<int32> m_latestTime;
+
+		HashTable<NetworkEntityID, History> m_histories;
+
+		[[nodiscard]]
+		Optional<Shape> rewind(const History& history, int32 serverTimeMillisec) const;
+
+		[[nodiscard]]
+		static int32 Elapsed(int32 from, int32 to) noexcept;
+	};
+}
+
+namespace s3d
+{
+	template <class ShapeType>
+	void NetworkLagCompensator::recordAll(const NetworkEntityReplicator& replicator, const size_t shapeComponent, const int32 serverTimeMillisec)
+	{
+		const Array<NetworkEntityID>& ids = replicator.ids();
+		const ShapeType* shapes = replicator.data<ShapeType>(shapeComponent);
+
+		for (size_t i = 0; i < ids.size(); ++i)
+		{
+			record(ids[i], serverTimeMillisec, shapes[i]);
+		}
+	}
+
+	template <class Shape2DType>
+	bool NetworkLagCompensator::intersects(const NetworkEntityID id, const int32 serverTimeMillisec, const Shape2DType& shape) const
+	{
+		const auto state = getState(id, serverTimeMillisec);
+
+		if (not state)
+		{
+			return false;
+		}
+
+		return std::visit([&](const auto& s) { return s.intersects(shape); }, *state);
+	}
+
+	template <class Shape2DType>
+	Array<NetworkEntityID> NetworkLagCompensator::findIntersections(const int32 serverTimeMillisec, const Shape2DType& shape) const
+	{
+		Array<NetworkEntityID> results;
+
+		for (const auto& [id, history] : m_histories)
+		{
+			const auto state = rewind(history, serverTimeMillisec);
+
+			if (state && std::visit([&](const auto& s) { return s.intersects(shape); }, *state))
+			{
+				results << id;
+			}
+		}
+
+		return results;
+	}
+}
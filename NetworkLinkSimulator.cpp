@@ -0,0 +1,484 @@
+﻿
+# include "NetworkLinkSimulator.hpp"
+# include <cmath>
+
+namespace s3d
+{
+	namespace detail
+	{
+		/// @brief 再送を諦めずに続ける回数の上限
+		constexpr int32 MaxResends = 16;
+
+		/// @brief [0, 1) の一様乱数 (標準ライブラリの分布は実装によって結果が異なるため、自前で変換する)
+		[[nodiscard]]
+		inline double NextDouble(DefaultRNG& rng)
+		{
+			return ((rng() >> 11) * (1.0 / 9007199254740992.0));
+		}
+
+		[[nodiscard]]
+		inline bool Chance(DefaultRNG& rng, const double probability)
+		{
+			// 確率が 0 の場合は乱数を消費しないので、設定を変えなければ他の項目の結果は変わらない
+			return ((0.0 < probability) && (NextDouble(rng) < probability));
+		}
+	}
+
+	class NetworkLinkSimulator::InnerListener : public NetworkTransport::Listener
+	{
+	public:
+
+		explicit InnerListener(NetworkLinkSimulator& simulator)
+			: m_simulator{ simulator } {}
+
+		void connectReturn(const int32 errorCode, const String& errorString) override
+		{
+			m_simulator.receive(0, true, [=](Listener& listener) { listener.connectReturn(errorCode, errorString); });
+		}
+
+		void disconnectReturn() override
+		{
+			m_simulator.receive(0, true, [](Listener& listener) { listener.disconnectReturn(); });
+		}
+
+		void joinRandomRoomReturn(const int32 localPlayerID, const int32 errorCode, const String& errorString) override
+		{
+			m_simulator.receive(0, true, [=](Listener& listener) { listener.joinRandomRoomReturn(localPlayerID, errorCode, errorString); });
+		}
+
+		void joinRoomReturn(const int32 localPlayerID, const int32 errorCode, const String& errorString) override
+		{
+			m_simulator.receive(0, true, [=](Listener& listener) { listener.joinRoomReturn(localPlayerID, errorCode, errorString); });
+		}
+
+		void createRoomReturn(const int32 localPlayerID, const int32 errorCode, const String& errorString) override
+		{
+			m_simulator.receive(0, true, [=](Listener& listener) { listener.createRoomReturn(localPlayerID, errorCode, errorString); });
+		}
+
+		void leaveRoomReturn(const int32 errorCode, const String& errorString) override
+		{
+			m_simulator.receive(0, true, [=](Listener& listener) { listener.leaveRoomReturn(errorCode, errorString); });
+		}
+
+		void joinRoomEventAction(const int32 playerID, const Array<int32>& playerIDs, const bool isSelf) override
+		{
+			m_simulator.receive(0, true, [=](Listener& listener) { listener.joinRoomEventAction(playerID, playerIDs, isSelf); });
+		}
+
+		void leaveRoomEventAction(const int32 playerID, const bool isInactive) override
+		{
+			m_simulator.receive(0, true, [=](Listener& listener) { listener.leaveRoomEventAction(playerID, isInactive); });
+		}
+
+		void customEventAction(const int32 playerID, const uint8 eventCode, const Blob& eventContent, const bool reliable, const EventFormat format) override
+		{
+			m_simulator.receive(eventContent.size(), reliable, [=](Listener& listener) { listener.customEventAction(playerID, eventCode, eventContent, reliable, format); });
+		}
+
+	private:
+
+		NetworkLinkSimulator& m_simulator;
+	};
+
+	Array<double> NetworkLinkSimulator::Link::schedule(DefaultRNG& rng, LinkStats& stats, const double nowMillisec, const size_t bytes, const bool reliable)
+	{
+		++stats.packets;
+		stats.bytes += bytes;
+
+		double departure = nowMillisec;
+
+		if (0.0 < condition.bandwidthKbps)
+		{
+			const double start = Max(nowMillisec, m_freeAtMillisec);
+
+			if ((not reliable) && (condition.maxQueueMillisec < (start - nowMillisec)))
+			{
+				++stats.lost;
+				return{};
+			}
+
+			// キロビット毎秒は 1 ミリ秒あたりのビット数と等しい
+			departure = m_freeAtMillisec = (start + ((bytes + condition.overheadBytes) * 8.0 / condition.bandwidthKbps));
+		}
+
+		double arrival = (departure + sampleLatency(rng));
+
+		if (sampleLoss(rng))
+		{
+			if (not reliable)
+			{
+				++stats.lost;
+				return{};
+			}
+
+			// reliable は届くまで再送する。再送の間隔は往復の遅延とそのばらつきから見積もる
+			const double resendInterval = Max((condition.latencyMillisec * 2.0 + condition.jitterMillisec * 4.0), 20.0);
+
+			for (int32 i = 0; i < detail::MaxResends; ++i)
+			{
+				++stats.resent;
+				arrival += resendInterval;
+
+				if (not sampleLoss(rng))
+				{
+					break;
+				}
+			}
+		}
+
+		Array<double> arrivals;
+
+		if (reliable)
+		{
+			// reliable は送った順に届く
+			arrival = Max(arrival, m_lastReliableArrival);
+			m_lastReliableArrival = arrival;
+			arrivals << arrival;
+		}
+		else
+		{
+			if (detail::Chance(rng, condition.reorderRate))
+			{
+				++stats.reordered;
+				arrival += (detail::NextDouble(rng) * condition.reorderDelayMillisec);
+			}
+			else
+			{
+				arrival = Max(arrival, m_lastUnreliableArrival);
+				m_lastUnreliableArrival = arrival;
+			}
+
+			arrivals << arrival;
+
+			if (detail::Chance(rng, condition.duplicateRate))
+			{
+				++stats.duplicated;
+				arrivals << (arrival + (detail::NextDouble(rng) * Max(condition.jitterMillisec, 1.0)));
+			}
+		}
+
+		const uint64 delivered = (stats.packets - stats.lost);
+		stats.averageDelayMillisec += (((arrival - nowMillisec) - stats.averageDelayMillisec) / delivered);
+
+		return arrivals;
+	}
+
+	double NetworkLinkSimulator::Link::sampleLatency(DefaultRNG& rng) const
+	{
+		double latency = condition.latencyMillisec;
+
+		if (condition.jitterMillisec <= 0.0)
+		{
+			return latency;
+		}
+
+		switch (condition.distribution)
+		{
+		case LatencyDistribution::Normal:
+		{
+			// Box-Muller 法
+			const double u1 = (1.0 - detail::NextDouble(rng));
+			const double u2 = detail::NextDouble(rng);
+			latency += (condition.jitterMillisec * std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * Math::Pi * u2));
+			break;
+		}
+		case LatencyDistribution::Exponential:
+			latency += (condition.jitterMillisec * -std::log(1.0 - detail::NextDouble(rng)));
+			break;
+		default:
+			latency += (condition.jitterMillisec * (detail::NextDouble(rng) * 2.0 - 1.0));
+			break;
+		}
+
+		return Max(latency, 0.0);
+	}
+
+	bool NetworkLinkSimulator::Link::sampleLoss(DefaultRNG& rng)
+	{
+		// Gilbert-Elliott モデル: 通常時とバースト状態を行き来し、状態ごとのロス率でパケットを失う
+		if (0.0 < condition.burstEnterRate)
+		{
+			if (m_burst)
+			{
+				m_burst = (not detail::Chance(rng, condition.burstExitRate));
+			}
+			else
+			{
+				m_burst = detail::Chance(rng, condition.burstEnterRate);
+			}
+		}
+
+		return detail::Chance(rng, (m_burst ? condition.burstLossRate : condition.lossRate));
+	}
+
+	NetworkLinkSimulator::NetworkLinkSimulator(std::unique_ptr<NetworkTransport> transport, const uint64 seed)
+		: m_innerListener{ std::make_unique<InnerListener>(*this) }
+		, m_transport{ std::move(transport) }
+		, m_rng{ seed }
+	{
+		assert(m_transport);
+
+		m_transport->setListener(m_innerListener.get());
+	}
+
+	NetworkLinkSimulator::~NetworkLinkSimulator()
+	{
+		m_transport->setListener(nullptr);
+	}
+
+	void NetworkLinkSimulator::setClock(std::function<double()> clock)
+	{
+		m_clock = std::move(clock);
+	}
+
+	void NetworkLinkSimulator::setOutgoingCondition(const LinkCondition& condition)
+	{
+		m_outgoing.condition = condition;
+	}
+
+	void NetworkLinkSimulator::setIncomingCondition(const LinkCondition& condition)
+	{
+		m_incoming.condition = condition;
+	}
+
+	void NetworkLinkSimulator::setCondition(const LinkCondition& condition)
+	{
+		setOutgoingCondition(condition);
+		setIncomingCondition(condition);
+	}
+
+	const NetworkLinkSimulator::LinkCondition& NetworkLinkSimulator::getOutgoingCondition() const noexcept
+	{
+		return m_outgoing.condition;
+	}
+
+	const NetworkLinkSimulator::LinkCondition& NetworkLinkSimulator::getIncomingCondition() const noexcept
+	{
+		return m_incoming.condition;
+	}
+
+	size_t NetworkLinkSimulator::num_pending() const noexcept
+	{
+		return (m_outgoingQueue.size() + m_incomingQueue.size());
+	}
+
+	const NetworkLinkSimulator::Stats& NetworkLinkSimulator::getStats() const noexcept
+	{
+		return m_stats;
+	}
+
+	NetworkTransport& NetworkLinkSimulator::getTransport() noexcept
+	{
+		return *m_transport;
+	}
+
+	bool NetworkLinkSimulator::connect(const StringView userName)
+	{
+		return m_transport->connect(userName);
+	}
+
+	void NetworkLinkSimulator::disconnect()
+	{
+		m_transport->disconnect();
+	}
+
+	void NetworkLinkSimulator::update()
+	{
+		flush(m_outgoingQueue);
+
+		m_transport->update();
+
+		flush(m_incomingQueue);
+	}
+
+	void NetworkLinkSimulator::joinRandomRoom(const int32 maxPlayers)
+	{
+		send(0, true, [this, maxPlayers]() { m_transport->joinRandomRoom(maxPlayers); });
+	}
+
+	void NetworkLinkSimulator::joinRoom(const StringView roomName)
+	{
+		send(0, true, [this, roomName = String{ roomName }]() { m_transport->joinRoom(roomName); });
+	}
+
+	void NetworkLinkSimulator::createRoom(const StringView roomName, const int32 maxPlayers)
+	{
+		send(0, true, [this, roomName = String{ roomName }, maxPlayers]() { m_transport->createRoom(roomName, maxPlayers); });
+	}
+
+	void NetworkLinkSimulator::leaveRoom()
+	{
+		send(0, true, [this]() { m_transport->leaveRoom(); });
+	}
+
+	void NetworkLinkSimulator::changeGroups(const Array<uint8>& groupsToRemove, const Array<uint8>& groupsToAdd)
+	{
+		send(0, true, [this, groupsToRemove, groupsToAdd]() { m_transport->changeGroups(groupsToRemove, groupsToAdd); });
+	}
+
+	void NetworkLinkSimulator::raiseEvent(const uint8 eventCode, const Blob& eventContent, const NetworkSystem::EventOption& option, const EventFormat format)
+	{
+		send(eventContent.size(), option.reliable, [this, eventCode, eventContent, option, format]() { m_transport->raiseEvent(eventCode, eventContent, option, format); });
+	}
+
+	String NetworkLinkSimulator::getName() const
+	{
+		return m_transport->getName();
+	}
+
+	String NetworkLinkSimulator::getUserID() const
+	{
+		return m_transport->getUserID();
+	}
+
+	Array<String> NetworkLinkSimulator::getRoomNameList() const
+	{
+		return m_transport->getRoomNameList();
+	}
+
+	Array<NetworkSystem::RoomInfo> NetworkLinkSimulator::getRoomList() const
+	{
+		return m_transport->getRoomList();
+	}
+
+	Optional<uint64> NetworkLinkSimulator::getRoomListVersion() const
+	{
+		return m_transport->getRoomListVersion();
+	}
+
+	Optional<uint64> NetworkLinkSimulator::getStateVersion() const
+	{
+		return m_transport->getStateVersion();
+	}
+
+	bool NetworkLinkSimulator::isInRoom() const
+	{
+		return m_transport->isInRoom();
+	}
+
+	String NetworkLinkSimulator::getCurrentRoomName() const
+	{
+		return m_transport->getCurrentRoomName();
+	}
+
+	int32 NetworkLinkSimulator::getPlayerCountInCurrentRoom() const
+	{
+		return m_transport->getPlayerCountInCurrentRoom();
+	}
+
+	int32 NetworkLinkSimulator::getMaxPlayersInCurrentRoom() const
+	{
+		return m_transport->getMaxPlayersInCurrentRoom();
+	}
+
+	bool NetworkLinkSimulator::getIsOpenInCurrentRoom() const
+	{
+		return m_transport->getIsOpenInCurrentRoom();
+	}
+
+	bool NetworkLinkSimulator::getIsVisibleInCurrentRoom() const
+	{
+		return m_transport->getIsVisibleInCurrentRoom();
+	}
+
+	void NetworkLinkSimulator::setIsOpenInCurrentRoom(const bool isOpen)
+	{
+		send(0, true, [this, isOpen]() { m_transport->setIsOpenInCurrentRoom(isOpen); });
+	}
+
+	void NetworkLinkSimulator::setIsVisibleInCurrentRoom(const bool isVisible)
+	{
+		send(0, true, [this, isVisible]() { m_transport->setIsVisibleInCurrentRoom(isVisible); });
+	}
+
+	int32 NetworkLinkSimulator::getCountGamesRunning() const
+	{
+		return m_transport->getCountGamesRunning();
+	}
+
+	int32 NetworkLinkSimulator::getCountPlayersIngame() const
+	{
+		return m_transport->getCountPlayersIngame();
+	}
+
+	int32 NetworkLinkSimulator::getCountPlayersOnline() const
+	{
+		return m_transport->getCountPlayersOnline();
+	}
+
+	Optional<int32> NetworkLinkSimulator::localPlayerID() const
+	{
+		return m_transport->localPlayerID();
+	}
+
+	Optional<int32> NetworkLinkSimulator::getMasterClientID() const
+	{
+		return m_transport->getMasterClientID();
+	}
+
+	int32 NetworkLinkSimulator::getServerTimeMillisec() const
+	{
+		return m_transport->getServerTimeMillisec();
+	}
+
+	int32 NetworkLinkSimulator::getRoundTripTimeMillisec() const
+	{
+		const double latency = (m_outgoing.condition.latencyMillisec + m_incoming.condition.latencyMillisec);
+		return (m_transport->getRoundTripTimeMillisec() + static_cast<int32>(latency));
+	}
+
+	NetworkStatistics::ConnectionStats NetworkLinkSimulator::getConnectionStats() const
+	{
+		NetworkStatistics::ConnectionStats stats = m_transport->getConnectionStats();
+		stats.roundTripTimeMillisec = getRoundTripTimeMillisec();
+		stats.roundTripTimeVarianceMillisec += static_cast<int32>(m_outgoing.condition.jitterMillisec + m_incoming.condition.jitterMillisec);
+		stats.queuedIncoming += m_incomingQueue.size();
+		stats.queuedOutgoing += m_outgoingQueue.size();
+		stats.resent += (m_stats.outgoing.resent + m_stats.incoming.resent);
+		stats.lost += (m_stats.outgoing.lost + m_stats.incoming.lost);
+		return stats;
+	}
+
+	void NetworkLinkSimulator::send(const size_t bytes, const bool reliable, std::function<void()> action)
+	{
+		enqueue(m_outgoing, m_stats.outgoing, m_outgoingQueue, bytes, reliable, action);
+	}
+
+	void NetworkLinkSimulator::receive(const size_t bytes, const bool reliable, std::function<void(Listener&)> notification)
+	{
+		enqueue(m_incoming, m_stats.incoming, m_incomingQueue, bytes, reliable, [this, notification = std::move(notification)]()
+		{
+			if (m_listener)
+			{
+				notification(*m_listener);
+			}
+		});
+	}
+
+	void NetworkLinkSimulator::enqueue(Link& link, LinkStats& stats, PendingQueue& queue, const size_t bytes, const bool reliable, const std::function<void()>& action)
+	{
+		for (const double deliverAt : link.schedule(m_rng, stats, nowMillisec(), bytes, reliable))
+		{
+			queue.push({ deliverAt, m_serial++, action });
+		}
+	}
+
+	double NetworkLinkSimulator::nowMillisec() const
+	{
+		return (m_clock ? m_clock() : m_stopwatch.msF());
+	}
+
+	void NetworkLinkSimulator::flush(PendingQueue& queue)
+	{
+		const double now = nowMillisec();
+
+		// action の中で新たなパケットが追加されることがあるため、1 つずつ取り出してから実行する
+		while ((not queue.empty()) && (queue.top().deliverAt <= now))
+		{
+			const std::function<void()> action = queue.top().action;
+			queue.pop();
+			action();
+		}
+	}
+}
@@ -0,0 +1,336 @@
+﻿
+# pragma once
+# include <queue>
+# include <Siv3D.hpp>
+# include "NetworkTransport.hpp"
+
+namespace s3d
+{
+	/// @brief SivPhoton とトランスポートの間に入り、遅延・ジッター・パケットロス・重複・順序の入れ替わり・帯域制限を再現するトランスポートです。
+	/// @remark 送信 (SivPhoton からトランスポート) と受信 (トランスポートから SivPhoton) の方向ごとに通信状態を設定できます。
+	/// 既定では実時間でパケットが届く時刻を決めます。setClock() で時刻を与えると、乱数のシード・操作の順序・与えた時刻によって結果が完全に決まります。
+	/// reliable のイベントとルームの操作・通知は失われず順序も保たれますが、ロスした分だけ再送の遅延が加わります。
+	/// connect() と disconnect() は遅延させずにそのまま転送します。
+	class NetworkLinkSimulator : public NetworkTransport
+	{
+	public:
+
+		/// @brief 遅延の分布
+		enum class LatencyDistribution : uint8
+		{
+			/// @brief latency ± jitter の一様分布
+			Uniform,
+
+			/// @brief 平均 latency, 標準偏差 jitter の正規分布
+			Normal,
+
+			/// @brief latency に平均 jitter の指数分布を加えたもの (まれに大きく遅れる)
+			Exponential,
+		};
+
+		/// @brief 一方向の通信状態
+		struct LinkCondition
+		{
+			/// @brief 片道の遅延 (ミリ秒)
+			double latencyMillisec = 0.0;
+
+			/// @brief 遅延のばらつき (ミリ秒)
+			double jitterMillisec = 0.0;
+
+			/// @brief 遅延の分布
+			LatencyDistribution distribution = LatencyDistribution::Uniform;
+
+			/// @brief 通常時にパケットが失われる確率
+			double lossRate = 0.0;
+
+			/// @brief 通常時からバースト状態に移る確率 (パケットごと)
+			/// @remark 0 の場合はバーストロスを再現しません (Gilbert-Elliott モデル)。
+			double burstEnterRate = 0.0;
+
+			/// @brief バースト状態から通常時に戻る確率 (パケットごと)
+			double burstExitRate = 0.5;
+
+			/// @brief バースト状態でパケットが失われる確率
+			double burstLossRate = 1.0;
+
+			/// @brief unreliable のパケットが重複して届く確率
+			double duplicateRate = 0.0;
+
+			/// @brief unreliable のパケットが後続のパケットに追い越される確率
+			double reorderRate = 0.0;
+
+			/// @brief 追い越されるパケットに加わる遅延の最大 (ミリ秒)
+			double reorderDelayMillisec = 50.0;
+
+			/// @brief 帯域 (キロビット毎秒), 0 の場合は無制限
+			double bandwidthKbps = 0.0;
+
+			/// @brief 帯域の計算で 1 パケットに加えるヘッダのバイト数
+			size_t overheadBytes = 40;
+
+			/// @brief 帯域制限で待たされる時間の上限 (ミリ秒), これを超える unreliable のパケットは破棄される
+			double maxQueueMillisec = 1000.0;
+		};
+
+		/// @brief 一方向の統計
+		struct LinkStats
+		{
+			/// @brief 送られたパケットの数
+			uint64 packets = 0;
+
+			/// @brief 送られたパケットのイベントの内容の合計バイト数
+			uint64 bytes = 0;
+
+			/// @brief 失われた unreliable のパケットの数
+			uint64 lost = 0;
+
+			/// @brief 失われて再送された reliable のパケットの数
+			uint64 resent = 0;
+
+			/// @brief 重複したパケットの数
+			uint64 duplicated = 0;
+
+			/// @brief 追い越されたパケットの数
+			uint64 reordered = 0;
+
+			/// @brief 届いたパケットの遅延の平均 (ミリ秒)
+			double averageDelayMillisec = 0.0;
+		};
+
+		/// @brief 統計
+		struct Stats
+		{
+			/// @brief 送信方向の統計
+			LinkStats outgoing;
+
+			/// @brief 受信方向の統計
+			LinkStats incoming;
+		};
+
+		/// @brief NetworkLinkSimulator を作成します。
+		/// @param transport 実際に通信を行うトランスポート
+		/// @param seed 乱数のシード
+		explicit NetworkLinkSimulator(std::unique_ptr<NetworkTransport> transport, uint64 seed = 0);
+
+		~NetworkLinkSimulator() override;
+
+		NetworkLinkSimulator(const NetworkLinkSimulator&) = delete;
+
+		NetworkLinkSimulator& operator =(const NetworkLinkSimulator&) = delete;
+
+		/// @brief 現在の時刻を返す関数を設定します。
+		/// @param clock 現在の時刻 (ミリ秒) を返す関数, 空の場合は実時間 (作成してからの経過時間)
+		/// @remark 固定の間隔で進める時刻を与えると、実行速度やスレッドのスケジューリングに関係なく同じ結果を再現できます。
+		/// 時刻は減少してはいけません。まだ届いていないパケットがある間に時刻の基準を変えないでください。
+		void setClock(std::function<double()> clock);
+
+		/// @brief 送信方向の通信状態を設定します。
+		/// @param condition 通信状態
+		void setOutgoingCondition(const LinkCondition& condition);
+
+		/// @brief 受信方向の通信状態を設定します。
+		/// @param condition 通信状態
+		void setIncomingCondition(const LinkCondition& condition);
+
+		/// @brief 両方向の通信状態を設定します。
+		/// @param condition 通信状態
+		void setCondition(const LinkCondition& condition);
+
+		[[nodiscard]]
+		const LinkCondition& getOutgoingCondition() const noexcept;
+
+		[[nodiscard]]
+		const LinkCondition& getIncomingCondition() const noexcept;
+
+		/// @brief まだ届いていないパケットの数を返します。
+		/// @return 送信方向と受信方向のパケットの数の合計
+		[[nodiscard]]
+		size_t num_pending() const noexcept;
+
+		/// @brief 統計を返します。
+		/// @return 統計
+		[[nodiscard]]
+		const Stats& getStats() const noexcept;
+
+		/// @brief 実際に通信を行うトランスポートを返します。
+		/// @return トランスポート
+		[[nodiscard]]
+		NetworkTransport& getTransport() noexcept;
+
+		bool connect(StringView userName) override;
+
+		void disconnect() override;
+
+		/// @brief 内側のトランスポートを更新し、時刻が来たパケットを送信・通知します。
+		void update() override;
+
+		void joinRandomRoom(int32 maxPlayers) override;
+
+		void joinRoom(StringView roomName) override;
+
+		void createRoom(StringView roomName, int32 maxPlayers) override;
+
+		void leaveRoom() override;
+
+		void changeGroups(const Array<uint8>& groupsToRemove, const Array<uint8>& groupsToAdd) override;
+
+		void raiseEvent(uint8 eventCode, const Blob& eventContent, const NetworkSystem::EventOption& option, EventFormat format) override;
+
+		[[nodiscard]]
+		String getName() const override;
+
+		[[nodiscard]]
+		String getUserID() const override;
+
+		[[nodiscard]]
+		Array<String> getRoomNameList() const override;
+
+		[[nodiscard]]
+		Array<NetworkSystem::RoomInfo> getRoomList() const override;
+
+		[[nodiscard]]
+		Optional<uint64> getRoomListVersion() const override;
+
+		[[nodiscard]]
+		Optional<uint64> getStateVersion() const override;
+
+		[[nodiscard]]
+		bool isInRoom() const override;
+
+		[[nodiscard]]
+		String getCurrentRoomName() const override;
+
+		[[nodiscard]]
+		int32 getPlayerCountInCurrentRoom() const override;
+
+		[[nodiscard]]
+		int32 getMaxPlayersInCurrentRoom() const override;
+
+		[[nodiscard]]
+		bool getIsOpenInCurrentRoom() const override;
+
+		[[nodiscard]]
+		bool getIsVisibleInCurrentRoom() const override;
+
+		void setIsOpenInCurrentRoom(bool isOpen) override;
+
+		void setIsVisibleInCurrentRoom(bool isVisible) override;
+
+		[[nodiscard]]
+		int32 getCountGamesRunning() const override;
+
+		[[nodiscard]]
+		int32 getCountPlayersIngame() const override;
+
+		[[nodiscard]]
+		int32 getCountPlayersOnline() const override;
+
+		[[nodiscard]]
+		Optional<int32> localPlayerID() const override;
+
+		[[nodiscard]]
+		Optional<int32> getMasterClientID() const override;
+
+		[[nodiscard]]
+		int32 getServerTimeMillisec() const override;
+
+		/// @brief 往復の遅延を返します。
+		/// @return 内側のトランスポートの往復の遅延に、両方向の遅延を加えたもの (ミリ秒)
+		[[nodiscard]]
+		int32 getRoundTripTimeMillisec() const override;
+
+		/// @brief 通信路の状態を返します。
+		/// @return 内側のトランスポートの状態に、再現している遅延・キューの長さ・再送・損失を加えたもの
+		[[nodiscard]]
+		NetworkStatistics::ConnectionStats getConnectionStats() const override;
+
+	private:
+
+		class InnerListener;
+
+		/// @brief 一方向の通信路
+		class Link
+		{
+		public:
+
+			LinkCondition condition;
+
+			/// @brief パケットが届く時刻を決めます。
+			/// @param rng 乱数生成器
+			/// @param stats 統計の書き込み先
+			/// @param nowMillisec 現在の時刻 (ミリ秒)
+			/// @param bytes パケットのバイト数
+			/// @param reliable reliable の場合 true
+			/// @return 届く時刻の一覧 (失われた場合は空, 重複した場合は 2 つ)
+			[[nodiscard]]
+			Array<double> schedule(DefaultRNG& rng, LinkStats& stats, double nowMillisec, size_t bytes, bool reliable);
+
+		private:
+
+			bool m_burst = false;
+
+			double m_freeAtMillisec = 0.0;
+
+			double m_lastReliableArrival = 0.0;
+
+			double m_lastUnreliableArrival = 0.0;
+
+			[[nodiscard]]
+			double sampleLatency(DefaultRNG& rng) const;
+
+			[[nodiscard]]
+			bool sampleLoss(DefaultRNG& rng);
+		};
+
+		struct Pending
+		{
+			double deliverAt = 0.0;
+
+			/// @brief 同じ時刻のパケットの順序を保つための通し番号
+			uint64 serial = 0;
+
+			std::function<void()> action;
+
+			[[nodiscard]]
+			friend bool operator >(const Pending& a, const Pending& b) noexcept
+			{
+				return (a.deliverAt != b.deliverAt) ? (a.deliverAt > b.deliverAt) : (a.serial > b.serial);
+			}
+		};
+
+		using PendingQueue = std::priority_queue<Pending, std::vector<Pending>, std::greater<Pending>>;
+
+		std::unique_ptr<InnerListener> m_innerListener;
+
+		std::unique_ptr<NetworkTransport> m_transport;
+
+		DefaultRNG m_rng;
+
+		Stopwatch m_stopwatch{ StartImmediately::Yes };
+
+		std::function<double()> m_clock;
+
+		Link m_outgoing;
+
+		Link m_incoming;
+
+		PendingQueue m_outgoingQueue;
+
+		PendingQueue m_incomingQueue;
+
+		uint64 m_serial = 0;
+
+		Stats m_stats;
+
+		[[nodiscard]]
+		double nowMillisec() const;
+
+		void send(size_t bytes, bool reliable, std::function<void()> action);
+
+		void receive(size_t bytes, bool reliable, std::function<void(Listener&)> notification);
+
+		void enqueue(Link& link, LinkStats& stats, PendingQueue& queue, size_t bytes, bool reliable, const std::function<void()>& action);
+
+		void flush(PendingQueue& queue);
+	};
+}
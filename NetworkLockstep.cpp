@@ -0,0 +1,363 @@
+﻿
+# include "NetworkLockstep.hpp"
+
+namespace s3d
+{
+	NetworkLockstep::NetworkLockstep(SivPhoton& network, const uint8 eventCode, const int32 inputDelay)
+		: m_network{ network }
+		, m_eventCode{ eventCode }
+		, m_inputDelay{ Clamp(inputDelay, 0, static_cast<int32>(BufferSize / 4)) }
+		, m_slots(BufferSize)
+	{
+		m_network.setEventHandler(m_eventCode, [this](const int32 playerID, const Blob& data) { onReceive(playerID, data); });
+	}
+
+	NetworkLockstep::~NetworkLockstep()
+	{
+		m_network.removeEventHandler(m_eventCode);
+	}
+
+	void NetworkLockstep::start(const Array<int32>& playerIDs)
+	{
+		m_playerIDs = playerIDs;
+		std::sort(m_playerIDs.begin(), m_playerIDs.end());
+		m_playerIDs.erase(std::unique(m_playerIDs.begin(), m_playerIDs.end()), m_playerIDs.end());
+
+		m_activePlayers.assign(m_playerIDs.size(), true);
+		m_lastReceivedFrames.assign(m_playerIDs.size(), none);
+
+		for (auto& slot : m_slots)
+		{
+			slot.frame = UINT32_MAX;
+		}
+
+		m_frame = 0;
+		m_lastSubmittedFrame.reset();
+		m_localChecksums.clear();
+		m_remoteChecksums.clear();
+		m_stats = {};
+
+		// 入力遅延の分の最初のフレームは全員の入力が空
+		for (uint32 frame = 0; frame < static_cast<uint32>(m_inputDelay); ++frame)
+		{
+			for (size_t i = 0; i < m_playerIDs.size(); ++i)
+			{
+				setInput(i, frame, Blob{});
+			}
+		}
+
+		m_running = true;
+
+		// 先に開始したプレイヤーの入力は 1 回しか送られないので、開始する前に受信したものを使う
+		for (const auto& [playerID, data] : m_earlyMessages)
+		{
+			onReceive(playerID, data);
+		}
+
+		m_earlyMessages.clear();
+	}
+
+	bool NetworkLockstep::isRunning() const noexcept
+	{
+		return m_running;
+	}
+
+	int32 NetworkLockstep::getInputDelay() const noexcept
+	{
+		return m_inputDelay;
+	}
+
+	void NetworkLockstep::setChecksum(const uint32 interval, std::function<uint64()> checksumFunction)
+	{
+		m_checksumInterval = interval;
+		m_checksumFunction = std::move(checksumFunction);
+	}
+
+	void NetworkLockstep::setDesyncCallback(std::function<void(uint32 frame, int32 playerID, uint64 localChecksum, uint64 remoteChecksum)> callback)
+	{
+		m_desyncCallback = std::move(callback);
+	}
+
+	bool NetworkLockstep::step(const Blob& localInput, const std::function<void(const InputBundle&)>& simulate)
+	{
+		if (not m_running)
+		{
+			return false;
+		}
+
+		const auto localPlayerID = m_network.localPlayerID();
+		const auto localIndex = (localPlayerID ? playerIndexOf(*localPlayerID) : none);
+
+		if (not localIndex)
+		{
+			return false;
+		}
+
+		const uint32 targetFrame = (m_frame + m_inputDelay);
+
+		if ((not m_lastSubmittedFrame) || (*m_lastSubmittedFrame < targetFrame))
+		{
+			setInput(*localIndex, targetFrame, localInput);
+
+			NetworkPacketWriter writer{ (sizeof(MessageType) + sizeof(uint32) * 2 + localInput.size()) };
+			writer.write(MessageType::Input);
+			writer.write(targetFrame);
+			writer.write(static_cast<uint32>(localInput.size()));
+			writer.writeBytes(localInput.data(), localInput.size());
+
+			m_network.opRaiseEvent(m_eventCode, writer.getBlob());
+			m_lastSubmittedFrame = targetFrame;
+		}
+
+		// 最も遅れているプレイヤーとの差
+		{
+			Optional<int64> slowestFrame;
+
+			for (size_t i = 0; i < m_playerIDs.size(); ++i)
+			{
+				if ((i == *localIndex) || (not m_activePlayers[i]) || (not m_lastReceivedFrames[i]))
+				{
+					continue;
+				}
+
+				const int64 remoteFrame = (static_cast<int64>(*m_lastReceivedFrames[i]) - m_inputDelay);
+				slowestFrame = (slowestFrame ? Min(*slowestFrame, remoteFrame) : remoteFrame);
+			}
+
+			m_stats.lead = (slowestFrame ? static_cast<int32>(static_cast<int64>(m_frame) - *slowestFrame) : 0);
+		}
+
+		if (not isComplete(m_frame))
+		{
+			++m_stats.stalledTicks;
+			return false;
+		}
+
+		FrameSlot& slot = getSlot(m_frame);
+		m_bundle.frame = m_frame;
+		m_bundle.playerIDs = m_playerIDs;
+		m_bundle.inputs.resize(m_playerIDs.size());
+
+		for (size_t i = 0; i < m_playerIDs.size(); ++i)
+		{
+			// 退室したプレイヤーの入力は空
+			m_bundle.inputs[i] = (slot.inputs[i] ? std::move(*slot.inputs[i]) : Blob{});
+		}
+
+		simulate(m_bundle);
+
+		if (m_checksumInterval && m_checksumFunction && ((m_frame % m_checksumInterval) == 0))
+		{
+			const uint64 checksum = m_checksumFunction();
+			m_localChecksums[m_frame] = checksum;
+
+			NetworkPacketWriter writer;
+			writer.write(MessageType::Checksum);
+			writer.write(m_frame);
+			writer.write(checksum);
+			m_network.opRaiseEvent(m_eventCode, writer.getBlob());
+
+			compareChecksums(m_frame);
+
+			if (MaxChecksums < m_localChecksums.size())
+			{
+				const uint32 oldest = (m_frame - static_cast<uint32>(MaxChecksums * m_checksumInterval));
+
+				for (auto it = m_localChecksums.begin(); it != m_localChecksums.end();)
+				{
+					it = ((it->first < oldest) ? m_localChecksums.erase(it) : std::next(it));
+				}
+			}
+		}
+
+		++m_frame;
+		m_stats.frame = m_frame;
+		return true;
+	}
+
+	double NetworkLockstep::getTimeScale() const noexcept
+	{
+		constexpr double Step = 0.02;
+
+		if (1 < m_stats.lead)
+		{
+			return Max((1.0 - Step * (m_stats.lead - 1)), 0.8);
+		}
+		else if (m_stats.lead < -1)
+		{
+			return Min((1.0 + Step * (-m_stats.lead - 1)), 1.2);
+		}
+
+		return 1.0;
+	}
+
+	void NetworkLockstep::onPlayerLeft(const int32 playerID)
+	{
+		if (const auto index = playerIndexOf(playerID))
+		{
+			m_activePlayers[*index] = false;
+		}
+	}
+
+	const NetworkLockstep::Stats& NetworkLockstep::getStats() const noexcept
+	{
+		return m_stats;
+	}
+
+	Optional<size_t> NetworkLockstep::playerIndexOf(const int32 playerID) const
+	{
+		const auto it = std::lower_bound(m_playerIDs.begin(), m_playerIDs.end(), playerID);
+
+		if ((it == m_playerIDs.end()) || (*it != playerID))
+		{
+			return none;
+		}
+
+		return static_cast<size_t>(it - m_playerIDs.begin());
+	}
+
+	NetworkLockstep::FrameSlot& NetworkLockstep::getSlot(const uint32 frame)
+	{
+		FrameSlot& slot = m_slots[frame % BufferSize];
+
+		if (slot.frame != frame)
+		{
+			slot.frame = frame;
+			slot.inputs.assign(m_playerIDs.size(), none);
+			slot.received = 0;
+		}
+
+		return slot;
+	}
+
+	void NetworkLockstep::setInput(const size_t playerIndex, const uint32 frame, const Blob& input)
+	{
+		FrameSlot& slot = getSlot(frame);
+
+		if (not slot.inputs[playerIndex])
+		{
+			slot.inputs[playerIndex] = input;
+			++slot.received;
+		}
+	}
+
+	bool NetworkLockstep::isComplete(const uint32 frame)
+	{
+		const FrameSlot& slot = getSlot(frame);
+
+		if (slot.received == m_playerIDs.size())
+		{
+			return true;
+		}
+
+		for (size_t i = 0; i < m_playerIDs.size(); ++i)
+		{
+			if ((not slot.inputs[i]) && m_activePlayers[i])
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void NetworkLockstep::compareChecksums(const uint32 frame)
+	{
+		const auto local = m_localChecksums.find(frame);
+		const auto remote = m_remoteChecksums.find(frame);
+
+		if ((local == m_localChecksums.end()) || (remote == m_remoteChecksums.end()))
+		{
+			return;
+		}
+
+		for (const auto& [playerID, checksum] : remote->second)
+		{
+			if (checksum != local->second)
+			{
+				++m_stats.desyncs;
+
+				if (m_desyncCallback)
+				{
+					m_desyncCallback(frame, playerID, local->second, checksum);
+				}
+			}
+		}
+
+		m_remoteChecksums.erase(remote);
+	}
+
+	void NetworkLockstep::onReceive(const int32 playerID, const Blob& data)
+	{
+		if (not m_running)
+		{
+			// プレイヤーの一覧が決まるまで保持し、start() で処理する
+			if (m_earlyMessages.size() < MaxEarlyMessages)
+			{
+				m_earlyMessages.emplace_back(playerID, data);
+			}
+
+			return;
+		}
+
+		const auto index = playerIndexOf(playerID);
+
+		if (not index)
+		{
+			return;
+		}
+
+		NetworkPacketReader reader{ data };
+		MessageType type;
+		uint32 frame = 0;
+
+		if ((not reader.read(type)) || (not reader.read(frame)))
+		{
+			return;
+		}
+
+		if (type == MessageType::Input)
+		{
+			uint32 size = 0;
+
+			if ((not reader.read(size)) || (reader.remaining() < size))
+			{
+				return;
+			}
+
+			// 既に進めたフレームと、保持できないほど先のフレームは無視する
+			if ((frame < m_frame) || ((m_frame + BufferSize) <= frame))
+			{
+				return;
+			}
+
+			setInput(*index, frame, Blob{ reader.current(), size });
+
+			auto& lastReceivedFrame = m_lastReceivedFrames[*index];
+			lastReceivedFrame = (lastReceivedFrame ? Max(*lastReceivedFrame, frame) : frame);
+			return;
+		}
+
+		if (type == MessageType::Checksum)
+		{
+			uint64 checksum = 0;
+
+			if (not reader.read(checksum))
+			{
+				return;
+			}
+
+			m_remoteChecksums[frame].emplace_back(playerID, checksum);
+			compareChecksums(frame);
+
+			// 自分のチェックサムが無いまま古くなったものは捨てる
+			if (MaxChecksums < m_remoteChecksums.size())
+			{
+				for (auto it = m_remoteChecksums.begin(); it != m_remoteChecksums.end();)
+				{
+					it = (((it->first + MaxChecksums * Max<uint32>(m_checksumInterval, 1)) < m_frame) ? m_remoteChecksums.erase(it) : std::next(it));
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,185 @@
+﻿
+# pragma once
+# include <Siv3D.hpp>
+# include "NetworkSystem.hpp"
+# include "NetworkPacket.hpp"
+
+namespace s3d
+{
+	/// @brief 入力だけを交換してシミュレーションを同期する決定論的ロックステップのクラスです。
+	/// @remark 各フレームの入力は inputDelay フレーム先のフレームの入力として送信され、
+	/// 全員の入力が揃ったフレームだけを進めます。送信量はユニットの数に関係なく一定です。
+	class NetworkLockstep
+	{
+	public:
+
+		/// @brief 1 フレーム分の全員の入力
+		struct InputBundle
+		{
+			/// @brief フレーム番号
+			uint32 frame = 0;
+
+			/// @brief プレイヤー ID の一覧 (昇順)
+			Array<int32> playerIDs;
+
+			/// @brief 入力の一覧 (並びは playerIDs と同じ)
+			Array<Blob> inputs;
+		};
+
+		/// @brief ロックステップの統計
+		struct Stats
+		{
+			/// @brief 次に進めるフレーム番号
+			uint32 frame = 0;
+
+			/// @brief 入力が揃わずに進めなかった回数
+			uint64 stalledTicks = 0;
+
+			/// @brief 検出した不一致の回数
+			uint64 desyncs = 0;
+
+			/// @brief 最も遅れているプレイヤーより何フレーム先にいるか
+			int32 lead = 0;
+		};
+
+		/// @brief NetworkLockstep を作成します。
+		/// @param network 送受信に使う SivPhoton
+		/// @param eventCode 送受信に使うイベントコード
+		/// @param inputDelay 入力遅延 (フレーム)
+		NetworkLockstep(SivPhoton& network, uint8 eventCode, int32 inputDelay = 3);
+
+		~NetworkLockstep();
+
+		NetworkLockstep(const NetworkLockstep&) = delete;
+
+		NetworkLockstep& operator =(const NetworkLockstep&) = delete;
+
+		/// @brief ロックステップを開始します。
+		/// @param playerIDs 参加するプレイヤー全員の ID (自分を含む)
+		/// @remark 全員が同じプレイヤーの一覧で開始する必要があります。
+		/// 全員が同時に開始する必要はありません。開始する前に受信した他のプレイヤーの入力は保持され、開始した時点で使われます。
+		void start(const Array<int32>& playerIDs);
+
+		/// @brief ロックステップが開始されているかを返します。
+		/// @return 開始されている場合 true, それ以外の場合は false
+		[[nodiscard]]
+		bool isRunning() const noexcept;
+
+		/// @brief 入力遅延を返します。
+		/// @return 入力遅延 (フレーム)
+		[[nodiscard]]
+		int32 getInputDelay() const noexcept;
+
+		/// @brief 状態のチェックサムを交換する間隔を設定します。
+		/// @param interval 間隔 (フレーム), 0 の場合は交換しない
+		/// @param checksumFunction シミュレーションの状態のチェックサムを返す関数
+		void setChecksum(uint32 interval, std::function<uint64()> checksumFunction);
+
+		/// @brief チェックサムの不一致を検出した際に呼び出される関数を設定します。
+		/// @param callback 呼び出される関数
+		void setDesyncCallback(std::function<void(uint32 frame, int32 playerID, uint64 localChecksum, uint64 remoteChecksum)> callback);
+
+		/// @brief 自分の入力を送信し、全員の入力が揃っていれば 1 フレーム進めます。
+		/// @param localInput 自分の入力
+		/// @param simulate フレームを進める関数
+		/// @return フレームを進めた場合 true, 入力が揃わずに待機した場合は false
+		/// @remark 固定フレームレートで 1 ティックに 1 回呼んでください。
+		/// 待機した場合、同じフレームの入力は再送されません。
+		bool step(const Blob& localInput, const std::function<void(const InputBundle&)>& simulate);
+
+		/// @brief 他のプレイヤーとの進み具合の差に応じた時間の進み方の倍率を返します。
+		/// @return 時間の進み方の倍率
+		/// @remark 先に進みすぎている場合は 1 より小さく、遅れている場合は 1 より大きくなります。
+		/// 固定ステップの経過時間に掛けることで、待機 (スタール) の発生を抑えられます。
+		[[nodiscard]]
+		double getTimeScale() const noexcept;
+
+		/// @brief プレイヤーがルームから退室したことを通知します。
+		/// @param playerID 退室したプレイヤーの ID
+		/// @remark 受信済みの入力はそのまま使い、以降のフレームではそのプレイヤーの入力は空になります。
+		void onPlayerLeft(int32 playerID);
+
+		/// @brief ロックステップの統計を返します。
+		/// @return ロックステップの統計
+		[[nodiscard]]
+		const Stats& getStats() const noexcept;
+
+	private:
+
+		enum class MessageType : uint8
+		{
+			Input,
+
+			Checksum,
+		};
+
+		struct FrameSlot
+		{
+			uint32 frame = UINT32_MAX;
+
+			Array<Optional<Blob>> inputs;
+
+			size_t received = 0;
+		};
+
+		/// @brief 保持するフレーム数
+		static constexpr uint32 BufferSize = 256;
+
+		/// @brief 保持するチェックサムの数
+		static constexpr size_t MaxChecksums = 64;
+
+		/// @brief 開始する前に受信して保持するメッセージの最大数
+		static constexpr size_t MaxEarlyMessages = (BufferSize * 4);
+
+		SivPhoton& m_network;
+
+		uint8 m_eventCode = 0;
+
+		int32 m_inputDelay = 3;
+
+		bool m_running = false;
+
+		uint32 m_frame = 0;
+
+		Optional<uint32> m_lastSubmittedFrame;
+
+		Array<int32> m_playerIDs;
+
+		Array<bool> m_activePlayers;
+
+		Array<Optional<uint32>> m_lastReceivedFrames;
+
+		Array<FrameSlot> m_slots;
+
+		InputBundle m_bundle;
+
+		uint32 m_checksumInterval = 0;
+
+		std::function<uint64()> m_checksumFunction;
+
+		HashTable<uint32, uint64> m_localChecksums;
+
+		HashTable<uint32, Array<std::pair<int32, uint64>>> m_remoteChecksums;
+
+		std::function<void(uint32, int32, uint64, uint64)> m_desyncCallback;
+
+		/// @brief 開始する前に受信したメッセージ (送信者のプレイヤー ID と内容)
+		Array<std::pair<int32, Blob>> m_earlyMessages;
+
+		Stats m_stats;
+
+		[[nodiscard]]
+		Optional<size_t> playerIndexOf(int32 playerID) const;
+
+		FrameSlot& getSlot(uint32 frame);
+
+		void setInput(size_t playerIndex, uint32 frame, const Blob& input);
+
+		[[nodiscard]]
+		bool isComplete(uint32 frame);
+
+		void compareChecksums(uint32 frame);
+
+		void onReceive(int32 playerID, const Blob& data);
+	};
+}
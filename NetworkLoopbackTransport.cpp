@@ -0,0 +1,612 @@
+﻿
+# include "NetworkLoopbackTransport.hpp"
+
+namespace s3d
+{
+	NetworkLoopbackHub::NetworkLoopbackHub()
+		: m_startTime{ std::chrono::steady_clock::now() } {}
+
+	std::unique_ptr<NetworkLoopbackTransport> NetworkLoopbackHub::createTransport()
+	{
+		return std::make_unique<NetworkLoopbackTransport>(*this);
+	}
+
+	size_t NetworkLoopbackHub::num_rooms() const
+	{
+		std::lock_guard lock{ m_mutex };
+
+		return m_rooms.size();
+	}
+
+	size_t NetworkLoopbackHub::num_peers() const
+	{
+		std::lock_guard lock{ m_mutex };
+
+		return m_peers.size();
+	}
+
+	NetworkLoopbackHub::Room* NetworkLoopbackHub::findRoom(const StringView roomName)
+	{
+		if (auto it = m_rooms.find(String{ roomName }); it != m_rooms.end())
+		{
+			return &it->second;
+		}
+
+		return nullptr;
+	}
+
+	void NetworkLoopbackHub::enterRoom(NetworkLoopbackTransport& peer, Room& room, const JoinKind kind)
+	{
+		const int32 playerID = room.nextPlayerID++;
+
+		// Photon と同様に、ルームを作成したプレイヤーが最初のマスタークライアントになる
+		if (not room.players)
+		{
+			room.masterClientID = playerID;
+		}
+
+		room.players << &peer;
+		peer.m_roomName = room.name;
+		peer.m_localPlayerID = playerID;
+		++m_version;
+
+		Array<int32> playerIDs;
+
+		for (const auto* player : room.players)
+		{
+			playerIDs << player->m_localPlayerID;
+		}
+
+		// 入室した本人には、入室の結果を先に通知する
+		peer.post([=](NetworkTransport::Listener& listener)
+		{
+			switch (kind)
+			{
+			case JoinKind::Create:
+				listener.createRoomReturn(playerID, 0, U"");
+				break;
+			case JoinKind::Join:
+				listener.joinRoomReturn(playerID, 0, U"");
+				break;
+			case JoinKind::JoinRandom:
+				listener.joinRandomRoomReturn(playerID, 0, U"");
+				break;
+			}
+		});
+
+		for (auto* player : room.players)
+		{
+			const bool isSelf = (player == &peer);
+			player->post([=](NetworkTransport::Listener& listener) { listener.joinRoomEventAction(playerID, playerIDs, isSelf); });
+		}
+	}
+
+	void NetworkLoopbackHub::exitRoom(NetworkLoopbackTransport& peer)
+	{
+		const String roomName = std::exchange(peer.m_roomName, String{});
+		Room* room = findRoom(roomName);
+
+		const int32 playerID = peer.m_localPlayerID;
+		peer.m_localPlayerID = -1;
+		peer.m_groups.clear();
+
+		if (not room)
+		{
+			return;
+		}
+
+		room->players.remove(&peer);
+		++m_version;
+
+		if (not room->players)
+		{
+			m_rooms.erase(roomName);
+			return;
+		}
+
+		// マスタークライアントが退室した場合は、Photon と同様に残りのプレイヤーのうち最も小さい ID のプレイヤーが引き継ぐ
+		if (room->masterClientID == playerID)
+		{
+			int32 masterClientID = room->players.front()->m_localPlayerID;
+
+			for (const auto* player : room->players)
+			{
+				masterClientID = Min(masterClientID, player->m_localPlayerID);
+			}
+
+			room->masterClientID = masterClientID;
+		}
+
+		for (auto* player : room->players)
+		{
+			player->post([=](NetworkTransport::Listener& listener) { listener.leaveRoomEventAction(playerID, false); });
+		}
+	}
+
+	NetworkLoopbackTransport::NetworkLoopbackTransport(NetworkLoopbackHub& hub)
+		: m_hub{ hub } {}
+
+	NetworkLoopbackTransport::~NetworkLoopbackTransport()
+	{
+		std::lock_guard lock{ m_hub.m_mutex };
+
+		if (m_connected)
+		{
+			m_hub.exitRoom(*this);
+			m_hub.m_peers.remove(this);
+			++m_hub.m_version;
+		}
+	}
+
+	bool NetworkLoopbackTransport::connect(const StringView userName)
+	{
+		std::lock_guard lock{ m_hub.m_mutex };
+
+		if (m_connected)
+		{
+			return false;
+		}
+
+		m_connected = true;
+		m_userName = userName;
+		m_userID = U"{}{}"_fmt(userName, ++m_hub.m_userSerial);
+		m_hub.m_peers << this;
+		++m_hub.m_version;
+
+		post([](Listener& listener) { listener.connectReturn(0, U""); });
+		return true;
+	}
+
+	void NetworkLoopbackTransport::disconnect()
+	{
+		std::lock_guard lock{ m_hub.m_mutex };
+
+		if (not m_connected)
+		{
+			return;
+		}
+
+		m_hub.exitRoom(*this);
+		m_hub.m_peers.remove(this);
+		m_connected = false;
+		++m_hub.m_version;
+
+		post([](Listener& listener) { listener.disconnectReturn(); });
+	}
+
+	void NetworkLoopbackTransport::update()
+	{
+		Array<Notification> inbox;
+		{
+			std::lock_guard lock{ m_hub.m_mutex };
+			inbox.swap(m_inbox);
+		}
+
+		if (not m_listener)
+		{
+			return;
+		}
+
+		// コールバックの中からトランスポートを操作できるように、ロックを外してから通知する
+		for (const auto& notification : inbox)
+		{
+			notification(*m_listener);
+		}
+	}
+
+	void NetworkLoopbackTransport::joinRandomRoom(const int32 maxPlayers)
+	{
+		std::lock_guard lock{ m_hub.m_mutex };
+
+		if ((not m_connected) || m_roomName)
+		{
+			return;
+		}
+
+		// 条件を満たすルームのうち、最も早く作られたものを選ぶ
+		NetworkLoopbackHub::Room* found = nullptr;
+
+		for (auto& [name, room] : m_hub.m_rooms)
+		{
+			if (room.isOpen && room.isVisible
+				&& (room.maxPlayers == maxPlayers)
+				&& (room.players.size() < static_cast<size_t>(room.maxPlayers))
+				&& ((not found) || (room.serial < found->serial)))
+			{
+				found = &room;
+			}
+		}
+
+		if (not found)
+		{
+			post([](Listener& listener) { listener.joinRandomRoomReturn(-1, NetworkSystem::NoRandomMatchFound, U"No match found"); });
+			return;
+		}
+
+		m_hub.enterRoom(*this, *found, NetworkLoopbackHub::JoinKind::JoinRandom);
+	}
+
+	void NetworkLoopbackTransport::joinRoom(const StringView roomName)
+	{
+		std::lock_guard lock{ m_hub.m_mutex };
+
+		if ((not m_connected) || m_roomName)
+		{
+			return;
+		}
+
+		NetworkLoopbackHub::Room* room = m_hub.findRoom(roomName);
+
+		if (not room)
+		{
+			post([](Listener& listener) { listener.joinRoomReturn(-1, NetworkSystem::GameDoesNotExist, U"Game does not exist"); });
+			return;
+		}
+
+		if (not room->isOpen)
+		{
+			post([](Listener& listener) { listener.joinRoomReturn(-1, NetworkSystem::GameClosed, U"Game closed"); });
+			return;
+		}
+
+		if (static_cast<size_t>(room->maxPlayers) <= room->players.size())
+		{
+			post([](Listener& listener) { listener.joinRoomReturn(-1, NetworkSystem::GameFull, U"Game full"); });
+			return;
+		}
+
+		m_hub.enterRoom(*this, *room, NetworkLoopbackHub::JoinKind::Join);
+	}
+
+	void NetworkLoopbackTransport::createRoom(const StringView roomName, const int32 maxPlayers)
+	{
+		std::lock_guard lock{ m_hub.m_mutex };
+
+		if ((not m_connected) || m_roomName)
+		{
+			return;
+		}
+
+		const uint64 serial = ++m_hub.m_roomSerial;
+
+		// Photon と同様に、ルーム名が空の場合はサーバ側で名前を決める
+		const String name = (roomName.isEmpty() ? U"loopback_{}"_fmt(serial) : String{ roomName });
+
+		if (m_hub.findRoom(name))
+		{
+			post([](Listener& listener) { listener.createRoomReturn(-1, NetworkSystem::GameIdAlreadyExists, U"A game with the specified id already exist."); });
+			return;
+		}
+
+		NetworkLoopbackHub::Room& room = m_hub.m_rooms[name];
+		room.name = name;
+		room.maxPlayers = maxPlayers;
+		room.serial = serial;
+
+		m_hub.enterRoom(*this, room, NetworkLoopbackHub::JoinKind::Create);
+	}
+
+	void NetworkLoopbackTransport::leaveRoom()
+	{
+		std::lock_guard lock{ m_hub.m_mutex };
+
+		if (not m_roomName)
+		{
+			return;
+		}
+
+		m_hub.exitRoom(*this);
+
+		post([](Listener& listener) { listener.leaveRoomReturn(0, U""); });
+	}
+
+	void NetworkLoopbackTransport::changeGroups(const Array<uint8>& groupsToRemove, const Array<uint8>& groupsToAdd)
+	{
+		std::lock_guard lock{ m_hub.m_mutex };
+
+		// Photon と同様に、削除を先に行う
+		for (const auto group : groupsToRemove)
+		{
+			m_groups.remove(group);
+		}
+
+		for (const auto group : groupsToAdd)
+		{
+			if (not m_groups.contains(group))
+			{
+				m_groups << group;
+			}
+		}
+	}
+
+	void NetworkLoopbackTransport::raiseEvent(const uint8 eventCode, const Blob& eventContent, const NetworkSystem::EventOption& option, const EventFormat format)
+	{
+		std::lock_guard lock{ m_hub.m_mutex };
+
+		const NetworkLoopbackHub::Room* room = currentRoom();
+
+		if (not room)
+		{
+			return;
+		}
+
+		const int32 senderID = m_localPlayerID;
+		const bool reliable = option.reliable;
+
+		// 受信者全員で 1 つのコピーを共有する
+		const auto content = std::make_shared<const Blob>(eventContent);
+
+		for (auto* player : room->players)
+		{
+			const int32 playerID = player->m_localPlayerID;
+
+			if (option.targetPlayers)
+			{
+				if (not option.targetPlayers.contains(playerID))
+				{
+					continue;
+				}
+			}
+			else
+			{
+				switch (option.receiverGroup)
+				{
+				case NetworkSystem::ReceiverGroup::All:
+					break;
+				case NetworkSystem::ReceiverGroup::MasterClient:
+					if (playerID != room->masterClientID)
+					{
+						continue;
+					}
+					break;
+				default:
+					if (player == this)
+					{
+						continue;
+					}
+					break;
+				}
+
+				if (option.interestGroup && (not player->m_groups.contains(option.interestGroup)))
+				{
+					continue;
+				}
+			}
+
+			player->post([=](Listener& listener) { listener.customEventAction(senderID, eventCode, *content, reliable, format); });
+		}
+	}
+
+	String NetworkLoopbackTransport::getName() const
+	{
+		std::lock_guard lock{ m_hub.m_mutex };
+
+		return m_userName;
+	}
+
+	String NetworkLoopbackTransport::getUserID() const
+	{
+		std::lock_guard lock{ m_hub.m_mutex };
+
+		return m_userID;
+	}
+
+	Array<String> NetworkLoopbackTransport::getRoomNameList() const
+	{
+		return getRoomList().map([](const NetworkSystem::RoomInfo& room) { return room.name; });
+	}
+
+	Array<NetworkSystem::RoomInfo> NetworkLoopbackTransport::getRoomList() const
+	{
+		std::lock_guard lock{ m_hub.m_mutex };
+
+		Array<const NetworkLoopbackHub::Room*> rooms;
+
+		for (const auto& [name, room] : m_hub.m_rooms)
+		{
+			if (room.isVisible)
+			{
+				rooms << &room;
+			}
+		}
+
+		rooms.sort_by([](const auto* a, const auto* b) { return (a->serial < b->serial); });
+
+		Array<NetworkSystem::RoomInfo> result;
+
+		for (const auto* room : rooms)
+		{
+			NetworkSystem::RoomInfo info;
+			info.name = room->name;
+			info.playerCount = static_cast<int32>(room->players.size());
+			info.maxPlayers = room->maxPlayers;
+			info.isOpen = room->isOpen;
+			info.isVisible = room->isVisible;
+			result << std::move(info);
+		}
+
+		return result;
+	}
+
+	Optional<uint64> NetworkLoopbackTransport::getRoomListVersion() const
+	{
+		return m_hub.m_version.load(std::memory_order_acquire);
+	}
+
+	Optional<uint64> NetworkLoopbackTransport::getStateVersion() const
+	{
+		return m_hub.m_version.load(std::memory_order_acquire);
+	}
+
+	bool NetworkLoopbackTransport::isInRoom() const
+	{
+		std::lock_guard lock{ m_hub.m_mutex };
+
+		return (not m_roomName.isEmpty());
+	}
+
+	String NetworkLoopbackTransport::getCurrentRoomName() const
+	{
+		std::lock_guard lock{ m_hub.m_mutex };
+
+		return m_roomName;
+	}
+
+	int32 NetworkLoopbackTransport::getPlayerCountInCurrentRoom() const
+	{
+		std::lock_guard lock{ m_hub.m_mutex };
+
+		if (const auto* room = currentRoom())
+		{
+			return static_cast<int32>(room->players.size());
+		}
+
+		return 0;
+	}
+
+	int32 NetworkLoopbackTransport::getMaxPlayersInCurrentRoom() const
+	{
+		std::lock_guard lock{ m_hub.m_mutex };
+
+		if (const auto* room = currentRoom())
+		{
+			return room->maxPlayers;
+		}
+
+		return 0;
+	}
+
+	bool NetworkLoopbackTransport::getIsOpenInCurrentRoom() const
+	{
+		std::lock_guard lock{ m_hub.m_mutex };
+
+		if (const auto* room = currentRoom())
+		{
+			return room->isOpen;
+		}
+
+		return false;
+	}
+
+	bool NetworkLoopbackTransport::getIsVisibleInCurrentRoom() const
+	{
+		std::lock_guard lock{ m_hub.m_mutex };
+
+		if (const auto* room = currentRoom())
+		{
+			return room->isVisible;
+		}
+
+		return false;
+	}
+
+	void NetworkLoopbackTransport::setIsOpenInCurrentRoom(const bool isOpen)
+	{
+		std::lock_guard lock{ m_hub.m_mutex };
+
+		if (auto* room = m_hub.findRoom(m_roomName))
+		{
+			room->isOpen = isOpen;
+			++m_hub.m_version;
+		}
+	}
+
+	void NetworkLoopbackTransport::setIsVisibleInCurrentRoom(const bool isVisible)
+	{
+		std::lock_guard lock{ m_hub.m_mutex };
+
+		if (auto* room = m_hub.findRoom(m_roomName))
+		{
+			room->isVisible = isVisible;
+			++m_hub.m_version;
+		}
+	}
+
+	int32 NetworkLoopbackTransport::getCountGamesRunning() const
+	{
+		std::lock_guard lock{ m_hub.m_mutex };
+
+		return static_cast<int32>(m_hub.m_rooms.size());
+	}
+
+	int32 NetworkLoopbackTransport::getCountPlayersIngame() const
+	{
+		std::lock_guard lock{ m_hub.m_mutex };
+
+		size_t count = 0;
+
+		for (const auto& [name, room] : m_hub.m_rooms)
+		{
+			count += room.players.size();
+		}
+
+		return static_cast<int32>(count);
+	}
+
+	int32 NetworkLoopbackTransport::getCountPlayersOnline() const
+	{
+		std::lock_guard lock{ m_hub.m_mutex };
+
+		return static_cast<int32>(m_hub.m_peers.size());
+	}
+
+	Optional<int32> NetworkLoopbackTransport::localPlayerID() const
+	{
+		std::lock_guard lock{ m_hub.m_mutex };
+
+		if (m_localPlayerID < 0)
+		{
+			return none;
+		}
+
+		return m_localPlayerID;
+	}
+
+	Optional<int32> NetworkLoopbackTransport::getMasterClientID() const
+	{
+		std::lock_guard lock{ m_hub.m_mutex };
+
+		if (const auto* room = currentRoom())
+		{
+			return room->masterClientID;
+		}
+
+		return none;
+	}
+
+	int32 NetworkLoopbackTransport::getServerTimeMillisec() const
+	{
+		// Photon のサーバ時刻と同様に、32 ビットで折り返すミリ秒
+		const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_hub.m_startTime);
+		return static_cast<int32>(static_cast<uint32>(elapsed.count()));
+	}
+
+	int32 NetworkLoopbackTransport::getRoundTripTimeMillisec() const
+	{
+		return 0;
+	}
+
+	NetworkStatistics::ConnectionStats NetworkLoopbackTransport::getConnectionStats() const
+	{
+		std::lock_guard lock{ m_hub.m_mutex };
+
+		NetworkStatistics::ConnectionStats stats;
+		stats.queuedIncoming = m_inbox.size();
+		return stats;
+	}
+
+	const NetworkLoopbackHub::Room* NetworkLoopbackTransport::currentRoom() const
+	{
+		if (not m_roomName)
+		{
+			return nullptr;
+		}
+
+		return m_hub.findRoom(m_roomName);
+	}
+
+	void NetworkLoopbackTransport::post(Notification notification)
+	{
+		m_inbox << std::move(notification);
+	}
+}
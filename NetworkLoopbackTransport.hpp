@@ -0,0 +1,240 @@
+﻿
+# pragma once
+# include <atomic>
+# include <chrono>
+# include <mutex>
+# include <Siv3D.hpp>
+# include "NetworkTransport.hpp"
+
+namespace s3d
+{
+	class NetworkLoopbackTransport;
+
+	/// @brief 同じプロセス内の NetworkLoopbackTransport を結ぶ、Photon サーバの代わりとなるクラスです。
+	/// @remark ルーム、プレイヤー ID の割り当て、マスタークライアントの選出、イベントの配信を Photon と同じ規則で再現します。
+	/// ネットワークも Photon アプリケーション ID も使わないため、SivPhoton を使う処理のテストやベンチマークを決定的に行えます。
+	/// 複数のスレッドから使うことができます。NetworkLoopbackHub はすべての NetworkLoopbackTransport よりも長く存在する必要があります。
+	class NetworkLoopbackHub
+	{
+	public:
+
+		NetworkLoopbackHub();
+
+		NetworkLoopbackHub(const NetworkLoopbackHub&) = delete;
+
+		NetworkLoopbackHub& operator =(const NetworkLoopbackHub&) = delete;
+
+		/// @brief このハブにつながるトランスポートを作成します。
+		/// @return トランスポート
+		[[nodiscard]]
+		std::unique_ptr<NetworkLoopbackTransport> createTransport();
+
+		/// @brief 存在するルームの数を返します。
+		/// @return ルームの数
+		[[nodiscard]]
+		size_t num_rooms() const;
+
+		/// @brief 接続しているトランスポートの数を返します。
+		/// @return トランスポートの数
+		[[nodiscard]]
+		size_t num_peers() const;
+
+	private:
+
+		friend class NetworkLoopbackTransport;
+
+		struct Room
+		{
+			String name;
+
+			/// @brief 作成された順番
+			uint64 serial = 0;
+
+			int32 maxPlayers = 0;
+
+			bool isOpen = true;
+
+			bool isVisible = true;
+
+			/// @brief 次に割り当てるプレイヤー ID (Photon と同様に 1 から始まり、再利用しない)
+			int32 nextPlayerID = 1;
+
+			int32 masterClientID = 0;
+
+			/// @brief 参加した順のプレイヤー
+			Array<NetworkLoopbackTransport*> players;
+		};
+
+		/// @brief 入室の結果を通知するコールバックの種類
+		enum class JoinKind : uint8
+		{
+			Create,
+
+			Join,
+
+			JoinRandom,
+		};
+
+		mutable std::mutex m_mutex;
+
+		HashTable<String, Room> m_rooms;
+
+		Array<NetworkLoopbackTransport*> m_peers;
+
+		std::chrono::steady_clock::time_point m_startTime;
+
+		uint64 m_userSerial = 0;
+
+		uint64 m_roomSerial = 0;
+
+		/// @brief 接続・切断・ルームの作成・削除・入退室・公開状態の変更のたびに増える値
+		/// @remark 変更は m_mutex をロックした状態で行い、読み込みはロックせずに行う
+		std::atomic<uint64> m_version{ 0 };
+
+		// 以下はすべて m_mutex をロックした状態で呼ぶ
+
+		[[nodiscard]]
+		Room* findRoom(StringView roomName);
+
+		void enterRoom(NetworkLoopbackTransport& peer, Room& room, JoinKind kind);
+
+		void exitRoom(NetworkLoopbackTransport& peer);
+	};
+
+	/// @brief NetworkLoopbackHub を介して、同じプロセス内の SivPhoton 同士を通信させるトランスポートです。
+	class NetworkLoopbackTransport : public NetworkTransport
+	{
+	public:
+
+		/// @brief NetworkLoopbackTransport を作成します。
+		/// @param hub 接続先のハブ
+		explicit NetworkLoopbackTransport(NetworkLoopbackHub& hub);
+
+		~NetworkLoopbackTransport() override;
+
+		NetworkLoopbackTransport(const NetworkLoopbackTransport&) = delete;
+
+		NetworkLoopbackTransport& operator =(const NetworkLoopbackTransport&) = delete;
+
+		bool connect(StringView userName) override;
+
+		void disconnect() override;
+
+		void update() override;
+
+		void joinRandomRoom(int32 maxPlayers) override;
+
+		void joinRoom(StringView roomName) override;
+
+		void createRoom(StringView roomName, int32 maxPlayers) override;
+
+		void leaveRoom() override;
+
+		void changeGroups(const Array<uint8>& groupsToRemove, const Array<uint8>& groupsToAdd) override;
+
+		void raiseEvent(uint8 eventCode, const Blob& eventContent, const NetworkSystem::EventOption& option, EventFormat format) override;
+
+		[[nodiscard]]
+		String getName() const override;
+
+		[[nodiscard]]
+		String getUserID() const override;
+
+		[[nodiscard]]
+		Array<String> getRoomNameList() const override;
+
+		[[nodiscard]]
+		Array<NetworkSystem::RoomInfo> getRoomList() const override;
+
+		/// @brief ルームの一覧の版を返します。
+		/// @return NetworkLoopbackHub のいずれかのルームが作成・削除されるか、入退室や公開状態の変更があるたびに増える値
+		/// @remark ミューテックスをロックしません。
+		[[nodiscard]]
+		Optional<uint64> getRoomListVersion() const override;
+
+		/// @brief 自分と参加しているルームの状態の版を返します。
+		/// @return getRoomListVersion() と同じ値に、接続と切断を加えたもの
+		/// @remark ミューテックスをロックしません。他のルームの変更でも値が変わるため、必要以上に読み直すことがあります。
+		[[nodiscard]]
+		Optional<uint64> getStateVersion() const override;
+
+		[[nodiscard]]
+		bool isInRoom() const override;
+
+		[[nodiscard]]
+		String getCurrentRoomName() const override;
+
+		[[nodiscard]]
+		int32 getPlayerCountInCurrentRoom() const override;
+
+		[[nodiscard]]
+		int32 getMaxPlayersInCurrentRoom() const override;
+
+		[[nodiscard]]
+		bool getIsOpenInCurrentRoom() const override;
+
+		[[nodiscard]]
+		bool getIsVisibleInCurrentRoom() const override;
+
+		void setIsOpenInCurrentRoom(bool isOpen) override;
+
+		void setIsVisibleInCurrentRoom(bool isVisible) override;
+
+		[[nodiscard]]
+		int32 getCountGamesRunning() const override;
+
+		[[nodiscard]]
+		int32 getCountPlayersIngame() const override;
+
+		[[nodiscard]]
+		int32 getCountPlayersOnline() const override;
+
+		[[nodiscard]]
+		Optional<int32> localPlayerID() const override;
+
+		[[nodiscard]]
+		Optional<int32> getMasterClientID() const override;
+
+		[[nodiscard]]
+		int32 getServerTimeMillisec() const override;
+
+		[[nodiscard]]
+		int32 getRoundTripTimeMillisec() const override;
+
+		/// @brief 通信路の状態を返します。
+		/// @return 次の update() で通知する内容の数 (queuedIncoming) のみ
+		[[nodiscard]]
+		NetworkStatistics::ConnectionStats getConnectionStats() const override;
+
+	private:
+
+		friend class NetworkLoopbackHub;
+
+		using Notification = std::function<void(NetworkTransport::Listener&)>;
+
+		NetworkLoopbackHub& m_hub;
+
+		// 以下はすべて m_hub.m_mutex で保護される
+
+		bool m_connected = false;
+
+		String m_userName;
+
+		String m_userID;
+
+		/// @brief 参加しているルームの名前 (参加していない場合は空)
+		String m_roomName;
+
+		int32 m_localPlayerID = -1;
+
+		Array<uint8> m_groups;
+
+		/// @brief 次の update() で Listener に通知する内容
+		Array<Notification> m_inbox;
+
+		[[nodiscard]]
+		const NetworkLoopbackHub::Room* currentRoom() const;
+
+		void post(Notification notification);
+	};
+}
@@ -0,0 +1,330 @@
+﻿
+# pragma once
+# include <Siv3D.hpp>
+
+namespace s3d
+{
+	/// @brief 送信データをバイト列に書き込むクラスです。
+	/// @remark トリビアルコピー可能な型はそのままのメモリ表現で書き込みます。
+	class NetworkPacketWriter
+	{
+	public:
+
+		NetworkPacketWriter() = default;
+
+		/// @brief バッファを予約して NetworkPacketWriter を作成します。
+		/// @param reserveBytes 予約するバイト数
+		explicit NetworkPacketWriter(const size_t reserveBytes)
+		{
+			m_blob.reserve(reserveBytes);
+		}
+
+		/// @brief 値を書き込みます。
+		/// @tparam Type トリビアルコピー可能な型
+		/// @param value 書き込む値
+		template <class Type, std::enable_if_t<std::is_trivially_copyable_v<Type>>* = nullptr>
+		void write(const Type& value)
+		{
+			m_blob.append(&value, sizeof(Type));
+		}
+
+		/// @brief 文字列を UTF-8 で書き込みます。
+		/// @param value 書き込む文字列
+		void write(const StringView value)
+		{
+			const std::string utf8 = Unicode::ToUTF8(value);
+			write(static_cast<uint32>(utf8.size()));
+			m_blob.append(utf8.data(), utf8.size());
+		}
+
+		/// @brief 配列を要素数とともに書き込みます。
+		/// @tparam Type トリビアルコピー可能な型
+		/// @param values 書き込む配列
+		template <class Type, std::enable_if_t<std::is_trivially_copyable_v<Type>>* = nullptr>
+		void write(const Array<Type>& values)
+		{
+			write(static_cast<uint32>(values.size()));
+			m_blob.append(values.data(), (values.size() * sizeof(Type)));
+		}
+
+		/// @brief 文字列の配列を要素数とともに書き込みます。
+		/// @param values 書き込む配列
+		void write(const Array<String>& values)
+		{
+			write(static_cast<uint32>(values.size()));
+
+			for (const auto& value : values)
+			{
+				write(StringView{ value });
+			}
+		}
+
+		/// @brief 二次元配列を大きさとともに書き込みます。
+		/// @tparam Type トリビアルコピー可能な型
+		/// @param values 書き込む二次元配列
+		template <class Type, std::enable_if_t<std::is_trivially_copyable_v<Type>>* = nullptr>
+		void write(const Grid<Type>& values)
+		{
+			write(static_cast<uint32>(values.width()));
+			write(static_cast<uint32>(values.height()));
+			m_blob.append(values.data(), (values.num_elements() * sizeof(Type)));
+		}
+
+		/// @brief メモリ上の連続したデータをそのまま書き込みます。
+		/// @param data データの先頭ポインタ
+		/// @param size データのバイト数
+		void writeBytes(const void* data, const size_t size)
+		{
+			m_blob.append(data, size);
+		}
+
+		/// @brief 既に書き込んだ位置の値を上書きします。
+		/// @tparam Type トリビアルコピー可能な型
+		/// @param offset 上書きする位置 (バイト)
+		/// @param value 上書きする値
+		/// @remark 要素数を後から確定させたい場合に使います。
+		template <class Type, std::enable_if_t<std::is_trivially_copyable_v<Type>>* = nullptr>
+		void overwrite(const size_t offset, const Type& value)
+		{
+			assert((offset + sizeof(Type)) <= m_blob.size());
+
+			std::memcpy((m_blob.data() + offset), &value, sizeof(Type));
+		}
+
+		/// @brief 書き込んだバイト数を返します。
+		/// @return 書き込んだバイト数
+		[[nodiscard]]
+		size_t size() const noexcept
+		{
+			return m_blob.size();
+		}
+
+		/// @brief 何も書き込まれていないかを返します。
+		/// @return 何も書き込まれていない場合 true, それ以外の場合は false
+		[[nodiscard]]
+		bool isEmpty() const noexcept
+		{
+			return m_blob.isEmpty();
+		}
+
+		/// @brief 書き込んだデータを消去します。
+		/// @remark 確保済みのメモリは保持されます。
+		void clear()
+		{
+			m_blob.clear();
+		}
+
+		/// @brief 書き込んだデータを返します。
+		/// @return 書き込んだデータ
+		[[nodiscard]]
+		const Blob& getBlob() const noexcept
+		{
+			return m_blob;
+		}
+
+	private:
+
+		Blob m_blob;
+	};
+
+	/// @brief 受信したバイト列からデータを読み込むクラスです。
+	/// @remark 読み込みに失敗した場合、以降の読み込みはすべて失敗します。
+	class NetworkPacketReader
+	{
+	public:
+
+		/// @brief NetworkPacketReader を作成します。
+		/// @param data 読み込むデータの先頭ポインタ
+		/// @param size 読み込むデータのバイト数
+		NetworkPacketReader(const void* data, const size_t size) noexcept
+			: m_data{ static_cast<const Byte*>(data) }
+			, m_size{ size } {}
+
+		/// @brief NetworkPacketReader を作成します。
+		/// @param blob 読み込むデータ
+		/// @remark 読み込みが終わるまで blob を破棄しないでください。
+		explicit NetworkPacketReader(const Blob& blob) noexcept
+			: NetworkPacketReader{ blob.data(), blob.size() } {}
+
+		/// @brief 値を読み込みます。
+		/// @tparam Type トリビアルコピー可能な型
+		/// @param value 読み込んだ値の格納先
+		/// @return 読み込みに成功した場合 true, それ以外の場合は false
+		template <class Type, std::enable_if_t<std::is_trivially_copyable_v<Type>>* = nullptr>
+		bool read(Type& value) noexcept
+		{
+			if (not canRead(sizeof(Type)))
+			{
+				return false;
+			}
+
+			std::memcpy(&value, (m_data + m_pos), sizeof(Type));
+			m_pos += sizeof(Type);
+			return true;
+		}
+
+		/// @brief UTF-8 で書き込まれた文字列を読み込みます。
+		/// @param value 読み込んだ文字列の格納先
+		/// @return 読み込みに成功した場合 true, それ以外の場合は false
+		bool read(String& value)
+		{
+			uint32 length = 0;
+
+			if ((not read(length)) || (not canRead(length)))
+			{
+				return false;
+			}
+
+			value = Unicode::FromUTF8(std::string_view{ reinterpret_cast<const char*>(m_data + m_pos), length });
+			m_pos += length;
+			return true;
+		}
+
+		/// @brief 要素数とともに書き込まれた配列を読み込みます。
+		/// @tparam Type トリビアルコピー可能な型
+		/// @param values 読み込んだ配列の格納先
+		/// @return 読み込みに成功した場合 true, それ以外の場合は false
+		template <class Type, std::enable_if_t<std::is_trivially_copyable_v<Type>>* = nullptr>
+		bool read(Array<Type>& values)
+		{
+			uint32 count = 0;
+
+			// 掛け算が桁あふれしないように、残りのバイト数を割って比べる
+			if ((not read(count)) || ((remaining() / sizeof(Type)) < count))
+			{
+				m_failed = true;
+				return false;
+			}
+
+			values.resize(count);
+			return readBytes(values.data(), (count * sizeof(Type)));
+		}
+
+		/// @brief 要素数とともに書き込まれた文字列の配列を読み込みます。
+		/// @param values 読み込んだ配列の格納先
+		/// @return 読み込みに成功した場合 true, それ以外の場合は false
+		bool read(Array<String>& values)
+		{
+			uint32 count = 0;
+
+			// 各文字列には少なくとも長さ (uint32) があるので、残りのバイト数を超える要素数は不正
+			if ((not read(count)) || ((remaining() / sizeof(uint32)) < count))
+			{
+				m_failed = true;
+				return false;
+			}
+
+			values.resize(count);
+
+			for (auto& value : values)
+			{
+				if (not read(value))
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		/// @brief 大きさとともに書き込まれた二次元配列を読み込みます。
+		/// @tparam Type トリビアルコピー可能な型
+		/// @param values 読み込んだ二次元配列の格納先
+		/// @return 読み込みに成功した場合 true, それ以外の場合は false
+		template <class Type, std::enable_if_t<std::is_trivially_copyable_v<Type>>* = nullptr>
+		bool read(Grid<Type>& values)
+		{
+			uint32 width = 0, height = 0;
+
+			if ((not read(width)) || (not read(height)))
+			{
+				return false;
+			}
+
+			// width と height はどちらも受信したデータなので、掛け算が桁あふれしないように残りのバイト数を割って比べる
+			if ((width != 0) && (((remaining() / sizeof(Type)) / width) < height))
+			{
+				m_failed = true;
+				return false;
+			}
+
+			values.resize(width, height);
+			return readBytes(values.data(), (values.num_elements() * sizeof(Type)));
+		}
+
+		/// @brief メモリ上の連続したデータをそのまま読み込みます。
+		/// @param dst 読み込んだデータの格納先
+		/// @param size 読み込むバイト数
+		/// @return 読み込みに成功した場合 true, それ以外の場合は false
+		bool readBytes(void* dst, const size_t size) noexcept
+		{
+			if (not canRead(size))
+			{
+				return false;
+			}
+
+			std::memcpy(dst, (m_data + m_pos), size);
+			m_pos += size;
+			return true;
+		}
+
+		/// @brief 読み込み位置を進めます。
+		/// @param size 進めるバイト数
+		/// @return 成功した場合 true, それ以外の場合は false
+		bool skip(const size_t size) noexcept
+		{
+			if (not canRead(size))
+			{
+				return false;
+			}
+
+			m_pos += size;
+			return true;
+		}
+
+		/// @brief 現在の読み込み位置のポインタを返します。
+		/// @return 現在の読み込み位置のポインタ
+		[[nodiscard]]
+		const Byte* current() const noexcept
+		{
+			return (m_data + m_pos);
+		}
+
+		/// @brief 残りのバイト数を返します。
+		/// @return 残りのバイト数
+		[[nodiscard]]
+		size_t remaining() const noexcept
+		{
+			return (m_failed ? 0 : (m_size - m_pos));
+		}
+
+		/// @brief これまでの読み込みがすべて成功しているかを返します。
+		/// @return すべて成功している場合 true, それ以外の場合は false
+		[[nodiscard]]
+		bool isValid() const noexcept
+		{
+			return (not m_failed);
+		}
+
+	private:
+
+		const Byte* m_data = nullptr;
+
+		size_t m_size = 0;
+
+		size_t m_pos = 0;
+
+		bool m_failed = false;
+
+		bool canRead(const size_t size) noexcept
+		{
+			if (m_failed || ((m_size - m_pos) < size))
+			{
+				m_failed = true;
+				return false;
+			}
+
+			return true;
+		}
+	};
+}
@@ -0,0 +1,474 @@
+﻿
+# pragma once
+# include <Siv3D.hpp>
+# include "NetworkSystem.hpp"
+# include "NetworkPacket.hpp"
+
+namespace s3d
+{
+	/// @brief マスタークライアントが状態を決める (権威を持つ) ゲームで、自分の入力を即座に反映するためのクラスです。
+	/// @tparam State トリビアルコピー可能なプレイヤーの状態の型
+	/// @tparam Input トリビアルコピー可能な入力の型
+	/// @remark 入力には通し番号が付けられ、マスタークライアントに送られます。
+	/// マスタークライアントから処理済みの番号とともに正しい状態が届くと、その状態から未処理の入力を再適用します。
+	/// 未処理の入力は処理済みの番号が届くまで毎回送り直され、マスタークライアントは番号の順に 1 つずつ適用します。
+	template <class State, class Input>
+	class NetworkPrediction
+	{
+	public:
+
+		static_assert(std::is_trivially_copyable_v<State>);
+
+		static_assert(std::is_trivially_copyable_v<Input>);
+
+		/// @brief 予測の統計
+		struct Stats
+		{
+			/// @brief マスタークライアントが未処理の入力の数
+			size_t pendingInputs = 0;
+
+			/// @brief マスタークライアントが処理済みの最新の入力の番号
+			uint32 acknowledgedSequence = 0;
+
+			/// @brief 正しい状態から入力を再適用した回数
+			uint64 reconciliations = 0;
+
+			/// @brief 再適用の結果が予測と異なっていた回数
+			uint64 corrections = 0;
+		};
+
+		/// @brief NetworkPrediction を作成します。
+		/// @param network 送受信に使う SivPhoton
+		/// @param eventCode 送受信に使うイベントコード
+		/// @param apply 状態に入力を 1 回適用する関数
+		/// @param initialState 各プレイヤーの最初の状態
+		/// @remark apply は同じ状態と入力に対して常に同じ結果を返す必要があります。
+		NetworkPrediction(SivPhoton& network, uint8 eventCode, std::function<void(State&, const Input&)> apply, const State& initialState = State{});
+
+		~NetworkPrediction();
+
+		NetworkPrediction(const NetworkPrediction&) = delete;
+
+		NetworkPrediction& operator =(const NetworkPrediction&) = delete;
+
+		/// @brief 自分の入力に番号を付け、自分の状態に即座に適用します。
+		/// @param input 自分の入力
+		/// @remark 入力は次の update() で送信されます。
+		void applyInput(const Input& input);
+
+		/// @brief 入力または状態を送信します。
+		/// @remark マスタークライアント以外は未処理の入力をマスタークライアントに送り、
+		/// マスタークライアントは全員の状態と処理済みの入力の番号を送ります。1 ティックに 1 回呼んでください。
+		void update();
+
+		/// @brief 予測した自分の状態を返します。
+		/// @return 自分の状態
+		[[nodiscard]]
+		const State& getState() const noexcept;
+
+		/// @brief マスタークライアントから受信した、プレイヤーの最新の状態を返します。
+		/// @param playerID プレイヤー ID
+		/// @return プレイヤーの状態, 存在しない場合は none
+		[[nodiscard]]
+		Optional<State> getState(int32 playerID) const;
+
+		/// @brief 最新の状態があるプレイヤー ID の一覧を返します。
+		/// @return プレイヤー ID の一覧
+		[[nodiscard]]
+		const Array<int32>& playerIDs() const noexcept;
+
+		/// @brief プレイヤーがルームから退室したことを通知します。
+		/// @param playerID 退室したプレイヤーの ID
+		/// @remark SivPhoton::leaveRoomEventAction() から呼んでください。
+		void onPlayerLeft(int32 playerID);
+
+		/// @brief 予測の統計を返します。
+		/// @return 予測の統計
+		[[nodiscard]]
+		const Stats& getStats() const noexcept;
+
+	private:
+
+		enum class MessageType : uint8
+		{
+			Inputs,
+
+			Snapshot,
+		};
+
+		struct PendingInput
+		{
+			uint32 sequence = 0;
+
+			Input input;
+		};
+
+		/// @brief 1 回のイベントで送る未処理の入力の最大数 (これを超える分は複数のイベントに分けて送る)
+		static constexpr size_t MaxInputsPerEvent = 64;
+
+		/// @brief 保持する未処理の入力の最大数
+		/// @remark これを超えた古い入力は破棄され、マスタークライアントはその番号を飛ばします。
+		static constexpr size_t MaxPendingInputs = 256;
+
+		SivPhoton& m_network;
+
+		uint8 m_eventCode = 0;
+
+		std::function<void(State&, const Input&)> m_apply;
+
+		State m_initialState;
+
+		// 自分の予測
+		State m_state;
+
+		uint32 m_sequence = 0;
+
+		Array<PendingInput> m_pendingInputs;
+
+		Optional<int32> m_lastSnapshotSenderID;
+
+		uint32 m_lastSnapshotSerial = 0;
+
+		bool m_wasMasterClient = false;
+
+		// 最新のスナップショット (マスタークライアントでは権威を持つ状態)
+		Array<int32> m_playerIDs;
+
+		Array<uint32> m_sequences;
+
+		Array<State> m_states;
+
+		uint32 m_snapshotSerial = 0;
+
+		NetworkPacketWriter m_writer;
+
+		Stats m_stats;
+
+		[[nodiscard]]
+		size_t findOrAddPlayer(int32 playerID);
+
+		void reconcile(int32 localPlayerID);
+
+		void onReceive(int32 playerID, const Blob& data);
+	};
+}
+
+namespace s3d
+{
+	template <class State, class Input>
+	NetworkPrediction<State, Input>::NetworkPrediction(SivPhoton& network, const uint8 eventCode, std::function<void(State&, const Input&)> apply, const State& initialState)
+		: m_network{ network }
+		, m_eventCode{ eventCode }
+		, m_apply{ std::move(apply) }
+		, m_initialState{ initialState }
+		, m_state{ initialState }
+	{
+		assert(m_apply);
+
+		m_network.setEventHandler(m_eventCode, [this](const int32 playerID, const Blob& data) { onReceive(playerID, data); });
+	}
+
+	template <class State, class Input>
+	NetworkPrediction<State, Input>::~NetworkPrediction()
+	{
+		m_network.removeEventHandler(m_eventCode);
+	}
+
+	template <class State, class Input>
+	void NetworkPrediction<State, Input>::applyInput(const Input& input)
+	{
+		const auto localPlayerID = m_network.localPlayerID();
+
+		if (not localPlayerID)
+		{
+			return;
+		}
+
+		++m_sequence;
+		m_apply(m_state, input);
+
+		if (m_network.isMasterClient())
+		{
+			// マスタークライアントの入力はそのまま権威を持つ状態になる
+			const size_t index = findOrAddPlayer(*localPlayerID);
+			m_states[index] = m_state;
+			m_sequences[index] = m_sequence;
+			m_pendingInputs.clear();
+			m_stats.acknowledgedSequence = m_sequence;
+		}
+		else
+		{
+			if (MaxPendingInputs <= m_pendingInputs.size())
+			{
+				m_pendingInputs.pop_front();
+			}
+
+			m_pendingInputs.push_back({ m_sequence, input });
+		}
+
+		m_stats.pendingInputs = m_pendingInputs.size();
+	}
+
+	template <class State, class Input>
+	void NetworkPrediction<State, Input>::update()
+	{
+		const auto localPlayerID = m_network.localPlayerID();
+
+		if (not localPlayerID)
+		{
+			return;
+		}
+
+		const bool isMasterClient = m_network.isMasterClient();
+
+		if (isMasterClient && (not m_wasMasterClient))
+		{
+			// 新しくマスタークライアントになった場合は、最新のスナップショットを引き継ぎ、自分の予測を正とする
+			const size_t index = findOrAddPlayer(*localPlayerID);
+			m_states[index] = m_state;
+			m_sequences[index] = m_sequence;
+			m_pendingInputs.clear();
+			m_stats.pendingInputs = 0;
+		}
+
+		m_wasMasterClient = isMasterClient;
+
+		if (not isMasterClient)
+		{
+			if (not m_pendingInputs)
+			{
+				return;
+			}
+
+			// 失われたイベントを補えるように、処理済みの番号が届いていない入力をすべて、最も古いものから送る
+			NetworkSystem::EventOption option;
+			option.reliable = false;
+			option.receiverGroup = NetworkSystem::ReceiverGroup::MasterClient;
+
+			// 保持している最も古い入力の番号 (これより前の未処理の入力は破棄済み)
+			const uint32 oldestSequence = m_pendingInputs.front().sequence;
+
+			for (size_t first = 0; first < m_pendingInputs.size(); first += MaxInputsPerEvent)
+			{
+				const size_t count = Min((m_pendingInputs.size() - first), MaxInputsPerEvent);
+
+				m_writer.clear();
+				m_writer.write(MessageType::Inputs);
+				m_writer.write(oldestSequence);
+				m_writer.write(m_pendingInputs[first].sequence);
+				m_writer.write(static_cast<uint8>(count));
+
+				for (size_t i = first; i < (first + count); ++i)
+				{
+					m_writer.write(m_pendingInputs[i].input);
+				}
+
+				m_network.opRaiseEvent(m_eventCode, m_writer.getBlob(), option);
+			}
+
+			return;
+		}
+
+		if (not m_playerIDs)
+		{
+			return;
+		}
+
+		m_writer.clear();
+		m_writer.write(MessageType::Snapshot);
+		m_writer.write(++m_snapshotSerial);
+		m_writer.write(static_cast<uint32>(m_playerIDs.size()));
+		m_writer.writeBytes(m_playerIDs.data(), (m_playerIDs.size() * sizeof(int32)));
+		m_writer.writeBytes(m_sequences.data(), (m_sequences.size() * sizeof(uint32)));
+		m_writer.writeBytes(m_states.data(), (m_states.size() * sizeof(State)));
+
+		m_network.opRaiseEvent(m_eventCode, m_writer.getBlob(), { .reliable = false });
+	}
+
+	template <class State, class Input>
+	const State& NetworkPrediction<State, Input>::getState() const noexcept
+	{
+		return m_state;
+	}
+
+	template <class State, class Input>
+	Optional<State> NetworkPrediction<State, Input>::getState(const int32 playerID) const
+	{
+		for (size_t i = 0; i < m_playerIDs.size(); ++i)
+		{
+			if (m_playerIDs[i] == playerID)
+			{
+				return m_states[i];
+			}
+		}
+
+		return none;
+	}
+
+	template <class State, class Input>
+	const Array<int32>& NetworkPrediction<State, Input>::playerIDs() const noexcept
+	{
+		return m_playerIDs;
+	}
+
+	template <class State, class Input>
+	void NetworkPrediction<State, Input>::onPlayerLeft(const int32 playerID)
+	{
+		for (size_t i = 0; i < m_playerIDs.size(); ++i)
+		{
+			if (m_playerIDs[i] == playerID)
+			{
+				m_playerIDs.remove_at(i);
+				m_sequences.remove_at(i);
+				m_states.remove_at(i);
+				break;
+			}
+		}
+	}
+
+	template <class State, class Input>
+	const typename NetworkPrediction<State, Input>::Stats& NetworkPrediction<State, Input>::getStats() const noexcept
+	{
+		return m_stats;
+	}
+
+	template <class State, class Input>
+	size_t NetworkPrediction<State, Input>::findOrAddPlayer(const int32 playerID)
+	{
+		for (size_t i = 0; i < m_playerIDs.size(); ++i)
+		{
+			if (m_playerIDs[i] == playerID)
+			{
+				return i;
+			}
+		}
+
+		m_playerIDs << playerID;
+		m_sequences << 0;
+		m_states << m_initialState;
+		return (m_playerIDs.size() - 1);
+	}
+
+	template <class State, class Input>
+	void NetworkPrediction<State, Input>::reconcile(const int32 localPlayerID)
+	{
+		const auto it = std::find(m_playerIDs.begin(), m_playerIDs.end(), localPlayerID);
+
+		if (it == m_playerIDs.end())
+		{
+			return;
+		}
+
+		const size_t index = static_cast<size_t>(it - m_playerIDs.begin());
+		const uint32 acknowledged = m_sequences[index];
+
+		// 古いスナップショットの処理済みの番号は無視する
+		if (acknowledged < m_stats.acknowledgedSequence)
+		{
+			return;
+		}
+
+		m_stats.acknowledgedSequence = acknowledged;
+
+		while (m_pendingInputs && (m_pendingInputs.front().sequence <= acknowledged))
+		{
+			m_pendingInputs.pop_front();
+		}
+
+		State state = m_states[index];
+
+		for (const auto& pending : m_pendingInputs)
+		{
+			m_apply(state, pending.input);
+		}
+
+		++m_stats.reconciliations;
+
+		if (std::memcmp(&state, &m_state, sizeof(State)) != 0)
+		{
+			++m_stats.corrections;
+		}
+
+		m_state = state;
+		m_stats.pendingInputs = m_pendingInputs.size();
+	}
+
+	template <class State, class Input>
+	void NetworkPrediction<State, Input>::onReceive(const int32 playerID, const Blob& data)
+	{
+		NetworkPacketReader reader{ data };
+		MessageType type;
+
+		if (not reader.read(type))
+		{
+			return;
+		}
+
+		if (type == MessageType::Inputs)
+		{
+			uint32 oldestSequence = 0;
+			uint32 firstSequence = 0;
+			uint8 count = 0;
+
+			if ((not m_network.isMasterClient())
+				|| (not reader.read(oldestSequence)) || (not reader.read(firstSequence)) || (not reader.read(count))
+				|| (reader.remaining() < (count * sizeof(Input))))
+			{
+				return;
+			}
+
+			const size_t index = findOrAddPlayer(playerID);
+
+			// 送信者が保持しきれずに破棄した入力は、二度と届かないので飛ばす
+			if ((m_sequences[index] + 1) < oldestSequence)
+			{
+				m_sequences[index] = (oldestSequence - 1);
+			}
+
+			for (uint32 i = 0; i < count; ++i)
+			{
+				const uint32 sequence = (firstSequence + i);
+				Input input;
+				reader.read(input);
+
+				// 次の番号の入力のみを適用する。処理済みの入力は無視し、途中が抜けている場合は送り直されるのを待つ
+				if (sequence == (m_sequences[index] + 1))
+				{
+					m_apply(m_states[index], input);
+					m_sequences[index] = sequence;
+				}
+			}
+
+			return;
+		}
+
+		if ((type == MessageType::Snapshot) && (m_network.getMasterClientID() == playerID))
+		{
+			uint32 serial = 0;
+			uint32 count = 0;
+
+			// 順番が入れ替わった古いスナップショットは無視する (マスタークライアントが替わった場合を除く)
+			if ((not reader.read(serial))
+				|| ((m_lastSnapshotSenderID == playerID) && (serial <= m_lastSnapshotSerial))
+				|| (not reader.read(count))
+				|| (reader.remaining() < (count * (sizeof(int32) + sizeof(uint32) + sizeof(State)))))
+			{
+				return;
+			}
+
+			m_lastSnapshotSenderID = playerID;
+			m_lastSnapshotSerial = serial;
+			m_playerIDs.resize(count);
+			m_sequences.resize(count);
+			m_states.resize(count);
+			reader.readBytes(m_playerIDs.data(), (count * sizeof(int32)));
+			reader.readBytes(m_sequences.data(), (count * sizeof(uint32)));
+			reader.readBytes(m_states.data(), (count * sizeof(State)));
+
+			if (const auto localPlayerID = m_network.localPlayerID())
+			{
+				reconcile(*localPlayerID);
+			}
+		}
+	}
+}
@@ -0,0 +1,61 @@
+﻿
+# include "NetworkRPC.hpp"
+
+namespace s3d
+{
+	NetworkRPC::NetworkRPC(SivPhoton& network, const uint8 eventCode)
+		: m_network{ network }
+		, m_eventCode{ eventCode }
+	{
+		m_network.setEventHandler(m_eventCode, [this](const int32 playerID, const Blob& data) { onReceive(playerID, data); });
+	}
+
+	NetworkRPC::~NetworkRPC()
+	{
+		m_network.removeEventHandler(m_eventCode);
+	}
+
+	void NetworkRPC::unbind(const NetworkRPCID rpcID)
+	{
+		m_invokers.erase(rpcID);
+	}
+
+	bool NetworkRPC::isBound(const NetworkRPCID rpcID) const
+	{
+		return m_invokers.contains(rpcID);
+	}
+
+	const NetworkRPC::Stats& NetworkRPC::getStats() const noexcept
+	{
+		return m_stats;
+	}
+
+	void NetworkRPC::onReceive(const int32 playerID, const Blob& data)
+	{
+		NetworkPacketReader reader{ data };
+		NetworkRPCID rpcID = 0;
+
+		if (not reader.read(rpcID))
+		{
+			++m_stats.malformedCalls;
+			return;
+		}
+
+		const auto it = m_invokers.find(rpcID);
+
+		if (it == m_invokers.end())
+		{
+			++m_stats.unknownCalls;
+			return;
+		}
+
+		if (it->second(playerID, reader))
+		{
+			++m_stats.receivedCalls;
+		}
+		else
+		{
+			++m_stats.malformedCalls;
+		}
+	}
+}
@@ -0,0 +1,236 @@
+﻿
+# pragma once
+# include <span>
+# include <Siv3D.hpp>
+# include "NetworkSystem.hpp"
+# include "NetworkPacket.hpp"
+
+namespace s3d
+{
+	/// @brief RPC の ID
+	using NetworkRPCID = uint32;
+
+	namespace NetworkSystem
+	{
+		/// @brief 関数名から RPC の ID を作成します。
+		/// @param name 関数名
+		/// @return 関数名の FNV-1a ハッシュ値
+		/// @remark constexpr 変数で受け取ることで、コンパイル時に計算されます。
+		[[nodiscard]]
+		inline constexpr NetworkRPCID MakeRPCID(const StringView name) noexcept
+		{
+			uint32 hash = 2166136261u;
+
+			for (const char32 ch : name)
+			{
+				hash ^= static_cast<uint32>(ch);
+				hash *= 16777619u;
+			}
+
+			return hash;
+		}
+	}
+
+	namespace detail
+	{
+		/// @brief 他のメモリを参照するだけの型 (受信側では参照先が存在しない)
+		template <class Type>
+		struct IsRPCViewType : std::false_type {};
+
+		template <class Char, class Traits>
+		struct IsRPCViewType<std::basic_string_view<Char, Traits>> : std::true_type {};
+
+		template <>
+		struct IsRPCViewType<StringView> : std::true_type {};
+
+		template <class Type, size_t Extent>
+		struct IsRPCViewType<std::span<Type, Extent>> : std::true_type {};
+
+		/// @brief RPC の引数としてそのまま書き込める型か
+		/// @remark ポインタ、配列、ビューはトリビアルコピー可能ですが、アドレスが送られるだけなので使えません。
+		template <class Type>
+		struct IsRPCArgument : std::bool_constant<std::is_trivially_copyable_v<Type>
+			&& (not std::is_pointer_v<Type>) && (not std::is_member_pointer_v<Type>) && (not std::is_null_pointer_v<Type>)
+			&& (not std::is_array_v<Type>) && (not IsRPCViewType<Type>::value)> {};
+
+		template <>
+		struct IsRPCArgument<String> : std::true_type {};
+
+		template <class Type>
+		struct IsRPCArgument<Array<Type>> : std::bool_constant<IsRPCArgument<Type>::value
+			&& (std::is_trivially_copyable_v<Type> || std::is_same_v<Type, String>)> {};
+
+		template <class Type>
+		struct IsRPCArgument<Grid<Type>> : std::bool_constant<IsRPCArgument<Type>::value && std::is_trivially_copyable_v<Type>> {};
+
+		/// @brief 文字列リテラルや StringView などの文字列を String に変換し、それ以外はそのまま返します。
+		template <class Type>
+		[[nodiscard]]
+		decltype(auto) ToRPCArgument(const Type& value)
+		{
+			if constexpr (std::is_convertible_v<const Type&, StringView> && (not std::is_same_v<Type, String>))
+			{
+				return String{ StringView{ value } };
+			}
+			else
+			{
+				return (value);
+			}
+		}
+
+		template <class Type>
+		using RPCArgumentType = std::remove_cvref_t<decltype(ToRPCArgument(std::declval<const Type&>()))>;
+	}
+
+	/// @brief 関数名で登録した関数を、他のプレイヤーから引数付きで呼び出すためのクラスです。
+	/// @remark すべての RPC は 1 つのイベントコードを共有し、関数は 32 ビットの ID で区別されます。
+	/// 引数は NetworkPacketWriter で書き込める型 (トリビアルコピー可能な型, String, Array, Grid) が使えます。
+	/// ポインタ、配列、StringView などのビューは使えません。call() に渡した文字列リテラルや StringView は String として送られます。
+	class NetworkRPC
+	{
+	public:
+
+		/// @brief RPC の統計
+		struct Stats
+		{
+			/// @brief 送信した呼び出しの数
+			uint64 sentCalls = 0;
+
+			/// @brief 受信して実行した呼び出しの数
+			uint64 receivedCalls = 0;
+
+			/// @brief 登録されていない ID の呼び出しを受信した数
+			uint64 unknownCalls = 0;
+
+			/// @brief 引数を読み込めなかった呼び出しの数
+			uint64 malformedCalls = 0;
+		};
+
+		/// @brief NetworkRPC を作成します。
+		/// @param network 送受信に使う SivPhoton
+		/// @param eventCode 送受信に使うイベントコード
+		NetworkRPC(SivPhoton& network, uint8 eventCode);
+
+		~NetworkRPC();
+
+		NetworkRPC(const NetworkRPC&) = delete;
+
+		NetworkRPC& operator =(const NetworkRPC&) = delete;
+
+		/// @brief 関数を登録します。
+		/// @param rpcID RPC の ID
+		/// @param f 呼び出される関数 (最初の引数は呼び出したプレイヤーの ID)
+		/// @return 登録した場合 true, 同じ ID の関数が既に登録されている場合は false
+		/// @remark 例: rpc.bind(NetworkSystem::MakeRPCID(U"Fire"), [](int32 senderID, Vec2 pos, double angle) { ... });
+		/// 異なる関数名の ID が衝突した場合も false を返すため、登録し直す場合は先に unbind() してください。
+		template <class Fty>
+		bool bind(NetworkRPCID rpcID, Fty&& f);
+
+		/// @brief 関数の登録を解除します。
+		/// @param rpcID RPC の ID
+		void unbind(NetworkRPCID rpcID);
+
+		/// @brief 関数が登録されているかを返します。
+		/// @param rpcID RPC の ID
+		/// @return 登録されている場合 true, それ以外の場合は false
+		[[nodiscard]]
+		bool isBound(NetworkRPCID rpcID) const;
+
+		/// @brief 自分以外のプレイヤーの関数を呼び出します。
+		/// @param rpcID RPC の ID
+		/// @param args 引数
+		template <class... Args>
+		void call(NetworkRPCID rpcID, const Args&... args);
+
+		/// @brief 送信先を指定して関数を呼び出します。
+		/// @param option 送信のオプション (全員, 自分以外, マスタークライアント, 指定したプレイヤー)
+		/// @param rpcID RPC の ID
+		/// @param args 引数
+		template <class... Args>
+		void callWith(const NetworkSystem::EventOption& option, NetworkRPCID rpcID, const Args&... args);
+
+		/// @brief RPC の統計を返します。
+		/// @return RPC の統計
+		[[nodiscard]]
+		const Stats& getStats() const noexcept;
+
+	private:
+
+		using Invoker = std::function<bool(int32, NetworkPacketReader&)>;
+
+		SivPhoton& m_network;
+
+		uint8 m_eventCode = 0;
+
+		HashTable<NetworkRPCID, Invoker> m_invokers;
+
+		NetworkPacketWriter m_writer;
+
+		Stats m_stats;
+
+		template <class... Args>
+		bool bindImpl(NetworkRPCID rpcID, std::function<void(int32, Args...)> f);
+
+		void onReceive(int32 playerID, const Blob& data);
+	};
+}
+
+namespace s3d
+{
+	template <class Fty>
+	bool NetworkRPC::bind(const NetworkRPCID rpcID, Fty&& f)
+	{
+		return bindImpl(rpcID, std::function{ std::forward<Fty>(f) });
+	}
+
+	template <class... Args>
+	void NetworkRPC::callWith(const NetworkSystem::EventOption& option, const NetworkRPCID rpcID, const Args&... args)
+	{
+		static_assert((detail::IsRPCArgument<detail::RPCArgumentType<Args>>::value && ...),
+			"NetworkRPC: pointers, arrays and views (StringView, std::span, ...) cannot be sent as RPC arguments");
+
+		m_writer.clear();
+		m_writer.write(rpcID);
+		(m_writer.write(detail::ToRPCArgument(args)), ...);
+
+		m_network.opRaiseEvent(m_eventCode, m_writer.getBlob(), option);
+		++m_stats.sentCalls;
+	}
+
+	template <class... Args>
+	void NetworkRPC::call(const NetworkRPCID rpcID, const Args&... args)
+	{
+		callWith({}, rpcID, args...);
+	}
+
+	template <class... Args>
+	bool NetworkRPC::bindImpl(const NetworkRPCID rpcID, std::function<void(int32, Args...)> f)
+	{
+		static_assert((detail::IsRPCArgument<std::remove_cvref_t<Args>>::value && ...),
+			"NetworkRPC: pointers, arrays and views (StringView, std::span, ...) cannot be received as RPC arguments");
+
+		// 異なる関数名の ID が衝突した場合も、登録済みの関数を上書きしない
+		if (m_invokers.contains(rpcID))
+		{
+			NetworkSystem::Log(U"NetworkRPC::bind(): RPC ID {:08X} is already bound"_fmt(rpcID));
+			return false;
+		}
+
+		m_invokers.emplace(rpcID, [f = std::move(f)](const int32 senderID, NetworkPacketReader& reader)
+			{
+				std::tuple<std::remove_cvref_t<Args>...> values;
+
+				const bool ok = std::apply([&](auto&... value) { return (reader.read(value) && ...); }, values);
+
+				if (not ok)
+				{
+					return false;
+				}
+
+				std::apply([&](auto&... value) { f(senderID, value...); }, values);
+				return true;
+			});
+
+		return true;
+	}
+}
@@ -0,0 +1,363 @@
+﻿
+# pragma once
+# include <Siv3D.hpp>
+# include "NetworkSystem.hpp"
+# include "NetworkPacket.hpp"
+
+namespace s3d
+{
+	/// @brief 各プレイヤーの状態をマスタークライアントに集め、1 つのスナップショットとして配信するクラスです。
+	/// @tparam State トリビアルコピー可能な状態の型 (Vec2 など)
+	/// @remark 全員が全員に送信する場合 1 ティックあたり N(N-1) 個のイベントが配信されますが、
+	/// このクラスでは N-1 個の送信と N-1 個のスナップショットの配信で済みます。
+	template <class State>
+	class NetworkRelayAggregator
+	{
+	public:
+
+		static_assert(std::is_trivially_copyable_v<State>);
+
+		/// @brief 送受信の統計
+		struct Stats
+		{
+			/// @brief 送信したイベントの数
+			size_t sentEvents = 0;
+
+			/// @brief 送信したバイト数
+			size_t sentBytes = 0;
+
+			/// @brief 受信したイベントの数
+			size_t receivedEvents = 0;
+
+			/// @brief 受信したバイト数
+			size_t receivedBytes = 0;
+		};
+
+		/// @brief NetworkRelayAggregator を作成します。
+		/// @param network 送受信に使う SivPhoton
+		/// @param eventCode 送受信に使うイベントコード
+		NetworkRelayAggregator(SivPhoton& network, uint8 eventCode);
+
+		~NetworkRelayAggregator();
+
+		NetworkRelayAggregator(const NetworkRelayAggregator&) = delete;
+
+		NetworkRelayAggregator& operator =(const NetworkRelayAggregator&) = delete;
+
+		/// @brief 自分の状態を設定します。
+		/// @param state 自分の状態
+		/// @remark 次の update() で送信されます。
+		void setState(const State& state);
+
+		/// @brief 状態を送信します。
+		/// @remark マスタークライアント以外は自分の状態をマスタークライアントに送り、
+		/// マスタークライアントは集めた状態を 1 つのスナップショットとして全員に送ります。
+		void update();
+
+		/// @brief 最新のスナップショットのプレイヤー ID の一覧を返します。
+		/// @return プレイヤー ID の一覧
+		[[nodiscard]]
+		const Array<int32>& playerIDs() const noexcept;
+
+		/// @brief 最新のスナップショットの状態の一覧を返します。
+		/// @return 状態の一覧 (並びは playerIDs() と同じ)
+		[[nodiscard]]
+		const Array<State>& states() const noexcept;
+
+		/// @brief 最新のスナップショットのプレイヤーの状態を返します。
+		/// @param playerID プレイヤー ID
+		/// @return プレイヤーの状態, 存在しない場合は none
+		[[nodiscard]]
+		Optional<State> getState(int32 playerID) const;
+
+		/// @brief スナップショットを受信した際に呼び出される関数を設定します。
+		/// @param callback 呼び出される関数
+		void setSnapshotCallback(std::function<void(const Array<int32>& playerIDs, const Array<State>& states)> callback);
+
+		/// @brief プレイヤーがルームから退室したことを通知します。
+		/// @param playerID 退室したプレイヤーの ID
+		/// @remark SivPhoton::leaveRoomEventAction() から呼んでください。
+		void onPlayerLeft(int32 playerID);
+
+		/// @brief 送受信の統計を返します。
+		/// @return 送受信の統計
+		[[nodiscard]]
+		const Stats& getStats() const noexcept;
+
+		/// @brief スナップショットを書き込みます。
+		/// @param writer 書き込み先
+		/// @param playerIDs プレイヤー ID の一覧
+		/// @param states 状態の一覧
+		static void WriteSnapshot(NetworkPacketWriter& writer, const Array<int32>& playerIDs, const Array<State>& states);
+
+		/// @brief スナップショットを読み込みます。
+		/// @param reader 読み込み元
+		/// @param playerIDs プレイヤー ID の一覧の格納先
+		/// @param states 状態の一覧の格納先
+		/// @return 読み込みに成功した場合 true, それ以外の場合は false
+		static bool ReadSnapshot(NetworkPacketReader& reader, Array<int32>& playerIDs, Array<State>& states);
+
+	private:
+
+		enum class MessageType : uint8
+		{
+			PlayerState,
+
+			Snapshot,
+		};
+
+		SivPhoton& m_network;
+
+		uint8 m_eventCode = 0;
+
+		Optional<State> m_localState;
+
+		bool m_wasMasterClient = false;
+
+		// マスタークライアントが集めた状態
+		Array<int32> m_collectedIDs;
+
+		Array<State> m_collectedStates;
+
+		// 最新のスナップショット
+		Array<int32> m_playerIDs;
+
+		Array<State> m_states;
+
+		NetworkPacketWriter m_writer;
+
+		Stats m_stats;
+
+		std::function<void(const Array<int32>&, const Array<State>&)> m_snapshotCallback;
+
+		void collect(int32 playerID, const State& state);
+
+		void onReceive(int32 playerID, const Blob& data);
+	};
+}
+
+namespace s3d
+{
+	template <class State>
+	NetworkRelayAggregator<State>::NetworkRelayAggregator(SivPhoton& network, const uint8 eventCode)
+		: m_network{ network }
+		, m_eventCode{ eventCode }
+	{
+		m_network.setEventHandler(m_eventCode, [this](const int32 playerID, const Blob& data) { onReceive(playerID, data); });
+	}
+
+	template <class State>
+	NetworkRelayAggregator<State>::~NetworkRelayAggregator()
+	{
+		m_network.removeEventHandler(m_eventCode);
+	}
+
+	template <class State>
+	void NetworkRelayAggregator<State>::setState(const State& state)
+	{
+		m_localState = state;
+	}
+
+	template <class State>
+	void NetworkRelayAggregator<State>::update()
+	{
+		const auto localPlayerID = m_network.localPlayerID();
+
+		if (not localPlayerID)
+		{
+			return;
+		}
+
+		const bool isMasterClient = m_network.isMasterClient();
+
+		if (isMasterClient && (not m_wasMasterClient))
+		{
+			// 新しくマスタークライアントになった場合は、最新のスナップショットを引き継ぐ
+			m_collectedIDs = m_playerIDs;
+			m_collectedStates = m_states;
+		}
+
+		m_wasMasterClient = isMasterClient;
+
+		if (not isMasterClient)
+		{
+			if (m_localState)
+			{
+				m_writer.clear();
+				m_writer.write(MessageType::PlayerState);
+				m_writer.write(*m_localState);
+
+				NetworkSystem::EventOption option;
+				option.reliable = false;
+				option.receiverGroup = NetworkSystem::ReceiverGroup::MasterClient;
+
+				m_network.opRaiseEvent(m_eventCode, m_writer.getBlob(), option);
+				++m_stats.sentEvents;
+				m_stats.sentBytes += m_writer.size();
+				m_localState.reset();
+			}
+
+			return;
+		}
+
+		if (m_localState)
+		{
+			collect(*localPlayerID, *m_localState);
+			m_localState.reset();
+		}
+
+		if (not m_collectedIDs)
+		{
+			return;
+		}
+
+		m_writer.clear();
+		m_writer.write(MessageType::Snapshot);
+		WriteSnapshot(m_writer, m_collectedIDs, m_collectedStates);
+
+		NetworkSystem::EventOption option;
+		option.reliable = false;
+
+		m_network.opRaiseEvent(m_eventCode, m_writer.getBlob(), option);
+		++m_stats.sentEvents;
+		m_stats.sentBytes += m_writer.size();
+
+		m_playerIDs = m_collectedIDs;
+		m_states = m_collectedStates;
+
+		if (m_snapshotCallback)
+		{
+			m_snapshotCallback(m_playerIDs, m_states);
+		}
+	}
+
+	template <class State>
+	const Array<int32>& NetworkRelayAggregator<State>::playerIDs() const noexcept
+	{
+		return m_playerIDs;
+	}
+
+	template <class State>
+	const Array<State>& NetworkRelayAggregator<State>::states() const noexcept
+	{
+		return m_states;
+	}
+
+	template <class State>
+	Optional<State> NetworkRelayAggregator<State>::getState(const int32 playerID) const
+	{
+		for (size_t i = 0; i < m_playerIDs.size(); ++i)
+		{
+			if (m_playerIDs[i] == playerID)
+			{
+				return m_states[i];
+			}
+		}
+
+		return none;
+	}
+
+	template <class State>
+	void NetworkRelayAggregator<State>::setSnapshotCallback(std::function<void(const Array<int32>& playerIDs, const Array<State>& states)> callback)
+	{
+		m_snapshotCallback = std::move(callback);
+	}
+
+	template <class State>
+	void NetworkRelayAggregator<State>::onPlayerLeft(const int32 playerID)
+	{
+		for (size_t i = 0; i < m_collectedIDs.size(); ++i)
+		{
+			if (m_collectedIDs[i] == playerID)
+			{
+				m_collectedIDs.remove_at(i);
+				m_collectedStates.remove_at(i);
+				break;
+			}
+		}
+	}
+
+	template <class State>
+	const typename NetworkRelayAggregator<State>::Stats& NetworkRelayAggregator<State>::getStats() const noexcept
+	{
+		return m_stats;
+	}
+
+	template <class State>
+	void NetworkRelayAggregator<State>::WriteSnapshot(NetworkPacketWriter& writer, const Array<int32>& playerIDs, const Array<State>& states)
+	{
+		assert(playerIDs.size() == states.size());
+
+		writer.write(static_cast<uint32>(playerIDs.size()));
+		writer.writeBytes(playerIDs.data(), (playerIDs.size() * sizeof(int32)));
+		writer.writeBytes(states.data(), (states.size() * sizeof(State)));
+	}
+
+	template <class State>
+	bool NetworkRelayAggregator<State>::ReadSnapshot(NetworkPacketReader& reader, Array<int32>& playerIDs, Array<State>& states)
+	{
+		uint32 count = 0;
+
+		if ((not reader.read(count)) || (reader.remaining() < (count * (sizeof(int32) + sizeof(State)))))
+		{
+			return false;
+		}
+
+		playerIDs.resize(count);
+		states.resize(count);
+
+		return (reader.readBytes(playerIDs.data(), (count * sizeof(int32)))
+			&& reader.readBytes(states.data(), (count * sizeof(State))));
+	}
+
+	template <class State>
+	void NetworkRelayAggregator<State>::collect(const int32 playerID, const State& state)
+	{
+		for (size_t i = 0; i < m_collectedIDs.size(); ++i)
+		{
+			if (m_collectedIDs[i] == playerID)
+			{
+				m_collectedStates[i] = state;
+				return;
+			}
+		}
+
+		m_collectedIDs << playerID;
+		m_collectedStates << state;
+	}
+
+	template <class State>
+	void NetworkRelayAggregator<State>::onReceive(const int32 playerID, const Blob& data)
+	{
+		++m_stats.receivedEvents;
+		m_stats.receivedBytes += data.size();
+
+		NetworkPacketReader reader{ data };
+		MessageType type;
+
+		if (not reader.read(type))
+		{
+			return;
+		}
+
+		if (type == MessageType::PlayerState)
+		{
+			State state;
+
+			if (m_network.isMasterClient() && reader.read(state))
+			{
+				collect(playerID, state);
+			}
+
+			return;
+		}
+
+		if ((type == MessageType::Snapshot) && (m_network.getMasterClientID() == playerID))
+		{
+			if (ReadSnapshot(reader, m_playerIDs, m_states) && m_snapshotCallback)
+			{
+				m_snapshotCallback(m_playerIDs, m_states);
+			}
+		}
+	}
+}
@@ -0,0 +1,428 @@
+﻿
+# pragma once
+# include <algorithm>
+# include <cstdint>
+# include <cstring>
+# include <map>
+# include <string>
+# include <string_view>
+# include <type_traits>
+# include <vector>
+
+namespace s3d
+{
+	/// @brief リレーサーバ (RelayServer) と NetworkRelayTransport の間の通信プロトコルです。
+	/// @remark サーバを Siv3D なしでビルドできるように、標準ライブラリだけを使います。
+	/// 1 つの UDP データグラムが 1 つのメッセージで、先頭に Header が付きます。数値はリトルエンディアンです。
+	namespace NetworkRelayProtocol
+	{
+		/// @brief 既定のポート番号
+		inline constexpr std::uint16_t DefaultPort = 5056;
+
+		/// @brief 1 つのデータグラムの最大のバイト数
+		inline constexpr std::size_t MaxDatagramSize = 60000;
+
+		/// @brief reliable のメッセージを最初に再送するまでの時間 (ミリ秒)
+		inline constexpr std::uint64_t ResendMillisec = 100;
+
+		/// @brief 再送の間隔の上限 (ミリ秒)
+		inline constexpr std::uint64_t MaxResendMillisec = 1000;
+
+		/// @brief この時間何も受信しなかった場合に切断する (ミリ秒)
+		inline constexpr std::uint64_t TimeoutMillisec = 10000;
+
+		/// @brief 順番を待つ reliable のメッセージとして受け取る、次に処理する通し番号からの範囲
+		inline constexpr std::uint32_t ReceiveWindow = 1024;
+
+		/// @brief 順番を待つ reliable のメッセージとして保持する最大のバイト数
+		inline constexpr std::size_t MaxOutOfOrderBytes = (4 << 20);
+
+		/// @brief クライアントが Ping を送る間隔 (ミリ秒)
+		inline constexpr std::uint64_t PingIntervalMillisec = 1000;
+
+		/// @brief 接続がタイムアウトした場合のエラーコード
+		inline constexpr std::int32_t ConnectionTimeout = 1040;
+
+		/// @brief 送信の方法
+		enum class Channel : std::uint8_t
+		{
+			/// @brief 再送しない
+			Unreliable,
+
+			/// @brief 届くまで再送し、送った順に処理する
+			Reliable,
+
+			/// @brief reliable のメッセージを受け取ったことを知らせる
+			Ack,
+		};
+
+		enum class MessageType : std::uint8_t
+		{
+			// クライアントからサーバ
+
+			Connect,
+
+			Disconnect,
+
+			JoinRandomRoom,
+
+			JoinRoom,
+
+			CreateRoom,
+
+			LeaveRoom,
+
+			ChangeGroups,
+
+			RaiseEvent,
+
+			SetRoomFlag,
+
+			Ping,
+
+			// サーバからクライアント
+
+			ConnectReturn,
+
+			JoinReturn,
+
+			LeaveRoomReturn,
+
+			PlayerJoined,
+
+			PlayerLeft,
+
+			Event,
+
+			RoomFlags,
+
+			Pong,
+
+			// 双方向
+
+			Ack,
+		};
+
+		/// @brief JoinReturn がどの操作の結果か
+		enum class JoinKind : std::uint8_t
+		{
+			Create,
+
+			Join,
+
+			JoinRandom,
+		};
+
+		/// @brief SetRoomFlag で変更する項目
+		enum class RoomFlag : std::uint8_t
+		{
+			IsOpen,
+
+			IsVisible,
+		};
+
+		/// @brief データグラムの先頭に付くヘッダ
+		struct Header
+		{
+			MessageType type = MessageType::Ack;
+
+			Channel channel = Channel::Unreliable;
+
+			/// @brief Reliable と Ack の場合の通し番号
+			std::uint32_t sequence = 0;
+		};
+
+		inline constexpr std::size_t HeaderSize = (sizeof(std::uint8_t) + sizeof(std::uint8_t) + sizeof(std::uint32_t));
+
+		/// @brief メッセージを書き込むクラス
+		class Writer
+		{
+		public:
+
+			Writer() = default;
+
+			/// @brief ヘッダを書き込んだ状態で作成します。
+			/// @param header ヘッダ
+			explicit Writer(const Header& header)
+			{
+				write(header.type);
+				write(header.channel);
+				write(header.sequence);
+			}
+
+			template <class Type>
+			Writer& write(const Type& value)
+			{
+				static_assert(std::is_trivially_copyable_v<Type>);
+
+				const auto* p = reinterpret_cast<const std::uint8_t*>(&value);
+				m_data.insert(m_data.end(), p, (p + sizeof(Type)));
+				return *this;
+			}
+
+			/// @brief UTF-8 の文字列を、16 ビットの長さに続けて書き込みます。
+			Writer& writeString(const std::string_view s)
+			{
+				const auto length = static_cast<std::uint16_t>(std::min<std::size_t>(s.size(), UINT16_MAX));
+				write(length);
+				m_data.insert(m_data.end(), s.begin(), (s.begin() + length));
+				return *this;
+			}
+
+			/// @brief 長さを付けずにバイト列を書き込みます。
+			Writer& writeBytes(const void* data, const std::size_t size)
+			{
+				const auto* p = static_cast<const std::uint8_t*>(data);
+				m_data.insert(m_data.end(), p, (p + size));
+				return *this;
+			}
+
+			[[nodiscard]]
+			const std::vector<std::uint8_t>& data() const noexcept
+			{
+				return m_data;
+			}
+
+			[[nodiscard]]
+			std::vector<std::uint8_t>& data() noexcept
+			{
+				return m_data;
+			}
+
+		private:
+
+			std::vector<std::uint8_t> m_data;
+		};
+
+		/// @brief メッセージを読み込むクラス
+		/// @remark 範囲外を読もうとすると、以降の読み込みはすべて失敗します。
+		class Reader
+		{
+		public:
+
+			Reader(const std::uint8_t* data, const std::size_t size) noexcept
+				: m_data{ data }
+				, m_size{ size } {}
+
+			template <class Type>
+			bool read(Type& value) noexcept
+			{
+				static_assert(std::is_trivially_copyable_v<Type>);
+
+				if (not require(sizeof(Type)))
+				{
+					return false;
+				}
+
+				std::memcpy(&value, (m_data + m_position), sizeof(Type));
+				m_position += sizeof(Type);
+				return true;
+			}
+
+			bool readHeader(Header& header) noexcept
+			{
+				return (read(header.type) && read(header.channel) && read(header.sequence));
+			}
+
+			bool readString(std::string& s)
+			{
+				std::uint16_t length = 0;
+
+				if ((not read(length)) || (not require(length)))
+				{
+					return false;
+				}
+
+				s.assign(reinterpret_cast<const char*>(m_data + m_position), length);
+				m_position += length;
+				return true;
+			}
+
+			/// @brief 残りのバイト列の先頭を返します。
+			[[nodiscard]]
+			const std::uint8_t* rest() const noexcept
+			{
+				return (m_data + m_position);
+			}
+
+			/// @brief 残りのバイト数を返します。
+			[[nodiscard]]
+			std::size_t restSize() const noexcept
+			{
+				return (m_failed ? 0 : (m_size - m_position));
+			}
+
+			[[nodiscard]]
+			bool failed() const noexcept
+			{
+				return m_failed;
+			}
+
+		private:
+
+			const std::uint8_t* m_data = nullptr;
+
+			std::size_t m_size = 0;
+
+			std::size_t m_position = 0;
+
+			bool m_failed = false;
+
+			bool require(const std::size_t size) noexcept
+			{
+				if (m_failed || ((m_size - m_position) < size))
+				{
+					m_failed = true;
+				}
+
+				return (not m_failed);
+			}
+		};
+
+		/// @brief reliable のメッセージの再送と、受信したメッセージの並べ直しを行うクラス
+		/// @remark 通し番号の折り返しは扱いません (毎秒 1000 個で約 49 日)。
+		class ReliableChannel
+		{
+		public:
+
+			/// @brief reliable のメッセージを作成し、受信の確認が来るまで保持します。
+			/// @param writer ヘッダの通し番号以外を書き込んだメッセージ
+			/// @param nowMillisec 現在の時刻 (ミリ秒)
+			/// @return 送信するデータグラム
+			const std::vector<std::uint8_t>& send(Writer&& writer, const std::uint64_t nowMillisec)
+			{
+				const std::uint32_t sequence = m_nextSendSequence++;
+
+				std::vector<std::uint8_t> datagram = std::move(writer.data());
+				std::memcpy((datagram.data() + 2), &sequence, sizeof(sequence));
+
+				Unacknowledged& entry = m_unacknowledged[sequence];
+				entry.datagram = std::move(datagram);
+				entry.lastSentMillisec = nowMillisec;
+				entry.intervalMillisec = ResendMillisec;
+				return entry.datagram;
+			}
+
+			/// @brief 受信の確認を処理します。
+			/// @param sequence 通し番号
+			void acknowledge(const std::uint32_t sequence)
+			{
+				m_unacknowledged.erase(sequence);
+			}
+
+			/// @brief 再送の時刻が来たメッセージを送信します。
+			/// @param nowMillisec 現在の時刻 (ミリ秒)
+			/// @param sendDatagram データグラムを送信する関数
+			/// @return 再送したメッセージの数
+			template <class SendDatagram>
+			std::size_t resend(const std::uint64_t nowMillisec, SendDatagram&& sendDatagram)
+			{
+				std::size_t count = 0;
+
+				for (auto& [sequence, entry] : m_unacknowledged)
+				{
+					if ((entry.lastSentMillisec + entry.intervalMillisec) <= nowMillisec)
+					{
+						sendDatagram(entry.datagram);
+						entry.lastSentMillisec = nowMillisec;
+						entry.intervalMillisec = std::min((entry.intervalMillisec * 2), MaxResendMillisec);
+						++count;
+					}
+				}
+
+				return count;
+			}
+
+			/// @brief reliable のメッセージを受け取れるかを返します。
+			/// @param sequence 通し番号
+			/// @param size データグラムのバイト数
+			/// @return 受け取れる場合 true, 次に処理する番号から ReceiveWindow 以上先の場合や、順番を待つメッセージが MaxOutOfOrderBytes を超える場合は false
+			/// @remark false の場合は受信の確認を返さずに破棄し、送信者に再送させてください。
+			[[nodiscard]]
+			bool canReceive(const std::uint32_t sequence, const std::size_t size) const noexcept
+			{
+				if ((sequence <= m_nextReceiveSequence) || m_outOfOrder.contains(sequence))
+				{
+					return true;
+				}
+
+				return (((sequence - m_nextReceiveSequence) < ReceiveWindow) && ((m_outOfOrderBytes + size) <= MaxOutOfOrderBytes));
+			}
+
+			/// @brief reliable のメッセージを受信します。
+			/// @param sequence 通し番号
+			/// @param data データグラム
+			/// @param size データグラムのバイト数
+			/// @param deliver 処理できる順番になったデータグラムを受け取る関数 (送られた順に呼ばれる)
+			/// @remark canReceive() が false を返すメッセージは無視します。
+			template <class Deliver>
+			void receive(const std::uint32_t sequence, const std::uint8_t* data, const std::size_t size, Deliver&& deliver)
+			{
+				// すでに処理したもの (確認が届かずに再送されたもの) は無視する
+				if (sequence < m_nextReceiveSequence)
+				{
+					return;
+				}
+
+				if (sequence != m_nextReceiveSequence)
+				{
+					// 先の番号を際限なく保持しないように、範囲と合計のバイト数を制限する
+					if (canReceive(sequence, size) && m_outOfOrder.try_emplace(sequence, data, (data + size)).second)
+					{
+						m_outOfOrderBytes += size;
+					}
+
+					return;
+				}
+
+				deliver(data, size);
+				++m_nextReceiveSequence;
+
+				for (auto it = m_outOfOrder.begin(); ((it != m_outOfOrder.end()) && (it->first == m_nextReceiveSequence)); it = m_outOfOrder.erase(it))
+				{
+					m_outOfOrderBytes -= it->second.size();
+					deliver(it->second.data(), it->second.size());
+					++m_nextReceiveSequence;
+				}
+			}
+
+			/// @brief 受信の確認を待っているメッセージの数を返します。
+			[[nodiscard]]
+			std::size_t num_unacknowledged() const noexcept
+			{
+				return m_unacknowledged.size();
+			}
+
+		private:
+
+			struct Unacknowledged
+			{
+				std::vector<std::uint8_t> datagram;
+
+				std::uint64_t lastSentMillisec = 0;
+
+				std::uint64_t intervalMillisec = 0;
+			};
+
+			std::uint32_t m_nextSendSequence = 0;
+
+			std::uint32_t m_nextReceiveSequence = 0;
+
+			std::map<std::uint32_t, Unacknowledged> m_unacknowledged;
+
+			std::map<std::uint32_t, std::vector<std::uint8_t>> m_outOfOrder;
+
+			/// @brief m_outOfOrder のデータグラムの合計のバイト数
+			std::size_t m_outOfOrderBytes = 0;
+		};
+
+		/// @brief 受信の確認のデータグラムを作成します。
+		/// @param sequence 受信したメッセージの通し番号
+		/// @return データグラム
+		[[nodiscard]]
+		inline std::vector<std::uint8_t> MakeAck(const std::uint32_t sequence)
+		{
+			return Writer{ Header{ MessageType::Ack, Channel::Ack, sequence } }.data();
+		}
+	}
+}
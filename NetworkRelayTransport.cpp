@@ -0,0 +1,841 @@
+﻿
+# include "NetworkRelayTransport.hpp"
+
+# if SIV3D_PLATFORM(WINDOWS)
+#	include <winsock2.h>
+#	include <ws2tcpip.h>
+#	pragma comment (lib, "ws2_32")
+# else
+#	include <cerrno>
+#	include <fcntl.h>
+#	include <netdb.h>
+#	include <netinet/in.h>
+#	include <sys/socket.h>
+#	include <unistd.h>
+# endif
+
+namespace s3d
+{
+	namespace detail
+	{
+# if SIV3D_PLATFORM(WINDOWS)
+		using SocketHandle = SOCKET;
+		inline constexpr SocketHandle InvalidSocket = INVALID_SOCKET;
+# else
+		using SocketHandle = int;
+		inline constexpr SocketHandle InvalidSocket = -1;
+# endif
+	}
+
+	struct NetworkRelayTransport::Socket
+	{
+		detail::SocketHandle handle = detail::InvalidSocket;
+
+		sockaddr_in address{};
+
+		Socket()
+		{
+		# if SIV3D_PLATFORM(WINDOWS)
+			WSADATA data;
+			::WSAStartup(MAKEWORD(2, 2), &data);
+		# endif
+		}
+
+		~Socket()
+		{
+			if (handle != detail::InvalidSocket)
+			{
+			# if SIV3D_PLATFORM(WINDOWS)
+				::closesocket(handle);
+			# else
+				::close(handle);
+			# endif
+			}
+
+		# if SIV3D_PLATFORM(WINDOWS)
+			::WSACleanup();
+		# endif
+		}
+
+		/// @brief ホスト名を解決し、ノンブロッキングの UDP ソケットを作成します。
+		[[nodiscard]]
+		bool open(const StringView host, const uint16 port)
+		{
+			addrinfo hints{};
+			hints.ai_family = AF_INET;
+			hints.ai_socktype = SOCK_DGRAM;
+
+			addrinfo* result = nullptr;
+
+			if ((::getaddrinfo(Unicode::ToUTF8(host).c_str(), nullptr, &hints, &result) != 0) || (not result))
+			{
+				return false;
+			}
+
+			std::memcpy(&address, result->ai_addr, sizeof(address));
+			address.sin_port = htons(port);
+			::freeaddrinfo(result);
+
+			handle = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+			if (handle == detail::InvalidSocket)
+			{
+				return false;
+			}
+
+		# if SIV3D_PLATFORM(WINDOWS)
+			u_long nonBlocking = 1;
+			return (::ioctlsocket(handle, FIONBIO, &nonBlocking) == 0);
+		# else
+			return (::fcntl(handle, F_SETFL, (::fcntl(handle, F_GETFL, 0) | O_NONBLOCK)) == 0);
+		# endif
+		}
+
+		void send(const std::vector<uint8>& datagram)
+		{
+			::sendto(handle, reinterpret_cast<const char*>(datagram.data()), static_cast<int>(datagram.size()), 0,
+				reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+		}
+
+		/// @brief データグラムを 1 つ受信します。
+		/// @return 受信したバイト数, 受信するものが無い場合は負の値
+		[[nodiscard]]
+		int64 receive(uint8* buffer, const size_t size)
+		{
+			sockaddr_in from{};
+			socklen_t fromLength = sizeof(from);
+			const auto received = ::recvfrom(handle, reinterpret_cast<char*>(buffer), static_cast<int>(size), 0, reinterpret_cast<sockaddr*>(&from), &fromLength);
+
+			// リレーサーバ以外からのデータグラムは無視する
+			if ((0 <= received)
+				&& ((from.sin_addr.s_addr != address.sin_addr.s_addr) || (from.sin_port != address.sin_port)))
+			{
+				return 0;
+			}
+
+			return received;
+		}
+	};
+
+	NetworkRelayTransport::NetworkRelayTransport(const StringView host, const uint16 port)
+		: m_host{ host }
+		, m_port{ port } {}
+
+	NetworkRelayTransport::~NetworkRelayTransport()
+	{
+		if (m_socket)
+		{
+			sendDatagram(NetworkRelayProtocol::Writer{ NetworkRelayProtocol::Header{ NetworkRelayProtocol::MessageType::Disconnect } }.data());
+		}
+	}
+
+	const NetworkRelayTransport::Stats& NetworkRelayTransport::getStats() const noexcept
+	{
+		return m_stats;
+	}
+
+	bool NetworkRelayTransport::connect(const StringView userName)
+	{
+		using namespace NetworkRelayProtocol;
+
+		if (m_socket)
+		{
+			return false;
+		}
+
+		auto socket = std::make_unique<Socket>();
+
+		if (not socket->open(m_host, m_port))
+		{
+			return false;
+		}
+
+		m_socket = std::move(socket);
+		m_state = State::Connecting;
+		m_channel = ReliableChannel{};
+		m_userName = userName;
+		m_userID.clear();
+		m_roundTripTimeMillisec = -1.0;
+		m_roundTripTimeVarianceMillisec = 0.0;
+		m_disconnectPending = false;
+		resetRoom();
+
+		m_connectStartedAt = m_lastReceivedAt = m_lastPingAt = nowMillisec();
+
+		// 同じアドレスからの再接続を、サーバが前回の接続と区別するための値
+		const uint64 sessionID = RandomUint64();
+
+		Writer writer{ Header{ MessageType::Connect, Channel::Reliable } };
+		writer.write(sessionID);
+		writer.writeString(Unicode::ToUTF8(userName));
+		sendReliable(std::move(writer));
+		return true;
+	}
+
+	void NetworkRelayTransport::disconnect()
+	{
+		using namespace NetworkRelayProtocol;
+
+		if (not m_socket)
+		{
+			return;
+		}
+
+		// 届かなかった場合は、サーバ側のタイムアウトで切断される
+		sendDatagram(Writer{ Header{ MessageType::Disconnect } }.data());
+
+		close();
+		m_disconnectPending = true;
+	}
+
+	void NetworkRelayTransport::update()
+	{
+		using namespace NetworkRelayProtocol;
+
+		if (not m_socket)
+		{
+			if (std::exchange(m_disconnectPending, false) && m_listener)
+			{
+				m_listener->disconnectReturn();
+			}
+
+			return;
+		}
+
+		// Listener の処理の中で disconnect() が呼ばれた場合は、残りを処理せずに終える
+		while (m_socket)
+		{
+			const int64 size = m_socket->receive(m_receiveBuffer.data(), m_receiveBuffer.size());
+
+			if (size < 0)
+			{
+				break;
+			}
+
+			++m_stats.receivedDatagrams;
+			m_stats.receivedBytes += size;
+
+			handleDatagram(m_receiveBuffer.data(), static_cast<size_t>(size));
+		}
+
+		if (not m_socket)
+		{
+			return;
+		}
+
+		const uint64 now = nowMillisec();
+
+		m_stats.resent += m_channel.resend(now, [this](const std::vector<uint8>& datagram) { sendDatagram(datagram); });
+
+		if (m_state == State::Connecting)
+		{
+			if ((m_connectStartedAt + TimeoutMillisec) < now)
+			{
+				close();
+
+				if (m_listener)
+				{
+					m_listener->connectReturn(ConnectionTimeout, U"Connection timeout");
+				}
+			}
+
+			return;
+		}
+
+		if ((m_lastReceivedAt + TimeoutMillisec) < now)
+		{
+			close();
+
+			if (m_listener)
+			{
+				m_listener->disconnectReturn();
+			}
+
+			return;
+		}
+
+		if ((m_lastPingAt + PingIntervalMillisec) <= now)
+		{
+			m_lastPingAt = now;
+
+			Writer writer{ Header{ MessageType::Ping } };
+			writer.write(now);
+			sendDatagram(writer.data());
+		}
+	}
+
+	void NetworkRelayTransport::joinRandomRoom(const int32 maxPlayers)
+	{
+		using namespace NetworkRelayProtocol;
+
+		if (m_state != State::Connected)
+		{
+			return;
+		}
+
+		Writer writer{ Header{ MessageType::JoinRandomRoom, Channel::Reliable } };
+		writer.write(static_cast<uint8>(maxPlayers));
+		sendReliable(std::move(writer));
+	}
+
+	void NetworkRelayTransport::joinRoom(const StringView roomName)
+	{
+		using namespace NetworkRelayProtocol;
+
+		if (m_state != State::Connected)
+		{
+			return;
+		}
+
+		Writer writer{ Header{ MessageType::JoinRoom, Channel::Reliable } };
+		writer.writeString(Unicode::ToUTF8(roomName));
+		sendReliable(std::move(writer));
+	}
+
+	void NetworkRelayTransport::createRoom(const StringView roomName, const int32 maxPlayers)
+	{
+		using namespace NetworkRelayProtocol;
+
+		if (m_state != State::Connected)
+		{
+			return;
+		}
+
+		Writer writer{ Header{ MessageType::CreateRoom, Channel::Reliable } };
+		writer.writeString(Unicode::ToUTF8(roomName));
+		writer.write(static_cast<uint8>(maxPlayers));
+		sendReliable(std::move(writer));
+	}
+
+	void NetworkRelayTransport::leaveRoom()
+	{
+		using namespace NetworkRelayProtocol;
+
+		if (m_state != State::Connected)
+		{
+			return;
+		}
+
+		sendReliable(Writer{ Header{ MessageType::LeaveRoom, Channel::Reliable } });
+	}
+
+	void NetworkRelayTransport::changeGroups(const Array<uint8>& groupsToRemove, const Array<uint8>& groupsToAdd)
+	{
+		using namespace NetworkRelayProtocol;
+
+		if (m_state != State::Connected)
+		{
+			return;
+		}
+
+		Writer writer{ Header{ MessageType::ChangeGroups, Channel::Reliable } };
+		writer.write(static_cast<uint8>(groupsToRemove.size()));
+		writer.writeBytes(groupsToRemove.data(), groupsToRemove.size());
+		writer.write(static_cast<uint8>(groupsToAdd.size()));
+		writer.writeBytes(groupsToAdd.data(), groupsToAdd.size());
+		sendReliable(std::move(writer));
+	}
+
+	void NetworkRelayTransport::raiseEvent(const uint8 eventCode, const Blob& eventContent, const NetworkSystem::EventOption& option, const EventFormat format)
+	{
+		using namespace NetworkRelayProtocol;
+
+		if (m_roomName.isEmpty())
+		{
+			return;
+		}
+
+		// 送信先の数は 1 バイトで送る
+		if (UINT8_MAX < option.targetPlayers.size())
+		{
+			++m_stats.droppedEvents;
+
+			if (NetworkSystem::IsLogEnabled())
+			{
+				NetworkSystem::Log(U"NetworkRelayTransport::raiseEvent(): event {} was dropped because it has {} target players (max: 255)"_fmt(eventCode, option.targetPlayers.size()));
+			}
+
+			return;
+		}
+
+		const Channel channel = (option.reliable ? Channel::Reliable : Channel::Unreliable);
+
+		Writer writer{ Header{ MessageType::RaiseEvent, channel } };
+		writer.write(eventCode);
+		writer.write(FromEnum(format));
+		writer.write(static_cast<uint8>(option.reliable));
+		writer.write(static_cast<uint8>(option.receiverGroup));
+		writer.write(option.interestGroup);
+		writer.write(static_cast<uint8>(option.targetPlayers.size()));
+
+		for (const auto targetPlayer : option.targetPlayers)
+		{
+			writer.write(static_cast<int32>(targetPlayer));
+		}
+
+		writer.writeBytes(eventContent.data(), eventContent.size());
+
+		if (MaxDatagramSize < writer.data().size())
+		{
+			++m_stats.droppedEvents;
+
+			if (NetworkSystem::IsLogEnabled())
+			{
+				NetworkSystem::Log(U"NetworkRelayTransport::raiseEvent(): event {} was dropped because it is {} bytes (max: {})"_fmt(eventCode, writer.data().size(), MaxDatagramSize));
+			}
+
+			return;
+		}
+
+		if (option.reliable)
+		{
+			sendReliable(std::move(writer));
+		}
+		else
+		{
+			sendDatagram(writer.data());
+		}
+	}
+
+	String NetworkRelayTransport::getName() const
+	{
+		return m_userName;
+	}
+
+	String NetworkRelayTransport::getUserID() const
+	{
+		return m_userID;
+	}
+
+	Array<String> NetworkRelayTransport::getRoomNameList() const
+	{
+		return m_roomNameList;
+	}
+
+	Optional<uint64> NetworkRelayTransport::getRoomListVersion() const
+	{
+		return m_roomListVersion;
+	}
+
+	Optional<uint64> NetworkRelayTransport::getStateVersion() const
+	{
+		return m_stateVersion;
+	}
+
+	bool NetworkRelayTransport::isInRoom() const
+	{
+		return (not m_roomName.isEmpty());
+	}
+
+	String NetworkRelayTransport::getCurrentRoomName() const
+	{
+		return m_roomName;
+	}
+
+	int32 NetworkRelayTransport::getPlayerCountInCurrentRoom() const
+	{
+		return static_cast<int32>(m_playerIDs.size());
+	}
+
+	int32 NetworkRelayTransport::getMaxPlayersInCurrentRoom() const
+	{
+		return (isInRoom() ? m_maxPlayers : 0);
+	}
+
+	bool NetworkRelayTransport::getIsOpenInCurrentRoom() const
+	{
+		return (isInRoom() && m_isOpen);
+	}
+
+	bool NetworkRelayTransport::getIsVisibleInCurrentRoom() const
+	{
+		return (isInRoom() && m_isVisible);
+	}
+
+	void NetworkRelayTransport::setIsOpenInCurrentRoom(const bool isOpen)
+	{
+		using namespace NetworkRelayProtocol;
+
+		if (not isInRoom())
+		{
+			return;
+		}
+
+		Writer writer{ Header{ MessageType::SetRoomFlag, Channel::Reliable } };
+		writer.write(RoomFlag::IsOpen);
+		writer.write(static_cast<uint8>(isOpen));
+		sendReliable(std::move(writer));
+	}
+
+	void NetworkRelayTransport::setIsVisibleInCurrentRoom(const bool isVisible)
+	{
+		using namespace NetworkRelayProtocol;
+
+		if (not isInRoom())
+		{
+			return;
+		}
+
+		Writer writer{ Header{ MessageType::SetRoomFlag, Channel::Reliable } };
+		writer.write(RoomFlag::IsVisible);
+		writer.write(static_cast<uint8>(isVisible));
+		sendReliable(std::move(writer));
+	}
+
+	int32 NetworkRelayTransport::getCountGamesRunning() const
+	{
+		return m_countGamesRunning;
+	}
+
+	int32 NetworkRelayTransport::getCountPlayersIngame() const
+	{
+		return m_countPlayersIngame;
+	}
+
+	int32 NetworkRelayTransport::getCountPlayersOnline() const
+	{
+		return m_countPlayersOnline;
+	}
+
+	Optional<int32> NetworkRelayTransport::localPlayerID() const
+	{
+		if (not isInRoom())
+		{
+			return none;
+		}
+
+		return m_localPlayerID;
+	}
+
+	Optional<int32> NetworkRelayTransport::getMasterClientID() const
+	{
+		if (not isInRoom())
+		{
+			return none;
+		}
+
+		return m_masterClientID;
+	}
+
+	int32 NetworkRelayTransport::getServerTimeMillisec() const
+	{
+		return static_cast<int32>(m_serverTimeMillisec + (nowMillisec() - m_serverTimeReceivedAt));
+	}
+
+	int32 NetworkRelayTransport::getRoundTripTimeMillisec() const
+	{
+		return static_cast<int32>(Max(m_roundTripTimeMillisec, 0.0));
+	}
+
+	NetworkStatistics::ConnectionStats NetworkRelayTransport::getConnectionStats() const
+	{
+		NetworkStatistics::ConnectionStats stats;
+		stats.roundTripTimeMillisec = getRoundTripTimeMillisec();
+		stats.roundTripTimeVarianceMillisec = static_cast<int32>(m_roundTripTimeVarianceMillisec);
+		stats.queuedOutgoing = m_channel.num_unacknowledged();
+		stats.resent = m_stats.resent;
+		stats.lost = m_stats.droppedEvents;
+		return stats;
+	}
+
+	uint64 NetworkRelayTransport::nowMillisec() const
+	{
+		return static_cast<uint64>(m_stopwatch.ms());
+	}
+
+	void NetworkRelayTransport::sendDatagram(const std::vector<uint8>& datagram)
+	{
+		if (not m_socket)
+		{
+			return;
+		}
+
+		m_socket->send(datagram);
+
+		++m_stats.sentDatagrams;
+		m_stats.sentBytes += datagram.size();
+	}
+
+	void NetworkRelayTransport::sendReliable(NetworkRelayProtocol::Writer&& writer)
+	{
+		sendDatagram(m_channel.send(std::move(writer), nowMillisec()));
+	}
+
+	void NetworkRelayTransport::handleDatagram(const uint8* data, const size_t size)
+	{
+		using namespace NetworkRelayProtocol;
+
+		Reader reader{ data, size };
+		Header header;
+
+		if (not reader.readHeader(header))
+		{
+			return;
+		}
+
+		m_lastReceivedAt = nowMillisec();
+
+		switch (header.channel)
+		{
+		case Channel::Ack:
+			m_channel.acknowledge(header.sequence);
+			return;
+		case Channel::Reliable:
+			// 受け取れないもの (先の番号すぎるもの) は確認を返さずに破棄し、再送させる
+			if (not m_channel.canReceive(header.sequence, size))
+			{
+				return;
+			}
+
+			sendDatagram(MakeAck(header.sequence));
+			m_channel.receive(header.sequence, data, size, [this](const uint8* message, const size_t messageSize)
+			{
+				// Listener の処理の中で disconnect() が呼ばれた場合は、残りを処理しない
+				if (not m_socket)
+				{
+					return;
+				}
+
+				Reader messageReader{ message, messageSize };
+				Header messageHeader;
+				messageReader.readHeader(messageHeader);
+				handleMessage(messageHeader, messageReader);
+			});
+			return;
+		default:
+			handleMessage(header, reader);
+			return;
+		}
+	}
+
+	void NetworkRelayTransport::handleMessage(const NetworkRelayProtocol::Header& header, NetworkRelayProtocol::Reader& reader)
+	{
+		using namespace NetworkRelayProtocol;
+
+		// イベントと Pong 以外のメッセージは、自分かルームの状態を変える
+		if ((header.type != MessageType::Event) && (header.type != MessageType::Pong))
+		{
+			++m_stateVersion;
+		}
+
+		switch (header.type)
+		{
+		case MessageType::ConnectReturn:
+		{
+			int32 errorCode = 0;
+			std::string userID;
+			reader.read(errorCode);
+			reader.readString(userID);
+
+			m_state = State::Connected;
+			m_userID = Unicode::FromUTF8(userID);
+
+			// 接続直後にルーム名の一覧と往復の遅延を得るため、すぐに Ping を送る
+			m_lastPingAt = 0;
+
+			if (m_listener)
+			{
+				m_listener->connectReturn(errorCode, U"");
+			}
+
+			return;
+		}
+		case MessageType::JoinReturn:
+		{
+			JoinKind kind{};
+			int32 playerID = -1, errorCode = 0;
+			std::string errorString, roomName;
+			uint8 maxPlayers = 0, isOpen = 1, isVisible = 1;
+			reader.read(kind);
+			reader.read(playerID);
+			reader.read(errorCode);
+			reader.readString(errorString);
+
+			if (errorCode == 0)
+			{
+				reader.readString(roomName);
+				reader.read(maxPlayers);
+				reader.read(isOpen);
+				reader.read(isVisible);
+
+				m_roomName = Unicode::FromUTF8(roomName);
+				m_localPlayerID = playerID;
+				m_maxPlayers = maxPlayers;
+				m_isOpen = (isOpen != 0);
+				m_isVisible = (isVisible != 0);
+			}
+
+			if (not m_listener)
+			{
+				return;
+			}
+
+			const String message = Unicode::FromUTF8(errorString);
+
+			switch (kind)
+			{
+			case JoinKind::Create:
+				m_listener->createRoomReturn(playerID, errorCode, message);
+				return;
+			case JoinKind::Join:
+				m_listener->joinRoomReturn(playerID, errorCode, message);
+				return;
+			default:
+				m_listener->joinRandomRoomReturn(playerID, errorCode, message);
+				return;
+			}
+		}
+		case MessageType::LeaveRoomReturn:
+		{
+			int32 errorCode = 0;
+			reader.read(errorCode);
+			resetRoom();
+
+			if (m_listener)
+			{
+				m_listener->leaveRoomReturn(errorCode, U"");
+			}
+
+			return;
+		}
+		case MessageType::PlayerJoined:
+		{
+			int32 playerID = -1;
+			uint16 count = 0;
+			reader.read(playerID);
+			reader.read(m_masterClientID);
+			reader.read(count);
+
+			m_playerIDs.clear();
+
+			for (uint16 i = 0; i < count; ++i)
+			{
+				int32 id = -1;
+				reader.read(id);
+				m_playerIDs << id;
+			}
+
+			if (m_listener)
+			{
+				m_listener->joinRoomEventAction(playerID, m_playerIDs, (playerID == m_localPlayerID));
+			}
+
+			return;
+		}
+		case MessageType::PlayerLeft:
+		{
+			int32 playerID = -1;
+			reader.read(playerID);
+			reader.read(m_masterClientID);
+			m_playerIDs.remove(playerID);
+
+			if (m_listener)
+			{
+				m_listener->leaveRoomEventAction(playerID, false);
+			}
+
+			return;
+		}
+		case MessageType::Event:
+		{
+			int32 playerID = -1;
+			uint8 eventCode = 0;
+			uint8 format = 0;
+
+			if ((not reader.read(playerID)) || (not reader.read(eventCode)) || (not reader.read(format)) || m_roomName.isEmpty())
+			{
+				return;
+			}
+
+			if (m_listener)
+			{
+				const Blob eventContent{ reader.rest(), reader.restSize() };
+				m_listener->customEventAction(playerID, eventCode, eventContent, (header.channel == Channel::Reliable), ToEnum<EventFormat>(format));
+			}
+
+			return;
+		}
+		case MessageType::RoomFlags:
+		{
+			uint8 isOpen = 1, isVisible = 1;
+			reader.read(isOpen);
+			reader.read(isVisible);
+			m_isOpen = (isOpen != 0);
+			m_isVisible = (isVisible != 0);
+			return;
+		}
+		case MessageType::Pong:
+		{
+			uint64 clientTime = 0;
+			uint16 count = 0;
+			reader.read(clientTime);
+			reader.read(m_serverTimeMillisec);
+			reader.read(m_countGamesRunning);
+			reader.read(m_countPlayersIngame);
+			reader.read(m_countPlayersOnline);
+			reader.read(count);
+
+			Array<String> roomNameList;
+
+			for (uint16 i = 0; i < count; ++i)
+			{
+				std::string roomName;
+
+				if (not reader.readString(roomName))
+				{
+					break;
+				}
+
+				roomNameList << Unicode::FromUTF8(roomName);
+			}
+
+			if (roomNameList != m_roomNameList)
+			{
+				m_roomNameList = std::move(roomNameList);
+				++m_roomListVersion;
+			}
+
+			// 往復の遅延は Photon と同様に平滑化する
+			const uint64 now = nowMillisec();
+			const double sample = static_cast<double>(now - clientTime);
+			if (m_roundTripTimeMillisec < 0.0)
+			{
+				m_roundTripTimeMillisec = sample;
+				m_roundTripTimeVarianceMillisec = (sample / 2);
+			}
+			else
+			{
+				m_roundTripTimeVarianceMillisec = (m_roundTripTimeVarianceMillisec * 0.75 + Abs(sample - m_roundTripTimeMillisec) * 0.25);
+				m_roundTripTimeMillisec = (m_roundTripTimeMillisec * 0.875 + sample * 0.125);
+			}
+
+			// サーバの時刻は、Pong が片道の遅延の分だけ遅れて届いたとみなして補正する
+			m_serverTimeMillisec += static_cast<uint32>(sample / 2);
+			m_serverTimeReceivedAt = now;
+			return;
+		}
+		default:
+			return;
+		}
+	}
+
+	void NetworkRelayTransport::close()
+	{
+		m_socket.reset();
+		m_state = State::Disconnected;
+		resetRoom();
+	}
+
+	void NetworkRelayTransport::resetRoom()
+	{
+		// connect() と close() からも呼ばれる
+		++m_stateVersion;
+		m_roomName.clear();
+		m_localPlayerID = -1;
+		m_masterClientID = 0;
+		m_maxPlayers = 0;
+		m_isOpen = true;
+		m_isVisible = true;
+		m_playerIDs.clear();
+	}
+}
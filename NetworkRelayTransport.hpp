@@ -0,0 +1,244 @@
+﻿
+# pragma once
+# include <Siv3D.hpp>
+# include "NetworkTransport.hpp"
+# include "NetworkRelayProtocol.hpp"
+
+namespace s3d
+{
+	/// @brief UDP でリレーサーバ (RelayServer) に接続するトランスポートです。
+	/// @remark Photon クラウドを使わずに、LAN 内の SivPhoton 同士を通信させたり、実際のソケットを通したテストやベンチマークを行ったりするために使います。
+	/// reliable のメッセージは受信の確認が来るまで再送され、送った順に処理されます。
+	/// ルーム名の一覧とサーバの統計は、1 秒ごとの Ping の応答で更新されます。
+	class NetworkRelayTransport : public NetworkTransport
+	{
+	public:
+
+		/// @brief 送受信の統計
+		struct Stats
+		{
+			uint64 sentDatagrams = 0;
+
+			uint64 sentBytes = 0;
+
+			uint64 receivedDatagrams = 0;
+
+			uint64 receivedBytes = 0;
+
+			/// @brief 再送した reliable のメッセージの数
+			uint64 resent = 0;
+
+			/// @brief 送信できずに破棄したイベントの数
+			/// @remark 1 つのデータグラムに収まらないイベントや、送信先のプレイヤーが 255 人を超えるイベントは送信されません。
+			uint64 droppedEvents = 0;
+		};
+
+		/// @brief NetworkRelayTransport を作成します。
+		/// @param host リレーサーバのホスト名または IPv4 アドレス
+		/// @param port リレーサーバのポート番号
+		explicit NetworkRelayTransport(StringView host = U"127.0.0.1", uint16 port = NetworkRelayProtocol::DefaultPort);
+
+		~NetworkRelayTransport() override;
+
+		NetworkRelayTransport(const NetworkRelayTransport&) = delete;
+
+		NetworkRelayTransport& operator =(const NetworkRelayTransport&) = delete;
+
+		/// @brief 統計を返します。
+		/// @return 統計
+		[[nodiscard]]
+		const Stats& getStats() const noexcept;
+
+		/// @brief リレーサーバへの接続を開始します。
+		/// @param userName ユーザ名
+		/// @return ホスト名を解決してソケットを作成できた場合 true, それ以外の場合は false
+		bool connect(StringView userName) override;
+
+		void disconnect() override;
+
+		/// @brief 受信したメッセージを処理し、必要に応じて再送と Ping の送信を行います。
+		void update() override;
+
+		void joinRandomRoom(int32 maxPlayers) override;
+
+		void joinRoom(StringView roomName) override;
+
+		void createRoom(StringView roomName, int32 maxPlayers) override;
+
+		void leaveRoom() override;
+
+		void changeGroups(const Array<uint8>& groupsToRemove, const Array<uint8>& groupsToAdd) override;
+
+		/// @brief イベントを送信します。
+		/// @remark 分割して送ることはしないため、ヘッダを含めて NetworkRelayProtocol::MaxDatagramSize バイトを超えるイベントは、reliable であってもログを出力して破棄し、Stats::droppedEvents に数えます。
+		void raiseEvent(uint8 eventCode, const Blob& eventContent, const NetworkSystem::EventOption& option, EventFormat format) override;
+
+		[[nodiscard]]
+		String getName() const override;
+
+		[[nodiscard]]
+		String getUserID() const override;
+
+		[[nodiscard]]
+		Array<String> getRoomNameList() const override;
+
+		/// @brief ルームの一覧の版を返します。
+		/// @return Pong で受け取ったルーム名の一覧が変わるたびに増える値
+		[[nodiscard]]
+		Optional<uint64> getRoomListVersion() const override;
+
+		/// @brief 自分と参加しているルームの状態の版を返します。
+		/// @return 接続・入退室・公開状態の変更などをサーバから受け取るたびに増える値
+		[[nodiscard]]
+		Optional<uint64> getStateVersion() const override;
+
+		[[nodiscard]]
+		bool isInRoom() const override;
+
+		[[nodiscard]]
+		String getCurrentRoomName() const override;
+
+		[[nodiscard]]
+		int32 getPlayerCountInCurrentRoom() const override;
+
+		[[nodiscard]]
+		int32 getMaxPlayersInCurrentRoom() const override;
+
+		[[nodiscard]]
+		bool getIsOpenInCurrentRoom() const override;
+
+		[[nodiscard]]
+		bool getIsVisibleInCurrentRoom() const override;
+
+		void setIsOpenInCurrentRoom(bool isOpen) override;
+
+		void setIsVisibleInCurrentRoom(bool isVisible) override;
+
+		[[nodiscard]]
+		int32 getCountGamesRunning() const override;
+
+		[[nodiscard]]
+		int32 getCountPlayersIngame() const override;
+
+		[[nodiscard]]
+		int32 getCountPlayersOnline() const override;
+
+		[[nodiscard]]
+		Optional<int32> localPlayerID() const override;
+
+		[[nodiscard]]
+		Optional<int32> getMasterClientID() const override;
+
+		/// @brief サーバの時刻を返します。
+		/// @return 最後に受信した Pong のサーバの時刻に、受信してからの経過時間を加えたもの (ミリ秒)
+		[[nodiscard]]
+		int32 getServerTimeMillisec() const override;
+
+		/// @brief 往復の遅延を返します。
+		/// @return Ping と Pong から測った往復の遅延の平滑値 (ミリ秒)
+		[[nodiscard]]
+		int32 getRoundTripTimeMillisec() const override;
+
+		/// @brief 通信路の状態を返します。
+		/// @return 往復の遅延とそのばらつき, 受信の確認を待っている reliable のメッセージの数, 再送の累計, 送信できずに破棄したイベントの累計
+		[[nodiscard]]
+		NetworkStatistics::ConnectionStats getConnectionStats() const override;
+
+	private:
+
+		enum class State : uint8
+		{
+			Disconnected,
+
+			Connecting,
+
+			Connected,
+		};
+
+		/// @brief プラットフォームごとのソケット
+		struct Socket;
+
+		String m_host;
+
+		uint16 m_port = 0;
+
+		std::unique_ptr<Socket> m_socket;
+
+		State m_state = State::Disconnected;
+
+		NetworkRelayProtocol::ReliableChannel m_channel;
+
+		Stopwatch m_stopwatch{ StartImmediately::Yes };
+
+		/// @brief 受信したデータグラムの書き込み先
+		std::vector<uint8> m_receiveBuffer = std::vector<uint8>(65536);
+
+		String m_userName;
+
+		String m_userID;
+
+		/// @brief 参加しているルームの名前 (参加していない場合は空)
+		String m_roomName;
+
+		int32 m_localPlayerID = -1;
+
+		int32 m_masterClientID = 0;
+
+		int32 m_maxPlayers = 0;
+
+		bool m_isOpen = true;
+
+		bool m_isVisible = true;
+
+		/// @brief ルーム内のプレイヤー ID
+		Array<int32> m_playerIDs;
+
+		Array<String> m_roomNameList;
+
+		uint64 m_roomListVersion = 0;
+
+		uint64 m_stateVersion = 0;
+
+		int32 m_countGamesRunning = 0;
+
+		int32 m_countPlayersIngame = 0;
+
+		int32 m_countPlayersOnline = 0;
+
+		/// @brief 往復の遅延の平滑値 (ミリ秒), 未計測の場合は負の値
+		double m_roundTripTimeMillisec = -1.0;
+
+		/// @brief 往復の遅延のばらつきの平滑値 (ミリ秒)
+		double m_roundTripTimeVarianceMillisec = 0.0;
+
+		uint32 m_serverTimeMillisec = 0;
+
+		uint64 m_serverTimeReceivedAt = 0;
+
+		uint64 m_connectStartedAt = 0;
+
+		uint64 m_lastReceivedAt = 0;
+
+		uint64 m_lastPingAt = 0;
+
+		/// @brief 次の update() で disconnectReturn を通知する場合 true
+		bool m_disconnectPending = false;
+
+		Stats m_stats;
+
+		[[nodiscard]]
+		uint64 nowMillisec() const;
+
+		void sendDatagram(const std::vector<uint8>& datagram);
+
+		void sendReliable(NetworkRelayProtocol::Writer&& writer);
+
+		void handleDatagram(const uint8* data, size_t size);
+
+		void handleMessage(const NetworkRelayProtocol::Header& header, NetworkRelayProtocol::Reader& reader);
+
+		void close();
+
+		void resetRoom();
+	};
+}
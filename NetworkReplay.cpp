@@ -0,0 +1,108 @@
+﻿
+# include "NetworkReplay.hpp"
+
+namespace s3d
+{
+	NetworkReplay::NetworkReplay(const FilePathView path)
+	{
+		open(path);
+	}
+
+	bool NetworkReplay::open(const FilePathView path)
+	{
+		m_next = 0;
+		m_timeMicrosec = 0;
+		return m_capture.open(path);
+	}
+
+	bool NetworkReplay::isOpen() const noexcept
+	{
+		return m_capture.isOpen();
+	}
+
+	void NetworkReplay::setOutboundEnabled(const bool enabled) noexcept
+	{
+		m_outboundEnabled = enabled;
+	}
+
+	void NetworkReplay::seek(const double seconds)
+	{
+		m_timeMicrosec = static_cast<int64>(Max(seconds, 0.0) * 1'000'000);
+		m_next = m_capture.lowerBound(m_timeMicrosec);
+	}
+
+	double NetworkReplay::position() const noexcept
+	{
+		return (m_timeMicrosec / 1'000'000.0);
+	}
+
+	double NetworkReplay::duration() const noexcept
+	{
+		return (m_capture.durationMicrosec() / 1'000'000.0);
+	}
+
+	bool NetworkReplay::isFinished() const noexcept
+	{
+		return (m_capture.size() <= m_next);
+	}
+
+	size_t NetworkReplay::update(SivPhoton& target, const double deltaTime, const double speed)
+	{
+		m_timeMicrosec += static_cast<int64>(Max(deltaTime * speed, 0.0) * 1'000'000);
+
+		size_t numDispatched = 0;
+
+		for (; m_next < m_capture.size(); ++m_next)
+		{
+			const NetworkCaptureRecord record = m_capture[m_next];
+
+			if (m_timeMicrosec < record.timeMicrosec)
+			{
+				break;
+			}
+
+			if (dispatch(target, record))
+			{
+				++numDispatched;
+			}
+		}
+
+		return numDispatched;
+	}
+
+	size_t NetworkReplay::step(SivPhoton& target, const size_t maxEvents)
+	{
+		size_t numDispatched = 0;
+
+		for (; (m_next < m_capture.size()) && (numDispatched < maxEvents); ++m_next)
+		{
+			const NetworkCaptureRecord record = m_capture[m_next];
+
+			// 時刻は、最後に渡したイベントの時刻まで進める
+			m_timeMicrosec = Max(m_timeMicrosec, record.timeMicrosec);
+
+			if (dispatch(target, record))
+			{
+				++numDispatched;
+			}
+		}
+
+		return numDispatched;
+	}
+
+	const NetworkCaptureReader& NetworkReplay::getCapture() const noexcept
+	{
+		return m_capture;
+	}
+
+	bool NetworkReplay::dispatch(SivPhoton& target, const NetworkCaptureRecord& record)
+	{
+		if ((record.direction == NetworkCaptureDirection::Outbound) && (not m_outboundEnabled))
+		{
+			return false;
+		}
+
+		target.dispatchEvent(record.playerID, record.eventCode, Blob{ record.data, record.size }, record.format);
+		return true;
+	}
+}
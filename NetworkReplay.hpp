@@ -0,0 +1,90 @@
+﻿
+# pragma once
+# include <Siv3D.hpp>
+# include "NetworkCapture.hpp"
+
+namespace s3d
+{
+	/// @brief SivPhoton::startCapture() でキャプチャしたイベントを、SivPhoton に受信したイベントとして渡し直すクラスです。
+	/// @remark イベントは SivPhoton::dispatchEvent() を通して、受信したときと同じ customEventAction() またはイベントハンドラに渡されます。
+	/// 再生の時刻は update() に渡した経過時間だけで進むため、同じ経過時間の列で再生すれば、同じイベントが同じ順序で同じ update() の中で渡されます。
+	/// 既定では受信したイベントのみを再生します。
+	class NetworkReplay
+	{
+	public:
+
+		NetworkReplay() = default;
+
+		/// @brief キャプチャのファイルを開きます。
+		/// @param path キャプチャのファイルのパス
+		explicit NetworkReplay(FilePathView path);
+
+		/// @brief キャプチャのファイルを開き、先頭に戻ります。
+		/// @param path キャプチャのファイルのパス
+		/// @return 開けた場合 true, それ以外の場合は false
+		bool open(FilePathView path);
+
+		/// @brief ファイルを開いているかを返します。
+		/// @return 開いている場合 true, それ以外の場合は false
+		[[nodiscard]]
+		bool isOpen() const noexcept;
+
+		/// @brief 送信したイベントも再生するかを設定します。
+		/// @param enabled 再生する場合 true, それ以外の場合は false
+		void setOutboundEnabled(bool enabled) noexcept;
+
+		/// @brief 再生の時刻を変更します。
+		/// @param seconds キャプチャの開始からの時間 (秒)
+		/// @remark 索引を二分探索し、その時刻以降の最初のイベントから再生を続けます。
+		void seek(double seconds);
+
+		/// @brief 現在の再生の時刻を返します。
+		/// @return キャプチャの開始からの時間 (秒)
+		[[nodiscard]]
+		double position() const noexcept;
+
+		/// @brief キャプチャの長さを返します。
+		/// @return 最後のイベントの時刻 (秒)
+		[[nodiscard]]
+		double duration() const noexcept;
+
+		/// @brief すべてのイベントを再生し終えたかを返します。
+		/// @return 再生し終えた場合 true, それ以外の場合は false
+		[[nodiscard]]
+		bool isFinished() const noexcept;
+
+		/// @brief 記録された間隔で再生します。
+		/// @param target イベントを渡す SivPhoton
+		/// @param deltaTime 再生の時刻を進める時間 (秒)
+		/// @param speed 再生の速さの倍率
+		/// @return 渡したイベントの数
+		size_t update(SivPhoton& target, double deltaTime = Scene::DeltaTime(), double speed = 1.0);
+
+		/// @brief 時刻を無視して、できるだけ速く再生します。
+		/// @param target イベントを渡す SivPhoton
+		/// @param maxEvents 渡すイベントの最大数
+		/// @return 渡したイベントの数
+		size_t step(SivPhoton& target, size_t maxEvents = Largest<size_t>);
+
+		/// @brief キャプチャを返します。
+		/// @return キャプチャ
+		[[nodiscard]]
+		const NetworkCaptureReader& getCapture() const noexcept;
+
+	private:
+
+		NetworkCaptureReader m_capture;
+
+		/// @brief 次に再生するイベントの番号
+		size_t m_next = 0;
+
+		/// @brief 再生の時刻 (マイクロ秒)
+		int64 m_timeMicrosec = 0;
+
+		bool m_outboundEnabled = false;
+
+		/// @brief イベントを 1 つ渡します。
+		/// @return 渡した場合 true, 再生しない向きのイベントの場合は false
+		bool dispatch(SivPhoton& target, const NetworkCaptureRecord& record);
+	};
+}
@@ -0,0 +1,167 @@
+﻿
+# include "NetworkReplicationScheduler.hpp"
+
+namespace s3d
+{
+	NetworkReplicationScheduler::NetworkReplicationScheduler(const size_t budgetBytes)
+		: m_budgetBytes{ budgetBytes } {}
+
+	void NetworkReplicationScheduler::setBudget(const size_t budgetBytes) noexcept
+	{
+		m_budgetBytes = budgetBytes;
+	}
+
+	size_t NetworkReplicationScheduler::getBudget() const noexcept
+	{
+		return m_budgetBytes;
+	}
+
+	void NetworkReplicationScheduler::setStarvationThreshold(const double seconds) noexcept
+	{
+		m_starvationThreshold = seconds;
+	}
+
+	void NetworkReplicationScheduler::addStream(const uint32 id, const double priority, const size_t sizeBytes)
+	{
+		if (const auto it = m_indices.find(id); it != m_indices.end())
+		{
+			m_priorities[it->second] = priority;
+			m_sizes[it->second] = sizeBytes;
+			return;
+		}
+
+		m_indices.emplace(id, m_ids.size());
+		m_ids << id;
+		m_priorities << priority;
+		m_accumulators << 0.0;
+		m_sizes << sizeBytes;
+		m_waitTimes << 0.0;
+	}
+
+	void NetworkReplicationScheduler::removeStream(const uint32 id)
+	{
+		const auto it = m_indices.find(id);
+
+		if (it == m_indices.end())
+		{
+			return;
+		}
+
+		const size_t index = it->second;
+		const size_t last = (m_ids.size() - 1);
+		m_indices.erase(it);
+
+		// 末尾の要素を削除した位置に移動する
+		if (index != last)
+		{
+			m_ids[index] = m_ids[last];
+			m_priorities[index] = m_priorities[last];
+			m_accumulators[index] = m_accumulators[last];
+			m_sizes[index] = m_sizes[last];
+			m_waitTimes[index] = m_waitTimes[last];
+			m_indices[m_ids[index]] = index;
+		}
+
+		m_ids.pop_back();
+		m_priorities.pop_back();
+		m_accumulators.pop_back();
+		m_sizes.pop_back();
+		m_waitTimes.pop_back();
+	}
+
+	void NetworkReplicationScheduler::setPriority(const uint32 id, const double priority)
+	{
+		if (const auto it = m_indices.find(id); it != m_indices.end())
+		{
+			m_priorities[it->second] = priority;
+		}
+	}
+
+	bool NetworkReplicationScheduler::contains(const uint32 id) const
+	{
+		return m_indices.contains(id);
+	}
+
+	size_t NetworkReplicationScheduler::num_streams() const noexcept
+	{
+		return m_ids.size();
+	}
+
+	const Array<uint32>& NetworkReplicationScheduler::schedule(const double deltaTime)
+	{
+		const size_t num = m_ids.size();
+
+		m_order.clear();
+
+		for (size_t i = 0; i < num; ++i)
+		{
+			m_accumulators[i] += (m_priorities[i] * deltaTime);
+			m_waitTimes[i] += deltaTime;
+
+			if (0.0 < m_accumulators[i])
+			{
+				m_order << i;
+			}
+		}
+
+		std::sort(m_order.begin(), m_order.end(),
+			[this](const size_t a, const size_t b) { return (m_accumulators[a] > m_accumulators[b]); });
+
+		m_scheduled.clear();
+		m_stats = {};
+
+		size_t remaining = m_budgetBytes;
+
+		for (const auto index : m_order)
+		{
+			const size_t size = m_sizes[index];
+
+			// 上限より大きいものも、最優先であれば単独で送る (永久に送られないのを防ぐ)
+			const bool oversized = (m_scheduled.isEmpty() && (m_budgetBytes < size));
+
+			if ((remaining < size) && (not oversized))
+			{
+				continue;
+			}
+
+			m_scheduled << m_ids[index];
+			m_stats.scheduledBytes += size;
+			remaining -= Min(size, remaining);
+			m_accumulators[index] = 0.0;
+			m_waitTimes[index] = 0.0;
+
+			if (remaining == 0)
+			{
+				break;
+			}
+		}
+
+		m_starved.clear();
+
+		for (size_t i = 0; i < num; ++i)
+		{
+			m_stats.maxWaitTime = Max(m_stats.maxWaitTime, m_waitTimes[i]);
+
+			if (m_starvationThreshold < m_waitTimes[i])
+			{
+				m_starved << m_ids[i];
+			}
+		}
+
+		m_stats.scheduledStreams = m_scheduled.size();
+		m_stats.deferredStreams = (num - m_scheduled.size());
+		m_stats.starvedStreams = m_starved.size();
+
+		return m_scheduled;
+	}
+
+	const Array<uint32>& NetworkReplicationScheduler::getStarvedStreams() const noexcept
+	{
+		return m_starved;
+	}
+
+	const NetworkReplicationScheduler::Stats& NetworkReplicationScheduler::getStats() const noexcept
+	{
+		return m_stats;
+	}
+}
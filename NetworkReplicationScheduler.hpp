@@ -0,0 +1,120 @@
+﻿
+# pragma once
+# include <Siv3D.hpp>
+
+namespace s3d
+{
+	/// @brief 送信量の上限の中で、優先度の高いストリームから送信するものを選ぶクラスです。
+	/// @remark 各ストリームの優先度は送信されるまで時間とともに蓄積され、送信されると 0 に戻ります。
+	/// オブジェクトの数に関わらず、1 回あたりの送信量は上限を超えません。
+	/// 送信先ごとに上限を設けたい場合は、送信先ごとにインスタンスを作成してください。
+	class NetworkReplicationScheduler
+	{
+	public:
+
+		/// @brief 直近の schedule() の結果
+		struct Stats
+		{
+			/// @brief 送信するストリームの数
+			size_t scheduledStreams = 0;
+
+			/// @brief 送信するストリームの合計バイト数
+			size_t scheduledBytes = 0;
+
+			/// @brief 送信されなかったストリームの数
+			size_t deferredStreams = 0;
+
+			/// @brief 送信待ちの時間がしきい値を超えているストリームの数
+			size_t starvedStreams = 0;
+
+			/// @brief 最も長い送信待ちの時間 (秒)
+			double maxWaitTime = 0.0;
+		};
+
+		/// @brief NetworkReplicationScheduler を作成します。
+		/// @param budgetBytes 1 回の schedule() で送信するバイト数の上限
+		explicit NetworkReplicationScheduler(size_t budgetBytes);
+
+		/// @brief 1 回の schedule() で送信するバイト数の上限を設定します。
+		/// @param budgetBytes バイト数の上限
+		void setBudget(size_t budgetBytes) noexcept;
+
+		/// @brief 1 回の schedule() で送信するバイト数の上限を返します。
+		/// @return バイト数の上限
+		[[nodiscard]]
+		size_t getBudget() const noexcept;
+
+		/// @brief 送信されない状態が続いていると判定するまでの時間を設定します。
+		/// @param seconds 時間 (秒)
+		void setStarvationThreshold(double seconds) noexcept;
+
+		/// @brief ストリームを追加します。
+		/// @param id ストリームの ID (NetworkEntityID など)
+		/// @param priority 1 秒あたりに蓄積される優先度
+		/// @param sizeBytes 1 回の送信で使うバイト数
+		/// @remark 既に存在する場合は優先度と大きさを更新します。
+		void addStream(uint32 id, double priority, size_t sizeBytes);
+
+		/// @brief ストリームを削除します。
+		/// @param id ストリームの ID
+		void removeStream(uint32 id);
+
+		/// @brief ストリームの優先度を変更します。
+		/// @param id ストリームの ID
+		/// @param priority 1 秒あたりに蓄積される優先度
+		void setPriority(uint32 id, double priority);
+
+		/// @brief ストリームが存在するかを返します。
+		/// @param id ストリームの ID
+		/// @return 存在する場合 true, それ以外の場合は false
+		[[nodiscard]]
+		bool contains(uint32 id) const;
+
+		/// @brief ストリームの数を返します。
+		/// @return ストリームの数
+		[[nodiscard]]
+		size_t num_streams() const noexcept;
+
+		/// @brief 優先度を蓄積し、今回送信するストリームを選びます。
+		/// @param deltaTime 前回の呼び出しからの経過時間 (秒)
+		/// @return 今回送信するストリームの ID の一覧 (優先度の高い順)
+		/// @remark 選ばれたストリームの優先度は 0 に戻ります。
+		const Array<uint32>& schedule(double deltaTime);
+
+		/// @brief 送信待ちの時間がしきい値を超えているストリームの ID の一覧を返します。
+		/// @return ストリームの ID の一覧
+		[[nodiscard]]
+		const Array<uint32>& getStarvedStreams() const noexcept;
+
+		/// @brief 直近の schedule() の結果を返します。
+		/// @return 直近の schedule() の結果
+		[[nodiscard]]
+		const Stats& getStats() const noexcept;
+
+	private:
+
+		size_t m_budgetBytes = 0;
+
+		double m_starvationThreshold = 1.0;
+
+		Array<uint32> m_ids;
+
+		Array<double> m_priorities;
+
+		Array<double> m_accumulators;
+
+		Array<size_t> m_sizes;
+
+		Array<double> m_waitTimes;
+
+		HashTable<uint32, size_t> m_indices;
+
+		Array<size_t> m_order;
+
+		Array<uint32> m_scheduled;
+
+		Array<uint32> m_starved;
+
+		Stats m_stats;
+	};
+}
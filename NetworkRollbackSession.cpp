@@ -0,0 +1,382 @@
+﻿
+# include "NetworkRollbackSession.hpp"
+
+namespace s3d
+{
+	NetworkRollbackSession::NetworkRollbackSession(SivPhoton& network, const uint8 eventCode, const int32 inputDelay, const int32 maxPrediction)
+		: m_network{ network }
+		, m_eventCode{ eventCode }
+		, m_inputDelay{ Clamp(inputDelay, 0, static_cast<int32>(BufferSize / 8)) }
+		, m_maxPrediction{ Clamp(maxPrediction, 1, static_cast<int32>(BufferSize / 8)) }
+		, m_slots(BufferSize)
+	{
+		m_network.setEventHandler(m_eventCode, [this](const int32 playerID, const Blob& data) { onReceive(playerID, data); });
+	}
+
+	NetworkRollbackSession::~NetworkRollbackSession()
+	{
+		m_network.removeEventHandler(m_eventCode);
+	}
+
+	void NetworkRollbackSession::setCallbacks(std::function<Blob()> save, std::function<void(const Blob&)> load, std::function<void(const InputBundle&)> advance)
+	{
+		m_save = std::move(save);
+		m_load = std::move(load);
+		m_advance = std::move(advance);
+	}
+
+	void NetworkRollbackSession::start(const Array<int32>& playerIDs)
+	{
+		assert(m_save && m_load && m_advance);
+
+		m_playerIDs = playerIDs;
+		std::sort(m_playerIDs.begin(), m_playerIDs.end());
+		m_playerIDs.erase(std::unique(m_playerIDs.begin(), m_playerIDs.end()), m_playerIDs.end());
+
+		m_activePlayers.assign(m_playerIDs.size(), true);
+		m_lastReceivedFrames.assign(m_playerIDs.size(), none);
+		m_remoteAcks.assign(m_playerIDs.size(), static_cast<uint32>(m_inputDelay));
+		m_lastInputs.assign(m_playerIDs.size(), Blob{});
+
+		for (auto& slot : m_slots)
+		{
+			slot.frame = UINT32_MAX;
+		}
+
+		m_frame = 0;
+		m_confirmedFrames = 0;
+		m_lastSubmittedFrame.reset();
+		m_mispredictedFrame.reset();
+		m_stats = {};
+
+		// 入力遅延の分の最初のフレームは全員の入力が空
+		for (uint32 frame = 0; frame < static_cast<uint32>(m_inputDelay); ++frame)
+		{
+			for (size_t i = 0; i < m_playerIDs.size(); ++i)
+			{
+				setInput(i, frame, Blob{});
+			}
+		}
+
+		m_running = true;
+	}
+
+	bool NetworkRollbackSession::isRunning() const noexcept
+	{
+		return m_running;
+	}
+
+	bool NetworkRollbackSession::step(const Blob& localInput)
+	{
+		if (not m_running)
+		{
+			return false;
+		}
+
+		const auto localPlayerID = m_network.localPlayerID();
+		const auto localIndex = (localPlayerID ? playerIndexOf(*localPlayerID) : none);
+
+		if (not localIndex)
+		{
+			return false;
+		}
+
+		updateConfirmedFrames();
+
+		// 最も遅れているプレイヤーとの差
+		{
+			Optional<int64> slowestFrame;
+
+			for (size_t i = 0; i < m_playerIDs.size(); ++i)
+			{
+				if ((i == *localIndex) || (not m_activePlayers[i]) || (not m_lastReceivedFrames[i]))
+				{
+					continue;
+				}
+
+				const int64 remoteFrame = (static_cast<int64>(*m_lastReceivedFrames[i]) - m_inputDelay);
+				slowestFrame = (slowestFrame ? Min(*slowestFrame, remoteFrame) : remoteFrame);
+			}
+
+			m_stats.lead = (slowestFrame ? static_cast<int32>(static_cast<int64>(m_frame) - *slowestFrame) : 0);
+		}
+
+		if (static_cast<int32>(m_frame - m_confirmedFrames) >= m_maxPrediction)
+		{
+			// 相手に届いていない可能性があるので、待機中も自分の入力を送り続ける
+			sendInputs(*localIndex);
+			++m_stats.stalledTicks;
+			return false;
+		}
+
+		const uint32 targetFrame = (m_frame + m_inputDelay);
+
+		if ((not m_lastSubmittedFrame) || (*m_lastSubmittedFrame < targetFrame))
+		{
+			setInput(*localIndex, targetFrame, localInput);
+			m_lastSubmittedFrame = targetFrame;
+		}
+
+		sendInputs(*localIndex);
+
+		rollback();
+
+		advanceFrame(m_frame);
+		++m_frame;
+		m_stats.frame = m_frame;
+		return true;
+	}
+
+	double NetworkRollbackSession::getTimeScale() const noexcept
+	{
+		constexpr double Step = 0.02;
+
+		if (1 < m_stats.lead)
+		{
+			return Max((1.0 - Step * (m_stats.lead - 1)), 0.8);
+		}
+		else if (m_stats.lead < -1)
+		{
+			return Min((1.0 + Step * (-m_stats.lead - 1)), 1.2);
+		}
+
+		return 1.0;
+	}
+
+	void NetworkRollbackSession::onPlayerLeft(const int32 playerID)
+	{
+		if (const auto index = playerIndexOf(playerID))
+		{
+			m_activePlayers[*index] = false;
+		}
+	}
+
+	const NetworkRollbackSession::Stats& NetworkRollbackSession::getStats() const noexcept
+	{
+		return m_stats;
+	}
+
+	Optional<size_t> NetworkRollbackSession::playerIndexOf(const int32 playerID) const
+	{
+		const auto it = std::lower_bound(m_playerIDs.begin(), m_playerIDs.end(), playerID);
+
+		if ((it == m_playerIDs.end()) || (*it != playerID))
+		{
+			return none;
+		}
+
+		return static_cast<size_t>(it - m_playerIDs.begin());
+	}
+
+	NetworkRollbackSession::FrameSlot& NetworkRollbackSession::getSlot(const uint32 frame)
+	{
+		FrameSlot& slot = m_slots[frame % BufferSize];
+
+		if (slot.frame != frame)
+		{
+			slot.frame = frame;
+			slot.inputs.assign(m_playerIDs.size(), none);
+			slot.usedInputs.assign(m_playerIDs.size(), Blob{});
+			slot.state = Blob{};
+		}
+
+		return slot;
+	}
+
+	void NetworkRollbackSession::setInput(const size_t playerIndex, const uint32 frame, const Blob& input)
+	{
+		FrameSlot& slot = getSlot(frame);
+
+		if (slot.inputs[playerIndex])
+		{
+			return;
+		}
+
+		slot.inputs[playerIndex] = input;
+
+		// 既に進めたフレームで、予測した入力と異なっていた場合は巻き戻す
+		if ((frame < m_frame) && (slot.usedInputs[playerIndex] != input))
+		{
+			m_mispredictedFrame = (m_mispredictedFrame ? Min(*m_mispredictedFrame, frame) : frame);
+		}
+	}
+
+	void NetworkRollbackSession::sendInputs(const size_t localIndex)
+	{
+		if (not m_lastSubmittedFrame)
+		{
+			return;
+		}
+
+		const uint32 lastFrame = *m_lastSubmittedFrame;
+
+		// まだ受信していないプレイヤーがいる最も古いフレームから送る
+		uint32 firstFrame = (lastFrame + 1);
+
+		for (size_t i = 0; i < m_playerIDs.size(); ++i)
+		{
+			if ((i != localIndex) && m_activePlayers[i])
+			{
+				firstFrame = Min(firstFrame, m_remoteAcks[i]);
+			}
+		}
+
+		firstFrame = Max(firstFrame, static_cast<uint32>(m_inputDelay));
+
+		if (MaxResendFrames < (lastFrame + 1 - firstFrame))
+		{
+			firstFrame = (lastFrame + 1 - MaxResendFrames);
+		}
+
+		m_writer.clear();
+		m_writer.write(MessageType::Inputs);
+		m_writer.write(m_confirmedFrames);
+		m_writer.write(firstFrame);
+		m_writer.write(static_cast<uint8>(lastFrame - firstFrame + 1));
+
+		for (uint32 frame = firstFrame; frame <= lastFrame; ++frame)
+		{
+			const Blob& input = *getSlot(frame).inputs[localIndex];
+			assert(input.size() <= UINT16_MAX);
+
+			m_writer.write(static_cast<uint16>(input.size()));
+			m_writer.writeBytes(input.data(), input.size());
+		}
+
+		m_network.opRaiseEvent(m_eventCode, m_writer.getBlob(), { .reliable = false });
+	}
+
+	void NetworkRollbackSession::rollback()
+	{
+		if ((not m_mispredictedFrame) || (m_frame <= *m_mispredictedFrame))
+		{
+			m_mispredictedFrame.reset();
+			return;
+		}
+
+		const uint32 firstFrame = *m_mispredictedFrame;
+		const uint32 depth = (m_frame - firstFrame);
+		m_mispredictedFrame.reset();
+
+		m_load(getSlot(firstFrame).state);
+
+		for (uint32 frame = firstFrame; frame < m_frame; ++frame)
+		{
+			advanceFrame(frame);
+		}
+
+		++m_stats.rollbacks;
+		m_stats.resimulatedFrames += depth;
+		m_stats.lastRollbackDepth = depth;
+		m_stats.maxRollbackDepth = Max(m_stats.maxRollbackDepth, depth);
+	}
+
+	void NetworkRollbackSession::advanceFrame(const uint32 frame)
+	{
+		FrameSlot& slot = getSlot(frame);
+		slot.state = m_save();
+
+		m_bundle.frame = frame;
+		m_bundle.playerIDs = m_playerIDs;
+		m_bundle.inputs.resize(m_playerIDs.size());
+		m_bundle.predicted.resize(m_playerIDs.size());
+
+		for (size_t i = 0; i < m_playerIDs.size(); ++i)
+		{
+			// 未受信の入力は、そのプレイヤーの最新の入力が続くと予測する
+			const bool predicted = (not slot.inputs[i].has_value());
+			slot.usedInputs[i] = (predicted ? m_lastInputs[i] : *slot.inputs[i]);
+			m_bundle.inputs[i] = slot.usedInputs[i];
+			m_bundle.predicted[i] = predicted;
+		}
+
+		m_advance(m_bundle);
+	}
+
+	void NetworkRollbackSession::updateConfirmedFrames()
+	{
+		while (m_confirmedFrames < m_frame)
+		{
+			FrameSlot& slot = getSlot(m_confirmedFrames);
+
+			for (size_t i = 0; i < m_playerIDs.size(); ++i)
+			{
+				if (slot.inputs[i])
+				{
+					continue;
+				}
+
+				if (m_activePlayers[i])
+				{
+					m_stats.confirmedFrames = m_confirmedFrames;
+					return;
+				}
+
+				// 退室したプレイヤーの入力は予測した入力のまま確定する
+				slot.inputs[i] = slot.usedInputs[i];
+			}
+
+			++m_confirmedFrames;
+		}
+
+		m_stats.confirmedFrames = m_confirmedFrames;
+	}
+
+	void NetworkRollbackSession::onReceive(const int32 playerID, const Blob& data)
+	{
+		if (not m_running)
+		{
+			return;
+		}
+
+		const auto index = playerIndexOf(playerID);
+
+		if (not index)
+		{
+			return;
+		}
+
+		NetworkPacketReader reader{ data };
+		MessageType type;
+		uint32 ack = 0;
+		uint32 firstFrame = 0;
+		uint8 count = 0;
+
+		if ((not reader.read(type)) || (type != MessageType::Inputs)
+			|| (not reader.read(ack)) || (not reader.read(firstFrame)) || (not reader.read(count)))
+		{
+			return;
+		}
+
+		// 順序が入れ替わって届いた古い確認応答で戻さない
+		m_remoteAcks[*index] = Max(m_remoteAcks[*index], ack);
+
+		for (uint32 frame = firstFrame; frame < (firstFrame + count); ++frame)
+		{
+			uint16 size = 0;
+
+			if ((not reader.read(size)) || (reader.remaining() < size))
+			{
+				return;
+			}
+
+			// 確定済みのフレームと、保持できないほど先のフレームは無視する
+			if ((m_confirmedFrames <= frame) && (frame < (m_frame + (BufferSize / 2))))
+			{
+				Blob input{ reader.current(), size };
+
+				auto& lastReceivedFrame = m_lastReceivedFrames[*index];
+
+				if ((not lastReceivedFrame) || (*lastReceivedFrame < frame))
+				{
+					lastReceivedFrame = frame;
+					m_lastInputs[*index] = input;
+				}
+
+				setInput(*index, frame, input);
+			}
+
+			reader.skip(size);
+		}
+	}
+}
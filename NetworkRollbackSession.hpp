@@ -0,0 +1,204 @@
+﻿
+# pragma once
+# include <Siv3D.hpp>
+# include "NetworkSystem.hpp"
+# include "NetworkPacket.hpp"
+
+namespace s3d
+{
+	/// @brief 他のプレイヤーの入力を予測して待たずに進め、予測が外れた場合は巻き戻して再シミュレーションするクラスです。
+	/// @remark 各イベントには、自分が全員の入力を受信済みのフレーム数 (確認応答) を含めます。
+	/// 自分の入力は、全員から確認応答を受け取っていないフレームをすべてまとめて非確実 (unreliable) に送信するため、
+	/// 何回続けてイベントが失われても、次に届いたイベントで補われます。
+	class NetworkRollbackSession
+	{
+	public:
+
+		/// @brief 1 フレーム分の全員の入力
+		struct InputBundle
+		{
+			/// @brief フレーム番号
+			uint32 frame = 0;
+
+			/// @brief プレイヤー ID の一覧 (昇順)
+			Array<int32> playerIDs;
+
+			/// @brief 入力の一覧 (並びは playerIDs と同じ)
+			Array<Blob> inputs;
+
+			/// @brief 入力が予測によるものか (並びは playerIDs と同じ)
+			Array<bool> predicted;
+		};
+
+		/// @brief ロールバックの統計
+		struct Stats
+		{
+			/// @brief 次に進めるフレーム番号
+			uint32 frame = 0;
+
+			/// @brief 全員の入力が確定しているフレームの数
+			uint32 confirmedFrames = 0;
+
+			/// @brief 巻き戻した回数
+			uint64 rollbacks = 0;
+
+			/// @brief 再シミュレーションしたフレームの合計
+			uint64 resimulatedFrames = 0;
+
+			/// @brief 最後に巻き戻したフレーム数
+			uint32 lastRollbackDepth = 0;
+
+			/// @brief 最大で巻き戻したフレーム数
+			uint32 maxRollbackDepth = 0;
+
+			/// @brief 予測できる範囲を超えて進めなかった回数
+			uint64 stalledTicks = 0;
+
+			/// @brief 最も遅れているプレイヤーより何フレーム先にいるか
+			int32 lead = 0;
+		};
+
+		/// @brief NetworkRollbackSession を作成します。
+		/// @param network 送受信に使う SivPhoton
+		/// @param eventCode 送受信に使うイベントコード
+		/// @param inputDelay 入力遅延 (フレーム)
+		/// @param maxPrediction 入力が確定していなくても進められる最大のフレーム数
+		/// @remark inputDelay と maxPrediction は、再送するフレームが保持できる範囲に収まるように、それぞれ 32 フレーム以下に制限されます。
+		NetworkRollbackSession(SivPhoton& network, uint8 eventCode, int32 inputDelay = 1, int32 maxPrediction = 8);
+
+		~NetworkRollbackSession();
+
+		NetworkRollbackSession(const NetworkRollbackSession&) = delete;
+
+		NetworkRollbackSession& operator =(const NetworkRollbackSession&) = delete;
+
+		/// @brief ゲームの状態を扱う関数を設定します。
+		/// @param save ゲームの状態を保存して返す関数
+		/// @param load 保存したゲームの状態を復元する関数
+		/// @param advance 全員の入力でゲームを 1 フレーム進める関数
+		/// @remark advance は再シミュレーションのために同じフレームで複数回呼ばれることがあります。
+		void setCallbacks(std::function<Blob()> save, std::function<void(const Blob&)> load, std::function<void(const InputBundle&)> advance);
+
+		/// @brief セッションを開始します。
+		/// @param playerIDs 参加するプレイヤー全員の ID (自分を含む)
+		/// @remark 全員が同じプレイヤーの一覧で開始する必要があります。
+		void start(const Array<int32>& playerIDs);
+
+		/// @brief セッションが開始されているかを返します。
+		/// @return 開始されている場合 true, それ以外の場合は false
+		[[nodiscard]]
+		bool isRunning() const noexcept;
+
+		/// @brief 自分の入力を送信し、必要であれば巻き戻してから 1 フレーム進めます。
+		/// @param localInput 自分の入力
+		/// @return フレームを進めた場合 true, 予測できる範囲を超えて待機した場合は false
+		/// @remark 固定フレームレートで 1 ティックに 1 回呼んでください。
+		bool step(const Blob& localInput);
+
+		/// @brief 他のプレイヤーとの進み具合の差に応じた時間の進み方の倍率を返します。
+		/// @return 時間の進み方の倍率
+		/// @remark 先に進みすぎている場合は 1 より小さく、遅れている場合は 1 より大きくなります。
+		[[nodiscard]]
+		double getTimeScale() const noexcept;
+
+		/// @brief プレイヤーがルームから退室したことを通知します。
+		/// @param playerID 退室したプレイヤーの ID
+		/// @remark 以降、そのプレイヤーの受信していない入力は予測した入力のまま確定します。
+		void onPlayerLeft(int32 playerID);
+
+		/// @brief ロールバックの統計を返します。
+		/// @return ロールバックの統計
+		[[nodiscard]]
+		const Stats& getStats() const noexcept;
+
+	private:
+
+		enum class MessageType : uint8
+		{
+			Inputs,
+		};
+
+		struct FrameSlot
+		{
+			uint32 frame = UINT32_MAX;
+
+			/// @brief 受信した (確定した) 入力
+			Array<Optional<Blob>> inputs;
+
+			/// @brief シミュレーションに使った入力
+			Array<Blob> usedInputs;
+
+			/// @brief このフレームを進める前の状態
+			Blob state;
+		};
+
+		/// @brief 保持するフレーム数
+		static constexpr uint32 BufferSize = 256;
+
+		/// @brief 1 回のイベントで送る自分の入力の最大のフレーム数
+		/// @remark 入力遅延と予測できるフレーム数を BufferSize / 8 以下に制限しているため、確認応答を待っているフレームはこの範囲に収まります。
+		static constexpr uint32 MaxResendFrames = (BufferSize / 2);
+
+		SivPhoton& m_network;
+
+		uint8 m_eventCode = 0;
+
+		int32 m_inputDelay = 1;
+
+		int32 m_maxPrediction = 8;
+
+		bool m_running = false;
+
+		uint32 m_frame = 0;
+
+		uint32 m_confirmedFrames = 0;
+
+		Optional<uint32> m_lastSubmittedFrame;
+
+		/// @brief 予測が外れた最も古いフレーム
+		Optional<uint32> m_mispredictedFrame;
+
+		Array<int32> m_playerIDs;
+
+		Array<bool> m_activePlayers;
+
+		Array<Optional<uint32>> m_lastReceivedFrames;
+
+		/// @brief 各プレイヤーが受信済みの自分の入力のフレーム数 (確認応答)
+		Array<uint32> m_remoteAcks;
+
+		/// @brief 予測に使う、各プレイヤーの最新の入力
+		Array<Blob> m_lastInputs;
+
+		Array<FrameSlot> m_slots;
+
+		InputBundle m_bundle;
+
+		NetworkPacketWriter m_writer;
+
+		std::function<Blob()> m_save;
+
+		std::function<void(const Blob&)> m_load;
+
+		std::function<void(const InputBundle&)> m_advance;
+
+		Stats m_stats;
+
+		[[nodiscard]]
+		Optional<size_t> playerIndexOf(int32 playerID) const;
+
+		FrameSlot& getSlot(uint32 frame);
+
+		void setInput(size_t playerIndex, uint32 frame, const Blob& input);
+
+		void sendInputs(size_t localIndex);
+
+		void rollback();
+
+		void advanceFrame(uint32 frame);
+
+		void updateConfirmedFrames();
+
+		void onReceive(int32 playerID, const Blob& data);
+	};
+}
@@ -0,0 +1,1776 @@
+﻿
+# include "NetworkSharedMemoryTransport.hpp"
+# include <atomic>
+# include <chrono>
+# include <thread>
+
+# if SIV3D_PLATFORM(WINDOWS)
+#	include <Siv3D/Windows/Windows.hpp>
+# else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+# endif
+
+# if SIV3D_PLATFORM(LINUX)
+#	include <climits>
+#	include <linux/futex.h>
+#	include <sys/syscall.h>
+# endif
+
+namespace s3d
+{
+	namespace detail
+	{
+		constexpr uint32 SharedMemoryMagic = 0x50565353; // "SSVP"
+
+		constexpr uint32 SharedMemoryVersion = 1;
+
+		/// @brief 相手の生存確認が途絶えてから切断とみなすまでの時間 (ミリ秒)
+		constexpr uint64 SharedMemoryTimeoutMillisec = 10000;
+
+		/// @brief 共有メモリに書き込むルーム名の最大数
+		constexpr size_t MaxSharedRoomNames = 64;
+
+		/// @brief 共有メモリに書き込む名前の最大のバイト数 (UTF-8, 終端を含む)
+		constexpr size_t SharedNameBytes = 64;
+
+		enum class SharedMessageType : uint8
+		{
+			/// @brief リングバッファの末尾の読み飛ばす領域
+			Padding,
+
+			// クライアントから NetworkSharedMemoryHub
+
+			Connect,
+
+			Disconnect,
+
+			JoinRandomRoom,
+
+			JoinRoom,
+
+			CreateRoom,
+
+			LeaveRoom,
+
+			ChangeGroups,
+
+			RaiseEvent,
+
+			SetRoomFlag,
+
+			// NetworkSharedMemoryHub からクライアント
+
+			ConnectReturn,
+
+			DisconnectReturn,
+
+			JoinRandomRoomReturn,
+
+			JoinRoomReturn,
+
+			CreateRoomReturn,
+
+			LeaveRoomReturn,
+
+			JoinRoomEvent,
+
+			LeaveRoomEvent,
+
+			CustomEvent,
+		};
+
+		/// @brief リングバッファの 1 つのメッセージの先頭
+		/// @remark a, b, c の意味はメッセージの種類ごとに異なります。可変長のデータはこの直後に続きます。
+		struct MessageHeader
+		{
+			/// @brief 次のメッセージまでのバイト数
+			uint32 size = 0;
+
+			SharedMessageType type = SharedMessageType::Padding;
+
+			uint8 eventCode = 0;
+
+			/// @brief reliable の場合 1
+			uint8 reliable = 0;
+
+			/// @brief イベントの内容の形式 (NetworkTransport::EventFormat)
+			uint8 format = 0;
+
+			int32 a = 0;
+
+			int32 b = 0;
+
+			int32 c = 0;
+
+			uint32 dataSize = 0;
+		};
+
+		static_assert(sizeof(MessageHeader) == 24);
+
+		static_assert(std::atomic<uint32>::is_always_lock_free && (sizeof(std::atomic<uint32>) == sizeof(uint32)));
+
+		enum class SlotState : uint32
+		{
+			Free,
+
+			Claimed,
+		};
+
+		/// @brief NetworkSharedMemoryHub が書き込む、クライアントごとの状態
+		struct SharedStatus
+		{
+			char userID[SharedNameBytes] = {};
+
+			char roomName[SharedNameBytes] = {};
+
+			int32 localPlayerID = -1;
+
+			int32 masterClientID = 0;
+
+			int32 playerCount = 0;
+
+			int32 maxPlayers = 0;
+
+			uint8 isInRoom = 0;
+
+			uint8 isOpen = 0;
+
+			uint8 isVisible = 0;
+
+			uint8 reserved = 0;
+		};
+
+		/// @brief NetworkSharedMemoryHub が書き込む、全体の状態
+		struct SharedRoomList
+		{
+			uint32 count = 0;
+
+			int32 countGamesRunning = 0;
+
+			int32 countPlayersIngame = 0;
+
+			int32 countPlayersOnline = 0;
+
+			char names[MaxSharedRoomNames][SharedNameBytes] = {};
+		};
+
+		/// @brief 一方向のリングバッファの読み書きの位置
+		/// @remark 書き込み側と読み込み側が同じキャッシュラインを奪い合わないように分けて配置する
+		struct RingControl
+		{
+			alignas(64) std::atomic<uint64> head{ 0 };
+
+			alignas(64) std::atomic<uint64> tail{ 0 };
+		};
+
+		struct alignas(64) SharedSlot
+		{
+			std::atomic<SlotState> state{ SlotState::Free };
+
+			/// @brief NetworkSharedMemoryHub がメッセージを送るたびに増える値
+			std::atomic<uint32> doorbell{ 0 };
+
+			/// @brief クライアントが wait() で待機している場合 1
+			std::atomic<uint32> waiting{ 0 };
+
+			/// @brief クライアントが最後に update() を呼んだ時刻
+			std::atomic<uint64> heartbeat{ 0 };
+
+			std::atomic<uint32> statusSequence{ 0 };
+
+			SharedStatus status;
+
+			/// @brief クライアントから NetworkSharedMemoryHub
+			RingControl requests;
+
+			/// @brief NetworkSharedMemoryHub からクライアント
+			RingControl notifications;
+		};
+
+		struct alignas(64) SharedHeader
+		{
+			uint32 magic = SharedMemoryMagic;
+
+			uint32 version = SharedMemoryVersion;
+
+			uint32 numSlots = 0;
+
+			uint32 reserved = 0;
+
+			uint64 ringBytes = 0;
+
+			/// @brief サーバ時刻の基準となる時刻
+			uint64 startMillisec = 0;
+
+			/// @brief NetworkSharedMemoryHub が最後に update() を呼んだ時刻
+			std::atomic<uint64> heartbeat{ 0 };
+
+			/// @brief クライアントがメッセージを送るたびに増える値
+			std::atomic<uint32> doorbell{ 0 };
+
+			/// @brief NetworkSharedMemoryHub が wait() で待機している場合 1
+			std::atomic<uint32> waiting{ 0 };
+
+			std::atomic<uint32> roomListSequence{ 0 };
+
+			SharedRoomList roomList;
+		};
+
+		[[nodiscard]]
+		constexpr size_t AlignUp(const size_t n, const size_t alignment) noexcept
+		{
+			return ((n + alignment - 1) / alignment * alignment);
+		}
+
+		[[nodiscard]]
+		inline size_t SlotsOffset() noexcept
+		{
+			return AlignUp(sizeof(SharedHeader), 64);
+		}
+
+		[[nodiscard]]
+		inline size_t DataOffset(const size_t numSlots) noexcept
+		{
+			return AlignUp(SlotsOffset() + numSlots * sizeof(SharedSlot), 4096);
+		}
+
+		/// @brief プロセス間で共通の時刻 (ミリ秒)
+		[[nodiscard]]
+		inline uint64 SteadyMillisec() noexcept
+		{
+			return static_cast<uint64>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+		}
+
+		/// @brief UTF-8 の文字の途中で切らないように、固定長の領域に名前を書き込みます。
+		template <size_t N>
+		void WriteName(char (&dst)[N], const StringView s)
+		{
+			const std::string utf8 = Unicode::ToUTF8(s);
+			size_t length = Min(utf8.size(), (N - 1));
+
+			while ((length < utf8.size()) && (0 < length) && ((static_cast<uint8>(utf8[length]) & 0xC0) == 0x80))
+			{
+				--length;
+			}
+
+			std::memcpy(dst, utf8.data(), length);
+			dst[length] = '\0';
+		}
+
+		template <size_t N>
+		[[nodiscard]]
+		String ReadName(const char (&src)[N])
+		{
+			size_t length = 0;
+
+			while ((length < N) && src[length])
+			{
+				++length;
+			}
+
+			return Unicode::FromUTF8(std::string_view{ src, length });
+		}
+
+		/// @brief シーケンスロックで保護された値を書き込みます (書き込み側は 1 つのみ)。
+		template <class Type>
+		void WriteSequenced(std::atomic<uint32>& sequence, Type& dst, const Type& src)
+		{
+			sequence.fetch_add(1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			std::memcpy(&dst, &src, sizeof(Type));
+			sequence.fetch_add(1, std::memory_order_release);
+		}
+
+		/// @brief シーケンスロックで保護された値を、書き込みの途中でない状態で読み込みます。
+		template <class Type>
+		[[nodiscard]]
+		Type ReadSequenced(const std::atomic<uint32>& sequence, const Type& src)
+		{
+			Type result;
+
+			for (;;)
+			{
+				const uint32 before = sequence.load(std::memory_order_acquire);
+
+				if (before & 1)
+				{
+					continue;
+				}
+
+				std::memcpy(&result, &src, sizeof(Type));
+				std::atomic_thread_fence(std::memory_order_acquire);
+
+				if (sequence.load(std::memory_order_relaxed) == before)
+				{
+					return result;
+				}
+			}
+		}
+
+		/// @brief doorbell が observed から変わるまで待機します。
+		inline bool WaitDoorbell(std::atomic<uint32>& doorbell, std::atomic<uint32>& waiting, const uint32 observed, const int32 timeoutMillisec)
+		{
+			if (doorbell.load() != observed)
+			{
+				return true;
+			}
+
+			// 相手は doorbell を増やした後に waiting を確認するので、waiting を立ててから doorbell を確認し直す
+			waiting.store(1);
+
+		# if SIV3D_PLATFORM(LINUX)
+
+			if (doorbell.load() == observed)
+			{
+				timespec timeout{ (timeoutMillisec / 1000), ((timeoutMillisec % 1000) * 1000000L) };
+				::syscall(SYS_futex, reinterpret_cast<uint32*>(&doorbell), FUTEX_WAIT, observed, &timeout, nullptr, 0);
+			}
+
+		# else
+
+			const uint64 deadline = (SteadyMillisec() + timeoutMillisec);
+
+			while ((doorbell.load() == observed) && (SteadyMillisec() < deadline))
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+			}
+
+		# endif
+
+			waiting.store(0);
+			return (doorbell.load() != observed);
+		}
+
+		/// @brief doorbell を増やし、相手が待機している場合は起こします。
+		inline void RingDoorbell(std::atomic<uint32>& doorbell, std::atomic<uint32>& waiting)
+		{
+			doorbell.fetch_add(1);
+
+			// 相手が待機していない場合はシステムコールを呼ばない
+			if (waiting.load())
+			{
+			# if SIV3D_PLATFORM(LINUX)
+				::syscall(SYS_futex, reinterpret_cast<uint32*>(&doorbell), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+			# endif
+			}
+		}
+
+		/// @brief 単一の書き込み側からリングバッファにメッセージを書き込むクラス
+		class RingWriter
+		{
+		public:
+
+			RingWriter() = default;
+
+			RingWriter(RingControl& control, uint8* data, const size_t capacity) noexcept
+				: m_control{ &control }
+				, m_data{ data }
+				, m_capacity{ capacity }
+				, m_tail{ control.tail.load(std::memory_order_relaxed) }
+				, m_published{ m_tail } {}
+
+			/// @brief 可変長のデータが dataSize バイトのメッセージを、空いていれば書き込める大きさかを返します。
+			/// @remark false の場合は、リングバッファが空いても書き込めません。
+			[[nodiscard]]
+			bool fits(const size_t dataSize) const noexcept
+			{
+				return (AlignUp((sizeof(MessageHeader) + dataSize), 8) <= (m_capacity / 2));
+			}
+
+			/// @brief メッセージの領域を確保します。
+			/// @param header メッセージの先頭 (dataSize を設定する)
+			/// @return 可変長のデータを書き込む領域, 空きが無い場合は nullptr
+			/// @remark 書き込んだ内容は publish() を呼ぶまで読み込み側に見えません。
+			[[nodiscard]]
+			uint8* allocate(MessageHeader header) noexcept
+			{
+				if (not fits(header.dataSize))
+				{
+					return nullptr;
+				}
+
+				const size_t total = AlignUp((sizeof(MessageHeader) + header.dataSize), 8);
+
+				size_t position = (m_tail & (m_capacity - 1));
+				const size_t contiguous = (m_capacity - position);
+
+				// 末尾に収まらない場合は、残りを読み飛ばさせて先頭から書き込む
+				const size_t padding = ((contiguous < total) ? contiguous : 0);
+
+				if ((m_capacity - (m_tail - m_control->head.load(std::memory_order_acquire))) < (padding + total))
+				{
+					return nullptr;
+				}
+
+				if (padding)
+				{
+					// MessageHeader が収まらないほど短い場合は、読み込み側も書かずに読み飛ばす
+					if (sizeof(MessageHeader) <= padding)
+					{
+						const MessageHeader paddingHeader{ .size = static_cast<uint32>(padding) };
+						std::memcpy((m_data + position), &paddingHeader, sizeof(MessageHeader));
+					}
+
+					m_tail += padding;
+					position = 0;
+				}
+
+				header.size = static_cast<uint32>(total);
+				std::memcpy((m_data + position), &header, sizeof(MessageHeader));
+				m_tail += total;
+
+				return (m_data + position + sizeof(MessageHeader));
+			}
+
+			/// @brief 確保したメッセージを読み込み側に公開します。
+			/// @return 新たに公開したメッセージがある場合 true
+			bool publish() noexcept
+			{
+				if (m_tail == m_published)
+				{
+					return false;
+				}
+
+				m_control->tail.store(m_tail, std::memory_order_release);
+				m_published = m_tail;
+				return true;
+			}
+
+		private:
+
+			RingControl* m_control = nullptr;
+
+			uint8* m_data = nullptr;
+
+			size_t m_capacity = 0;
+
+			uint64 m_tail = 0;
+
+			uint64 m_published = 0;
+		};
+
+		/// @brief 単一の読み込み側がリングバッファからメッセージを読み込むクラス
+		class RingReader
+		{
+		public:
+
+			RingReader() = default;
+
+			RingReader(RingControl& control, const uint8* data, const size_t capacity) noexcept
+				: m_control{ &control }
+				, m_data{ data }
+				, m_capacity{ capacity }
+				, m_head{ control.head.load(std::memory_order_relaxed) } {}
+
+			/// @brief 公開されたメッセージを順に処理します。
+			/// @param handler (const MessageHeader&, const uint8* data) を受け取り、続ける場合 true を返す関数
+			/// @remark handler が false を返した場合は、リングバッファにそれ以上触れずに終了します (切断した後に使う)。
+			template <class Handler>
+			void consume(Handler&& handler)
+			{
+				const uint64 tail = m_control->tail.load(std::memory_order_acquire);
+
+				while (m_head < tail)
+				{
+					const size_t position = (m_head & (m_capacity - 1));
+
+					if ((m_capacity - position) < sizeof(MessageHeader))
+					{
+						m_head += (m_capacity - position);
+						continue;
+					}
+
+					MessageHeader header;
+					std::memcpy(&header, (m_data + position), sizeof(MessageHeader));
+
+					if (header.type == SharedMessageType::Padding)
+					{
+						m_head += header.size;
+						continue;
+					}
+
+					m_head += header.size;
+
+					if (not handler(header, (m_data + position + sizeof(MessageHeader))))
+					{
+						return;
+					}
+				}
+
+				m_control->head.store(m_head, std::memory_order_release);
+			}
+
+		private:
+
+			RingControl* m_control = nullptr;
+
+			const uint8* m_data = nullptr;
+
+			size_t m_capacity = 0;
+
+			uint64 m_head = 0;
+		};
+
+		/// @brief 名前付きの共有メモリ
+		class SharedRegion
+		{
+		public:
+
+			SharedRegion() = default;
+
+			SharedRegion(const SharedRegion&) = delete;
+
+			SharedRegion& operator =(const SharedRegion&) = delete;
+
+			~SharedRegion()
+			{
+			# if SIV3D_PLATFORM(WINDOWS)
+
+				if (m_data)
+				{
+					::UnmapViewOfFile(m_data);
+				}
+
+				if (m_handle)
+				{
+					::CloseHandle(m_handle);
+				}
+
+			# else
+
+				if (m_data)
+				{
+					::munmap(m_data, m_size);
+				}
+
+				if (m_owner)
+				{
+					::shm_unlink(m_name.c_str());
+				}
+
+			# endif
+			}
+
+			/// @brief 共有メモリを作成します。内容は 0 で初期化されます。
+			[[nodiscard]]
+			bool create(const StringView name, const size_t size)
+			{
+			# if SIV3D_PLATFORM(WINDOWS)
+
+				const std::wstring path = (L"Local\\SivPhoton." + Unicode::ToWstring(name));
+				m_handle = ::CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+					static_cast<DWORD>(static_cast<uint64>(size) >> 32), static_cast<DWORD>(size), path.c_str());
+
+				if (not m_handle)
+				{
+					return false;
+				}
+
+				m_data = static_cast<uint8*>(::MapViewOfFile(m_handle, FILE_MAP_ALL_ACCESS, 0, 0, size));
+
+			# else
+
+				m_name = ("/SivPhoton." + Unicode::ToUTF8(name));
+
+				// 前回異常終了した NetworkSharedMemoryHub の共有メモリが残っている場合は作り直す
+				::shm_unlink(m_name.c_str());
+
+				const int fd = ::shm_open(m_name.c_str(), (O_CREAT | O_EXCL | O_RDWR), 0600);
+
+				if (fd < 0)
+				{
+					return false;
+				}
+
+				m_owner = true;
+
+				if (::ftruncate(fd, static_cast<off_t>(size)) != 0)
+				{
+					::close(fd);
+					return false;
+				}
+
+				void* data = ::mmap(nullptr, size, (PROT_READ | PROT_WRITE), MAP_SHARED, fd, 0);
+				::close(fd);
+				m_data = ((data == MAP_FAILED) ? nullptr : static_cast<uint8*>(data));
+
+			# endif
+
+				m_size = size;
+				return (m_data != nullptr);
+			}
+
+			/// @brief 作成済みの共有メモリを開きます。
+			[[nodiscard]]
+			bool open(const StringView name)
+			{
+			# if SIV3D_PLATFORM(WINDOWS)
+
+				const std::wstring path = (L"Local\\SivPhoton." + Unicode::ToWstring(name));
+				m_handle = ::OpenFileMappingW(FILE_MAP_ALL_ACCESS, FALSE, path.c_str());
+
+				if (not m_handle)
+				{
+					return false;
+				}
+
+				m_data = static_cast<uint8*>(::MapViewOfFile(m_handle, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+
+				MEMORY_BASIC_INFORMATION info{};
+
+				if ((not m_data) || (::VirtualQuery(m_data, &info, sizeof(info)) == 0))
+				{
+					return false;
+				}
+
+				m_size = info.RegionSize;
+
+			# else
+
+				m_name = ("/SivPhoton." + Unicode::ToUTF8(name));
+
+				const int fd = ::shm_open(m_name.c_str(), O_RDWR, 0600);
+
+				if (fd < 0)
+				{
+					return false;
+				}
+
+				struct stat st{};
+
+				if (::fstat(fd, &st) != 0)
+				{
+					::close(fd);
+					return false;
+				}
+
+				m_size = static_cast<size_t>(st.st_size);
+
+				void* data = ::mmap(nullptr, m_size, (PROT_READ | PROT_WRITE), MAP_SHARED, fd, 0);
+				::close(fd);
+				m_data = ((data == MAP_FAILED) ? nullptr : static_cast<uint8*>(data));
+
+			# endif
+
+				if ((not m_data) || (m_size < sizeof(SharedHeader)))
+				{
+					return false;
+				}
+
+				const SharedHeader& h = header();
+
+				return ((h.magic == SharedMemoryMagic)
+					&& (h.version == SharedMemoryVersion)
+					&& ((DataOffset(h.numSlots) + h.numSlots * 2 * h.ringBytes) <= m_size));
+			}
+
+			[[nodiscard]]
+			uint8* data() const noexcept
+			{
+				return m_data;
+			}
+
+			[[nodiscard]]
+			SharedHeader& header() const noexcept
+			{
+				return *reinterpret_cast<SharedHeader*>(m_data);
+			}
+
+			[[nodiscard]]
+			SharedSlot& slot(const size_t index) const noexcept
+			{
+				return reinterpret_cast<SharedSlot*>(m_data + SlotsOffset())[index];
+			}
+
+			[[nodiscard]]
+			RingWriter requestWriter(const size_t index) const noexcept
+			{
+				return{ slot(index).requests, ringData(index, 0), header().ringBytes };
+			}
+
+			[[nodiscard]]
+			RingReader requestReader(const size_t index) const noexcept
+			{
+				return{ slot(index).requests, ringData(index, 0), header().ringBytes };
+			}
+
+			[[nodiscard]]
+			RingWriter notificationWriter(const size_t index) const noexcept
+			{
+				return{ slot(index).notifications, ringData(index, 1), header().ringBytes };
+			}
+
+			[[nodiscard]]
+			RingReader notificationReader(const size_t index) const noexcept
+			{
+				return{ slot(index).notifications, ringData(index, 1), header().ringBytes };
+			}
+
+		private:
+
+			uint8* m_data = nullptr;
+
+			size_t m_size = 0;
+
+		# if SIV3D_PLATFORM(WINDOWS)
+
+			HANDLE m_handle = nullptr;
+
+		# else
+
+			std::string m_name;
+
+			bool m_owner = false;
+
+		# endif
+
+			[[nodiscard]]
+			uint8* ringData(const size_t index, const size_t direction) const noexcept
+			{
+				return (m_data + DataOffset(header().numSlots) + (index * 2 + direction) * header().ringBytes);
+			}
+		};
+
+		/// @brief メッセージを書き込みます。
+		/// @return 書き込めた場合 true, 空きが無い場合は false
+		inline bool Push(RingWriter& ring, const MessageHeader& header, const void* data = nullptr)
+		{
+			uint8* p = ring.allocate(header);
+
+			if (not p)
+			{
+				return false;
+			}
+
+			if (header.dataSize)
+			{
+				std::memcpy(p, data, header.dataSize);
+			}
+
+			return true;
+		}
+
+		/// @brief リングバッファに空きが無い間、書き込めなかったメッセージを順に保持するクラス
+		class OverflowQueue
+		{
+		public:
+
+			[[nodiscard]]
+			bool isEmpty() const noexcept
+			{
+				return m_messages.isEmpty();
+			}
+
+			[[nodiscard]]
+			size_t size() const noexcept
+			{
+				return m_messages.size();
+			}
+
+			void push(const MessageHeader& header, Blob&& data)
+			{
+				m_messages.push_back({ header, std::move(data) });
+			}
+
+			/// @brief 保持しているメッセージを、空きがある限り先頭から書き込みます。
+			/// @return 書き込んだメッセージの数
+			size_t retry(RingWriter& ring)
+			{
+				size_t count = 0;
+
+				while ((count < m_messages.size()) && Push(ring, m_messages[count].header, m_messages[count].data.data()))
+				{
+					++count;
+				}
+
+				m_messages.erase(m_messages.begin(), (m_messages.begin() + count));
+				return count;
+			}
+
+			void clear() noexcept
+			{
+				m_messages.clear();
+			}
+
+		private:
+
+			struct Message
+			{
+				MessageHeader header;
+
+				Blob data;
+			};
+
+			Array<Message> m_messages;
+		};
+
+		enum class PushResult : uint8
+		{
+			/// @brief リングバッファに書き込んだ
+			Written,
+
+			/// @brief 空きが無いため OverflowQueue に保持した
+			Deferred,
+
+			/// @brief 破棄した
+			Dropped,
+		};
+
+		/// @brief 空きが無い場合に破棄してよいメッセージ (unreliable のイベント) かを返します。
+		[[nodiscard]]
+		inline bool IsDroppable(const MessageHeader& header) noexcept
+		{
+			return (((header.type == SharedMessageType::RaiseEvent) || (header.type == SharedMessageType::CustomEvent)) && (not header.reliable));
+		}
+
+		/// @brief メッセージを書き込み、空きが無い場合は OverflowQueue に保持します。
+		/// @param first 可変長のデータの前半
+		/// @param firstSize 前半のバイト数
+		/// @param second 可変長のデータの後半 (header.dataSize - firstSize バイト)
+		/// @remark 保持しているメッセージがある間は、順序を保つために新しいメッセージも保持します。
+		/// unreliable のイベントは保持せずに破棄します。リングバッファの半分を超えるメッセージは、書き込めることが無いため破棄します。
+		inline PushResult PushOrDefer(RingWriter& ring, OverflowQueue& overflow, const MessageHeader& header, const void* first, const size_t firstSize, const void* second = nullptr)
+		{
+			if (not ring.fits(header.dataSize))
+			{
+				return PushResult::Dropped;
+			}
+
+			const size_t secondSize = (header.dataSize - firstSize);
+
+			if (overflow.isEmpty())
+			{
+				if (uint8* p = ring.allocate(header))
+				{
+					if (firstSize)
+					{
+						std::memcpy(p, first, firstSize);
+					}
+
+					if (secondSize)
+					{
+						std::memcpy((p + firstSize), second, secondSize);
+					}
+
+					return PushResult::Written;
+				}
+			}
+
+			if (IsDroppable(header))
+			{
+				return PushResult::Dropped;
+			}
+
+			Blob data;
+			data.reserve(header.dataSize);
+			data.append(first, firstSize);
+			data.append(second, secondSize);
+
+			overflow.push(header, std::move(data));
+			return PushResult::Deferred;
+		}
+
+		inline PushResult PushOrDefer(RingWriter& ring, OverflowQueue& overflow, const MessageHeader& header, const void* data = nullptr)
+		{
+			return PushOrDefer(ring, overflow, header, data, header.dataSize);
+		}
+
+		inline PushResult PushStringOrDefer(RingWriter& ring, OverflowQueue& overflow, MessageHeader header, const StringView s)
+		{
+			const std::string utf8 = Unicode::ToUTF8(s);
+			header.dataSize = static_cast<uint32>(utf8.size());
+			return PushOrDefer(ring, overflow, header, utf8.data());
+		}
+
+		[[nodiscard]]
+		inline String ReadString(const MessageHeader& header, const uint8* data)
+		{
+			return Unicode::FromUTF8(std::string_view{ reinterpret_cast<const char*>(data), header.dataSize });
+		}
+	}
+
+	struct NetworkSharedMemoryHub::Mapping
+	{
+		detail::SharedRegion region;
+
+		Array<detail::RingReader> requests;
+
+		Array<detail::RingWriter> notifications;
+
+		/// @brief クライアントごとの、通知のリングバッファに書き込めなかったメッセージ
+		Array<detail::OverflowQueue> overflow;
+
+		/// @brief クライアントごとの、最後に共有メモリに書き込んだ状態
+		Array<detail::SharedStatus> publishedStatus;
+	};
+
+	/// @brief 内部の NetworkLoopbackTransport からの通知を、クライアントのリングバッファに書き込むクラス
+	class NetworkSharedMemoryHub::ClientListener : public NetworkTransport::Listener
+	{
+	public:
+
+		ClientListener(NetworkSharedMemoryHub& hub, const size_t index)
+			: m_hub{ hub }
+			, m_index{ index } {}
+
+		void connectReturn(const int32 errorCode, const String& errorString) override
+		{
+			pushString({ .type = detail::SharedMessageType::ConnectReturn, .a = errorCode }, errorString);
+		}
+
+		void disconnectReturn() override
+		{
+			push({ .type = detail::SharedMessageType::DisconnectReturn });
+		}
+
+		void joinRandomRoomReturn(const int32 localPlayerID, const int32 errorCode, const String& errorString) override
+		{
+			pushString({ .type = detail::SharedMessageType::JoinRandomRoomReturn, .a = localPlayerID, .b = errorCode }, errorString);
+		}
+
+		void joinRoomReturn(const int32 localPlayerID, const int32 errorCode, const String& errorString) override
+		{
+			pushString({ .type = detail::SharedMessageType::JoinRoomReturn, .a = localPlayerID, .b = errorCode }, errorString);
+		}
+
+		void createRoomReturn(const int32 localPlayerID, const int32 errorCode, const String& errorString) override
+		{
+			pushString({ .type = detail::SharedMessageType::CreateRoomReturn, .a = localPlayerID, .b = errorCode }, errorString);
+		}
+
+		void leaveRoomReturn(const int32 errorCode, const String& errorString) override
+		{
+			pushString({ .type = detail::SharedMessageType::LeaveRoomReturn, .a = errorCode }, errorString);
+		}
+
+		void joinRoomEventAction(const int32 playerID, const Array<int32>& playerIDs, const bool isSelf) override
+		{
+			push({ .type = detail::SharedMessageType::JoinRoomEvent, .a = playerID, .b = isSelf, .dataSize = static_cast<uint32>(playerIDs.size_bytes()) }, playerIDs.data());
+		}
+
+		void leaveRoomEventAction(const int32 playerID, const bool isInactive) override
+		{
+			push({ .type = detail::SharedMessageType::LeaveRoomEvent, .a = playerID, .b = isInactive });
+		}
+
+		void customEventAction(const int32 playerID, const uint8 eventCode, const Blob& eventContent, const bool reliable, const NetworkTransport::EventFormat format) override
+		{
+			push({ .type = detail::SharedMessageType::CustomEvent, .eventCode = eventCode, .reliable = reliable, .format = FromEnum(format), .a = playerID, .dataSize = static_cast<uint32>(eventContent.size()) }, eventContent.data());
+		}
+
+	private:
+
+		NetworkSharedMemoryHub& m_hub;
+
+		size_t m_index = 0;
+
+		void push(const detail::MessageHeader& header, const void* data = nullptr)
+		{
+			count(detail::PushOrDefer(m_hub.m_mapping->notifications[m_index], m_hub.m_mapping->overflow[m_index], header, data));
+		}
+
+		void pushString(const detail::MessageHeader& header, const String& s)
+		{
+			count(detail::PushStringOrDefer(m_hub.m_mapping->notifications[m_index], m_hub.m_mapping->overflow[m_index], header, s));
+		}
+
+		void count(const detail::PushResult result)
+		{
+			switch (result)
+			{
+			case detail::PushResult::Written:
+				++m_hub.m_stats.notifications;
+				break;
+			case detail::PushResult::Deferred:
+				++m_hub.m_stats.notifications;
+				++m_hub.m_stats.deferred;
+				break;
+			case detail::PushResult::Dropped:
+				++m_hub.m_stats.dropped;
+				break;
+			}
+		}
+	};
+
+	NetworkSharedMemoryHub::NetworkSharedMemoryHub(const StringView name, const size_t maxClients, const size_t ringBytes)
+	{
+		const size_t numSlots = Max<size_t>(maxClients, 1);
+		size_t capacity = 4096;
+
+		while (capacity < ringBytes)
+		{
+			capacity *= 2;
+		}
+
+		auto mapping = std::make_unique<Mapping>();
+
+		if (not mapping->region.create(name, (detail::DataOffset(numSlots) + numSlots * 2 * capacity)))
+		{
+			return;
+		}
+
+		// 共有メモリは 0 で初期化されているが、アトミック変数を正しく構築する
+		auto* header = new (mapping->region.data()) detail::SharedHeader{};
+		header->numSlots = static_cast<uint32>(numSlots);
+		header->ringBytes = capacity;
+		header->startMillisec = detail::SteadyMillisec();
+		header->heartbeat.store(header->startMillisec);
+
+		for (size_t i = 0; i < numSlots; ++i)
+		{
+			new (&mapping->region.slot(i)) detail::SharedSlot{};
+			mapping->requests << mapping->region.requestReader(i);
+			mapping->notifications << mapping->region.notificationWriter(i);
+		}
+
+		mapping->overflow.resize(numSlots);
+		mapping->publishedStatus.resize(numSlots);
+
+		m_mapping = std::move(mapping);
+		m_clients.resize(numSlots);
+	}
+
+	NetworkSharedMemoryHub::~NetworkSharedMemoryHub() = default;
+
+	bool NetworkSharedMemoryHub::isOpen() const noexcept
+	{
+		return (m_mapping != nullptr);
+	}
+
+	void NetworkSharedMemoryHub::update()
+	{
+		if (not m_mapping)
+		{
+			return;
+		}
+
+		detail::SharedRegion& region = m_mapping->region;
+		detail::SharedHeader& header = region.header();
+		const uint64 now = detail::SteadyMillisec();
+
+		header.heartbeat.store(now, std::memory_order_relaxed);
+		m_observedDoorbell = header.doorbell.load();
+
+		for (size_t i = 0; i < m_clients.size(); ++i)
+		{
+			detail::SharedSlot& slot = region.slot(i);
+
+			if (slot.state.load(std::memory_order_acquire) == detail::SlotState::Free)
+			{
+				continue;
+			}
+
+			// 応答の無いクライアント (異常終了したプロセスなど) は切断する
+			if ((slot.heartbeat.load(std::memory_order_relaxed) + detail::SharedMemoryTimeoutMillisec) < now)
+			{
+				m_clients[i].closing = true;
+				continue;
+			}
+
+			// 前回までに書き込めなかった通知を、新しい通知より先に書き込む
+			m_mapping->overflow[i].retry(m_mapping->notifications[i]);
+
+			handleRequests(i);
+		}
+
+		for (auto& client : m_clients)
+		{
+			if (client.transport)
+			{
+				client.transport->update();
+			}
+		}
+
+		// ルーム名の一覧と全体の統計は、どのトランスポートから取得しても同じ
+		if (const auto it = std::find_if(m_clients.begin(), m_clients.end(), [](const Client& client) { return (client.transport != nullptr); });
+			it != m_clients.end())
+		{
+			const NetworkLoopbackTransport& transport = *it->transport;
+			const Array<String> roomNames = transport.getRoomNameList();
+
+			detail::SharedRoomList roomList;
+			roomList.count = static_cast<uint32>(Min(roomNames.size(), detail::MaxSharedRoomNames));
+			roomList.countGamesRunning = transport.getCountGamesRunning();
+			roomList.countPlayersIngame = transport.getCountPlayersIngame();
+			roomList.countPlayersOnline = transport.getCountPlayersOnline();
+
+			for (uint32 i = 0; i < roomList.count; ++i)
+			{
+				detail::WriteName(roomList.names[i], roomNames[i]);
+			}
+
+			// 変わった場合のみ書き込み、クライアントが版 (roomListSequence) で変更を判断できるようにする
+			if ((not m_publishedRoomList) || (std::memcmp(m_publishedRoomList.get(), &roomList, sizeof(roomList)) != 0))
+			{
+				detail::WriteSequenced(header.roomListSequence, header.roomList, roomList);
+				m_publishedRoomList = std::make_unique<detail::SharedRoomList>(roomList);
+			}
+		}
+
+		for (size_t i = 0; i < m_clients.size(); ++i)
+		{
+			if (m_clients[i].closing)
+			{
+				release(i);
+			}
+			else if (m_clients[i].transport)
+			{
+				publish(i);
+			}
+		}
+	}
+
+	bool NetworkSharedMemoryHub::wait(const int32 timeoutMillisec)
+	{
+		if (not m_mapping)
+		{
+			return false;
+		}
+
+		detail::SharedHeader& header = m_mapping->region.header();
+
+		return detail::WaitDoorbell(header.doorbell, header.waiting, m_observedDoorbell, timeoutMillisec);
+	}
+
+	size_t NetworkSharedMemoryHub::num_clients() const noexcept
+	{
+		return static_cast<size_t>(std::count_if(m_clients.begin(), m_clients.end(), [](const Client& client) { return (client.transport != nullptr); }));
+	}
+
+	size_t NetworkSharedMemoryHub::num_rooms() const
+	{
+		return m_hub.num_rooms();
+	}
+
+	const NetworkSharedMemoryHub::Stats& NetworkSharedMemoryHub::getStats() const noexcept
+	{
+		return m_stats;
+	}
+
+	void NetworkSharedMemoryHub::handleRequests(const size_t index)
+	{
+		Client& client = m_clients[index];
+
+		m_mapping->requests[index].consume([&](const detail::MessageHeader& header, const uint8* data)
+		{
+			++m_stats.requests;
+
+			if (header.type == detail::SharedMessageType::Connect)
+			{
+				if (not client.transport)
+				{
+					client.transport = m_hub.createTransport();
+					client.listener = std::make_unique<ClientListener>(*this, index);
+					client.transport->setListener(client.listener.get());
+				}
+
+				client.transport->connect(detail::ReadString(header, data));
+				return true;
+			}
+
+			if (not client.transport)
+			{
+				return true;
+			}
+
+			NetworkLoopbackTransport& transport = *client.transport;
+
+			switch (header.type)
+			{
+			case detail::SharedMessageType::Disconnect:
+				// スロットは update() の終わりに解放するので、以降のメッセージは読まない
+				client.closing = true;
+				return false;
+			case detail::SharedMessageType::JoinRandomRoom:
+				transport.joinRandomRoom(header.a);
+				break;
+			case detail::SharedMessageType::JoinRoom:
+				transport.joinRoom(detail::ReadString(header, data));
+				break;
+			case detail::SharedMessageType::CreateRoom:
+				transport.createRoom(detail::ReadString(header, data), header.a);
+				break;
+			case detail::SharedMessageType::LeaveRoom:
+				transport.leaveRoom();
+				break;
+			case detail::SharedMessageType::ChangeGroups:
+				{
+					// a: 削除するグループの数, data: 削除するグループ, 追加するグループ
+					const size_t numRemove = Min<size_t>(header.a, header.dataSize);
+					const Array<uint8> groupsToRemove(data, (data + numRemove));
+					const Array<uint8> groupsToAdd((data + numRemove), (data + header.dataSize));
+					transport.changeGroups(groupsToRemove, groupsToAdd);
+				}
+				break;
+			case detail::SharedMessageType::RaiseEvent:
+				{
+					// a: 送信先のグループ, b: インタレストグループ, c: 送信先のプレイヤーの数, data: 送信先のプレイヤー ID, イベントの内容
+					const size_t targetBytes = Min<size_t>((header.c * sizeof(int32)), header.dataSize);
+
+					NetworkSystem::EventOption option;
+					option.reliable = (header.reliable != 0);
+					option.receiverGroup = static_cast<NetworkSystem::ReceiverGroup>(header.a);
+					option.interestGroup = static_cast<uint8>(header.b);
+					option.targetPlayers.resize(targetBytes / sizeof(int32));
+					std::memcpy(option.targetPlayers.data(), data, option.targetPlayers.size_bytes());
+
+					transport.raiseEvent(header.eventCode, Blob{ (data + targetBytes), (header.dataSize - targetBytes) }, option, ToEnum<NetworkTransport::EventFormat>(header.format));
+				}
+				break;
+			case detail::SharedMessageType::SetRoomFlag:
+				if (header.a == 0)
+				{
+					transport.setIsOpenInCurrentRoom(header.b != 0);
+				}
+				else
+				{
+					transport.setIsVisibleInCurrentRoom(header.b != 0);
+				}
+				break;
+			default:
+				break;
+			}
+
+			return true;
+		});
+	}
+
+	void NetworkSharedMemoryHub::publish(const size_t index)
+	{
+		const NetworkLoopbackTransport& transport = *m_clients[index].transport;
+		detail::SharedSlot& slot = m_mapping->region.slot(index);
+
+		detail::SharedStatus status;
+		detail::WriteName(status.userID, transport.getUserID());
+		detail::WriteName(status.roomName, transport.getCurrentRoomName());
+		status.localPlayerID = transport.localPlayerID().value_or(-1);
+		status.masterClientID = transport.getMasterClientID().value_or(0);
+		status.playerCount = transport.getPlayerCountInCurrentRoom();
+		status.maxPlayers = transport.getMaxPlayersInCurrentRoom();
+		status.isInRoom = transport.isInRoom();
+		status.isOpen = transport.getIsOpenInCurrentRoom();
+		status.isVisible = transport.getIsVisibleInCurrentRoom();
+
+		// 状態を先に書き込み、通知を受け取った時点で状態が反映されているようにする。
+		// 変わった場合のみ書き込み、クライアントが版 (statusSequence) で変更を判断できるようにする
+		if (detail::SharedStatus& published = m_mapping->publishedStatus[index];
+			std::memcmp(&published, &status, sizeof(status)) != 0)
+		{
+			detail::WriteSequenced(slot.statusSequence, slot.status, status);
+			published = status;
+		}
+
+		if (m_mapping->notifications[index].publish())
+		{
+			detail::RingDoorbell(slot.doorbell, slot.waiting);
+		}
+	}
+
+	void NetworkSharedMemoryHub::release(const size_t index)
+	{
+		m_clients[index] = Client{};
+
+		detail::SharedRegion& region = m_mapping->region;
+		detail::SharedSlot& slot = region.slot(index);
+
+		slot.requests.head.store(0, std::memory_order_relaxed);
+		slot.requests.tail.store(0, std::memory_order_relaxed);
+		slot.notifications.head.store(0, std::memory_order_relaxed);
+		slot.notifications.tail.store(0, std::memory_order_relaxed);
+		detail::WriteSequenced(slot.statusSequence, slot.status, detail::SharedStatus{});
+
+		m_mapping->requests[index] = region.requestReader(index);
+		m_mapping->notifications[index] = region.notificationWriter(index);
+		m_mapping->overflow[index].clear();
+		m_mapping->publishedStatus[index] = detail::SharedStatus{};
+
+		// リングバッファを初期化してから、他のクライアントが確保できるようにする
+		slot.state.store(detail::SlotState::Free, std::memory_order_release);
+	}
+
+	struct NetworkSharedMemoryTransport::Mapping
+	{
+		detail::SharedRegion region;
+
+		detail::RingWriter requests;
+
+		detail::RingReader notifications;
+
+		/// @brief 送信のリングバッファに書き込めなかったメッセージ
+		detail::OverflowQueue overflow;
+
+		uint32 observedDoorbell = 0;
+	};
+
+	NetworkSharedMemoryTransport::NetworkSharedMemoryTransport(const StringView name)
+		: m_name{ name } {}
+
+	NetworkSharedMemoryTransport::~NetworkSharedMemoryTransport()
+	{
+		if (m_slot)
+		{
+			disconnect();
+		}
+	}
+
+	bool NetworkSharedMemoryTransport::wait(const int32 timeoutMillisec)
+	{
+		if (not m_slot)
+		{
+			return false;
+		}
+
+		detail::SharedSlot& slot = m_mapping->region.slot(*m_slot);
+
+		return detail::WaitDoorbell(slot.doorbell, slot.waiting, m_mapping->observedDoorbell, timeoutMillisec);
+	}
+
+	const NetworkSharedMemoryTransport::Stats& NetworkSharedMemoryTransport::getStats() const noexcept
+	{
+		return m_stats;
+	}
+
+	bool NetworkSharedMemoryTransport::connect(const StringView userName)
+	{
+		if (m_slot)
+		{
+			return false;
+		}
+
+		// NetworkSharedMemoryHub が作り直されている場合に備えて、接続のたびに開き直す
+		auto mapping = std::make_unique<Mapping>();
+
+		if (not mapping->region.open(m_name))
+		{
+			return false;
+		}
+
+		const detail::SharedHeader& header = mapping->region.header();
+		const uint64 now = detail::SteadyMillisec();
+
+		if ((header.heartbeat.load(std::memory_order_relaxed) + detail::SharedMemoryTimeoutMillisec) < now)
+		{
+			return false;
+		}
+
+		for (size_t i = 0; i < header.numSlots; ++i)
+		{
+			detail::SharedSlot& slot = mapping->region.slot(i);
+			detail::SlotState expected = detail::SlotState::Free;
+
+			if (slot.state.load(std::memory_order_relaxed) != expected)
+			{
+				continue;
+			}
+
+			// 確保した直後にタイムアウトとみなされないように、先に時刻を書き込む
+			slot.heartbeat.store(now, std::memory_order_relaxed);
+
+			if (not slot.state.compare_exchange_strong(expected, detail::SlotState::Claimed, std::memory_order_acq_rel))
+			{
+				continue;
+			}
+
+			mapping->requests = mapping->region.requestWriter(i);
+			mapping->notifications = mapping->region.notificationReader(i);
+			mapping->observedDoorbell = slot.doorbell.load();
+
+			m_mapping = std::move(mapping);
+			m_slot = i;
+			m_userName = userName;
+			m_disconnectPending = false;
+
+			sendString({ .type = detail::SharedMessageType::Connect }, userName);
+			return true;
+		}
+
+		return false;
+	}
+
+	void NetworkSharedMemoryTransport::disconnect()
+	{
+		if (not m_slot)
+		{
+			return;
+		}
+
+		// 送り直しを待っているメッセージは切断により不要になるため、Disconnect を先に書き込めるようにする。
+		// それでも空きが無い場合は、NetworkSharedMemoryHub が応答の無いクライアントとして切断する
+		m_mapping->overflow.clear();
+		send({ .type = detail::SharedMessageType::Disconnect });
+
+		m_slot.reset();
+		m_disconnectPending = true;
+	}
+
+	void NetworkSharedMemoryTransport::update()
+	{
+		if (not m_slot)
+		{
+			if (std::exchange(m_disconnectPending, false) && m_listener)
+			{
+				m_listener->disconnectReturn();
+			}
+
+			return;
+		}
+
+		detail::SharedSlot& slot = m_mapping->region.slot(*m_slot);
+		const uint64 now = detail::SteadyMillisec();
+
+		slot.heartbeat.store(now, std::memory_order_relaxed);
+
+		// NetworkSharedMemoryHub のプロセスが終了した場合は切断する
+		if ((m_mapping->region.header().heartbeat.load(std::memory_order_relaxed) + detail::SharedMemoryTimeoutMillisec) < now)
+		{
+			m_slot.reset();
+
+			if (m_listener)
+			{
+				m_listener->disconnectReturn();
+			}
+
+			return;
+		}
+
+		// 前回までに書き込めなかったメッセージを送り直す
+		if (m_mapping->overflow.retry(m_mapping->requests))
+		{
+			flush();
+		}
+
+		m_mapping->observedDoorbell = slot.doorbell.load();
+
+		m_mapping->notifications.consume([this](const detail::MessageHeader& header, const uint8* data)
+		{
+			++m_stats.received;
+
+			if (not m_listener)
+			{
+				return true;
+			}
+
+			switch (header.type)
+			{
+			case detail::SharedMessageType::ConnectReturn:
+				m_listener->connectReturn(header.a, detail::ReadString(header, data));
+				break;
+			case detail::SharedMessageType::JoinRandomRoomReturn:
+				m_listener->joinRandomRoomReturn(header.a, header.b, detail::ReadString(header, data));
+				break;
+			case detail::SharedMessageType::JoinRoomReturn:
+				m_listener->joinRoomReturn(header.a, header.b, detail::ReadString(header, data));
+				break;
+			case detail::SharedMessageType::CreateRoomReturn:
+				m_listener->createRoomReturn(header.a, header.b, detail::ReadString(header, data));
+				break;
+			case detail::SharedMessageType::LeaveRoomReturn:
+				m_listener->leaveRoomReturn(header.a, detail::ReadString(header, data));
+				break;
+			case detail::SharedMessageType::JoinRoomEvent:
+				{
+					Array<int32> playerIDs(header.dataSize / sizeof(int32));
+					std::memcpy(playerIDs.data(), data, playerIDs.size_bytes());
+					m_listener->joinRoomEventAction(header.a, playerIDs, (header.b != 0));
+				}
+				break;
+			case detail::SharedMessageType::LeaveRoomEvent:
+				m_listener->leaveRoomEventAction(header.a, (header.b != 0));
+				break;
+			case detail::SharedMessageType::CustomEvent:
+				// Listener は Blob を受け取るため、リングバッファからコピーする
+				m_listener->customEventAction(header.a, header.eventCode, Blob{ data, header.dataSize }, (header.reliable != 0), ToEnum<EventFormat>(header.format));
+				break;
+			default:
+				break;
+			}
+
+			// Listener の処理の中で disconnect() が呼ばれた場合は、リングバッファにそれ以上触れない
+			return m_slot.has_value();
+		});
+	}
+
+	void NetworkSharedMemoryTransport::joinRandomRoom(const int32 maxPlayers)
+	{
+		send({ .type = detail::SharedMessageType::JoinRandomRoom, .a = maxPlayers });
+	}
+
+	void NetworkSharedMemoryTransport::joinRoom(const StringView roomName)
+	{
+		sendString({ .type = detail::SharedMessageType::JoinRoom }, roomName);
+	}
+
+	void NetworkSharedMemoryTransport::createRoom(const StringView roomName, const int32 maxPlayers)
+	{
+		sendString({ .type = detail::SharedMessageType::CreateRoom, .a = maxPlayers }, roomName);
+	}
+
+	void NetworkSharedMemoryTransport::leaveRoom()
+	{
+		send({ .type = detail::SharedMessageType::LeaveRoom });
+	}
+
+	void NetworkSharedMemoryTransport::changeGroups(const Array<uint8>& groupsToRemove, const Array<uint8>& groupsToAdd)
+	{
+		if (not m_slot)
+		{
+			return;
+		}
+
+		const detail::MessageHeader header{ .type = detail::SharedMessageType::ChangeGroups, .a = static_cast<int32>(groupsToRemove.size()),
+			.dataSize = static_cast<uint32>(groupsToRemove.size() + groupsToAdd.size()) };
+
+		count(detail::PushOrDefer(m_mapping->requests, m_mapping->overflow, header, groupsToRemove.data(), groupsToRemove.size(), groupsToAdd.data()));
+		flush();
+	}
+
+	void NetworkSharedMemoryTransport::raiseEvent(const uint8 eventCode, const Blob& eventContent, const NetworkSystem::EventOption& option, const EventFormat format)
+	{
+		if (not m_slot)
+		{
+			return;
+		}
+
+		const size_t targetBytes = option.targetPlayers.size_bytes();
+		const detail::MessageHeader header{ .type = detail::SharedMessageType::RaiseEvent, .eventCode = eventCode, .reliable = option.reliable, .format = FromEnum(format),
+			.a = FromEnum(option.receiverGroup), .b = option.interestGroup, .c = static_cast<int32>(option.targetPlayers.size()),
+			.dataSize = static_cast<uint32>(targetBytes + eventContent.size()) };
+
+		// 空きがある場合は、イベントの内容を一時的なバッファを介さずにリングバッファへ書き込む
+		count(detail::PushOrDefer(m_mapping->requests, m_mapping->overflow, header, option.targetPlayers.data(), targetBytes, eventContent.data()));
+		flush();
+	}
+
+	void NetworkSharedMemoryTransport::send(const detail::MessageHeader& header)
+	{
+		if (not m_slot)
+		{
+			return;
+		}
+
+		count(detail::PushOrDefer(m_mapping->requests, m_mapping->overflow, header));
+		flush();
+	}
+
+	void NetworkSharedMemoryTransport::sendString(const detail::MessageHeader& header, const StringView s)
+	{
+		if (not m_slot)
+		{
+			return;
+		}
+
+		count(detail::PushStringOrDefer(m_mapping->requests, m_mapping->overflow, header, s));
+		flush();
+	}
+
+	void NetworkSharedMemoryTransport::count(const detail::PushResult result) noexcept
+	{
+		switch (result)
+		{
+		case detail::PushResult::Written:
+			++m_stats.sent;
+			break;
+		case detail::PushResult::Deferred:
+			++m_stats.sent;
+			++m_stats.deferred;
+			break;
+		case detail::PushResult::Dropped:
+			++m_stats.dropped;
+			break;
+		}
+	}
+
+	void NetworkSharedMemoryTransport::flush()
+	{
+		if (m_mapping->requests.publish())
+		{
+			detail::SharedHeader& header = m_mapping->region.header();
+			detail::RingDoorbell(header.doorbell, header.waiting);
+		}
+	}
+
+	detail::SharedStatus NetworkSharedMemoryTransport::readStatus() const
+	{
+		const detail::SharedSlot& slot = m_mapping->region.slot(*m_slot);
+
+		return detail::ReadSequenced(slot.statusSequence, slot.status);
+	}
+
+	detail::SharedRoomList NetworkSharedMemoryTransport::readRoomList() const
+	{
+		const detail::SharedHeader& header = m_mapping->region.header();
+
+		return detail::ReadSequenced(header.roomListSequence, header.roomList);
+	}
+
+	String NetworkSharedMemoryTransport::getName() const
+	{
+		return m_userName;
+	}
+
+	String NetworkSharedMemoryTransport::getUserID() const
+	{
+		if (not m_slot)
+		{
+			return{};
+		}
+
+		return detail::ReadName(readStatus().userID);
+	}
+
+	Array<String> NetworkSharedMemoryTransport::getRoomNameList() const
+	{
+		if (not m_slot)
+		{
+			return{};
+		}
+
+		const detail::SharedRoomList roomList = readRoomList();
+
+		Array<String> result;
+
+		for (uint32 i = 0; i < Min<uint32>(roomList.count, detail::MaxSharedRoomNames); ++i)
+		{
+			result << detail::ReadName(roomList.names[i]);
+		}
+
+		return result;
+	}
+
+	Optional<uint64> NetworkSharedMemoryTransport::getRoomListVersion() const
+	{
+		if (not m_slot)
+		{
+			return none;
+		}
+
+		return m_mapping->region.header().roomListSequence.load(std::memory_order_acquire);
+	}
+
+	Optional<uint64> NetworkSharedMemoryTransport::getStateVersion() const
+	{
+		if (not m_slot)
+		{
+			return none;
+		}
+
+		return m_mapping->region.slot(*m_slot).statusSequence.load(std::memory_order_acquire);
+	}
+
+	bool NetworkSharedMemoryTransport::isInRoom() const
+	{
+		return (m_slot && readStatus().isInRoom);
+	}
+
+	String NetworkSharedMemoryTransport::getCurrentRoomName() const
+	{
+		if (not m_slot)
+		{
+			return{};
+		}
+
+		return detail::ReadName(readStatus().roomName);
+	}
+
+	int32 NetworkSharedMemoryTransport::getPlayerCountInCurrentRoom() const
+	{
+		return (m_slot ? readStatus().playerCount : 0);
+	}
+
+	int32 NetworkSharedMemoryTransport::getMaxPlayersInCurrentRoom() const
+	{
+		return (m_slot ? readStatus().maxPlayers : 0);
+	}
+
+	bool NetworkSharedMemoryTransport::getIsOpenInCurrentRoom() const
+	{
+		return (m_slot && readStatus().isOpen);
+	}
+
+	bool NetworkSharedMemoryTransport::getIsVisibleInCurrentRoom() const
+	{
+		return (m_slot && readStatus().isVisible);
+	}
+
+	void NetworkSharedMemoryTransport::setIsOpenInCurrentRoom(const bool isOpen)
+	{
+		send({ .type = detail::SharedMessageType::SetRoomFlag, .a = 0, .b = isOpen });
+	}
+
+	void NetworkSharedMemoryTransport::setIsVisibleInCurrentRoom(const bool isVisible)
+	{
+		send({ .type = detail::SharedMessageType::SetRoomFlag, .a = 1, .b = isVisible });
+	}
+
+	int32 NetworkSharedMemoryTransport::getCountGamesRunning() const
+	{
+		return (m_slot ? readRoomList().countGamesRunning : 0);
+	}
+
+	int32 NetworkSharedMemoryTransport::getCountPlayersIngame() const
+	{
+		return (m_slot ? readRoomList().countPlayersIngame : 0);
+	}
+
+	int32 NetworkSharedMemoryTransport::getCountPlayersOnline() const
+	{
+		return (m_slot ? readRoomList().countPlayersOnline : 0);
+	}
+
+	Optional<int32> NetworkSharedMemoryTransport::localPlayerID() const
+	{
+		if (not m_slot)
+		{
+			return none;
+		}
+
+		if (const auto status = readStatus(); status.isInRoom)
+		{
+			return status.localPlayerID;
+		}
+
+		return none;
+	}
+
+	Optional<int32> NetworkSharedMemoryTransport::getMasterClientID() const
+	{
+		if (not m_slot)
+		{
+			return none;
+		}
+
+		if (const auto status = readStatus(); status.isInRoom)
+		{
+			return status.masterClientID;
+		}
+
+		return none;
+	}
+
+	int32 NetworkSharedMemoryTransport::getServerTimeMillisec() const
+	{
+		if (not m_mapping)
+		{
+			return 0;
+		}
+
+		// Photon のサーバ時刻と同様に、32 ビットで折り返すミリ秒
+		return static_cast<int32>(static_cast<uint32>(detail::SteadyMillisec() - m_mapping->region.header().startMillisec));
+	}
+
+	int32 NetworkSharedMemoryTransport::getRoundTripTimeMillisec() const
+	{
+		return 0;
+	}
+
+	NetworkStatistics::ConnectionStats NetworkSharedMemoryTransport::getConnectionStats() const
+	{
+		NetworkStatistics::ConnectionStats stats;
+		stats.queuedOutgoing = (m_slot ? m_mapping->overflow.size() : 0);
+		stats.lost = m_stats.dropped;
+		return stats;
+	}
+}
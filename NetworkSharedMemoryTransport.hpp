@@ -0,0 +1,294 @@
+﻿
+# pragma once
+# include <Siv3D.hpp>
+# include "NetworkTransport.hpp"
+# include "NetworkLoopbackTransport.hpp"
+
+namespace s3d
+{
+	namespace detail
+	{
+		struct MessageHeader;
+
+		struct SharedStatus;
+
+		struct SharedRoomList;
+
+		enum class PushResult : uint8;
+	}
+
+	/// @brief 同じマシン上の別のプロセスの NetworkSharedMemoryTransport を結ぶ、Photon サーバの代わりとなるクラスです。
+	/// @remark 名前付きの共有メモリを作成し、クライアントごとに送信用と受信用のリングバッファを割り当てます。
+	/// ルームとイベントの配信は、内部の NetworkLoopbackHub が Photon と同じ規則で行います。
+	/// すべてのメッセージはこのクラスを経由して中継されるため、ゼロコピーではありません。
+	/// イベントの内容は、送信側のリングバッファ → 中継用の Blob → NetworkLoopbackHub が共有する Blob → 受信側のリングバッファ → 受信側の Blob の順にコピーされます。
+	/// ソケットとカーネルを経由しないため、ボット・リプレイ・ホストを同じマシンで動かす場合のシステムコールを減らせます。
+	/// クライアントのリングバッファに空きが無い場合、unreliable のイベント以外の通知は保持しておき、次の update() で送り直します。
+	/// update() は 1 つのスレッドから呼ぶ必要があります。
+	class NetworkSharedMemoryHub
+	{
+	public:
+
+		/// @brief 統計
+		struct Stats
+		{
+			/// @brief クライアントから受け取ったメッセージの数
+			uint64 requests = 0;
+
+			/// @brief クライアントに送ったメッセージの数
+			uint64 notifications = 0;
+
+			/// @brief クライアントのリングバッファに空きが無く、次の update() で送り直すことにしたメッセージの数
+			uint64 deferred = 0;
+
+			/// @brief クライアントのリングバッファに空きが無く、破棄した unreliable のイベントの数
+			uint64 dropped = 0;
+		};
+
+		/// @brief 共有メモリを作成します。
+		/// @param name 共有メモリの名前 (NetworkSharedMemoryTransport で同じ名前を指定します)
+		/// @param maxClients 接続できるクライアントの最大数
+		/// @param ringBytes 1 つのリングバッファのバイト数 (2 の累乗に切り上げられます)
+		/// @remark 同じ名前の共有メモリが残っている場合は作り直します。
+		explicit NetworkSharedMemoryHub(StringView name, size_t maxClients = 64, size_t ringBytes = (256 << 10));
+
+		~NetworkSharedMemoryHub();
+
+		NetworkSharedMemoryHub(const NetworkSharedMemoryHub&) = delete;
+
+		NetworkSharedMemoryHub& operator =(const NetworkSharedMemoryHub&) = delete;
+
+		/// @brief 共有メモリを作成できたかを返します。
+		/// @return 作成できた場合 true, それ以外の場合は false
+		[[nodiscard]]
+		bool isOpen() const noexcept;
+
+		/// @brief クライアントからのメッセージを処理し、結果とイベントを各クライアントに送ります。
+		void update();
+
+		/// @brief クライアントからのメッセージが届くまで待機します。
+		/// @param timeoutMillisec 最大の待機時間 (ミリ秒)
+		/// @return メッセージが届いた場合 true, タイムアウトした場合は false
+		/// @remark Linux では futex で待機します。それ以外の環境では短い間隔で確認します。
+		bool wait(int32 timeoutMillisec);
+
+		/// @brief 接続しているクライアントの数を返します。
+		/// @return クライアントの数
+		[[nodiscard]]
+		size_t num_clients() const noexcept;
+
+		/// @brief 存在するルームの数を返します。
+		/// @return ルームの数
+		[[nodiscard]]
+		size_t num_rooms() const;
+
+		/// @brief 統計を返します。
+		/// @return 統計
+		[[nodiscard]]
+		const Stats& getStats() const noexcept;
+
+	private:
+
+		struct Mapping;
+
+		class ClientListener;
+
+		struct Client
+		{
+			std::unique_ptr<NetworkLoopbackTransport> transport;
+
+			std::unique_ptr<ClientListener> listener;
+
+			/// @brief 次の update() の終わりにスロットを解放する場合 true
+			bool closing = false;
+		};
+
+		std::unique_ptr<Mapping> m_mapping;
+
+		NetworkLoopbackHub m_hub;
+
+		Array<Client> m_clients;
+
+		uint32 m_observedDoorbell = 0;
+
+		/// @brief 最後に共有メモリに書き込んだルーム名の一覧と全体の統計
+		std::unique_ptr<detail::SharedRoomList> m_publishedRoomList;
+
+		Stats m_stats;
+
+		void handleRequests(size_t index);
+
+		void publish(size_t index);
+
+		void release(size_t index);
+	};
+
+	/// @brief NetworkSharedMemoryHub を介して、同じマシン上の別のプロセスの SivPhoton と通信するトランスポートです。
+	/// @remark イベントの内容は送信用のリングバッファに直接書き込まれ、ソケットを経由しません。
+	/// リングバッファに空きが無い場合、unreliable のイベント以外のメッセージは保持しておき、次の update() で送った順に送り直します。
+	/// ルームの状態は NetworkSharedMemoryHub が共有メモリに書き込んだものを読み取ります。
+	class NetworkSharedMemoryTransport : public NetworkTransport
+	{
+	public:
+
+		/// @brief 統計
+		struct Stats
+		{
+			/// @brief 送ったメッセージの数
+			uint64 sent = 0;
+
+			/// @brief 受け取ったメッセージの数
+			uint64 received = 0;
+
+			/// @brief リングバッファに空きが無く、次の update() で送り直すことにしたメッセージの数
+			uint64 deferred = 0;
+
+			/// @brief 破棄したメッセージの数
+			/// @remark リングバッファに空きが無かった unreliable のイベントと、リングバッファの半分を超える大きさのメッセージを数えます。
+			uint64 dropped = 0;
+		};
+
+		/// @brief NetworkSharedMemoryTransport を作成します。
+		/// @param name 共有メモリの名前 (NetworkSharedMemoryHub と同じ名前)
+		explicit NetworkSharedMemoryTransport(StringView name);
+
+		~NetworkSharedMemoryTransport() override;
+
+		NetworkSharedMemoryTransport(const NetworkSharedMemoryTransport&) = delete;
+
+		NetworkSharedMemoryTransport& operator =(const NetworkSharedMemoryTransport&) = delete;
+
+		/// @brief NetworkSharedMemoryHub からのメッセージが届くまで待機します。
+		/// @param timeoutMillisec 最大の待機時間 (ミリ秒)
+		/// @return メッセージが届いた場合 true, タイムアウトした場合は false
+		bool wait(int32 timeoutMillisec);
+
+		/// @brief 統計を返します。
+		/// @return 統計
+		[[nodiscard]]
+		const Stats& getStats() const noexcept;
+
+		/// @brief 共有メモリを開き、空いているスロットを確保して接続を開始します。
+		/// @param userName ユーザ名
+		/// @return 接続を開始できた場合 true, 共有メモリが無い場合や空いているスロットが無い場合は false
+		bool connect(StringView userName) override;
+
+		void disconnect() override;
+
+		void update() override;
+
+		void joinRandomRoom(int32 maxPlayers) override;
+
+		void joinRoom(StringView roomName) override;
+
+		void createRoom(StringView roomName, int32 maxPlayers) override;
+
+		void leaveRoom() override;
+
+		void changeGroups(const Array<uint8>& groupsToRemove, const Array<uint8>& groupsToAdd) override;
+
+		void raiseEvent(uint8 eventCode, const Blob& eventContent, const NetworkSystem::EventOption& option, EventFormat format) override;
+
+		[[nodiscard]]
+		String getName() const override;
+
+		[[nodiscard]]
+		String getUserID() const override;
+
+		[[nodiscard]]
+		Array<String> getRoomNameList() const override;
+
+		/// @brief ルームの一覧の版を返します。
+		/// @return NetworkSharedMemoryHub がルーム名の一覧か全体の統計を書き換えるたびに変わる値
+		[[nodiscard]]
+		Optional<uint64> getRoomListVersion() const override;
+
+		/// @brief 自分と参加しているルームの状態の版を返します。
+		/// @return NetworkSharedMemoryHub がこのクライアントの状態を書き換えるたびに変わる値, 接続していない場合は none
+		[[nodiscard]]
+		Optional<uint64> getStateVersion() const override;
+
+		[[nodiscard]]
+		bool isInRoom() const override;
+
+		[[nodiscard]]
+		String getCurrentRoomName() const override;
+
+		[[nodiscard]]
+		int32 getPlayerCountInCurrentRoom() const override;
+
+		[[nodiscard]]
+		int32 getMaxPlayersInCurrentRoom() const override;
+
+		[[nodiscard]]
+		bool getIsOpenInCurrentRoom() const override;
+
+		[[nodiscard]]
+		bool getIsVisibleInCurrentRoom() const override;
+
+		void setIsOpenInCurrentRoom(bool isOpen) override;
+
+		void setIsVisibleInCurrentRoom(bool isVisible) override;
+
+		[[nodiscard]]
+		int32 getCountGamesRunning() const override;
+
+		[[nodiscard]]
+		int32 getCountPlayersIngame() const override;
+
+		[[nodiscard]]
+		int32 getCountPlayersOnline() const override;
+
+		[[nodiscard]]
+		Optional<int32> localPlayerID() const override;
+
+		[[nodiscard]]
+		Optional<int32> getMasterClientID() const override;
+
+		[[nodiscard]]
+		int32 getServerTimeMillisec() const override;
+
+		/// @brief 往復の遅延を返します。
+		/// @return 同じマシン内の通信のため常に 0
+		[[nodiscard]]
+		int32 getRoundTripTimeMillisec() const override;
+
+		/// @brief 通信路の状態を返します。
+		/// @return 送り直しを待っているメッセージの数 (queuedOutgoing) と、破棄したメッセージの数 (lost)
+		[[nodiscard]]
+		NetworkStatistics::ConnectionStats getConnectionStats() const override;
+
+	private:
+
+		struct Mapping;
+
+		String m_name;
+
+		std::unique_ptr<Mapping> m_mapping;
+
+		/// @brief 確保したスロットの番号 (接続していない場合は none)
+		Optional<size_t> m_slot;
+
+		String m_userName;
+
+		/// @brief 次の update() で disconnectReturn を通知する場合 true
+		bool m_disconnectPending = false;
+
+		Stats m_stats;
+
+		void send(const detail::MessageHeader& header);
+
+		void sendString(const detail::MessageHeader& header, StringView s);
+
+		void count(detail::PushResult result) noexcept;
+
+		/// @brief 書き込んだメッセージを公開し、NetworkSharedMemoryHub が待機している場合は起こします。
+		void flush();
+
+		[[nodiscard]]
+		detail::SharedStatus readStatus() const;
+
+		[[nodiscard]]
+		detail::SharedRoomList readRoomList() const;
+	};
+}
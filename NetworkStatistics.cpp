@@ -0,0 +1,175 @@
+﻿
+# include "NetworkStatistics.hpp"
+
+namespace s3d
+{
+	namespace detail
+	{
+		template <class Key>
+		inline void Merge(HashTable<Key, NetworkStatistics::Entry>& to, const HashTable<Key, NetworkStatistics::Entry>& from)
+		{
+			for (const auto& [key, entry] : from)
+			{
+				auto& e = to[key];
+				e.sent += entry.sent;
+				e.received += entry.received;
+			}
+		}
+	}
+
+	double NetworkStatistics::Traffic::averageMicrosec() const noexcept
+	{
+		return (messages ? (microsec / messages) : 0.0);
+	}
+
+	NetworkStatistics::Traffic& NetworkStatistics::Traffic::operator +=(const Traffic& other) noexcept
+	{
+		messages += other.messages;
+		bytes += other.bytes;
+		microsec += other.microsec;
+		return *this;
+	}
+
+	NetworkStatistics::NetworkStatistics(const double windowSeconds, const size_t numBuckets)
+		: m_bucketSeconds{ (Max(windowSeconds, 0.001) / Max<size_t>(numBuckets, 1)) }
+		, m_buckets(Max<size_t>(numBuckets, 1)) {}
+
+	void NetworkStatistics::recordSent(const uint8 eventCode, const size_t bytes, const double microsec, const Array<int32>& targetPlayers)
+	{
+		const Traffic traffic{ 1, bytes, microsec };
+
+		for (Report* report : { &m_total.report, &currentBucket().report })
+		{
+			report->total.sent += traffic;
+			report->eventCodes[eventCode].sent += traffic;
+
+			for (const auto playerID : targetPlayers)
+			{
+				report->peers[playerID].sent += traffic;
+			}
+		}
+	}
+
+	void NetworkStatistics::recordReceived(const uint8 eventCode, const int32 playerID, const size_t bytes, const double microsec)
+	{
+		const Traffic traffic{ 1, bytes, microsec };
+
+		for (Report* report : { &m_total.report, &currentBucket().report })
+		{
+			report->total.received += traffic;
+			report->eventCodes[eventCode].received += traffic;
+			report->peers[playerID].received += traffic;
+		}
+	}
+
+	void NetworkStatistics::sampleConnection(const ConnectionStats& stats)
+	{
+		// 累計が減った場合は、接続し直して 0 から数え直したとみなす
+		const uint64 resent = ((m_connection.resent <= stats.resent) ? (stats.resent - m_connection.resent) : stats.resent);
+		const uint64 lost = ((m_connection.lost <= stats.lost) ? (stats.lost - m_connection.lost) : stats.lost);
+		m_connection = stats;
+
+		for (Bucket* bucket : { &m_total, &currentBucket() })
+		{
+			bucket->report.resent += resent;
+			bucket->report.lost += lost;
+			bucket->report.maxRoundTripTimeMillisec = Max(bucket->report.maxRoundTripTimeMillisec, stats.roundTripTimeMillisec);
+			bucket->roundTripTimeSum += stats.roundTripTimeMillisec;
+			++bucket->roundTripTimeSamples;
+		}
+	}
+
+	const NetworkStatistics::ConnectionStats& NetworkStatistics::getConnectionStats() const noexcept
+	{
+		return m_connection;
+	}
+
+	NetworkStatistics::Report NetworkStatistics::getTotal() const
+	{
+		Report total = m_total.report;
+		total.seconds = m_stopwatch.sF();
+
+		if (m_total.roundTripTimeSamples)
+		{
+			total.averageRoundTripTimeMillisec = (m_total.roundTripTimeSum / m_total.roundTripTimeSamples);
+		}
+
+		return total;
+	}
+
+	NetworkStatistics::Report NetworkStatistics::getWindow() const
+	{
+		const double elapsed = m_stopwatch.sF();
+		const uint64 current = static_cast<uint64>(elapsed / m_bucketSeconds);
+
+		Report window;
+		double roundTripTimeSum = 0.0;
+		size_t roundTripTimeSamples = 0;
+
+		for (const auto& bucket : m_buckets)
+		{
+			// 古い区間と、まだ使われていない区間は除く
+			if ((current < bucket.index) || (m_buckets.size() <= (current - bucket.index)))
+			{
+				continue;
+			}
+
+			const Report& report = bucket.report;
+			window.total.sent += report.total.sent;
+			window.total.received += report.total.received;
+			detail::Merge(window.eventCodes, report.eventCodes);
+			detail::Merge(window.peers, report.peers);
+			window.maxRoundTripTimeMillisec = Max(window.maxRoundTripTimeMillisec, report.maxRoundTripTimeMillisec);
+			window.resent += report.resent;
+			window.lost += report.lost;
+			roundTripTimeSum += bucket.roundTripTimeSum;
+			roundTripTimeSamples += bucket.roundTripTimeSamples;
+		}
+
+		// 現在の区間は途中までしか経過していない
+		window.seconds = Min(elapsed, ((m_buckets.size() - 1) * m_bucketSeconds + (elapsed - current * m_bucketSeconds)));
+
+		if (roundTripTimeSamples)
+		{
+			window.averageRoundTripTimeMillisec = (roundTripTimeSum / roundTripTimeSamples);
+		}
+
+		return window;
+	}
+
+	double NetworkStatistics::getWindowSeconds() const noexcept
+	{
+		return (m_bucketSeconds * m_buckets.size());
+	}
+
+	void NetworkStatistics::reset()
+	{
+		for (auto& bucket : m_buckets)
+		{
+			bucket = Bucket{};
+		}
+
+		m_total = Bucket{};
+		m_connection = ConnectionStats{};
+		m_stopwatch.restart();
+	}
+
+	uint64 NetworkStatistics::currentBucketIndex() const
+	{
+		return static_cast<uint64>(m_stopwatch.sF() / m_bucketSeconds);
+	}
+
+	NetworkStatistics::Bucket& NetworkStatistics::currentBucket()
+	{
+		const uint64 index = currentBucketIndex();
+		Bucket& bucket = m_buckets[index % m_buckets.size()];
+
+		if (bucket.index != index)
+		{
+			bucket = Bucket{};
+			bucket.index = index;
+		}
+
+		return bucket;
+	}
+}
@@ -0,0 +1,173 @@
+﻿
+# pragma once
+# include <Siv3D.hpp>
+
+namespace s3d
+{
+	/// @brief 自分が送受信したイベントを、イベントコードごと・プレイヤーごとに集計するクラスです。
+	/// @remark 起動 (または reset()) からの累計と、直近の一定時間 (ローリングウィンドウ) の値の両方を返します。
+	/// ウィンドウは等しい長さの区間に分けて集計し、古い区間から捨てていきます。
+	/// SivPhoton::getStatistics() で、その SivPhoton の統計を取得できます。
+	class NetworkStatistics
+	{
+	public:
+
+		/// @brief 送信または受信の量
+		struct Traffic
+		{
+			/// @brief メッセージの数
+			uint64 messages = 0;
+
+			/// @brief 直列化後のバイト数
+			uint64 bytes = 0;
+
+			/// @brief 直列化 (送信時) または復元 (受信時) にかかった時間の合計 (マイクロ秒)
+			double microsec = 0.0;
+
+			/// @brief 1 メッセージあたりの直列化または復元の時間を返します。
+			/// @return 時間 (マイクロ秒), メッセージが無い場合は 0
+			[[nodiscard]]
+			double averageMicrosec() const noexcept;
+
+			Traffic& operator +=(const Traffic& other) noexcept;
+		};
+
+		/// @brief 1 つのイベントコードまたはプレイヤーの統計
+		struct Entry
+		{
+			Traffic sent;
+
+			Traffic received;
+		};
+
+		/// @brief 通信路の状態
+		/// @remark Photon を使う場合は Photon のピアの値、トランスポートを使う場合は NetworkTransport::getConnectionStats() の値です。
+		struct ConnectionStats
+		{
+			/// @brief 往復の遅延 (ミリ秒)
+			int32 roundTripTimeMillisec = 0;
+
+			/// @brief 往復の遅延のばらつき (ミリ秒)
+			int32 roundTripTimeVarianceMillisec = 0;
+
+			/// @brief 受信して、まだ処理していないメッセージの数
+			size_t queuedIncoming = 0;
+
+			/// @brief 送信待ち、または受信の確認待ちのメッセージの数
+			size_t queuedOutgoing = 0;
+
+			/// @brief 再送した reliable のメッセージの累計
+			uint64 resent = 0;
+
+			/// @brief 失われたメッセージの累計
+			uint64 lost = 0;
+		};
+
+		/// @brief 一定期間の統計
+		struct Report
+		{
+			/// @brief 集計した期間 (秒)
+			double seconds = 0.0;
+
+			/// @brief すべてのイベントコードの合計
+			Entry total;
+
+			/// @brief イベントコードごとの統計
+			HashTable<uint8, Entry> eventCodes;
+
+			/// @brief プレイヤー ID ごとの統計
+			/// @remark 受信はすべてのイベントを送信者ごとに、送信は NetworkSystem::EventOption::targetPlayers を指定したイベントのみを送信先ごとに集計します。
+			HashTable<int32, Entry> peers;
+
+			/// @brief 期間内の往復の遅延の平均 (ミリ秒)
+			double averageRoundTripTimeMillisec = 0.0;
+
+			/// @brief 期間内の往復の遅延の最大 (ミリ秒)
+			int32 maxRoundTripTimeMillisec = 0;
+
+			/// @brief 期間内に再送した reliable のメッセージの数
+			uint64 resent = 0;
+
+			/// @brief 期間内に失われたメッセージの数
+			uint64 lost = 0;
+		};
+
+		/// @brief NetworkStatistics を作成します。
+		/// @param windowSeconds ローリングウィンドウの長さ (秒)
+		/// @param numBuckets ウィンドウを分ける区間の数
+		explicit NetworkStatistics(double windowSeconds = 10.0, size_t numBuckets = 10);
+
+		/// @brief 送信したイベントを記録します。
+		/// @param eventCode イベントコード
+		/// @param bytes 直列化後のバイト数
+		/// @param microsec 直列化と送信キューへの追加にかかった時間 (マイクロ秒)
+		/// @param targetPlayers 送信先のプレイヤー ID の一覧 (グループに送信した場合は空)
+		void recordSent(uint8 eventCode, size_t bytes, double microsec, const Array<int32>& targetPlayers = {});
+
+		/// @brief 受信したイベントを記録します。
+		/// @param eventCode イベントコード
+		/// @param playerID 送信者のプレイヤー ID
+		/// @param bytes 直列化後のバイト数
+		/// @param microsec 復元とコールバックの呼び出しにかかった時間 (マイクロ秒)
+		void recordReceived(uint8 eventCode, int32 playerID, size_t bytes, double microsec);
+
+		/// @brief 通信路の状態を記録します。
+		/// @param stats 通信路の状態
+		/// @remark 再送と損失の数は、前回の記録からの増加分をウィンドウに加えます。
+		void sampleConnection(const ConnectionStats& stats);
+
+		/// @brief 最後に記録した通信路の状態を返します。
+		/// @return 通信路の状態
+		[[nodiscard]]
+		const ConnectionStats& getConnectionStats() const noexcept;
+
+		/// @brief 作成 (または reset()) からの累計を返します。
+		/// @return 累計
+		[[nodiscard]]
+		Report getTotal() const;
+
+		/// @brief 直近のローリングウィンドウの統計を返します。
+		/// @return ウィンドウの統計
+		[[nodiscard]]
+		Report getWindow() const;
+
+		/// @brief ローリングウィンドウの長さを返します。
+		/// @return 長さ (秒)
+		[[nodiscard]]
+		double getWindowSeconds() const noexcept;
+
+		/// @brief すべての統計を消去します。
+		void reset();
+
+	private:
+
+		struct Bucket
+		{
+			/// @brief 区間の通し番号
+			uint64 index = 0;
+
+			Report report;
+
+			double roundTripTimeSum = 0.0;
+
+			size_t roundTripTimeSamples = 0;
+		};
+
+		double m_bucketSeconds = 1.0;
+
+		Stopwatch m_stopwatch{ StartImmediately::Yes };
+
+		Array<Bucket> m_buckets;
+
+		/// @brief 累計 (index は使わない)
+		Bucket m_total;
+
+		ConnectionStats m_connection;
+
+		[[nodiscard]]
+		uint64 currentBucketIndex() const;
+
+		[[nodiscard]]
+		Bucket& currentBucket();
+	};
+}
@@ -1,8 +1,14 @@
 ﻿
 # pragma once
 # define NOMINMAX
+# include <atomic>
+# include <iostream>
+# include <mutex>
 # include <LoadBalancing-cpp/inc/Client.h>
+# include "NetworkCapture.hpp"
 # include "NetworkSystem.hpp"
+# include "NetworkTrace.hpp"
+# include "NetworkTransport.hpp"
 
 # if SIV3D_PLATFORM(WINDOWS)
 # if SIV3D_BUILD(DEBUG)
@@ -21,6 +27,64 @@ namespace s3d
 {
 	namespace detail
 	{
+		std::mutex LogMutex;
+
+		std::function<void(StringView)> LogSink;
+
+		std::atomic<bool> LogEnabled{ true };
+
+		/// @brief << で連結したメッセージを、破棄される際に 1 行のログとして出力します。
+		class LogBuffer
+		{
+		public:
+
+			LogBuffer()
+				: m_enabled{ NetworkSystem::IsLogEnabled() } {}
+
+			LogBuffer(LogBuffer&& other) noexcept
+				: m_text{ std::move(other.m_text) }
+				, m_enabled{ std::exchange(other.m_enabled, false) } {}
+
+			~LogBuffer()
+			{
+				if (m_enabled)
+				{
+					NetworkSystem::Log(m_text);
+				}
+			}
+
+			template <class Type>
+			LogBuffer& operator <<(const Type& value)
+			{
+				if (m_enabled)
+				{
+					m_text += Format(value);
+				}
+
+				return *this;
+			}
+
+		private:
+
+			String m_text;
+
+			bool m_enabled = true;
+		};
+
+		struct LogStream
+		{
+			template <class Type>
+			LogBuffer operator <<(const Type& value) const
+			{
+				LogBuffer buffer;
+				buffer << value;
+				return buffer;
+			}
+		};
+
+		/// @brief Print の代わりに使うログの出力
+		constexpr LogStream Logger{};
+
 		[[nodiscard]]
 		String ToString(const ExitGames::Common::JString& str)
 		{
@@ -32,6 +96,229 @@ namespace s3d
 		{
 			return ExitGames::Common::JString{ Unicode::ToWstring(s).c_str() };
 		}
+
+		[[nodiscard]]
+		ExitGames::LoadBalancing::RaiseEventOptions ToRaiseEventOptions(const NetworkSystem::EventOption& option)
+		{
+			ExitGames::LoadBalancing::RaiseEventOptions result;
+
+			if (option.interestGroup)
+			{
+				result.setInterestGroup(option.interestGroup);
+			}
+
+			if (option.targetPlayers)
+			{
+				result.setTargetPlayers(option.targetPlayers.data(), static_cast<short>(option.targetPlayers.size()));
+				return result;
+			}
+
+			switch (option.receiverGroup)
+			{
+			case NetworkSystem::ReceiverGroup::All:
+				result.setReceiverGroup(ExitGames::Lite::ReceiverGroup::ALL);
+				break;
+			case NetworkSystem::ReceiverGroup::MasterClient:
+				result.setReceiverGroup(ExitGames::Lite::ReceiverGroup::MASTER_CLIENT);
+				break;
+			default:
+				result.setReceiverGroup(ExitGames::Lite::ReceiverGroup::OTHERS);
+				break;
+			}
+
+			return result;
+		}
+
+		[[nodiscard]]
+		ExitGames::Common::Hashtable ToHashtable(const HashTable<String, NetworkSystem::RoomPropertyValue>& properties)
+		{
+			ExitGames::Common::Hashtable result;
+
+			for (const auto& [key, value] : properties)
+			{
+				const auto keyJ = ToJString(key);
+
+				std::visit([&](const auto& v)
+					{
+						if constexpr (std::is_same_v<std::decay_t<decltype(v)>, String>)
+						{
+							result.put(keyJ, ToJString(v));
+						}
+						else
+						{
+							result.put(keyJ, v);
+						}
+					}, value);
+			}
+
+			return result;
+		}
+
+		[[nodiscard]]
+		NetworkSystem::RoomPropertyValue ToRoomPropertyValue(const ExitGames::Common::Object& object)
+		{
+			switch (object.getType())
+			{
+			case ExitGames::Common::TypeCode::BYTE:
+				return static_cast<int32>(ExitGames::Common::ValueObject<nByte>(object).getDataCopy());
+			case ExitGames::Common::TypeCode::SHORT:
+				return static_cast<int32>(ExitGames::Common::ValueObject<short>(object).getDataCopy());
+			case ExitGames::Common::TypeCode::INTEGER:
+				return static_cast<int32>(ExitGames::Common::ValueObject<int>(object).getDataCopy());
+			case ExitGames::Common::TypeCode::FLOAT:
+				return static_cast<double>(ExitGames::Common::ValueObject<float>(object).getDataCopy());
+			case ExitGames::Common::TypeCode::DOUBLE:
+				return ExitGames::Common::ValueObject<double>(object).getDataCopy();
+			case ExitGames::Common::TypeCode::BOOLEAN:
+				return ExitGames::Common::ValueObject<bool>(object).getDataCopy();
+			case ExitGames::Common::TypeCode::STRING:
+				return ToString(ExitGames::Common::ValueObject<ExitGames::Common::JString>(object).getDataCopy());
+			default:
+				return ToString(object.toString());
+			}
+		}
+
+		[[nodiscard]]
+		NetworkSystem::RoomInfo ToRoomInfo(const ExitGames::LoadBalancing::Room& room)
+		{
+			NetworkSystem::RoomInfo info;
+			info.name = ToString(room.getName());
+			info.playerCount = room.getPlayerCount();
+			info.maxPlayers = room.getMaxPlayers();
+			info.isOpen = room.getIsOpen();
+
+			// ロビーの一覧には、表示されるルームのみが含まれる
+			info.isVisible = true;
+
+			// ロビーに公開されたプロパティのみが含まれる
+			const ExitGames::Common::Hashtable& properties = room.getCustomProperties();
+			const ExitGames::Common::JVector<ExitGames::Common::Object> keys = properties.getKeys();
+
+			for (unsigned i = 0; i < keys.getSize(); ++i)
+			{
+				if (keys[i].getType() != ExitGames::Common::TypeCode::STRING)
+				{
+					continue;
+				}
+
+				const auto keyJ = ExitGames::Common::ValueObject<ExitGames::Common::JString>(keys[i]).getDataCopy();
+
+				if (const ExitGames::Common::Object* value = properties.getValue(keyJ))
+				{
+					info.properties.emplace(ToString(keyJ), ToRoomPropertyValue(*value));
+				}
+			}
+
+			return info;
+		}
+	}
+
+	namespace NetworkSystem
+	{
+		void SetLogSink(std::function<void(StringView)> sink)
+		{
+			std::lock_guard lock{ detail::LogMutex };
+			detail::LogSink = std::move(sink);
+		}
+
+		void SetLogEnabled(const bool enabled) noexcept
+		{
+			detail::LogEnabled.store(enabled, std::memory_order_relaxed);
+		}
+
+		bool IsLogEnabled() noexcept
+		{
+			return detail::LogEnabled.load(std::memory_order_relaxed);
+		}
+
+		void Log(const StringView message)
+		{
+			std::lock_guard lock{ detail::LogMutex };
+
+			if (detail::LogSink)
+			{
+				detail::LogSink(message);
+				return;
+			}
+
+# ifdef SIVPHOTON_HEADLESS
+
+			std::cerr << message.toUTF8() << '\n';
+
+# else
+
+			Print << message;
+
+# endif
+		}
+
+		RoomPage QueryRooms(const Array<RoomInfo>& rooms, const RoomQuery& query)
+		{
+			Array<const RoomInfo*> matched;
+			matched.reserve(rooms.size());
+
+			for (const auto& room : rooms)
+			{
+				if ((query.excludeFull && room.isFull())
+					|| (query.excludeClosed && (not room.isOpen))
+					|| (query.filter && (not query.filter(room))))
+				{
+					continue;
+				}
+
+				matched << &room;
+			}
+
+			RoomPage result;
+			result.totalCount = matched.size();
+
+			if (matched.isEmpty())
+			{
+				return result;
+			}
+
+			const size_t pageSize = (query.pageSize ? query.pageSize : matched.size());
+			result.numPages = ((matched.size() + pageSize - 1) / pageSize);
+
+			if (result.numPages <= query.page)
+			{
+				return result;
+			}
+
+			const size_t begin = (query.page * pageSize);
+			const size_t end = Min((begin + pageSize), matched.size());
+
+			if (query.sortBy)
+			{
+				// 同じ順位のルームは元の順序にして、ページをまたいでも順序が変わらないようにする
+				const auto compare = [&](const RoomInfo* a, const RoomInfo* b)
+				{
+					if (query.sortBy(*a, *b))
+					{
+						return true;
+					}
+
+					if (query.sortBy(*b, *a))
+					{
+						return false;
+					}
+
+					return (a < b);
+				};
+
+				// 指定したページの末尾までを並べれば十分
+				std::partial_sort(matched.begin(), (matched.begin() + end), matched.end(), compare);
+			}
+
+			result.rooms.reserve(end - begin);
+
+			for (size_t i = begin; i < end; ++i)
+			{
+				result.rooms << *matched[i];
+			}
+
+			return result;
+		}
 	}
 
 	template <class T, uint8 customTypeIndex>
@@ -131,6 +418,70 @@ namespace s3d
 	using PhotonFloat3 = SivCustomType<Float3, 16>;
 	using PhotonFloat4 = SivCustomType<Float4, 17>;
 	using PhotonMat3x2 = SivCustomType<Mat3x2, 18>;
+
+	namespace detail
+	{
+		std::mutex CustomTypeMutex;
+
+		size_t CustomTypeReferenceCount = 0;
+
+		// カスタム型の登録はプロセス全体で共有されるため、最初の SivPhoton で登録し、最後の SivPhoton で解除する
+		void RegisterCustomTypes()
+		{
+			std::lock_guard lock{ CustomTypeMutex };
+
+			if (CustomTypeReferenceCount++ == 0)
+			{
+				PhotonPoint::registerType();
+				PhotonVec2::registerType();
+				PhotonRect::registerType();
+				PhotonCircle::registerType();
+				PhotonColorF::registerType();
+				PhotonColor::registerType();
+				PhotonHSV::registerType();
+				PhotonLine::registerType();
+				PhotonTriangle::registerType();
+				PhotonRectF::registerType();
+				PhotonQuad::registerType();
+				PhotonEllipse::registerType();
+				PhotonRoundRect::registerType();
+				PhotonVec3::registerType();
+				PhotonVec4::registerType();
+				PhotonFloat2::registerType();
+				PhotonFloat3::registerType();
+				PhotonFloat4::registerType();
+				PhotonMat3x2::registerType();
+			}
+		}
+
+		void UnregisterCustomTypes()
+		{
+			std::lock_guard lock{ CustomTypeMutex };
+
+			if (--CustomTypeReferenceCount == 0)
+			{
+				PhotonPoint::unregisterType();
+				PhotonVec2::unregisterType();
+				PhotonRect::unregisterType();
+				PhotonCircle::unregisterType();
+				PhotonColorF::unregisterType();
+				PhotonColor::unregisterType();
+				PhotonHSV::unregisterType();
+				PhotonLine::unregisterType();
+				PhotonTriangle::unregisterType();
+				PhotonRectF::unregisterType();
+				PhotonQuad::unregisterType();
+				PhotonEllipse::unregisterType();
+				PhotonRoundRect::unregisterType();
+				PhotonVec3::unregisterType();
+				PhotonVec4::unregisterType();
+				PhotonFloat2::unregisterType();
+				PhotonFloat3::unregisterType();
+				PhotonFloat4::unregisterType();
+				PhotonMat3x2::unregisterType();
+			}
+		}
+	}
 }
 
 namespace s3d
@@ -210,6 +561,7 @@ namespace s3d
 
 		void connectionErrorReturn(const int errorCode) override
 		{
+			const NetworkTrace::Span span{ "SivPhoton::connectionErrorReturn" };
 			m_context.connectionErrorReturn(errorCode);
 			m_context.m_isUsePhoton = false;
 		}
@@ -241,20 +593,44 @@ namespace s3d
 			const auto myID = m_context.getClient().getLocalPlayer().getNumber();
 			const auto newID = player.getNumber();
 			const bool isSelf = (myID == newID);
+			refreshSnapshot();
+			const NetworkTrace::Span span{ "SivPhoton::joinRoomEventAction" };
 			m_context.joinRoomEventAction(playerID, ids, isSelf);
 		}
 
 		// 他人でも、誰かが退室したら呼ばれるコールバック
 		void leaveRoomEventAction(const int playerID, const bool isInactive) override
 		{
+			refreshSnapshot();
+			const NetworkTrace::Span span{ "SivPhoton::leaveRoomEventAction" };
 			m_context.leaveRoomEventAction(playerID, isInactive);
 		}
 
 		// ルームで他人が RaiseEvent したら呼ばれるコールバック
 		void customEventAction(const int playerID, const nByte eventCode, const ExitGames::Common::Object& eventContent) override
 		{
-			Print << U"SivPhoton::SivPhotonDetail::customEventAction() [ルームで他人が RaiseEvent したときの処理]";
-			Print << U"eventCode: " << int32(eventCode);
+			const NetworkTrace::Span span{ "SivPhotonDetail::customEventAction", eventCode };
+
+			// ハンドラで問題が起きても残るように、処理する前に書き込む
+			if (m_context.m_capture)
+			{
+				ExitGames::Common::Serializer serializer;
+				serializer.push(eventContent);
+				m_context.m_capture->write(NetworkCaptureDirection::Inbound, playerID, eventCode, NetworkSystem::EventFormat::PhotonSerialized, serializer.getData(), static_cast<size_t>(serializer.getSize()));
+			}
+
+			const Stopwatch stopwatch{ StartImmediately::Yes };
+
+			dispatchEvent(playerID, eventCode, eventContent);
+
+			m_context.m_statistics.recordReceived(eventCode, playerID, static_cast<size_t>(m_context.m_client->getByteCountCurrentDispatch()), stopwatch.usF());
+		}
+
+		// 受信したイベントを、内容の型に応じた SivPhoton::customEventAction() に渡す
+		void dispatchEvent(const int playerID, const nByte eventCode, const ExitGames::Common::Object& eventContent)
+		{
+			detail::Logger << U"SivPhoton::SivPhotonDetail::customEventAction() [ルームで他人が RaiseEvent したときの処理]";
+			detail::Logger << U"eventCode: " << int32(eventCode);
 
 			uint8 type = eventContent.getType();
 
@@ -269,6 +645,22 @@ namespace s3d
 			{
 				ExitGames::Common::Hashtable eventDataContent = ExitGames::Common::ValueObject<ExitGames::Common::Hashtable>(eventContent).getDataCopy();
 				ExitGames::Common::JString arrayType = ExitGames::Common::ValueObject<ExitGames::Common::JString>(eventDataContent.getValue(L"ArrayType")).getDataCopy();
+				if (arrayType == L"Blob")
+				{
+					const ExitGames::Common::ValueObject<nByte*> values{ eventDataContent.getValue(L"values") };
+					const Blob data{ *values.getDataAddress(), static_cast<size_t>(*values.getSizes()) };
+
+					if (auto it = m_context.m_eventHandlers.find(eventCode); it != m_context.m_eventHandlers.end())
+					{
+						const NetworkTrace::Span span{ "SivPhoton::eventHandler", eventCode };
+						it->second(playerID, data);
+						return;
+					}
+
+					invokeCustomEventAction(playerID, eventCode, data);
+					return;
+				}
+
 				if (arrayType == L"Array")
 				{
 					type = eventDataContent.getValue(L"values")->getType();
@@ -291,7 +683,7 @@ namespace s3d
 						{
 							data << values[i];
 						}
-						m_context.customEventAction(playerID, eventCode, data);
+						invokeCustomEventAction(playerID, eventCode, data);
 						return;
 					}
 					case ExitGames::Common::TypeCode::DOUBLE:
@@ -299,14 +691,14 @@ namespace s3d
 						auto values = ExitGames::Common::ValueObject<double*>(eventDataContent.getValue(L"values")).getDataCopy();
 						auto length = *(ExitGames::Common::ValueObject<double*>(eventDataContent.getValue(L"values"))).getSizes();
 
-						Print << length;
+						detail::Logger << length;
 
 						Array<double> data;
 						for (const auto i : step(length))
 						{
 							data << values[i];
 						}
-						m_context.customEventAction(playerID, eventCode, data);
+						invokeCustomEventAction(playerID, eventCode, data);
 						return;
 					}
 					case ExitGames::Common::TypeCode::FLOAT:
@@ -319,7 +711,7 @@ namespace s3d
 						{
 							data << values[i];
 						}
-						m_context.customEventAction(playerID, eventCode, data);
+						invokeCustomEventAction(playerID, eventCode, data);
 						return;
 					}
 					case ExitGames::Common::TypeCode::BOOLEAN:
@@ -332,7 +724,7 @@ namespace s3d
 						{
 							data << values[i];
 						}
-						m_context.customEventAction(playerID, eventCode, data);
+						invokeCustomEventAction(playerID, eventCode, data);
 						return;
 					}
 					case ExitGames::Common::TypeCode::STRING:
@@ -345,7 +737,7 @@ namespace s3d
 						{
 							data << detail::ToString(values[i]);
 						}
-						m_context.customEventAction(playerID, eventCode, data);
+						invokeCustomEventAction(playerID, eventCode, data);
 						return;
 					}
 					default:
@@ -379,7 +771,7 @@ namespace s3d
 
 						Grid<int32> grid(size, data);
 
-						m_context.customEventAction(playerID, eventCode, grid);
+						invokeCustomEventAction(playerID, eventCode, grid);
 						return;
 					}
 					case ExitGames::Common::TypeCode::DOUBLE:
@@ -387,7 +779,7 @@ namespace s3d
 						auto values = ExitGames::Common::ValueObject<double*>(eventDataContent.getValue(L"values")).getDataCopy();
 						auto length = *(ExitGames::Common::ValueObject<double*>(eventDataContent.getValue(L"values"))).getSizes();
 
-						Print << length;
+						detail::Logger << length;
 
 						Array<double> data;
 						for (const auto i : step(length))
@@ -397,7 +789,7 @@ namespace s3d
 
 						Grid<double> grid(size, data);
 
-						m_context.customEventAction(playerID, eventCode, grid);
+						invokeCustomEventAction(playerID, eventCode, grid);
 						return;
 					}
 					case ExitGames::Common::TypeCode::FLOAT:
@@ -413,7 +805,7 @@ namespace s3d
 
 						Grid<float> grid(size, data);
 
-						m_context.customEventAction(playerID, eventCode, grid);
+						invokeCustomEventAction(playerID, eventCode, grid);
 						return;
 					}
 					case ExitGames::Common::TypeCode::BOOLEAN:
@@ -429,7 +821,7 @@ namespace s3d
 
 						Grid<bool> grid(size, data);
 
-						m_context.customEventAction(playerID, eventCode, grid);
+						invokeCustomEventAction(playerID, eventCode, grid);
 						return;
 					}
 					case ExitGames::Common::TypeCode::STRING:
@@ -445,7 +837,7 @@ namespace s3d
 
 						Grid<String> grid(size, data);
 
-						m_context.customEventAction(playerID, eventCode, grid);
+						invokeCustomEventAction(playerID, eventCode, grid);
 						return;
 					}
 					default:
@@ -459,19 +851,19 @@ namespace s3d
 			switch (type)
 			{
 			case ExitGames::Common::TypeCode::INTEGER:
-				m_context.customEventAction(playerID, eventCode, ExitGames::Common::ValueObject<int>(eventContent).getDataCopy());
+				invokeCustomEventAction(playerID, eventCode, ExitGames::Common::ValueObject<int>(eventContent).getDataCopy());
 				return;
 			case ExitGames::Common::TypeCode::DOUBLE:
-				m_context.customEventAction(playerID, eventCode, ExitGames::Common::ValueObject<double>(eventContent).getDataCopy());
+				invokeCustomEventAction(playerID, eventCode, ExitGames::Common::ValueObject<double>(eventContent).getDataCopy());
 				return;
 			case ExitGames::Common::TypeCode::FLOAT:
-				m_context.customEventAction(playerID, eventCode, ExitGames::Common::ValueObject<float>(eventContent).getDataCopy());
+				invokeCustomEventAction(playerID, eventCode, ExitGames::Common::ValueObject<float>(eventContent).getDataCopy());
 				return;
 			case ExitGames::Common::TypeCode::BOOLEAN:
-				m_context.customEventAction(playerID, eventCode, ExitGames::Common::ValueObject<bool>(eventContent).getDataCopy());
+				invokeCustomEventAction(playerID, eventCode, ExitGames::Common::ValueObject<bool>(eventContent).getDataCopy());
 				return;
 			case ExitGames::Common::TypeCode::STRING:
-				m_context.customEventAction(playerID, eventCode, detail::ToString(ExitGames::Common::ValueObject<ExitGames::Common::JString>(eventContent).getDataCopy()));
+				invokeCustomEventAction(playerID, eventCode, detail::ToString(ExitGames::Common::ValueObject<ExitGames::Common::JString>(eventContent).getDataCopy()));
 				return;
 			default:
 				break;
@@ -484,6 +876,8 @@ namespace s3d
 			const String errorText = detail::ToString(errorString);
 			const String regionText = detail::ToString(region);
 			const String clusterText = detail::ToString(cluster);
+			refreshSnapshot();
+			const NetworkTrace::Span span{ "SivPhoton::connectReturn" };
 			m_context.connectReturn(errorCode, errorText, regionText, clusterText);
 			if (errorCode)
 			{
@@ -494,27 +888,61 @@ namespace s3d
 		// disconnect() の結果を通知するコールバック
 		void disconnectReturn() override
 		{
+			refreshSnapshot();
+			const NetworkTrace::Span span{ "SivPhoton::disconnectReturn" };
 			m_context.disconnectReturn();
 			m_context.m_isUsePhoton = false;
+			m_context.refreshRoomList();
+		}
+
+		// ロビーのルームの一覧が変更されたら呼ばれるコールバック
+		void onRoomListUpdate() override
+		{
+			m_context.refreshRoomList();
 		}
 
 		// 
 		void leaveRoomReturn(const int errorCode, const ExitGames::Common::JString& errorString) override
 		{
 			const String errorText = detail::ToString(errorString);
+			refreshSnapshot();
+			const NetworkTrace::Span span{ "SivPhoton::leaveRoomReturn" };
 			m_context.leaveRoomReturn(errorCode, errorText);
 		}
 
 		void joinRandomRoomReturn(const int localPlayerID, const ExitGames::Common::Hashtable& roomProperties, const ExitGames::Common::Hashtable& playerProperties, const int errorCode, const ExitGames::Common::JString& errorString) override
 		{
+			refreshSnapshot();
+			const NetworkTrace::Span span{ "SivPhoton::joinRandomRoomReturn" };
 			m_context.joinRandomRoomReturn(localPlayerID, errorCode, detail::ToString(errorString));
 		}
 
+		void joinRoomReturn(const int localPlayerID, const ExitGames::Common::Hashtable& roomProperties, const ExitGames::Common::Hashtable& playerProperties, const int errorCode, const ExitGames::Common::JString& errorString) override
+		{
+			refreshSnapshot();
+			const NetworkTrace::Span span{ "SivPhoton::joinRoomReturn" };
+			m_context.joinRoomReturn(localPlayerID, errorCode, detail::ToString(errorString));
+		}
+
 		void createRoomReturn(const int localPlayerID, const ExitGames::Common::Hashtable& roomProperties, const ExitGames::Common::Hashtable& playerProperties, const int errorCode, const ExitGames::Common::JString& errorString) override
 		{
+			refreshSnapshot();
+			const NetworkTrace::Span span{ "SivPhoton::createRoomReturn" };
 			m_context.createRoomReturn(localPlayerID, errorCode, detail::ToString(errorString));
 		}
 
+		// マスタークライアントが変わったら呼ばれるコールバック
+		void onMasterClientChanged(const int, const int) override
+		{
+			refreshSnapshot();
+		}
+
+		// ルームのプロパティ (開閉・公開など) が変更されたら呼ばれるコールバック
+		void onRoomPropertiesChange(const ExitGames::Common::Hashtable&) override
+		{
+			refreshSnapshot();
+		}
+
 	private:
 
 		SivPhoton& m_context;
@@ -525,11 +953,26 @@ namespace s3d
 
 		HashTable<uint8, std::function<void(const int, const nByte, const ExitGames::Common::Object*, const Size)>> m_receiveGridEventFunctions;
 
+		// ユーザーのコールバックより前に状態を更新し、コールバックの後に SDK が反映する変更は次の update() で拾う
+		void refreshSnapshot()
+		{
+			m_context.refreshSnapshot();
+			m_context.m_snapshotDirty = true;
+		}
+
+		// ユーザーのコールバックの呼び出しを、トレースの区間として記録する
+		template <class T>
+		void invokeCustomEventAction(const int playerID, const nByte eventCode, const T& value)
+		{
+			const NetworkTrace::Span span{ "SivPhoton::customEventAction", eventCode };
+			m_context.customEventAction(playerID, eventCode, value);
+		}
+
 		template <class T, uint8 N>
 		void receivedCustomType(const int playerID, const nByte eventCode, const ExitGames::Common::Object& eventContent)
 		{
 			auto value = ExitGames::Common::ValueObject<SivCustomType<T, N>>(eventContent).getDataCopy().getValue();
-			m_context.customEventAction(playerID, eventCode, value);
+			invokeCustomEventAction(playerID, eventCode, value);
 		}
 
 		template <class T, uint8 N>
@@ -543,7 +986,7 @@ namespace s3d
 			{
 				data << values[i].getValue();
 			}
-			m_context.customEventAction(playerID, eventCode, data);
+			invokeCustomEventAction(playerID, eventCode, data);
 		}
 
 		template <class T, uint8 N>
@@ -559,8 +1002,98 @@ namespace s3d
 			}
 
 			Grid<T> grid{ size, data };
-			m_context.customEventAction(playerID, eventCode, grid);
+			invokeCustomEventAction(playerID, eventCode, grid);
+		}
+	};
+
+	class SivPhoton::SivPhotonTransportListener : public NetworkTransport::Listener
+	{
+	public:
+
+		explicit SivPhotonTransportListener(SivPhoton& context_)
+			: m_context{ context_ } {}
+
+		void connectReturn(const int32 errorCode, const String& errorString) override
+		{
+			m_context.refreshSnapshot();
+			const NetworkTrace::Span span{ "SivPhoton::connectReturn" };
+			m_context.connectReturn(errorCode, errorString, U"", U"");
+			if (errorCode)
+			{
+				m_context.m_isUsePhoton = false;
+			}
+		}
+
+		void disconnectReturn() override
+		{
+			m_context.refreshSnapshot();
+			const NetworkTrace::Span span{ "SivPhoton::disconnectReturn" };
+			m_context.disconnectReturn();
+			m_context.m_isUsePhoton = false;
+		}
+
+		void joinRandomRoomReturn(const int32 localPlayerID, const int32 errorCode, const String& errorString) override
+		{
+			m_context.refreshSnapshot();
+			const NetworkTrace::Span span{ "SivPhoton::joinRandomRoomReturn" };
+			m_context.joinRandomRoomReturn(localPlayerID, errorCode, errorString);
 		}
+
+		void joinRoomReturn(const int32 localPlayerID, const int32 errorCode, const String& errorString) override
+		{
+			m_context.refreshSnapshot();
+			const NetworkTrace::Span span{ "SivPhoton::joinRoomReturn" };
+			m_context.joinRoomReturn(localPlayerID, errorCode, errorString);
+		}
+
+		void createRoomReturn(const int32 localPlayerID, const int32 errorCode, const String& errorString) override
+		{
+			m_context.refreshSnapshot();
+			const NetworkTrace::Span span{ "SivPhoton::createRoomReturn" };
+			m_context.createRoomReturn(localPlayerID, errorCode, errorString);
+		}
+
+		void leaveRoomReturn(const int32 errorCode, const String& errorString) override
+		{
+			m_context.refreshSnapshot();
+			const NetworkTrace::Span span{ "SivPhoton::leaveRoomReturn" };
+			m_context.leaveRoomReturn(errorCode, errorString);
+		}
+
+		void joinRoomEventAction(const int32 playerID, const Array<int32>& playerIDs, const bool isSelf) override
+		{
+			m_context.refreshSnapshot();
+			const NetworkTrace::Span span{ "SivPhoton::joinRoomEventAction" };
+			m_context.joinRoomEventAction(playerID, playerIDs, isSelf);
+		}
+
+		void leaveRoomEventAction(const int32 playerID, const bool isInactive) override
+		{
+			m_context.refreshSnapshot();
+			const NetworkTrace::Span span{ "SivPhoton::leaveRoomEventAction" };
+			m_context.leaveRoomEventAction(playerID, isInactive);
+		}
+
+		void customEventAction(const int32 playerID, const uint8 eventCode, const Blob& eventContent, bool, const NetworkTransport::EventFormat format) override
+		{
+			const NetworkTrace::Span span{ "SivPhotonTransportListener::customEventAction", eventCode };
+
+			// ハンドラで問題が起きても残るように、処理する前に書き込む
+			if (m_context.m_capture)
+			{
+				m_context.m_capture->write(NetworkCaptureDirection::Inbound, playerID, eventCode, format, eventContent.data(), eventContent.size());
+			}
+
+			const Stopwatch stopwatch{ StartImmediately::Yes };
+
+			m_context.dispatchEvent(playerID, eventCode, eventContent, format);
+
+			m_context.m_statistics.recordReceived(eventCode, playerID, eventContent.size(), stopwatch.usF());
+		}
+
+	private:
+
+		SivPhoton& m_context;
 	};
 }
 
@@ -571,97 +1104,159 @@ namespace s3d
 		, m_client{ std::make_unique<ExitGames::LoadBalancing::Client>(*m_listener, detail::ToJString(secretPhotonAppID), detail::ToJString(photonAppVersion)) }
 		, m_isUsePhoton{ false }
 	{
+		detail::RegisterCustomTypes();
+
+		m_snapshot = readSnapshot();
+	}
+
+	SivPhoton::SivPhoton(std::unique_ptr<NetworkTransport> transport)
+		: m_listener{ std::make_unique<SivPhotonDetail>(*this) }
+		, m_client{ std::make_unique<ExitGames::LoadBalancing::Client>(*m_listener, L"", L"") }
+		, m_transportListener{ std::make_unique<SivPhotonTransportListener>(*this) }
+		, m_transport{ std::move(transport) }
+		, m_isUsePhoton{ false }
+	{
+		assert(m_transport);
+
+		detail::RegisterCustomTypes();
+
+		m_transport->setListener(m_transportListener.get());
 
-		PhotonPoint::registerType();
-		PhotonVec2::registerType();
-		PhotonRect::registerType();
-		PhotonCircle::registerType();
-		PhotonColorF::registerType();
-		PhotonColor::registerType();
-		PhotonHSV::registerType();
-		PhotonLine::registerType();
-		PhotonTriangle::registerType();
-		PhotonRectF::registerType();
-		PhotonQuad::registerType();
-		PhotonEllipse::registerType();
-		PhotonRoundRect::registerType();
-		PhotonVec3::registerType();
-		PhotonVec4::registerType();
-		PhotonFloat2::registerType();
-		PhotonFloat3::registerType();
-		PhotonFloat4::registerType();
-		PhotonMat3x2::registerType();
+		m_snapshot = readSnapshot();
 	}
 
 	SivPhoton::~SivPhoton()
 	{
-		Print << U"SivPhoton::~SivPhoton()";
-
-		PhotonPoint::unregisterType();
-		PhotonVec2::unregisterType();
-		PhotonRect::unregisterType();
-		PhotonCircle::unregisterType();
-		PhotonColorF::unregisterType();
-		PhotonColor::unregisterType();
-		PhotonHSV::unregisterType();
-		PhotonLine::unregisterType();
-		PhotonTriangle::unregisterType();
-		PhotonRectF::unregisterType();
-		PhotonQuad::unregisterType();
-		PhotonEllipse::unregisterType();
-		PhotonRoundRect::unregisterType();
-		PhotonVec3::unregisterType();
-		PhotonVec4::unregisterType();
-		PhotonFloat2::unregisterType();
-		PhotonFloat3::unregisterType();
-		PhotonFloat4::unregisterType();
-		PhotonMat3x2::unregisterType();
+		detail::Logger << U"SivPhoton::~SivPhoton()";
+
+		detail::UnregisterCustomTypes();
 
 		disconnect();
 	}
 
 	void SivPhoton::connect(const StringView userName, const Optional<String>& defaultRoomName)
 	{
-		Print << U"SivPhoton::connect() [サーバに接続する]";
+		detail::Logger << U"SivPhoton::connect() [サーバに接続する]";
 
 		m_defaultRoomName = defaultRoomName.value_or(String{ userName });
 
+		if (m_transport)
+		{
+			m_isUsePhoton = m_transport->connect(userName);
+			refreshSnapshot();
+			return;
+		}
+
 		const auto userNameJ = detail::ToJString(userName);
 		const auto userID = ExitGames::LoadBalancing::AuthenticationValues{}
 		.setUserID(userNameJ + GETTIMEMS());
 
 		if (not m_client->connect({ userID, userNameJ }))
 		{
-			Print << U"ExitGmae::LoadBalancing::Client::connect() failed.";
+			detail::Logger << U"ExitGmae::LoadBalancing::Client::connect() failed.";
+			return;
+		}
+
+		m_client->fetchServerTimestamp();
+		m_isUsePhoton = true;
+		refreshSnapshot();
+	}
+
+	void SivPhoton::disconnect()
+	{
+		if (m_transport)
+		{
+			m_transport->disconnect();
 			return;
 		}
 
-		m_client->fetchServerTimestamp();
-		m_isUsePhoton = true;
+		m_client->disconnect();
+	}
+
+	void SivPhoton::update()
+	{
+		const NetworkTrace::Span span{ "SivPhoton::update" };
+
+		if (m_transport)
+		{
+			const NetworkTrace::Span transportSpan{ "NetworkTransport::update" };
+			m_transport->update();
+
+			// ルームの一覧は、トランスポートが版を管理している場合は変わったときだけ読み直す
+			// (一覧の作成はトランスポートによっては重いため)
+			if (const Optional<uint64> version = m_transport->getRoomListVersion();
+				(not version) || (version != m_transportRoomListVersion))
+			{
+				m_transportRoomListVersion = version;
+				refreshRoomList();
+			}
+
+			// 状態も同様に、トランスポートが版を管理している場合は変わったときだけ読み直す
+			// (読み込みは 10 回ほどの仮想関数の呼び出しで、トランスポートによってはそれぞれがロックを取る)
+			if (const Optional<uint64> version = m_transport->getStateVersion();
+				(not version) || (version != m_transportStateVersion))
+			{
+				m_transportStateVersion = version;
+				refreshSnapshot();
+			}
+		}
+		else
+		{
+			{
+				const NetworkTrace::Span serviceSpan{ "Client::service" };
+				m_client->service();
+			}
+
+			// コールバックの時点で SDK に反映されていなかった変更も拾う
+			if (m_snapshotDirty)
+			{
+				refreshSnapshot();
+			}
+		}
+
+		m_statistics.sampleConnection(getConnectionStats());
 	}
 
-	void SivPhoton::disconnect()
+	void SivPhoton::opJoinRandomRoom(const int32 maxPlayers)
 	{
-		m_client->disconnect();
-	}
+		detail::Logger << U"SivPhoton::opJoinRandomRoom(maxPlayers = {}) [既存のランダムなルームに参加する]"_fmt(maxPlayers);
 
-	void SivPhoton::update()
-	{
-		m_client->service();
+		assert(InRange(maxPlayers, 0, 255));
+
+		if (m_transport)
+		{
+			m_transport->joinRandomRoom(Clamp(maxPlayers, 1, 255));
+			return;
+		}
+
+		m_client->opJoinRandomRoom({}, static_cast<uint8>(Clamp(maxPlayers, 1, 255)));
 	}
 
-	void SivPhoton::opJoinRandomRoom(const int32 maxPlayers)
+	void SivPhoton::opJoinRandomRoom(const int32 maxPlayers, const StringView sqlLobbyFilter, const StringView sqlLobbyName)
 	{
-		Print << U"SivPhoton::opJoinRandomRoom(maxPlayers = {}) [既存のランダムなルームに参加する]"_fmt(maxPlayers);
+		detail::Logger << U"SivPhoton::opJoinRandomRoom(maxPlayers = {}, sqlLobbyFilter = {}) [SQL ロビーから条件に合うランダムなルームに参加する]"_fmt(maxPlayers, sqlLobbyFilter);
 
 		assert(InRange(maxPlayers, 0, 255));
 
-		m_client->opJoinRandomRoom({}, static_cast<uint8>(Clamp(maxPlayers, 1, 255)));
+		if (m_transport)
+		{
+			m_transport->joinRandomRoom(Clamp(maxPlayers, 1, 255));
+			return;
+		}
+
+		m_client->opJoinRandomRoom({}, static_cast<uint8>(Clamp(maxPlayers, 0, 255)), ExitGames::LoadBalancing::MatchmakingMode::FILL_ROOM,
+			detail::ToJString(sqlLobbyName), ExitGames::LoadBalancing::LobbyType::SQL_LOBBY, detail::ToJString(sqlLobbyFilter));
 	}
 
 	void SivPhoton::opJoinRoom(const StringView roomName, const bool rejoin)
 	{
-		Print << U"SivPhoton::opJoinRoom() [既存の指定したルームに参加する]";
+		detail::Logger << U"SivPhoton::opJoinRoom() [既存の指定したルームに参加する]";
+
+		if (m_transport)
+		{
+			m_transport->joinRoom(roomName);
+			return;
+		}
 
 		const auto roomNameJ = detail::ToJString(roomName);
 
@@ -670,10 +1265,16 @@ namespace s3d
 
 	void SivPhoton::opCreateRoom(const StringView roomName, const int32 maxPlayers)
 	{
-		Print << U"SivPhoton::opCreateRoom() [ルームを新規に作成する]";
+		detail::Logger << U"SivPhoton::opCreateRoom() [ルームを新規に作成する]";
 
 		assert(InRange(maxPlayers, 0, 255));
 
+		if (m_transport)
+		{
+			m_transport->createRoom(roomName, Clamp(maxPlayers, 1, 255));
+			return;
+		}
+
 		const auto roomNameJ = detail::ToJString(roomName);
 		const auto roomOption = ExitGames::LoadBalancing::RoomOptions()
 			.setMaxPlayers(static_cast<uint8>(Clamp(maxPlayers, 1, 255)));
@@ -681,18 +1282,124 @@ namespace s3d
 		m_client->opCreateRoom(roomNameJ, roomOption);
 	}
 
+	void SivPhoton::opCreateRoom(const StringView roomName, const int32 maxPlayers, const HashTable<String, NetworkSystem::RoomPropertyValue>& lobbyProperties, const StringView sqlLobbyName)
+	{
+		detail::Logger << U"SivPhoton::opCreateRoom() [プロパティを持つルームを新規に作成する]";
+
+		assert(InRange(maxPlayers, 0, 255));
+
+		if (m_transport)
+		{
+			m_transport->createRoom(roomName, Clamp(maxPlayers, 1, 255));
+			return;
+		}
+
+		// 指定したプロパティはすべてロビーに公開する
+		ExitGames::Common::JVector<ExitGames::Common::JString> propsListedInLobby;
+
+		for (const auto& [key, value] : lobbyProperties)
+		{
+			propsListedInLobby.addElement(detail::ToJString(key));
+		}
+
+		auto roomOption = ExitGames::LoadBalancing::RoomOptions()
+			.setMaxPlayers(static_cast<uint8>(Clamp(maxPlayers, 1, 255)))
+			.setCustomRoomProperties(detail::ToHashtable(lobbyProperties))
+			.setPropsListedInLobby(propsListedInLobby);
+
+		if (not sqlLobbyName.isEmpty())
+		{
+			roomOption.setLobbyName(detail::ToJString(sqlLobbyName))
+				.setLobbyType(ExitGames::LoadBalancing::LobbyType::SQL_LOBBY);
+		}
+
+		m_client->opCreateRoom(detail::ToJString(roomName), roomOption);
+	}
+
 	void SivPhoton::opLeaveRoom()
 	{
-		Print << U"SivPhoton::opLeaveRoom() [ルームを退室する]";
+		detail::Logger << U"SivPhoton::opLeaveRoom() [ルームを退室する]";
+
+		if (m_transport)
+		{
+			m_transport->leaveRoom();
+			return;
+		}
 
 		constexpr bool willComeBack = false;
 
 		m_client->opLeaveRoom(willComeBack);
 	}
+
+	void SivPhoton::opChangeGroups(const Array<uint8>& groupsToRemove, const Array<uint8>& groupsToAdd)
+	{
+		assert(not groupsToRemove.contains(0));
+		assert(not groupsToAdd.contains(0));
+
+		if (m_transport)
+		{
+			m_transport->changeGroups(groupsToRemove, groupsToAdd);
+			return;
+		}
+
+		// 空の JVector は「すべてのグループ」を意味するので、変更が無い場合は nullptr を渡す
+		ExitGames::Common::JVector<nByte> removeJ;
+		ExitGames::Common::JVector<nByte> addJ;
+
+		for (const auto group : groupsToRemove)
+		{
+			removeJ.addElement(group);
+		}
+
+		for (const auto group : groupsToAdd)
+		{
+			addJ.addElement(group);
+		}
+
+		m_client->opChangeGroups((groupsToRemove ? &removeJ : nullptr), (groupsToAdd ? &addJ : nullptr));
+	}
 }
 
 namespace s3d
 {
+	template <class Type>
+	void SivPhoton::raisePhotonEvent(const bool reliable, const Type& content, const uint8 eventCode)
+	{
+		const NetworkTrace::Span span{ "SivPhoton::opRaiseEvent", eventCode };
+		const Stopwatch stopwatch{ StartImmediately::Yes };
+
+		if (m_transport)
+		{
+			ExitGames::Common::Serializer serializer;
+			serializer.push(content);
+
+			NetworkSystem::EventOption option;
+			option.reliable = reliable;
+
+			const Blob blob{ serializer.getData(), static_cast<size_t>(serializer.getSize()) };
+			m_transport->raiseEvent(eventCode, blob, option, NetworkTransport::EventFormat::PhotonSerialized);
+			m_statistics.recordSent(eventCode, blob.size(), stopwatch.usF());
+
+			if (m_capture)
+			{
+				m_capture->write(NetworkCaptureDirection::Outbound, localPlayerID().value_or(-1), eventCode, NetworkSystem::EventFormat::PhotonSerialized, blob.data(), blob.size());
+			}
+
+			return;
+		}
+
+		m_client->opRaiseEvent(reliable, content, eventCode);
+		m_statistics.recordSent(eventCode, static_cast<size_t>(m_client->getByteCountLastOperation()), stopwatch.usF());
+
+		if (m_capture)
+		{
+			// Photon は直列化したバイト列を返さないため、キャプチャ用に直列化し直す
+			ExitGames::Common::Serializer serializer;
+			serializer.push(content);
+			m_capture->write(NetworkCaptureDirection::Outbound, localPlayerID().value_or(-1), eventCode, NetworkSystem::EventFormat::PhotonSerialized, serializer.getData(), static_cast<size_t>(serializer.getSize()));
+		}
+	}
+
 	template<class T>
 	void s3d::SivPhoton::opRaiseEvent(const uint8 eventCode, const T& value)
 	{
@@ -702,178 +1409,178 @@ namespace s3d
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Rect& value)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
-		m_client->opRaiseEvent(reliable, PhotonRect{ value }, eventCode);
+		raisePhotonEvent(reliable, PhotonRect{ value }, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Vec2& value)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
-		m_client->opRaiseEvent(reliable, PhotonVec2{ value }, eventCode);
+		raisePhotonEvent(reliable, PhotonVec2{ value }, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Point& value)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
-		m_client->opRaiseEvent(reliable, PhotonPoint{ value }, eventCode);
+		raisePhotonEvent(reliable, PhotonPoint{ value }, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Circle& value)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
-		m_client->opRaiseEvent(reliable, PhotonCircle{ value }, eventCode);
+		raisePhotonEvent(reliable, PhotonCircle{ value }, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const ColorF& value)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
-		m_client->opRaiseEvent(reliable, PhotonColorF{ value }, eventCode);
+		raisePhotonEvent(reliable, PhotonColorF{ value }, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Color& value)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
-		m_client->opRaiseEvent(reliable, PhotonColor{ value }, eventCode);
+		raisePhotonEvent(reliable, PhotonColor{ value }, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const HSV& value)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
-		m_client->opRaiseEvent(reliable, PhotonHSV{ value }, eventCode);
+		raisePhotonEvent(reliable, PhotonHSV{ value }, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Line& value)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
-		m_client->opRaiseEvent(reliable, PhotonLine{ value }, eventCode);
+		raisePhotonEvent(reliable, PhotonLine{ value }, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Triangle& value)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
-		m_client->opRaiseEvent(reliable, PhotonTriangle{ value }, eventCode);
+		raisePhotonEvent(reliable, PhotonTriangle{ value }, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const RectF& value)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
-		m_client->opRaiseEvent(reliable, PhotonRectF{ value }, eventCode);
+		raisePhotonEvent(reliable, PhotonRectF{ value }, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Quad& value)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
-		m_client->opRaiseEvent(reliable, PhotonQuad{ value }, eventCode);
+		raisePhotonEvent(reliable, PhotonQuad{ value }, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Ellipse& value)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
-		m_client->opRaiseEvent(reliable, PhotonEllipse{ value }, eventCode);
+		raisePhotonEvent(reliable, PhotonEllipse{ value }, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const RoundRect& value)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
-		m_client->opRaiseEvent(reliable, PhotonRoundRect{ value }, eventCode);
+		raisePhotonEvent(reliable, PhotonRoundRect{ value }, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Vec3& value)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
-		m_client->opRaiseEvent(reliable, PhotonVec3{ value }, eventCode);
+		raisePhotonEvent(reliable, PhotonVec3{ value }, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Vec4& value)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
-		m_client->opRaiseEvent(reliable, PhotonVec4{ value }, eventCode);
+		raisePhotonEvent(reliable, PhotonVec4{ value }, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Float2& value)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
-		m_client->opRaiseEvent(reliable, PhotonFloat2{ value }, eventCode);
+		raisePhotonEvent(reliable, PhotonFloat2{ value }, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Float3& value)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
-		m_client->opRaiseEvent(reliable, PhotonFloat3{ value }, eventCode);
+		raisePhotonEvent(reliable, PhotonFloat3{ value }, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Float4& value)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
-		m_client->opRaiseEvent(reliable, PhotonFloat4{ value }, eventCode);
+		raisePhotonEvent(reliable, PhotonFloat4{ value }, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Mat3x2& value)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
-		m_client->opRaiseEvent(reliable, PhotonMat3x2{ value }, eventCode);
+		raisePhotonEvent(reliable, PhotonMat3x2{ value }, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Array<Point>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -887,13 +1594,13 @@ namespace s3d
 		ev.put(L"ArrayType", L"Array");
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Array<Vec2>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -907,13 +1614,13 @@ namespace s3d
 		ev.put(L"ArrayType", L"Array");
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Array<Rect>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -927,13 +1634,13 @@ namespace s3d
 		ev.put(L"ArrayType", L"Array");
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Array<Circle>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -947,13 +1654,13 @@ namespace s3d
 		ev.put(L"ArrayType", L"Array");
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Array<ColorF>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -967,13 +1674,13 @@ namespace s3d
 		ev.put(L"ArrayType", L"Array");
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Array<Color>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -987,13 +1694,13 @@ namespace s3d
 		ev.put(L"ArrayType", L"Array");
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Array<HSV>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1007,13 +1714,13 @@ namespace s3d
 		ev.put(L"ArrayType", L"Array");
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Array<Line>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1027,13 +1734,13 @@ namespace s3d
 		ev.put(L"ArrayType", L"Array");
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Array<Triangle>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1047,13 +1754,13 @@ namespace s3d
 		ev.put(L"ArrayType", L"Array");
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Array<RectF>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1067,13 +1774,13 @@ namespace s3d
 		ev.put(L"ArrayType", L"Array");
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Array<Quad>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1087,13 +1794,13 @@ namespace s3d
 		ev.put(L"ArrayType", L"Array");
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Array<Ellipse>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1107,13 +1814,13 @@ namespace s3d
 		ev.put(L"ArrayType", L"Array");
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Array<RoundRect>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1127,13 +1834,13 @@ namespace s3d
 		ev.put(L"ArrayType", L"Array");
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Array<Vec3>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1147,13 +1854,13 @@ namespace s3d
 		ev.put(L"ArrayType", L"Array");
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Array<Vec4>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1167,13 +1874,13 @@ namespace s3d
 		ev.put(L"ArrayType", L"Array");
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Array<Float2>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1187,13 +1894,13 @@ namespace s3d
 		ev.put(L"ArrayType", L"Array");
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Array<Float3>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1207,13 +1914,13 @@ namespace s3d
 		ev.put(L"ArrayType", L"Array");
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Array<Float4>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1227,13 +1934,13 @@ namespace s3d
 		ev.put(L"ArrayType", L"Array");
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Array<Mat3x2>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1247,13 +1954,13 @@ namespace s3d
 		ev.put(L"ArrayType", L"Array");
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Grid<Point>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1268,13 +1975,13 @@ namespace s3d
 		ev.put(L"xy", PhotonPoint{ Point{values.width(), values.height()} });
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Grid<Vec2>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1289,13 +1996,13 @@ namespace s3d
 		ev.put(L"xy", PhotonPoint{ Point{values.width(), values.height()} });
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Grid<Rect>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1310,13 +2017,13 @@ namespace s3d
 		ev.put(L"xy", PhotonPoint{ Point{values.width(), values.height()} });
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Grid<Circle>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1331,13 +2038,13 @@ namespace s3d
 		ev.put(L"xy", PhotonPoint{ Point{values.width(), values.height()} });
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Grid<ColorF>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1352,13 +2059,13 @@ namespace s3d
 		ev.put(L"xy", PhotonPoint{ Point{values.width(), values.height()} });
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Grid<Color>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1373,13 +2080,13 @@ namespace s3d
 		ev.put(L"xy", PhotonPoint{ Point{values.width(), values.height()} });
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Grid<HSV>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1394,13 +2101,13 @@ namespace s3d
 		ev.put(L"xy", PhotonPoint{ Point{values.width(), values.height()} });
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Grid<Line>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1415,13 +2122,13 @@ namespace s3d
 		ev.put(L"xy", PhotonPoint{ Point{values.width(), values.height()} });
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Grid<Triangle>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1436,13 +2143,13 @@ namespace s3d
 		ev.put(L"xy", PhotonPoint{ Point{values.width(), values.height()} });
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Grid<RectF>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1457,13 +2164,13 @@ namespace s3d
 		ev.put(L"xy", PhotonPoint{ Point{values.width(), values.height()} });
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Grid<Quad>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1478,13 +2185,13 @@ namespace s3d
 		ev.put(L"xy", PhotonPoint{ Point{values.width(), values.height()} });
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Grid<Ellipse>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1499,13 +2206,13 @@ namespace s3d
 		ev.put(L"xy", PhotonPoint{ Point{values.width(), values.height()} });
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Grid<RoundRect>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1520,13 +2227,13 @@ namespace s3d
 		ev.put(L"xy", PhotonPoint{ Point{values.width(), values.height()} });
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Grid<Vec3>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1541,13 +2248,13 @@ namespace s3d
 		ev.put(L"xy", PhotonPoint{ Point{values.width(), values.height()} });
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Grid<Vec4>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1562,13 +2269,13 @@ namespace s3d
 		ev.put(L"xy", PhotonPoint{ Point{values.width(), values.height()} });
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Grid<Float2>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1583,13 +2290,13 @@ namespace s3d
 		ev.put(L"xy", PhotonPoint{ Point{values.width(), values.height()} });
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Grid<Float3>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1604,13 +2311,13 @@ namespace s3d
 		ev.put(L"xy", PhotonPoint{ Point{values.width(), values.height()} });
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Grid<Float4>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1625,13 +2332,13 @@ namespace s3d
 		ev.put(L"xy", PhotonPoint{ Point{values.width(), values.height()} });
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	template<>
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Grid<Mat3x2>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1646,52 +2353,52 @@ namespace s3d
 		ev.put(L"xy", PhotonPoint{ Point{values.width(), values.height()} });
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const int32 value)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
-		m_client->opRaiseEvent(reliable, value, eventCode);
+		raisePhotonEvent(reliable, value, eventCode);
 	}
 
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const double value)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
-		m_client->opRaiseEvent(reliable, value, eventCode);
+		raisePhotonEvent(reliable, value, eventCode);
 	}
 
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const float value)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
-		m_client->opRaiseEvent(reliable, value, eventCode);
+		raisePhotonEvent(reliable, value, eventCode);
 	}
 
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const bool value)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
-		m_client->opRaiseEvent(reliable, value, eventCode);
+		raisePhotonEvent(reliable, value, eventCode);
 	}
 
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const StringView value)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
-		m_client->opRaiseEvent(reliable, detail::ToJString(value), eventCode);
+		raisePhotonEvent(reliable, detail::ToJString(value), eventCode);
 	}
 
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Array<int32>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1699,12 +2406,12 @@ namespace s3d
 		ev.put(L"ArrayType", L"Array");
 		ev.put(L"values", values.data(), values.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Array<double>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1712,12 +2419,12 @@ namespace s3d
 		ev.put(L"ArrayType", L"Array");
 		ev.put(L"values", values.data(), values.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Array<float>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1725,12 +2432,12 @@ namespace s3d
 		ev.put(L"ArrayType", L"Array");
 		ev.put(L"values", values.data(), values.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Array<bool>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1738,12 +2445,12 @@ namespace s3d
 		ev.put(L"ArrayType", L"Array");
 		ev.put(L"values", values.data(), values.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Array<String>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1757,12 +2464,12 @@ namespace s3d
 		ev.put(L"ArrayType", L"Array");
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Grid<int32>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1773,12 +2480,12 @@ namespace s3d
 		ev.put(L"xy", PhotonPoint{ Point{values.width(), values.height()} });
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Grid<double>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1789,12 +2496,12 @@ namespace s3d
 		ev.put(L"xy", PhotonPoint{ Point{values.width(), values.height()} });
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Grid<float>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1805,12 +2512,12 @@ namespace s3d
 		ev.put(L"xy", PhotonPoint{ Point{values.width(), values.height()} });
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Grid<bool>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1821,12 +2528,12 @@ namespace s3d
 		ev.put(L"xy", PhotonPoint{ Point{values.width(), values.height()} });
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
 	}
 
 	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Grid<String>& values)
 	{
-		Print << U"opRaiseEvent()";
+		detail::Logger << U"opRaiseEvent()";
 
 		constexpr bool reliable = true;
 
@@ -1841,117 +2548,296 @@ namespace s3d
 		ev.put(L"xy", PhotonPoint{ Point{values.width(), values.height()} });
 		ev.put(L"values", data.data(), data.size());
 
-		m_client->opRaiseEvent(reliable, ev, eventCode);
+		raisePhotonEvent(reliable, ev, eventCode);
+	}
+
+	void SivPhoton::opRaiseEvent(const uint8 eventCode, const Blob& value, const NetworkSystem::EventOption& option)
+	{
+		const NetworkTrace::Span span{ "SivPhoton::opRaiseEvent", eventCode };
+		const Stopwatch stopwatch{ StartImmediately::Yes };
+
+		if (m_transport)
+		{
+			m_transport->raiseEvent(eventCode, value, option, NetworkTransport::EventFormat::Blob);
+			m_statistics.recordSent(eventCode, value.size(), stopwatch.usF(), option.targetPlayers);
+
+			if (m_capture)
+			{
+				m_capture->write(NetworkCaptureDirection::Outbound, localPlayerID().value_or(-1), eventCode, NetworkSystem::EventFormat::Blob, value.data(), value.size());
+			}
+
+			return;
+		}
+
+		ExitGames::Common::Hashtable ev;
+		ev.put(L"ArrayType", L"Blob");
+		ev.put(L"values", reinterpret_cast<const nByte*>(value.data()), static_cast<int>(value.size()));
+
+		m_client->opRaiseEvent(option.reliable, ev, eventCode, detail::ToRaiseEventOptions(option));
+		m_statistics.recordSent(eventCode, static_cast<size_t>(m_client->getByteCountLastOperation()), stopwatch.usF(), option.targetPlayers);
+
+		if (m_capture)
+		{
+			ExitGames::Common::Serializer serializer;
+			serializer.push(ev);
+			m_capture->write(NetworkCaptureDirection::Outbound, localPlayerID().value_or(-1), eventCode, NetworkSystem::EventFormat::PhotonSerialized, serializer.getData(), static_cast<size_t>(serializer.getSize()));
+		}
 	}
 
-	String SivPhoton::getName() const
+	void SivPhoton::setEventHandler(const uint8 eventCode, std::function<void(int32 playerID, const Blob& eventContent)> handler)
 	{
-		return detail::ToString(m_client->getLocalPlayer().getName());
+		m_eventHandlers.insert_or_assign(eventCode, std::move(handler));
 	}
 
-	String SivPhoton::getUserID() const
+	void SivPhoton::removeEventHandler(const uint8 eventCode)
 	{
-		return detail::ToString(m_client->getLocalPlayer().getUserID());
+		m_eventHandlers.erase(eventCode);
 	}
 
-	Array<String> SivPhoton::getRoomNameList() const
+	const String& SivPhoton::getName() const noexcept
 	{
-		const auto roomNameList = m_client->getRoomNameList();
-		Array<String> result;
+		return m_snapshot.userName;
+	}
 
-		for (uint32 i = 0; i < roomNameList.getSize(); ++i)
-		{
-			result << detail::ToString(roomNameList[i]);
-		}
+	const String& SivPhoton::getUserID() const noexcept
+	{
+		return m_snapshot.userID;
+	}
 
-		return result;
+	const Array<String>& SivPhoton::getRoomNameList() const noexcept
+	{
+		return m_roomNameList;
 	}
 
-	bool SivPhoton::isInRoom() const
+	const Array<NetworkSystem::RoomInfo>& SivPhoton::getRoomList() const noexcept
 	{
-		return m_client->getIsInGameRoom();
+		return m_roomList;
 	}
 
-	String SivPhoton::getCurrentRoomName() const
+	NetworkSystem::RoomPage SivPhoton::findRooms(const NetworkSystem::RoomQuery& query) const
 	{
-		if (not m_client->getIsInGameRoom())
-		{
-			return{};
-		}
+		return NetworkSystem::QueryRooms(m_roomList, query);
+	}
+
+	uint64 SivPhoton::getRoomListGeneration() const noexcept
+	{
+		return m_roomListGeneration;
+	}
 
-		return detail::ToString(m_client->getCurrentlyJoinedRoom().getName());
+	const NetworkSystem::SessionSnapshot& SivPhoton::getSnapshot() const noexcept
+	{
+		return m_snapshot;
 	}
 
-	int32 SivPhoton::getPlayerCountInCurrentRoom() const
+	uint64 SivPhoton::getSnapshotGeneration() const noexcept
 	{
-		if (not m_client->getIsInGameRoom())
-		{
-			return 0;
-		}
+		return m_snapshotGeneration;
+	}
 
-		return m_client->getCurrentlyJoinedRoom().getPlayerCount();
+	bool SivPhoton::isInRoom() const noexcept
+	{
+		return m_snapshot.isInRoom;
 	}
 
-	int32 SivPhoton::getMaxPlayersInCurrentRoom() const
+	const String& SivPhoton::getCurrentRoomName() const noexcept
 	{
-		if (not m_client->getIsInGameRoom())
-		{
-			return 0;
-		}
+		return m_snapshot.roomName;
+	}
+
+	int32 SivPhoton::getPlayerCountInCurrentRoom() const noexcept
+	{
+		return m_snapshot.playerCount;
+	}
 
-		return m_client->getCurrentlyJoinedRoom().getMaxPlayers();
+	int32 SivPhoton::getMaxPlayersInCurrentRoom() const noexcept
+	{
+		return m_snapshot.maxPlayers;
 	}
 
-	bool SivPhoton::getIsOpenInCurrentRoom() const
+	bool SivPhoton::getIsOpenInCurrentRoom() const noexcept
 	{
-		return m_client->getCurrentlyJoinedRoom().getIsOpen();
+		return m_snapshot.isOpen;
 	}
 
-	bool SivPhoton::getIsVisibleInCurrentRoom() const
+	bool SivPhoton::getIsVisibleInCurrentRoom() const noexcept
 	{
-		return m_client->getCurrentlyJoinedRoom().getIsVisible();
+		return m_snapshot.isVisible;
 	}
 
 	void SivPhoton::setIsOpenInCurrentRoom(const bool isOpen)
 	{
-		m_client->getCurrentlyJoinedRoom().setIsOpen(isOpen);
+		if (m_transport)
+		{
+			m_transport->setIsOpenInCurrentRoom(isOpen);
+		}
+		else
+		{
+			m_client->getCurrentlyJoinedRoom().setIsOpen(isOpen);
+		}
+
+		refreshSnapshot();
 	}
 
 	void SivPhoton::setIsVisibleInCurrentRoom(const bool isVisible)
 	{
-		m_client->getCurrentlyJoinedRoom().setIsVisible(isVisible);
+		if (m_transport)
+		{
+			m_transport->setIsVisibleInCurrentRoom(isVisible);
+		}
+		else
+		{
+			m_client->getCurrentlyJoinedRoom().setIsVisible(isVisible);
+		}
+
+		refreshSnapshot();
 	}
 
 	int32 SivPhoton::getCountGamesRunning() const
 	{
+		if (m_transport)
+		{
+			return m_transport->getCountGamesRunning();
+		}
+
 		return m_client->getCountGamesRunning();
 	}
 
 	int32 SivPhoton::getCountPlayersIngame() const
 	{
+		if (m_transport)
+		{
+			return m_transport->getCountPlayersIngame();
+		}
+
 		return m_client->getCountPlayersIngame();
 	}
 
 	int32 SivPhoton::getCountPlayersOnline() const
 	{
+		if (m_transport)
+		{
+			return m_transport->getCountPlayersOnline();
+		}
+
 		return m_client->getCountPlayersOnline();
 	}
 
-	Optional<int32> SivPhoton::localPlayerID() const
+	Optional<int32> SivPhoton::localPlayerID() const noexcept
+	{
+		return m_snapshot.localPlayerID;
+	}
+
+	bool SivPhoton::isMasterClient() const noexcept
+	{
+		return m_snapshot.isMasterClient;
+	}
+
+	Optional<int32> SivPhoton::getMasterClientID() const noexcept
+	{
+		return m_snapshot.masterClientID;
+	}
+
+	int32 SivPhoton::getServerTimeMillisec() const
+	{
+		if (m_transport)
+		{
+			return m_transport->getServerTimeMillisec();
+		}
+
+		return m_client->getServerTime();
+	}
+
+	int32 SivPhoton::getRoundTripTimeMillisec() const
+	{
+		if (m_transport)
+		{
+			return m_transport->getRoundTripTimeMillisec();
+		}
+
+		return m_client->getRoundTripTime();
+	}
+
+	NetworkStatistics::ConnectionStats SivPhoton::getConnectionStats() const
+	{
+		if (m_transport)
+		{
+			return m_transport->getConnectionStats();
+		}
+
+		NetworkStatistics::ConnectionStats stats;
+		stats.roundTripTimeMillisec = m_client->getRoundTripTime();
+		stats.roundTripTimeVarianceMillisec = m_client->getRoundTripTimeVariance();
+		stats.queuedIncoming = static_cast<size_t>(m_client->getQueuedIncomingCommands());
+		stats.queuedOutgoing = static_cast<size_t>(m_client->getQueuedOutgoingCommands());
+		stats.resent = static_cast<uint64>(m_client->getResentReliableCommands());
+		stats.lost = static_cast<uint64>(m_client->getPacketLossByCRC());
+		return stats;
+	}
+
+	const NetworkStatistics& SivPhoton::getStatistics() const noexcept
+	{
+		return m_statistics;
+	}
+
+	void SivPhoton::resetStatistics()
+	{
+		m_statistics.reset();
+	}
+
+	bool SivPhoton::startCapture(const FilePathView path)
 	{
-		const int32 localPlayerID = m_client->getLocalPlayer().getNumber();
+		stopCapture();
+
+		auto capture = std::make_unique<NetworkCaptureWriter>(path);
+
+		if (not capture->isOpen())
+		{
+			return false;
+		}
 
-		if (localPlayerID < 0)
+		m_capture = std::move(capture);
+		return true;
+	}
+
+	void SivPhoton::stopCapture()
+	{
+		if (m_capture)
 		{
-			return none;
+			m_capture->flush();
+			m_capture.reset();
 		}
+	}
 
-		return localPlayerID;
+	bool SivPhoton::isCapturing() const noexcept
+	{
+		return static_cast<bool>(m_capture);
 	}
 
-	bool SivPhoton::isMasterClient() const
+	void SivPhoton::dispatchEvent(const int32 playerID, const uint8 eventCode, const Blob& eventContent, const NetworkSystem::EventFormat format)
 	{
-		return m_client->getLocalPlayer().getIsMasterClient();
+		// Photon 経由で受信したときと同じ順序で処理する
+		if (format == NetworkSystem::EventFormat::PhotonSerialized)
+		{
+			ExitGames::Common::Deserializer deserializer{ reinterpret_cast<const nByte*>(eventContent.data()), static_cast<int>(eventContent.size()) };
+			ExitGames::Common::Object object;
+
+			if (deserializer.pop(object))
+			{
+				static_cast<SivPhotonDetail&>(*m_listener).dispatchEvent(playerID, eventCode, object);
+			}
+
+			return;
+		}
+
+		if (auto it = m_eventHandlers.find(eventCode); it != m_eventHandlers.end())
+		{
+			const NetworkTrace::Span span{ "SivPhoton::eventHandler", eventCode };
+			it->second(playerID, eventContent);
+			return;
+		}
+
+		const NetworkTrace::Span span{ "SivPhoton::customEventAction", eventCode };
+		customEventAction(playerID, eventCode, eventContent);
 	}
 
 	bool SivPhoton::isUsePhoton() const noexcept
@@ -1961,652 +2847,772 @@ namespace s3d
 
 	void SivPhoton::connectionErrorReturn(const int32 errorCode)
 	{
-		Print << U"SivPhoton::connectionErrorReturn() [サーバへの接続が失敗したときに呼ばれる]";
-		Print << U"errorCode: " << errorCode;
+		detail::Logger << U"SivPhoton::connectionErrorReturn() [サーバへの接続が失敗したときに呼ばれる]";
+		detail::Logger << U"errorCode: " << errorCode;
 	}
 
 	void SivPhoton::connectReturn(const int32 errorCode, const String& errorString, const String& region, const String& cluster)
 	{
-		Print << U"SivPhoton::connectReturn()";
-		Print << U"error: " << errorString;
-		Print << U"region: " << region;
-		Print << U"cluster: " << cluster;
+		detail::Logger << U"SivPhoton::connectReturn()";
+		detail::Logger << U"error: " << errorString;
+		detail::Logger << U"region: " << region;
+		detail::Logger << U"cluster: " << cluster;
 	}
 
 	void SivPhoton::disconnectReturn()
 	{
-		Print << U"SivPhoton::disconnectReturn() [サーバから切断されたときに呼ばれる]";
+		detail::Logger << U"SivPhoton::disconnectReturn() [サーバから切断されたときに呼ばれる]";
+	}
+
+	void SivPhoton::roomListUpdate(const Array<String>& roomNameList)
+	{
+		detail::Logger << U"SivPhoton::roomListUpdate() [ルームの一覧が変更されたときに呼ばれる]";
+		detail::Logger << U"roomNameList: " << roomNameList.size() << U" rooms";
+	}
+
+	void SivPhoton::snapshotUpdate(const NetworkSystem::SessionSnapshot& current, const NetworkSystem::SessionSnapshot&)
+	{
+		detail::Logger << U"SivPhoton::snapshotUpdate() [自分とルームの状態が変更されたときに呼ばれる]";
+		detail::Logger << U"roomName: " << current.roomName << U", playerCount: " << current.playerCount << U", isMasterClient: " << current.isMasterClient;
 	}
 
 	void SivPhoton::leaveRoomReturn(const int32 errorCode, const String& errorString)
 	{
-		Print << U"SivPhoton::leaveRoomReturn() [ルームから退室した結果を処理する]";
-		Print << U"- errorCode:" << errorCode;
-		Print << U"- errorString:" << errorString;
+		detail::Logger << U"SivPhoton::leaveRoomReturn() [ルームから退室した結果を処理する]";
+		detail::Logger << U"- errorCode:" << errorCode;
+		detail::Logger << U"- errorString:" << errorString;
 	}
 
 	void SivPhoton::joinRandomRoomReturn(const int32 localPlayerID, const int32 errorCode, const String& errorString)
 	{
-		Print << U"SivPhoton::joinRandomRoomReturn()";
-		Print << U"localPlayerID:" << localPlayerID;
-		Print << U"errorCode:" << errorCode;
-		Print << U"errorString:" << errorString;
+		detail::Logger << U"SivPhoton::joinRandomRoomReturn()";
+		detail::Logger << U"localPlayerID:" << localPlayerID;
+		detail::Logger << U"errorCode:" << errorCode;
+		detail::Logger << U"errorString:" << errorString;
 	}
 
 	void SivPhoton::joinRoomReturn(const int32 localPlayerID, const int32 errorCode, const String& errorString)
 	{
-		Print << U"SivPhoton::joinRoomReturn()";
-		Print << U"localPlayerID:" << localPlayerID;
-		Print << U"errorCode:" << errorCode;
-		Print << U"errorString:" << errorString;
+		detail::Logger << U"SivPhoton::joinRoomReturn()";
+		detail::Logger << U"localPlayerID:" << localPlayerID;
+		detail::Logger << U"errorCode:" << errorCode;
+		detail::Logger << U"errorString:" << errorString;
 	}
 
 	void SivPhoton::joinRoomEventAction(const int32 localPlayerID, const Array<int32>& playerIDs, const bool isSelf)
 	{
-		Print << U"SivPhoton::joinRoomEventAction() [自分を含め、プレイヤーが参加したら呼ばれる]";
-		Print << U"localPlayerID [参加した人の ID]:" << localPlayerID;
-		Print << U"playerIDs: [ルームの参加者一覧]" << playerIDs;
-		Print << U"isSelf [自分自身の参加？]:" << isSelf;
+		detail::Logger << U"SivPhoton::joinRoomEventAction() [自分を含め、プレイヤーが参加したら呼ばれる]";
+		detail::Logger << U"localPlayerID [参加した人の ID]:" << localPlayerID;
+		detail::Logger << U"playerIDs: [ルームの参加者一覧]" << playerIDs;
+		detail::Logger << U"isSelf [自分自身の参加？]:" << isSelf;
 	}
 
 	void SivPhoton::leaveRoomEventAction(const int32 playerID, const bool isInactive)
 	{
-		Print << U"SivPhoton::leaveRoomEventAction()";
-		Print << U"playerID: " << playerID;
-		Print << U"isInactive: " << isInactive;
+		detail::Logger << U"SivPhoton::leaveRoomEventAction()";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"isInactive: " << isInactive;
 
-		if (m_client->getLocalPlayer().getIsMasterClient())
+		if (isMasterClient())
 		{
-			Print << U"I am now the master client";
+			detail::Logger << U"I am now the master client";
 		}
 		else
 		{
-			Print << U"I am still not the master client";
+			detail::Logger << U"I am still not the master client";
 		}
 	}
 
 	void SivPhoton::createRoomReturn(const int32 localPlayerID, const int32 errorCode, const String& errorString)
 	{
-		Print << U"SivPhoton::createRoomReturn() [ルームを新規作成した結果を処理する]";
-		Print << U"- localPlayerID:" << localPlayerID;
-		Print << U"- errorCode:" << errorCode;
-		Print << U"- errorString:" << errorString;
+		detail::Logger << U"SivPhoton::createRoomReturn() [ルームを新規作成した結果を処理する]";
+		detail::Logger << U"- localPlayerID:" << localPlayerID;
+		detail::Logger << U"- errorCode:" << errorCode;
+		detail::Logger << U"- errorString:" << errorString;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const int32 eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(int32)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(int32)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const double eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(double)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(double)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const float eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(float)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(float)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const bool eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(bool)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(bool)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const String& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(String)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(String)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Array<int32>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Array<int32>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Array<int32>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Array<double>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Array<double>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Array<double>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Array<float>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Array<float>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Array<float>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Array<bool>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Array<bool>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Array<bool>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Array<String>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Array<String>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Array<String>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Grid<int32>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Grid<int32>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Grid<int32>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Grid<double>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Grid<double>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Grid<double>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Grid<float>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Grid<float>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Grid<float>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Grid<bool>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Grid<bool>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Grid<bool>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Grid<String>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Grid<String>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Grid<String>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Point& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Point)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Point)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Vec2& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Vec2)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Vec2)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Rect& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Rect)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Rect)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Circle& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Circle)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Circle)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const ColorF& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(ColorF)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(ColorF)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Color& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Color)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Color)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const HSV& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(HSV)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(HSV)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Line& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Line)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Line)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Triangle& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(v)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(v)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const RectF& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(RectF)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(RectF)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Quad& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Quad)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Quad)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Ellipse& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Ellipse)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Ellipse)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const RoundRect& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(RoundRect)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(RoundRect)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Vec3& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Vec3)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Vec3)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Vec4& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Vec4)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Vec4)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Float2& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Float2)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Float2)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Mat3x2& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Mat3x2)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Mat3x2)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Float3& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Float3)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Float3)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Float4& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Float4)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Float4)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Array<Point>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Array<Point>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Array<Point>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Array<Vec2>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Array<Vec2>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Array<Vec2>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Array<Rect>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Array<Rect>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Array<Rect>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Array<Circle>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Array<Circle>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Array<Circle>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Array<ColorF>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Array<ColorF>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Array<ColorF>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Array<Color>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Array<Color>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Array<Color>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Array<HSV>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Array<HSV>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Array<HSV>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Array<Line>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Array<Line>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Array<Line>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Array<Triangle>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Array<Triangle>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Array<Triangle>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Array<RectF>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Array<RectF>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Array<RectF>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Array<Quad>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Array<Quad>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Array<Quad>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Array<Ellipse>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Array<Ellipse>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Array<Ellipse>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Array<RoundRect>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Array<RoundRect>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Array<RoundRect>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Array<Vec3>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Array<Vec3>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Array<Vec3>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Array<Vec4>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Array<Vec4>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Array<Vec4>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Array<Float2>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Array<Float2>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Array<Float2>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Array<Mat3x2>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Array<Mat3x2>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Array<Mat3x2>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Array<Float3>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Array<Float3>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Array<Float3>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Array<Float4>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Array<Float4>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Array<Float4>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Grid<Point>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Grid<Point>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Grid<Point>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Grid<Vec2>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Grid<Vec2>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Grid<Vec2>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Grid<Rect>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Grid<Rect>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Grid<Rect>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Grid<Circle>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Grid<Circle>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Grid<Circle>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Grid<ColorF>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Grid<ColorF>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Grid<ColorF>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Grid<Color>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Grid<Color>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Grid<Color>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Grid<HSV>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Grid<HSV>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Grid<HSV>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Grid<Line>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Grid<Line>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Grid<Line>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Grid<Triangle>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Grid<Triangle>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Grid<Triangle>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Grid<RectF>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Grid<RectF>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Grid<RectF>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Grid<Quad>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Grid<Quad>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Grid<Quad>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Grid<Ellipse>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Grid<Ellipse>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Grid<Ellipse>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Grid<RoundRect>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Grid<RoundRect>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Grid<RoundRect>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Grid<Vec3>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Grid<Vec3>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Grid<Vec3>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Grid<Vec4>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Grid<Vec4>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Grid<Vec4>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Grid<Float2>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Grid<Float2>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Grid<Float2>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Grid<Mat3x2>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Grid<Mat3x2>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Grid<Mat3x2>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Grid<Float3>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Grid<Float3>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Grid<Float3>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
 	}
 
 	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Grid<Float4>& eventContent)
 	{
-		Print << U"SivPhoton::customEventAction(Grid<Float4>)";
-		Print << U"playerID: " << playerID;
-		Print << U"eventCode: " << eventCode;
-		Print << U"eventContent: " << eventContent;
+		detail::Logger << U"SivPhoton::customEventAction(Grid<Float4>)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent;
+	}
+
+	void SivPhoton::customEventAction(const int32 playerID, const int32 eventCode, const Blob& eventContent)
+	{
+		detail::Logger << U"SivPhoton::customEventAction(Blob)";
+		detail::Logger << U"playerID: " << playerID;
+		detail::Logger << U"eventCode: " << eventCode;
+		detail::Logger << U"eventContent: " << eventContent.size() << U" bytes";
+	}
+
+	void SivPhoton::refreshRoomList()
+	{
+		Array<NetworkSystem::RoomInfo> roomList;
+
+		if (m_transport)
+		{
+			roomList = m_transport->getRoomList();
+		}
+		else
+		{
+			const auto& roomListJ = m_client->getRoomList();
+			roomList.reserve(roomListJ.getSize());
+
+			for (uint32 i = 0; i < roomListJ.getSize(); ++i)
+			{
+				roomList << detail::ToRoomInfo(*roomListJ[i]);
+			}
+		}
+
+		if (roomList == m_roomList)
+		{
+			return;
+		}
+
+		m_roomList = std::move(roomList);
+		m_roomNameList = m_roomList.map([](const NetworkSystem::RoomInfo& room) { return room.name; });
+		++m_roomListGeneration;
+
+		const NetworkTrace::Span span{ "SivPhoton::roomListUpdate" };
+		roomListUpdate(m_roomNameList);
+	}
+
+	NetworkSystem::SessionSnapshot SivPhoton::readSnapshot() const
+	{
+		NetworkSystem::SessionSnapshot snapshot;
+
+		if (m_transport)
+		{
+			snapshot.userName = m_transport->getName();
+			snapshot.userID = m_transport->getUserID();
+			snapshot.isInRoom = m_transport->isInRoom();
+			snapshot.localPlayerID = m_transport->localPlayerID();
+
+			if (snapshot.isInRoom)
+			{
+				snapshot.roomName = m_transport->getCurrentRoomName();
+				snapshot.playerCount = m_transport->getPlayerCountInCurrentRoom();
+				snapshot.maxPlayers = m_transport->getMaxPlayersInCurrentRoom();
+				snapshot.isOpen = m_transport->getIsOpenInCurrentRoom();
+				snapshot.isVisible = m_transport->getIsVisibleInCurrentRoom();
+				snapshot.masterClientID = m_transport->getMasterClientID();
+			}
+
+			snapshot.isMasterClient = (snapshot.localPlayerID && (snapshot.localPlayerID == snapshot.masterClientID));
+			return snapshot;
+		}
+
+		const ExitGames::LoadBalancing::Player& localPlayer = m_client->getLocalPlayer();
+		snapshot.userName = detail::ToString(localPlayer.getName());
+		snapshot.userID = detail::ToString(localPlayer.getUserID());
+		snapshot.isInRoom = m_client->getIsInGameRoom();
+		snapshot.isMasterClient = localPlayer.getIsMasterClient();
+
+		if (const int32 localPlayerID = localPlayer.getNumber(); 0 <= localPlayerID)
+		{
+			snapshot.localPlayerID = localPlayerID;
+		}
+
+		if (snapshot.isInRoom)
+		{
+			const ExitGames::LoadBalancing::MutableRoom& room = m_client->getCurrentlyJoinedRoom();
+			snapshot.roomName = detail::ToString(room.getName());
+			snapshot.playerCount = room.getPlayerCount();
+			snapshot.maxPlayers = room.getMaxPlayers();
+			snapshot.isOpen = room.getIsOpen();
+			snapshot.isVisible = room.getIsVisible();
+			snapshot.masterClientID = room.getMasterClientID();
+		}
+
+		return snapshot;
+	}
+
+	void SivPhoton::refreshSnapshot()
+	{
+		m_snapshotDirty = false;
+
+		NetworkSystem::SessionSnapshot snapshot = readSnapshot();
+
+		if (snapshot == m_snapshot)
+		{
+			return;
+		}
+
+		const NetworkSystem::SessionSnapshot previous = std::exchange(m_snapshot, std::move(snapshot));
+		++m_snapshotGeneration;
+
+		const NetworkTrace::Span span{ "SivPhoton::snapshotUpdate" };
+		snapshotUpdate(m_snapshot, previous);
 	}
 
 	ExitGames::LoadBalancing::Client& SivPhoton::getClient()
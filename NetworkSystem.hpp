@@ -1,6 +1,8 @@
 ﻿
 # pragma once
+# include <variant>
 # include <Siv3D.hpp>
+# include "NetworkStatistics.hpp"
 
 // Photono SDK クラスの前方宣言
 namespace ExitGames
@@ -25,9 +27,200 @@ namespace s3d
 			return String{ encryptedPhotonAppID };
 		}
 
+		inline constexpr int32 GameIdAlreadyExists = (0x7FFF - 1);
+
+		inline constexpr int32 GameFull = (0x7FFF - 2);
+
+		inline constexpr int32 GameClosed = (0x7FFF - 3);
+
 		inline constexpr int32 NoRandomMatchFound = (0x7FFF - 7);
+
+		inline constexpr int32 GameDoesNotExist = (0x7FFF - 9);
+
+		/// @brief イベントの送信先のグループ
+		enum class ReceiverGroup : uint8
+		{
+			/// @brief 自分以外のルーム内のプレイヤー全員
+			Others,
+
+			/// @brief 自分を含むルーム内のプレイヤー全員
+			All,
+
+			/// @brief マスタークライアントのみ
+			MasterClient,
+		};
+
+		/// @brief イベントの送信オプション
+		struct EventOption
+		{
+			/// @brief 確実に届ける (再送する) 場合 true, それ以外の場合は false
+			bool reliable = true;
+
+			/// @brief 送信先のグループ
+			ReceiverGroup receiverGroup = ReceiverGroup::Others;
+
+			/// @brief 送信先のプレイヤー ID の一覧
+			/// @remark 空でない場合は receiverGroup よりも優先されます。
+			Array<int32> targetPlayers;
+
+			/// @brief 送信先のインタレストグループ
+			/// @remark 0 以外の場合は、そのグループを受信しているプレイヤーにのみ送信されます。
+			uint8 interestGroup = 0;
+		};
+
+		/// @brief 送受信するイベントの内容の形式
+		enum class EventFormat : uint8
+		{
+			/// @brief opRaiseEvent(Blob) で送られたバイト列
+			Blob,
+
+			/// @brief Blob 以外の型の opRaiseEvent() で送られた、Photon の直列化によるバイト列
+			PhotonSerialized,
+		};
+
+		/// @brief ロビーに公開するルームのプロパティの値
+		using RoomPropertyValue = std::variant<int32, double, bool, String>;
+
+		/// @brief ロビーから見えるルームの情報
+		struct RoomInfo
+		{
+			/// @brief ルーム名
+			String name;
+
+			/// @brief ルーム内のプレイヤーの数
+			int32 playerCount = 0;
+
+			/// @brief ルームの最大人数 (0 の場合は制限なし)
+			int32 maxPlayers = 0;
+
+			/// @brief 入室できる場合 true, それ以外の場合は false
+			bool isOpen = true;
+
+			/// @brief ロビーに表示される場合 true, それ以外の場合は false
+			bool isVisible = true;
+
+			/// @brief ロビーに公開されたプロパティ
+			HashTable<String, RoomPropertyValue> properties;
+
+			/// @brief ルームが満員であるかを返します。
+			/// @return 満員である場合 true, それ以外の場合は false
+			[[nodiscard]]
+			bool isFull() const noexcept
+			{
+				return ((0 < maxPlayers) && (maxPlayers <= playerCount));
+			}
+
+			[[nodiscard]]
+			bool operator ==(const RoomInfo& other) const = default;
+		};
+
+		/// @brief ルームの一覧の絞り込み・並べ替え・ページ分割の条件
+		struct RoomQuery
+		{
+			/// @brief 満員のルームを除く場合 true, それ以外の場合は false
+			bool excludeFull = false;
+
+			/// @brief 入室できないルームを除く場合 true, それ以外の場合は false
+			bool excludeClosed = false;
+
+			/// @brief ルームを残す場合に true を返す関数, 空の場合はすべて残す
+			std::function<bool(const RoomInfo&)> filter;
+
+			/// @brief a を b より前に並べる場合に true を返す関数, 空の場合は元の順序
+			std::function<bool(const RoomInfo& a, const RoomInfo& b)> sortBy;
+
+			/// @brief 返すページの番号 (0 から始まる)
+			size_t page = 0;
+
+			/// @brief 1 ページあたりのルームの数, 0 の場合はすべてを 1 ページとする
+			size_t pageSize = 0;
+		};
+
+		/// @brief ルームの一覧を絞り込んだ結果の 1 ページ
+		struct RoomPage
+		{
+			/// @brief ページに含まれるルーム
+			Array<RoomInfo> rooms;
+
+			/// @brief 絞り込んだ後のルームの総数
+			size_t totalCount = 0;
+
+			/// @brief ページの数
+			size_t numPages = 0;
+		};
+
+		/// @brief ルームの一覧を絞り込み、並べ替え、1 ページ分を返します。
+		/// @param rooms ルームの一覧
+		/// @param query 条件
+		/// @return 指定したページ
+		/// @remark 並べ替えは指定したページの末尾までの部分ソートで行い、返すルームのみをコピーします。
+		[[nodiscard]]
+		RoomPage QueryRooms(const Array<RoomInfo>& rooms, const RoomQuery& query);
+
+		/// @brief 自分と、参加しているルームの状態
+		struct SessionSnapshot
+		{
+			/// @brief サーバに接続したときのユーザ名
+			String userName;
+
+			/// @brief サーバに接続したときのユーザ ID
+			String userID;
+
+			/// @brief ルームに参加している場合 true, それ以外の場合は false
+			bool isInRoom = false;
+
+			/// @brief 現在のルーム名
+			String roomName;
+
+			/// @brief 現在のルームに存在するプレイヤーの人数
+			int32 playerCount = 0;
+
+			/// @brief 現在のルームの最大人数
+			int32 maxPlayers = 0;
+
+			/// @brief 現在のルームに新たに他のプレイヤーが参加できる場合 true, それ以外の場合は false
+			bool isOpen = false;
+
+			/// @brief 現在のルームがロビーから見える場合 true, それ以外の場合は false
+			bool isVisible = false;
+
+			/// @brief ルーム内での自分のプレイヤー ID
+			Optional<int32> localPlayerID;
+
+			/// @brief 現在のルームのマスタークライアントのプレイヤー ID
+			Optional<int32> masterClientID;
+
+			/// @brief 自分がマスタークライアントである場合 true, それ以外の場合は false
+			bool isMasterClient = false;
+
+			[[nodiscard]]
+			bool operator ==(const SessionSnapshot& other) const = default;
+		};
+
+		/// @brief SivPhoton のログの出力先を設定します。
+		/// @param sink 1 行分のログを受け取る関数, 空の場合は既定の出力先
+		/// @remark 既定の出力先は Print です。SIVPHOTON_HEADLESS が定義されている場合は標準エラー出力です。
+		void SetLogSink(std::function<void(StringView)> sink);
+
+		/// @brief SivPhoton のログを出力するかを設定します。
+		/// @param enabled 出力する場合 true, それ以外の場合は false
+		/// @remark 出力しない場合はメッセージの書式化も行われないため、多数のインスタンスを動かす際の負荷を減らせます。
+		void SetLogEnabled(bool enabled) noexcept;
+
+		/// @brief SivPhoton のログを出力するかを返します。
+		/// @return 出力する場合 true, それ以外の場合は false
+		[[nodiscard]]
+		bool IsLogEnabled() noexcept;
+
+		/// @brief SivPhoton のログを出力します。
+		/// @param message メッセージ
+		void Log(StringView message);
 	}
 
+	class NetworkTransport;
+
+	class NetworkCaptureWriter;
+
 	class SivPhoton
 	{
 	public:
@@ -38,6 +231,12 @@ namespace s3d
 		/// @remark アプリケーションバージョンが異なる SivPhoton とは通信できません。
 		SivPhoton(StringView secretPhotonAppID, StringView photonAppVersion);
 
+		/// @brief Photon の代わりにトランスポートを使う SivPhoton を作成します。
+		/// @param transport トランスポート
+		/// @remark ルームの操作と opRaiseEvent() はトランスポートを経由します。
+		/// Blob 以外の型は Photon の直列化でバイト列にしてから送信し、受信側で Photon と同じ customEventAction() に復元します。
+		explicit SivPhoton(std::unique_ptr<NetworkTransport> transport);
+
 		virtual ~SivPhoton();
 
 		/// @brief Photon サーバへの接続を試みます。
@@ -56,6 +255,15 @@ namespace s3d
 		/// @remark 最大 255, 無料の Photon アカウントの場合は 20
 		void opJoinRandomRoom(int32 maxPlayers);
 
+		/// @brief SQL ロビーから、条件に合うルームにランダムに入室を試みます。
+		/// @param maxPlayers ルームの最大人数, 0 の場合は問わない
+		/// @param sqlLobbyFilter SQL の WHERE 句と同じ形式の条件 (例: U"C0 = 1 AND C1 > 100")
+		/// @param sqlLobbyName SQL ロビーの名前
+		/// @remark 条件はサーバで評価されるため、ルームの一覧を取得する必要がありません。
+		/// 条件に使えるプロパティは、opCreateRoom() の lobbyProperties で指定した "C0" から "C9" です。
+		/// トランスポートを使う場合、条件は無視されます。
+		void opJoinRandomRoom(int32 maxPlayers, StringView sqlLobbyFilter, StringView sqlLobbyName);
+
 		/// @brief ルームに入室した際に呼び出されます。
 		/// @param roomName ルーム名
 		/// @param rejoin 退出した際にルームに再接続するか
@@ -67,9 +275,24 @@ namespace s3d
 		/// @remark 最大 255, 無料の Photon アカウントの場合は 20
 		void opCreateRoom(StringView roomName, int32 maxPlayers);
 
+		/// @brief ロビーに公開するプロパティを持つルームを作成します。
+		/// @param roomName ルーム名
+		/// @param maxPlayers ルームの最大人数
+		/// @param lobbyProperties ロビーに公開するプロパティ
+		/// @param sqlLobbyName SQL ロビーの名前, 空の場合は既定のロビー
+		/// @remark SQL ロビーで opJoinRandomRoom() の条件に使う場合、プロパティ名は "C0" から "C9" にしてください。
+		/// トランスポートを使う場合、プロパティとロビーの名前は無視されます。
+		void opCreateRoom(StringView roomName, int32 maxPlayers, const HashTable<String, NetworkSystem::RoomPropertyValue>& lobbyProperties, StringView sqlLobbyName = U"");
+
 		/// @brief ルームを退出した際に呼び出されます。
 		void opLeaveRoom();
 
+		/// @brief 受信するインタレストグループを変更します。
+		/// @param groupsToRemove 受信をやめるグループの一覧
+		/// @param groupsToAdd 受信を始めるグループの一覧
+		/// @remark グループ 0 はルーム全体を表すため指定できません。
+		void opChangeGroups(const Array<uint8>& groupsToRemove, const Array<uint8>& groupsToAdd);
+
 		/// @brief データの送信を行います。
 		/// @tparam T Siv3D系のクラス
 		/// @param eventCode イベントコード
@@ -152,51 +375,99 @@ namespace s3d
 		/// @param value 送信するデータ
 		void opRaiseEvent(uint8 eventCode, const Grid<String>& value);
 
+		/// @brief バイト列のデータの送信を行います。
+		/// @param eventCode イベントコード
+		/// @param value 送信するデータ
+		/// @param option 送信オプション
+		void opRaiseEvent(uint8 eventCode, const Blob& value, const NetworkSystem::EventOption& option = {});
+
+		/// @brief 指定したイベントコードのバイト列のデータを受信した際に呼び出される関数を登録します。
+		/// @param eventCode イベントコード
+		/// @param handler 呼び出される関数
+		/// @remark 登録された関数がある場合、そのイベントコードでは customEventAction(int32, int32, const Blob&) は呼ばれません。
+		void setEventHandler(uint8 eventCode, std::function<void(int32 playerID, const Blob& eventContent)> handler);
+
+		/// @brief setEventHandler() で登録した関数を解除します。
+		/// @param eventCode イベントコード
+		void removeEventHandler(uint8 eventCode);
+
 		/// @brief サーバに接続したときのユーザ名を返します。
 		/// @return ユーザ名
 		[[nodiscard]]
-		String getName() const;
+		const String& getName() const noexcept;
 
 		/// @brief サーバに接続したときのユーザ ID (ユーザ名 + タイムスタンプ）を返します。
 		/// @return ユーザ ID
 		[[nodiscard]]
-		String getUserID() const;
+		const String& getUserID() const noexcept;
 
 		/// @brief 存在するルーム名の一覧を返します。
 		/// @remark 自分でルームを作成してそれに参加すると表示されないっぽい (?)
+		/// 一覧は変更が通知された際にのみ作り直すため、毎フレーム呼んでもコピーや文字列の変換は行われません。
 		/// @return 存在するルーム名の一覧
 		[[nodiscard]]
-		Array<String> getRoomNameList() const;
+		const Array<String>& getRoomNameList() const noexcept;
+
+		/// @brief ロビーから見えるルームの情報の一覧を返します。
+		/// @return ルームの情報の一覧
+		/// @remark getRoomNameList() と同じく、変更が通知された際にのみ作り直します。
+		[[nodiscard]]
+		const Array<NetworkSystem::RoomInfo>& getRoomList() const noexcept;
+
+		/// @brief ルームの情報の一覧を絞り込み、並べ替え、1 ページ分を返します。
+		/// @param query 条件
+		/// @return 指定したページ
+		[[nodiscard]]
+		NetworkSystem::RoomPage findRooms(const NetworkSystem::RoomQuery& query) const;
+
+		/// @brief ルーム名の一覧が変更された回数を返します。
+		/// @return 変更された回数
+		/// @remark 前回の値と比べることで、一覧が変わったかを調べられます。ルームの人数やプロパティが変わった場合も増えます。
+		[[nodiscard]]
+		uint64 getRoomListGeneration() const noexcept;
+
+		/// @brief 自分と、参加しているルームの状態を返します。
+		/// @return 自分と、参加しているルームの状態
+		/// @remark 状態は接続・入退室・マスタークライアントの変更・ルームのプロパティの変更が通知された際にのみ読み直すため、毎フレーム呼んでも Photon の関数の呼び出しや文字列の変換は行われません。
+		/// トランスポートを使う場合は、update() ごとに 1 回読み直します。
+		/// getName() や isInRoom() などもこの状態を返します。
+		[[nodiscard]]
+		const NetworkSystem::SessionSnapshot& getSnapshot() const noexcept;
+
+		/// @brief 自分と、参加しているルームの状態が変更された回数を返します。
+		/// @return 変更された回数
+		[[nodiscard]]
+		uint64 getSnapshotGeneration() const noexcept;
 
 		/// @brief 自分がルームに参加しているかを返します。
 		/// @return ルームに参加している場合 true, それ以外の場合は false
 		[[nodiscard]]
-		bool isInRoom() const;
+		bool isInRoom() const noexcept;
 
 		/// @brief 現在のルーム名を返します。
 		/// @return 現在のルーム名
 		[[nodiscard]]
-		String getCurrentRoomName() const;
+		const String& getCurrentRoomName() const noexcept;
 
 		/// @brief 現在のルームに存在するプレイヤーの人数を返します。
 		/// @return プレイヤーの人数
 		[[nodiscard]]
-		int32 getPlayerCountInCurrentRoom() const;
+		int32 getPlayerCountInCurrentRoom() const noexcept;
 
 		/// @brief 現在のルームの最大人数を返します。
 		/// @return ルームの最大人数
 		[[nodiscard]]
-		int32 getMaxPlayersInCurrentRoom() const;
+		int32 getMaxPlayersInCurrentRoom() const noexcept;
 
 		/// @brief 現在のルームに新たに他のプレイヤーが参加できるかを返します。
 		/// @return ルームが開いている場合 true, それ以外の場合は false
 		[[nodiscard]]
-		bool getIsOpenInCurrentRoom() const;
+		bool getIsOpenInCurrentRoom() const noexcept;
 
 		/// @brief 現在のルームがロビーから見えるかを返します。
 		/// @return ルームが見えている場合 true, それ以外の場合は false
 		[[nodiscard]]
-		bool getIsVisibleInCurrentRoom() const;
+		bool getIsVisibleInCurrentRoom() const noexcept;
 
 		/// @brief  現在のルームに新たに他のプレイヤーが参加できるかを設定します。
 		/// @param isOpen 他のプレイヤーが参加できる場合 true, それ以外の場合は false
@@ -224,12 +495,64 @@ namespace s3d
 		/// @brief ルーム内でのプレイヤー ID を返します。
 		/// @return ルーム内でのプレイヤー ID, ルームに参加していない場合は none
 		[[nodiscard]]
-		Optional<int32> localPlayerID() const;
+		Optional<int32> localPlayerID() const noexcept;
 
 		/// @brief 自分がマスタークライアントであるかを返します。
 		/// @return マスタークライアントである場合 true, それ以外の場合は false
 		[[nodiscard]]
-		bool isMasterClient() const;
+		bool isMasterClient() const noexcept;
+
+		/// @brief 現在のルームのマスタークライアントのプレイヤー ID を返します。
+		/// @return マスタークライアントのプレイヤー ID, ルームに参加していない場合は none
+		[[nodiscard]]
+		Optional<int32> getMasterClientID() const noexcept;
+
+		/// @brief サーバの時刻を返します。
+		/// @return サーバの時刻 (ミリ秒)
+		/// @remark ルーム内の全員で共通の時刻です。int32 の範囲で一周するため、比較は差で行ってください。
+		[[nodiscard]]
+		int32 getServerTimeMillisec() const;
+
+		/// @brief サーバとの往復の通信時間を返します。
+		/// @return 往復の通信時間 (ミリ秒)
+		[[nodiscard]]
+		int32 getRoundTripTimeMillisec() const;
+
+		/// @brief 通信路の状態を返します。
+		/// @return 往復の遅延とそのばらつき, 送受信のキューの長さ, 再送と損失の累計
+		[[nodiscard]]
+		NetworkStatistics::ConnectionStats getConnectionStats() const;
+
+		/// @brief 送受信したイベントの統計を返します。
+		/// @return イベントコードごと・プレイヤーごとの統計
+		/// @remark 通信路の状態は update() のたびに記録されます。
+		[[nodiscard]]
+		const NetworkStatistics& getStatistics() const noexcept;
+
+		/// @brief 送受信したイベントの統計を消去します。
+		void resetStatistics();
+
+		/// @brief 送受信するイベントのキャプチャを開始します。
+		/// @param path キャプチャを書き込むファイルのパス
+		/// @return ファイルを作成できた場合 true, それ以外の場合は false
+		/// @remark すでにキャプチャしている場合は、そのファイルを閉じてから新しいファイルに書き込みます。ファイルの形式は NetworkCaptureWriter を参照してください。
+		bool startCapture(FilePathView path);
+
+		/// @brief キャプチャを終了し、ファイルを閉じます。
+		void stopCapture();
+
+		/// @brief キャプチャしているかを返します。
+		/// @return キャプチャしている場合 true, それ以外の場合は false
+		[[nodiscard]]
+		bool isCapturing() const noexcept;
+
+		/// @brief 直列化されたイベントの内容を復元し、受信したときと同じ customEventAction() またはイベントハンドラに渡します。
+		/// @param playerID 送信したプレイヤーの ID
+		/// @param eventCode イベントコード
+		/// @param eventContent 直列化された内容
+		/// @param format 内容の形式
+		/// @remark NetworkReplay がキャプチャを再生するために使います。統計とキャプチャには記録しません。
+		void dispatchEvent(int32 playerID, uint8 eventCode, const Blob& eventContent, NetworkSystem::EventFormat format);
 
 		/// @brief Photon SDKを使用しているかを返します。
 		/// @return  Photon SDKを使用している場合 true, それ以外の場合は false
@@ -284,6 +607,16 @@ namespace s3d
 		/// @param errorString エラー文字列
 		virtual void createRoomReturn(int32 localPlayerID, int32 errorCode, const String& errorString);
 
+		/// @brief ルームの一覧が変更された事を通知します。
+		/// @param roomNameList 変更後のルーム名の一覧
+		virtual void roomListUpdate(const Array<String>& roomNameList);
+
+		/// @brief 自分と、参加しているルームの状態が変更された事を通知します。
+		/// @param current 変更後の状態
+		/// @param previous 変更前の状態
+		/// @remark 入退室などのコールバックより前に呼ばれます。
+		virtual void snapshotUpdate(const NetworkSystem::SessionSnapshot& current, const NetworkSystem::SessionSnapshot& previous);
+
 		/// @brief データを受信した際に呼び出されます。
 		/// @param playerID 送信したプレイヤーのID
 		/// @param eventCode イベントコード
@@ -716,6 +1049,12 @@ namespace s3d
 		/// @param eventContent 受信したデータ
 		virtual void customEventAction(int32 playerID, int32 eventCode, const Grid<Mat3x2>& eventContent);
 
+		/// @brief バイト列のデータを受信した際に呼び出されます。
+		/// @param playerID 送信したプレイヤーのID
+		/// @param eventCode イベントコード
+		/// @param eventContent 受信したデータ
+		virtual void customEventAction(int32 playerID, int32 eventCode, const Blob& eventContent);
+
 	protected:
 
 		String m_defaultRoomName;
@@ -724,12 +1063,63 @@ namespace s3d
 
 		class SivPhotonDetail;
 
+		class SivPhotonTransportListener;
+
 		std::unique_ptr<ExitGames::LoadBalancing::Listener> m_listener;
 
 		std::unique_ptr<ExitGames::LoadBalancing::Client> m_client;
 
+		std::unique_ptr<SivPhotonTransportListener> m_transportListener;
+
+		std::unique_ptr<NetworkTransport> m_transport;
+
 		bool m_isUsePhoton = false;
 
+		HashTable<uint8, std::function<void(int32, const Blob&)>> m_eventHandlers;
+
+		NetworkStatistics m_statistics;
+
+		std::unique_ptr<NetworkCaptureWriter> m_capture;
+
+		Array<String> m_roomNameList;
+
+		Array<NetworkSystem::RoomInfo> m_roomList;
+
+		uint64 m_roomListGeneration = 0;
+
+		/// @brief 最後にルームの一覧を読み込んだときの NetworkTransport::getRoomListVersion()
+		Optional<uint64> m_transportRoomListVersion;
+
+		/// @brief 最後に状態を読み込んだときの NetworkTransport::getStateVersion()
+		Optional<uint64> m_transportStateVersion;
+
+		NetworkSystem::SessionSnapshot m_snapshot;
+
+		uint64 m_snapshotGeneration = 0;
+
+		/// @brief service() の中でコールバックが呼ばれ、service() の後に状態を読み直す必要がある場合 true
+		bool m_snapshotDirty = false;
+
+		/// @brief Blob 以外の型のイベントを送信します。
+		/// @tparam Type Photon で直列化できる型
+		/// @param reliable 確実に届ける (再送する) 場合 true, それ以外の場合は false
+		/// @param content 送信するデータ
+		/// @param eventCode イベントコード
+		/// @remark トランスポートを使う場合は Photon の直列化でバイト列にして NetworkTransport::raiseEvent() に渡します。
+		template <class Type>
+		void raisePhotonEvent(bool reliable, const Type& content, uint8 eventCode);
+
+		/// @brief Photon またはトランスポートからルームの一覧を読み直し、変更されていれば roomListUpdate() を呼びます。
+		void refreshRoomList();
+
+		/// @brief Photon またはトランスポートから、自分と参加しているルームの状態を読み込みます。
+		/// @return 自分と参加しているルームの状態
+		[[nodiscard]]
+		NetworkSystem::SessionSnapshot readSnapshot() const;
+
+		/// @brief 自分と参加しているルームの状態を読み直し、変更されていれば snapshotUpdate() を呼びます。
+		void refreshSnapshot();
+
 		/// @brief リスナーの参照を返します。
 		/// @return リスナーの参照
 		[[nodiscard]]
@@ -0,0 +1,288 @@
+﻿
+# include <chrono>
+# include <cstdio>
+# include <mutex>
+# include "NetworkTrace.hpp"
+
+namespace s3d
+{
+	namespace NetworkTrace::detail
+	{
+		/// @brief 1 つのバッファのチャンクに入る区間の数
+		inline constexpr size_t ChunkSize = 4096;
+
+		/// @brief 1 つのスレッドで記録する区間の最大数 (超えた分は捨てる)
+		inline constexpr size_t MaxEventsPerThread = (ChunkSize * 256);
+
+		struct Event
+		{
+			const char* name;
+
+			int32 arg;
+
+			int64 begin;
+
+			int64 end;
+		};
+
+		struct Chunk
+		{
+			std::array<Event, ChunkSize> events;
+
+			/// @brief 書き込みが完了した区間の数 (書き込むスレッドが release で更新する)
+			std::atomic<size_t> count{ 0 };
+
+			std::atomic<Chunk*> next{ nullptr };
+		};
+
+		/// @brief 1 つのスレッドが書き込むバッファ
+		/// @remark 書き込むのは所有するスレッドのみで、読み出す側は count と next を acquire で読むことで、完了した区間だけを参照します。
+		/// スレッドが終了しても、記録を書き出せるように消去されるまで残します。
+		struct ThreadBuffer
+		{
+			int32 threadID = 0;
+
+			std::unique_ptr<Chunk> head = std::make_unique<Chunk>();
+
+			/// @brief 書き込み中のチャンク (書き込むスレッドのみが使う)
+			Chunk* tail = head.get();
+
+			size_t numEvents = 0;
+
+			std::atomic<uint64> dropped{ 0 };
+
+			~ThreadBuffer()
+			{
+				// チャンクのリストを順に解放する
+				Chunk* chunk = head.release();
+
+				while (chunk)
+				{
+					Chunk* next = chunk->next.load(std::memory_order_relaxed);
+					delete chunk;
+					chunk = next;
+				}
+			}
+		};
+
+		/// @brief すべてのスレッドのバッファ
+		/// @remark スレッドの初回の記録時と、読み出し・消去の際にのみロックします。
+		struct Registry
+		{
+			std::mutex mutex;
+
+			Array<std::unique_ptr<ThreadBuffer>> buffers;
+
+			int32 nextThreadID = 1;
+
+			/// @brief Clear() のたびに増え、スレッドが古いバッファを参照していないかの判定に使う
+			std::atomic<uint64> generation{ 0 };
+		};
+
+		[[nodiscard]]
+		inline Registry& GetRegistry()
+		{
+			static Registry registry;
+			return registry;
+		}
+
+		inline std::chrono::steady_clock::time_point GetEpoch() noexcept
+		{
+			static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+			return epoch;
+		}
+
+		[[nodiscard]]
+		inline ThreadBuffer& GetThreadBuffer()
+		{
+			thread_local ThreadBuffer* buffer = nullptr;
+			thread_local uint64 generation = 0;
+
+			Registry& registry = GetRegistry();
+
+			if ((not buffer) || (generation != registry.generation.load(std::memory_order_acquire)))
+			{
+				std::lock_guard lock{ registry.mutex };
+
+				auto newBuffer = std::make_unique<ThreadBuffer>();
+				newBuffer->threadID = registry.nextThreadID++;
+				buffer = newBuffer.get();
+				generation = registry.generation.load(std::memory_order_relaxed);
+				registry.buffers.push_back(std::move(newBuffer));
+			}
+
+			return *buffer;
+		}
+
+		inline void AppendEscaped(std::string& out, const char* s)
+		{
+			for (; *s; ++s)
+			{
+				if ((*s == '"') || (*s == '\\'))
+				{
+					out += '\\';
+				}
+
+				out += *s;
+			}
+		}
+
+		inline void AppendMicrosec(std::string& out, const int64 nanosec)
+		{
+			char buffer[32];
+			const int length = std::snprintf(buffer, sizeof(buffer), "%.3f", (nanosec / 1000.0));
+			out.append(buffer, static_cast<size_t>(length));
+		}
+
+		[[nodiscard]]
+		inline std::string BuildJSON()
+		{
+			Registry& registry = GetRegistry();
+			std::lock_guard lock{ registry.mutex };
+
+			std::string json = R"({"displayTimeUnit":"ms","traceEvents":[)";
+			bool first = true;
+
+			for (const auto& buffer : registry.buffers)
+			{
+				if (not first)
+				{
+					json += ',';
+				}
+
+				first = false;
+				json += R"({"name":"thread_name","ph":"M","pid":1,"tid":)";
+				json += std::to_string(buffer->threadID);
+				json += R"(,"args":{"name":"thread )";
+				json += std::to_string(buffer->threadID);
+				json += R"("}})";
+
+				for (const Chunk* chunk = buffer->head.get(); chunk; chunk = chunk->next.load(std::memory_order_acquire))
+				{
+					const size_t count = chunk->count.load(std::memory_order_acquire);
+
+					for (size_t i = 0; i < count; ++i)
+					{
+						const Event& event = chunk->events[i];
+
+						json += R"(,{"name":")";
+						AppendEscaped(json, event.name);
+						json += R"(","cat":"network","ph":"X","pid":1,"tid":)";
+						json += std::to_string(buffer->threadID);
+						json += R"(,"ts":)";
+						AppendMicrosec(json, event.begin);
+						json += R"(,"dur":)";
+						AppendMicrosec(json, (event.end - event.begin));
+
+						if (0 <= event.arg)
+						{
+							json += R"(,"args":{"code":)";
+							json += std::to_string(event.arg);
+							json += '}';
+						}
+
+						json += '}';
+					}
+				}
+
+				if (const uint64 dropped = buffer->dropped.load(std::memory_order_relaxed))
+				{
+					json += R"(,{"name":"dropped","ph":"i","s":"t","pid":1,"tid":)";
+					json += std::to_string(buffer->threadID);
+					json += R"(,"ts":0,"args":{"count":)";
+					json += std::to_string(dropped);
+					json += "}}";
+				}
+			}
+
+			json += "]}";
+			return json;
+		}
+
+		int64 Now() noexcept
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - GetEpoch()).count();
+		}
+
+		void Record(const char* name, const int32 arg, const int64 beginNanosec, const int64 endNanosec)
+		{
+			ThreadBuffer& buffer = GetThreadBuffer();
+
+			if (MaxEventsPerThread <= buffer.numEvents)
+			{
+				buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+
+			Chunk* chunk = buffer.tail;
+			size_t index = chunk->count.load(std::memory_order_relaxed);
+
+			if (index == ChunkSize)
+			{
+				Chunk* next = new Chunk;
+				chunk->next.store(next, std::memory_order_release);
+				buffer.tail = chunk = next;
+				index = 0;
+			}
+
+			chunk->events[index] = Event{ name, arg, beginNanosec, endNanosec };
+			chunk->count.store((index + 1), std::memory_order_release);
+			++buffer.numEvents;
+		}
+	}
+
+	namespace NetworkTrace
+	{
+		void SetEnabled(const bool enabled) noexcept
+		{
+			// 最初の区間より前に基準の時刻を決めておく
+			detail::GetEpoch();
+			detail::Enabled.store(enabled, std::memory_order_relaxed);
+		}
+
+		void Clear()
+		{
+			detail::Registry& registry = detail::GetRegistry();
+			std::lock_guard lock{ registry.mutex };
+
+			registry.buffers.clear();
+			registry.generation.fetch_add(1, std::memory_order_release);
+		}
+
+		size_t GetNumEvents()
+		{
+			detail::Registry& registry = detail::GetRegistry();
+			std::lock_guard lock{ registry.mutex };
+
+			size_t numEvents = 0;
+
+			for (const auto& buffer : registry.buffers)
+			{
+				for (const detail::Chunk* chunk = buffer->head.get(); chunk; chunk = chunk->next.load(std::memory_order_acquire))
+				{
+					numEvents += chunk->count.load(std::memory_order_acquire);
+				}
+			}
+
+			return numEvents;
+		}
+
+		String ToJSON()
+		{
+			return Unicode::FromUTF8(detail::BuildJSON());
+		}
+
+		bool Save(const FilePathView path)
+		{
+			TextWriter writer{ path };
+
+			if (not writer)
+			{
+				return false;
+			}
+
+			writer.write(ToJSON());
+			return true;
+		}
+	}
+}
@@ -0,0 +1,95 @@
+﻿
+# pragma once
+# include <atomic>
+# include <Siv3D.hpp>
+
+namespace s3d
+{
+	/// @brief SivPhoton の通信処理の区間を記録し、Chrome のトレース形式 (JSON) で書き出す機能です。
+	/// @remark 書き出したファイルは chrome://tracing や Perfetto (ui.perfetto.dev) で開けます。
+	/// 区間はスレッドごとのバッファにロックを使わずに追加します。記録が無効な間は、区間 1 つあたり atomic な読み込み 1 回の負荷しかかかりません。
+	namespace NetworkTrace
+	{
+		namespace detail
+		{
+			inline std::atomic<bool> Enabled{ false };
+
+			/// @brief 記録の基準の時刻からの経過時間を返します。
+			/// @return 経過時間 (ナノ秒)
+			[[nodiscard]]
+			int64 Now() noexcept;
+
+			/// @brief 完了した区間を、呼び出したスレッドのバッファに追加します。
+			void Record(const char* name, int32 arg, int64 beginNanosec, int64 endNanosec);
+		}
+
+		/// @brief 区間を記録するかを設定します。
+		/// @param enabled 記録する場合 true, それ以外の場合は false
+		/// @remark 既定では記録しません。
+		void SetEnabled(bool enabled) noexcept;
+
+		/// @brief 区間を記録するかを返します。
+		/// @return 記録する場合 true, それ以外の場合は false
+		[[nodiscard]]
+		inline bool IsEnabled() noexcept
+		{
+			return detail::Enabled.load(std::memory_order_relaxed);
+		}
+
+		/// @brief 記録したすべての区間を消去します。
+		/// @remark 記録を無効にし、実行中の区間が無い状態で呼んでください。
+		void Clear();
+
+		/// @brief 記録した区間の数を返します。
+		/// @return 区間の数
+		[[nodiscard]]
+		size_t GetNumEvents();
+
+		/// @brief 記録した区間を Chrome のトレース形式の JSON にします。
+		/// @return JSON
+		/// @remark 記録中に呼んでも構いません。その時点までに完了した区間を含みます。
+		[[nodiscard]]
+		String ToJSON();
+
+		/// @brief 記録した区間を Chrome のトレース形式の JSON ファイルに保存します。
+		/// @param path 保存するファイルのパス
+		/// @return 保存に成功した場合 true, それ以外の場合は false
+		bool Save(FilePathView path);
+
+		/// @brief スコープの開始から終了までを 1 つの区間として記録するクラスです。
+		/// @remark 作成した時点で記録が無効な場合は何もしません。
+		class Span
+		{
+		public:
+
+			/// @brief 区間を開始します。
+			/// @param name 区間の名前 (文字列リテラルなど、記録を書き出すまで有効な文字列)
+			/// @param arg 区間に付ける値 (イベントコードなど), 負の場合は付けない
+			explicit Span(const char* name, const int32 arg = -1) noexcept
+				: m_name{ IsEnabled() ? name : nullptr }
+				, m_arg{ arg }
+				, m_begin{ m_name ? detail::Now() : 0 } {}
+
+			Span(const Span&) = delete;
+
+			Span& operator =(const Span&) = delete;
+
+			/// @brief 区間を終了し、記録します。
+			~Span()
+			{
+				if (m_name)
+				{
+					detail::Record(m_name, m_arg, m_begin, detail::Now());
+				}
+			}
+
+		private:
+
+			const char* m_name;
+
+			int32 m_arg;
+
+			int64 m_begin;
+		};
+	}
+}
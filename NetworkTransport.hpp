@@ -0,0 +1,192 @@
+﻿
+# pragma once
+# include <Siv3D.hpp>
+# include "NetworkSystem.hpp"
+
+namespace s3d
+{
+	/// @brief SivPhoton の通信を Photon 以外の経路で行うためのトランスポートのインタフェースです。
+	/// @remark SivPhoton はトランスポートを使って作成された場合、ルームの操作とバイト列のイベントの送受信をトランスポートに任せます。
+	/// トランスポートは受け取った結果を update() の中で Listener に通知します。
+	class NetworkTransport
+	{
+	public:
+
+		/// @brief イベントの内容の形式
+		using EventFormat = NetworkSystem::EventFormat;
+
+		/// @brief トランスポートからの通知を受け取るインタフェース
+		/// @remark 各関数は SivPhoton の同名のコールバックと同じ意味を持ちます。
+		class Listener
+		{
+		public:
+
+			virtual ~Listener() = default;
+
+			virtual void connectReturn(int32 errorCode, const String& errorString) = 0;
+
+			virtual void disconnectReturn() = 0;
+
+			virtual void joinRandomRoomReturn(int32 localPlayerID, int32 errorCode, const String& errorString) = 0;
+
+			virtual void joinRoomReturn(int32 localPlayerID, int32 errorCode, const String& errorString) = 0;
+
+			virtual void createRoomReturn(int32 localPlayerID, int32 errorCode, const String& errorString) = 0;
+
+			virtual void leaveRoomReturn(int32 errorCode, const String& errorString) = 0;
+
+			virtual void joinRoomEventAction(int32 playerID, const Array<int32>& playerIDs, bool isSelf) = 0;
+
+			virtual void leaveRoomEventAction(int32 playerID, bool isInactive) = 0;
+
+			/// @remark reliable は送信者が指定した NetworkSystem::EventOption::reliable, format は送信者が raiseEvent() に渡した形式です。
+			virtual void customEventAction(int32 playerID, uint8 eventCode, const Blob& eventContent, bool reliable, EventFormat format) = 0;
+		};
+
+		virtual ~NetworkTransport() = default;
+
+		/// @brief 通知の送り先を設定します。
+		/// @param listener 通知の送り先
+		void setListener(Listener* listener) noexcept
+		{
+			m_listener = listener;
+		}
+
+		/// @brief 接続を開始します。
+		/// @param userName ユーザ名
+		/// @return 接続を開始できた場合 true, それ以外の場合は false
+		virtual bool connect(StringView userName) = 0;
+
+		/// @brief 切断します。
+		virtual void disconnect() = 0;
+
+		/// @brief 受信した結果やイベントを Listener に通知します。
+		virtual void update() = 0;
+
+		virtual void joinRandomRoom(int32 maxPlayers) = 0;
+
+		virtual void joinRoom(StringView roomName) = 0;
+
+		virtual void createRoom(StringView roomName, int32 maxPlayers) = 0;
+
+		virtual void leaveRoom() = 0;
+
+		virtual void changeGroups(const Array<uint8>& groupsToRemove, const Array<uint8>& groupsToAdd) = 0;
+
+		/// @brief イベントを送信します。
+		/// @param eventCode イベントコード
+		/// @param eventContent イベントの内容
+		/// @param option 送信オプション
+		/// @param format イベントの内容の形式 (受信者にそのまま伝えます)
+		virtual void raiseEvent(uint8 eventCode, const Blob& eventContent, const NetworkSystem::EventOption& option, EventFormat format) = 0;
+
+		[[nodiscard]]
+		virtual String getName() const = 0;
+
+		[[nodiscard]]
+		virtual String getUserID() const = 0;
+
+		[[nodiscard]]
+		virtual Array<String> getRoomNameList() const = 0;
+
+		/// @brief ロビーから見えるルームの情報の一覧を返します。
+		/// @return ルームの情報の一覧
+		/// @remark 既定の実装はルーム名のみを設定します。
+		[[nodiscard]]
+		virtual Array<NetworkSystem::RoomInfo> getRoomList() const
+		{
+			Array<NetworkSystem::RoomInfo> rooms;
+
+			for (const auto& name : getRoomNameList())
+			{
+				NetworkSystem::RoomInfo room;
+				room.name = name;
+				rooms << std::move(room);
+			}
+
+			return rooms;
+		}
+
+		/// @brief ルームの一覧の版を返します。
+		/// @return ルームの一覧が変わるたびに変わる値, 版を管理しない場合は none
+		/// @remark SivPhoton は、値が前回と同じ場合は getRoomList() を呼びません。
+		/// 既定の実装は none を返し、SivPhoton は update() のたびに getRoomList() を呼んで比べます。
+		[[nodiscard]]
+		virtual Optional<uint64> getRoomListVersion() const
+		{
+			return none;
+		}
+
+		/// @brief 自分と参加しているルームの状態 (NetworkSystem::SessionSnapshot に含まれる値) の版を返します。
+		/// @return 状態が変わるたびに変わる値, 版を管理しない場合は none
+		/// @remark SivPhoton は、値が前回と同じ場合は update() で状態を読み直しません (Listener への通知の際には読み直します)。
+		/// 既定の実装は none を返し、SivPhoton は update() のたびに状態を読み直して比べます。
+		[[nodiscard]]
+		virtual Optional<uint64> getStateVersion() const
+		{
+			return none;
+		}
+
+		[[nodiscard]]
+		virtual bool isInRoom() const = 0;
+
+		[[nodiscard]]
+		virtual String getCurrentRoomName() const = 0;
+
+		[[nodiscard]]
+		virtual int32 getPlayerCountInCurrentRoom() const = 0;
+
+		[[nodiscard]]
+		virtual int32 getMaxPlayersInCurrentRoom() const = 0;
+
+		[[nodiscard]]
+		virtual bool getIsOpenInCurrentRoom() const = 0;
+
+		[[nodiscard]]
+		virtual bool getIsVisibleInCurrentRoom() const = 0;
+
+		virtual void setIsOpenInCurrentRoom(bool isOpen) = 0;
+
+		virtual void setIsVisibleInCurrentRoom(bool isVisible) = 0;
+
+		[[nodiscard]]
+		virtual int32 getCountGamesRunning() const = 0;
+
+		[[nodiscard]]
+		virtual int32 getCountPlayersIngame() const = 0;
+
+		[[nodiscard]]
+		virtual int32 getCountPlayersOnline() const = 0;
+
+		/// @brief ルーム内での自分のプレイヤー ID を返します。
+		/// @return 自分のプレイヤー ID, ルームに参加していない場合は none
+		[[nodiscard]]
+		virtual Optional<int32> localPlayerID() const = 0;
+
+		/// @brief ルームのマスタークライアントのプレイヤー ID を返します。
+		/// @return マスタークライアントのプレイヤー ID, ルームに参加していない場合は none
+		[[nodiscard]]
+		virtual Optional<int32> getMasterClientID() const = 0;
+
+		[[nodiscard]]
+		virtual int32 getServerTimeMillisec() const = 0;
+
+		[[nodiscard]]
+		virtual int32 getRoundTripTimeMillisec() const = 0;
+
+		/// @brief 通信路の状態を返します。
+		/// @return 通信路の状態
+		/// @remark 既定の実装は往復の遅延のみを設定します。
+		[[nodiscard]]
+		virtual NetworkStatistics::ConnectionStats getConnectionStats() const
+		{
+			NetworkStatistics::ConnectionStats stats;
+			stats.roundTripTimeMillisec = getRoundTripTimeMillisec();
+			return stats;
+		}
+
+	protected:
+
+		Listener* m_listener = nullptr;
+	};
+}
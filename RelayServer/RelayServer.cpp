@@ -0,0 +1,881 @@
+﻿
+# include <algorithm>
+# include <cerrno>
+# include <chrono>
+# include <csignal>
+# include <cstdio>
+# include <cstdlib>
+# include <memory>
+# include <string>
+# include <unordered_map>
+# include <utility>
+# include <vector>
+# include <arpa/inet.h>
+# include <fcntl.h>
+# include <netinet/in.h>
+# include <sys/epoll.h>
+# include <sys/socket.h>
+# include <unistd.h>
+# include "../NetworkRelayProtocol.hpp"
+
+// Photon クラウドの代わりに LAN 内で SivPhoton 同士を通信させる、ローカルのリレーサーバ (Linux, epoll)
+//
+// 使い方: RelayServer [ポート番号 (既定 5056)] [--stats]
+//
+// ルーム、プレイヤー ID の割り当て、マスタークライアントの選出、イベントの配信を Photon と同じ規則で行います。
+// クライアントは NetworkRelayTransport を使って接続します。Siv3D は使わないので、単体でビルドできます。
+// --stats を付けると、5 秒ごとに送受信の量を表示します (localhost でのスループットの計測に使えます)。
+
+namespace
+{
+	using namespace s3d::NetworkRelayProtocol;
+
+	using Datagram = std::vector<std::uint8_t>;
+
+	// Photon と同じエラーコード (NetworkSystem.hpp と同じ値)
+	constexpr std::int32_t GameIdAlreadyExists = (0x7FFF - 1);
+
+	constexpr std::int32_t GameFull = (0x7FFF - 2);
+
+	constexpr std::int32_t GameClosed = (0x7FFF - 3);
+
+	constexpr std::int32_t NoRandomMatchFound = (0x7FFF - 7);
+
+	constexpr std::int32_t GameDoesNotExist = (0x7FFF - 9);
+
+	/// @brief Pong に載せるルーム名の一覧の最大のバイト数
+	constexpr std::size_t MaxRoomListBytes = 1000;
+
+	/// @brief 統計を表示する間隔 (ミリ秒)
+	constexpr std::uint64_t StatsIntervalMillisec = 5000;
+
+	volatile std::sig_atomic_t Running = 1;
+
+	struct Client
+	{
+		sockaddr_in address{};
+
+		std::uint64_t sessionID = 0;
+
+		std::string userName;
+
+		std::string userID;
+
+		/// @brief 参加しているルームの名前 (参加していない場合は空)
+		std::string roomName;
+
+		std::int32_t playerID = -1;
+
+		std::vector<std::uint8_t> groups;
+
+		ReliableChannel channel;
+
+		std::uint64_t lastReceivedMillisec = 0;
+	};
+
+	struct Room
+	{
+		std::string name;
+
+		std::uint64_t serial = 0;
+
+		std::int32_t maxPlayers = 0;
+
+		bool isOpen = true;
+
+		bool isVisible = true;
+
+		std::int32_t nextPlayerID = 1;
+
+		std::int32_t masterClientID = 0;
+
+		/// @brief 参加した順のプレイヤー
+		std::vector<Client*> players;
+	};
+
+	struct Stats
+	{
+		std::uint64_t receivedDatagrams = 0;
+
+		std::uint64_t receivedBytes = 0;
+
+		std::uint64_t sentDatagrams = 0;
+
+		std::uint64_t sentBytes = 0;
+
+		std::uint64_t resent = 0;
+	};
+
+	[[nodiscard]]
+	std::uint64_t ToKey(const sockaddr_in& address) noexcept
+	{
+		return ((static_cast<std::uint64_t>(address.sin_addr.s_addr) << 16) | address.sin_port);
+	}
+
+	class RelayServer
+	{
+	public:
+
+		RelayServer() = default;
+
+		RelayServer(const RelayServer&) = delete;
+
+		RelayServer& operator =(const RelayServer&) = delete;
+
+		~RelayServer()
+		{
+			if (0 <= m_epoll)
+			{
+				::close(m_epoll);
+			}
+
+			if (0 <= m_socket)
+			{
+				::close(m_socket);
+			}
+		}
+
+		bool open(const std::uint16_t port)
+		{
+			m_socket = ::socket(AF_INET, (SOCK_DGRAM | SOCK_NONBLOCK), 0);
+
+			if (m_socket < 0)
+			{
+				std::perror("socket");
+				return false;
+			}
+
+			// 多数のクライアントからの一斉送信を取りこぼさないように、受信バッファを大きくする
+			const int bufferSize = (4 << 20);
+			::setsockopt(m_socket, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+			::setsockopt(m_socket, SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+
+			sockaddr_in address{};
+			address.sin_family = AF_INET;
+			address.sin_addr.s_addr = htonl(INADDR_ANY);
+			address.sin_port = htons(port);
+
+			if (::bind(m_socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0)
+			{
+				std::perror("bind");
+				return false;
+			}
+
+			m_epoll = ::epoll_create1(0);
+
+			if (m_epoll < 0)
+			{
+				std::perror("epoll_create1");
+				return false;
+			}
+
+			epoll_event event{};
+			event.events = EPOLLIN;
+			event.data.fd = m_socket;
+
+			if (::epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_socket, &event) < 0)
+			{
+				std::perror("epoll_ctl");
+				return false;
+			}
+
+			m_startTime = std::chrono::steady_clock::now();
+			return true;
+		}
+
+		void run(const bool printStats)
+		{
+			std::uint64_t lastStatsMillisec = now();
+			Stats lastStats;
+
+			while (Running)
+			{
+				// 再送とタイムアウトの確認のため、受信が無くても 10 ミリ秒ごとに起きる
+				epoll_event events[1];
+				const int n = ::epoll_wait(m_epoll, events, 1, 10);
+
+				if ((n < 0) && (errno != EINTR))
+				{
+					std::perror("epoll_wait");
+					break;
+				}
+
+				if (0 < n)
+				{
+					receiveAll();
+				}
+
+				tick();
+
+				if (printStats && ((lastStatsMillisec + StatsIntervalMillisec) <= now()))
+				{
+					const double seconds = ((now() - lastStatsMillisec) / 1000.0);
+					std::printf("clients=%zu rooms=%zu in=%.0f/s (%.1f kB/s) out=%.0f/s (%.1f kB/s) resent=%llu\n",
+						m_clients.size(), m_rooms.size(),
+						((m_stats.receivedDatagrams - lastStats.receivedDatagrams) / seconds), ((m_stats.receivedBytes - lastStats.receivedBytes) / seconds / 1000.0),
+						((m_stats.sentDatagrams - lastStats.sentDatagrams) / seconds), ((m_stats.sentBytes - lastStats.sentBytes) / seconds / 1000.0),
+						static_cast<unsigned long long>(m_stats.resent - lastStats.resent));
+					std::fflush(stdout);
+
+					lastStatsMillisec = now();
+					lastStats = m_stats;
+				}
+			}
+		}
+
+	private:
+
+		int m_socket = -1;
+
+		int m_epoll = -1;
+
+		std::chrono::steady_clock::time_point m_startTime;
+
+		std::unordered_map<std::uint64_t, std::unique_ptr<Client>> m_clients;
+
+		std::unordered_map<std::string, Room> m_rooms;
+
+		std::uint64_t m_userSerial = 0;
+
+		std::uint64_t m_roomSerial = 0;
+
+		Stats m_stats;
+
+		[[nodiscard]]
+		std::uint64_t now() const
+		{
+			return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_startTime).count());
+		}
+
+		void receiveAll()
+		{
+			static std::uint8_t buffer[65536];
+
+			for (;;)
+			{
+				sockaddr_in address{};
+				socklen_t addressLength = sizeof(address);
+				const ssize_t size = ::recvfrom(m_socket, buffer, sizeof(buffer), 0, reinterpret_cast<sockaddr*>(&address), &addressLength);
+
+				if (size < 0)
+				{
+					// EAGAIN (受信し終えた) またはエラー
+					return;
+				}
+
+				++m_stats.receivedDatagrams;
+				m_stats.receivedBytes += size;
+
+				handleDatagram(address, buffer, static_cast<std::size_t>(size));
+			}
+		}
+
+		void handleDatagram(const sockaddr_in& address, const std::uint8_t* data, const std::size_t size)
+		{
+			Reader reader{ data, size };
+			Header header;
+
+			if (not reader.readHeader(header))
+			{
+				return;
+			}
+
+			const std::uint64_t key = ToKey(address);
+			auto it = m_clients.find(key);
+
+			if (header.type == MessageType::Connect)
+			{
+				std::uint64_t sessionID = 0;
+				reader.read(sessionID);
+
+				// 同じアドレスからの新しい接続 (前回の切断が届かなかった場合など) は、古い接続を破棄してから受け付ける
+				if ((it != m_clients.end()) && (it->second->sessionID != sessionID))
+				{
+					removeClient(*it->second);
+					m_clients.erase(it);
+					it = m_clients.end();
+				}
+
+				if (it == m_clients.end())
+				{
+					auto client = std::make_unique<Client>();
+					client->address = address;
+					client->sessionID = sessionID;
+					it = m_clients.emplace(key, std::move(client)).first;
+				}
+			}
+
+			if (it == m_clients.end())
+			{
+				return;
+			}
+
+			Client& client = *it->second;
+			client.lastReceivedMillisec = now();
+
+			switch (header.channel)
+			{
+			case Channel::Ack:
+				client.channel.acknowledge(header.sequence);
+				return;
+			case Channel::Reliable:
+				// 受け取れないもの (先の番号すぎるもの) は確認を返さずに破棄し、再送させる
+				if (not client.channel.canReceive(header.sequence, size))
+				{
+					return;
+				}
+
+				sendTo(client, MakeAck(header.sequence));
+				client.channel.receive(header.sequence, data, size, [&](const std::uint8_t* message, const std::size_t messageSize)
+				{
+					Reader messageReader{ message, messageSize };
+					Header messageHeader;
+					messageReader.readHeader(messageHeader);
+					handleMessage(client, messageHeader.type, messageReader);
+				});
+				return;
+			default:
+				handleMessage(client, header.type, reader);
+				return;
+			}
+		}
+
+		void handleMessage(Client& client, const MessageType type, Reader& reader)
+		{
+			switch (type)
+			{
+			case MessageType::Connect:
+			{
+				std::uint64_t sessionID = 0;
+				reader.read(sessionID);
+				reader.readString(client.userName);
+				client.userID = (client.userName + std::to_string(++m_userSerial));
+
+				Writer writer{ Header{ MessageType::ConnectReturn, Channel::Reliable } };
+				writer.write(std::int32_t{ 0 });
+				writer.writeString(client.userID);
+				sendReliable(client, std::move(writer));
+				return;
+			}
+			case MessageType::Disconnect:
+			{
+				const std::uint64_t key = ToKey(client.address);
+				removeClient(client);
+				m_clients.erase(key);
+				return;
+			}
+			case MessageType::JoinRandomRoom:
+			{
+				std::uint8_t maxPlayers = 0;
+				reader.read(maxPlayers);
+				joinRandomRoom(client, maxPlayers);
+				return;
+			}
+			case MessageType::JoinRoom:
+			{
+				std::string roomName;
+				reader.readString(roomName);
+				joinRoom(client, roomName);
+				return;
+			}
+			case MessageType::CreateRoom:
+			{
+				std::string roomName;
+				std::uint8_t maxPlayers = 0;
+				reader.readString(roomName);
+				reader.read(maxPlayers);
+				createRoom(client, roomName, maxPlayers);
+				return;
+			}
+			case MessageType::LeaveRoom:
+			{
+				if (client.roomName.empty())
+				{
+					return;
+				}
+
+				exitRoom(client);
+
+				Writer writer{ Header{ MessageType::LeaveRoomReturn, Channel::Reliable } };
+				writer.write(std::int32_t{ 0 });
+				sendReliable(client, std::move(writer));
+				return;
+			}
+			case MessageType::ChangeGroups:
+			{
+				changeGroups(client, reader);
+				return;
+			}
+			case MessageType::RaiseEvent:
+			{
+				raiseEvent(client, reader);
+				return;
+			}
+			case MessageType::SetRoomFlag:
+			{
+				setRoomFlag(client, reader);
+				return;
+			}
+			case MessageType::Ping:
+			{
+				std::uint64_t clientTime = 0;
+				reader.read(clientTime);
+				sendPong(client, clientTime);
+				return;
+			}
+			default:
+				return;
+			}
+		}
+
+		void sendTo(const Client& client, const Datagram& datagram)
+		{
+			::sendto(m_socket, datagram.data(), datagram.size(), 0, reinterpret_cast<const sockaddr*>(&client.address), sizeof(client.address));
+
+			++m_stats.sentDatagrams;
+			m_stats.sentBytes += datagram.size();
+		}
+
+		void sendReliable(Client& client, Writer&& writer)
+		{
+			sendTo(client, client.channel.send(std::move(writer), now()));
+		}
+
+		[[nodiscard]]
+		Room* findRoom(const std::string& roomName)
+		{
+			if (auto it = m_rooms.find(roomName); it != m_rooms.end())
+			{
+				return &it->second;
+			}
+
+			return nullptr;
+		}
+
+		void sendJoinError(Client& client, const JoinKind kind, const std::int32_t errorCode, const std::string_view errorString)
+		{
+			Writer writer{ Header{ MessageType::JoinReturn, Channel::Reliable } };
+			writer.write(kind);
+			writer.write(std::int32_t{ -1 });
+			writer.write(errorCode);
+			writer.writeString(errorString);
+			sendReliable(client, std::move(writer));
+		}
+
+		void joinRandomRoom(Client& client, const std::int32_t maxPlayers)
+		{
+			if (not client.roomName.empty())
+			{
+				return;
+			}
+
+			// 条件を満たすルームのうち、最も早く作られたものを選ぶ
+			Room* found = nullptr;
+
+			for (auto& [name, room] : m_rooms)
+			{
+				if (room.isOpen && room.isVisible
+					&& (room.maxPlayers == maxPlayers)
+					&& (room.players.size() < static_cast<std::size_t>(room.maxPlayers))
+					&& ((not found) || (room.serial < found->serial)))
+				{
+					found = &room;
+				}
+			}
+
+			if (not found)
+			{
+				sendJoinError(client, JoinKind::JoinRandom, NoRandomMatchFound, "No match found");
+				return;
+			}
+
+			enterRoom(client, *found, JoinKind::JoinRandom);
+		}
+
+		void joinRoom(Client& client, const std::string& roomName)
+		{
+			if (not client.roomName.empty())
+			{
+				return;
+			}
+
+			Room* room = findRoom(roomName);
+
+			if (not room)
+			{
+				sendJoinError(client, JoinKind::Join, GameDoesNotExist, "Game does not exist");
+				return;
+			}
+
+			if (not room->isOpen)
+			{
+				sendJoinError(client, JoinKind::Join, GameClosed, "Game closed");
+				return;
+			}
+
+			if (static_cast<std::size_t>(room->maxPlayers) <= room->players.size())
+			{
+				sendJoinError(client, JoinKind::Join, GameFull, "Game full");
+				return;
+			}
+
+			enterRoom(client, *room, JoinKind::Join);
+		}
+
+		void createRoom(Client& client, const std::string& roomName, const std::int32_t maxPlayers)
+		{
+			if (not client.roomName.empty())
+			{
+				return;
+			}
+
+			const std::uint64_t serial = ++m_roomSerial;
+
+			// Photon と同様に、ルーム名が空の場合はサーバ側で名前を決める
+			const std::string name = (roomName.empty() ? ("relay_" + std::to_string(serial)) : roomName);
+
+			if (findRoom(name))
+			{
+				sendJoinError(client, JoinKind::Create, GameIdAlreadyExists, "A game with the specified id already exist.");
+				return;
+			}
+
+			Room& room = m_rooms[name];
+			room.name = name;
+			room.serial = serial;
+			room.maxPlayers = std::max(maxPlayers, 1);
+
+			enterRoom(client, room, JoinKind::Create);
+		}
+
+		void enterRoom(Client& client, Room& room, const JoinKind kind)
+		{
+			const std::int32_t playerID = room.nextPlayerID++;
+
+			// Photon と同様に、ルームを作成したプレイヤーが最初のマスタークライアントになる
+			if (room.players.empty())
+			{
+				room.masterClientID = playerID;
+			}
+
+			room.players.push_back(&client);
+			client.roomName = room.name;
+			client.playerID = playerID;
+
+			// 入室した本人には、入室の結果を先に通知する
+			{
+				Writer writer{ Header{ MessageType::JoinReturn, Channel::Reliable } };
+				writer.write(kind);
+				writer.write(playerID);
+				writer.write(std::int32_t{ 0 });
+				writer.writeString("");
+				writer.writeString(room.name);
+				writer.write(static_cast<std::uint8_t>(room.maxPlayers));
+				writer.write(static_cast<std::uint8_t>(room.isOpen));
+				writer.write(static_cast<std::uint8_t>(room.isVisible));
+				sendReliable(client, std::move(writer));
+			}
+
+			for (auto* player : room.players)
+			{
+				Writer writer{ Header{ MessageType::PlayerJoined, Channel::Reliable } };
+				writer.write(playerID);
+				writer.write(room.masterClientID);
+				writer.write(static_cast<std::uint16_t>(room.players.size()));
+
+				for (const auto* p : room.players)
+				{
+					writer.write(p->playerID);
+				}
+
+				sendReliable(*player, std::move(writer));
+			}
+		}
+
+		void exitRoom(Client& client)
+		{
+			const std::string roomName = std::exchange(client.roomName, std::string{});
+			const std::int32_t playerID = std::exchange(client.playerID, -1);
+			client.groups.clear();
+
+			Room* room = findRoom(roomName);
+
+			if (not room)
+			{
+				return;
+			}
+
+			room->players.erase(std::remove(room->players.begin(), room->players.end(), &client), room->players.end());
+
+			if (room->players.empty())
+			{
+				m_rooms.erase(roomName);
+				return;
+			}
+
+			// マスタークライアントが退室した場合は、Photon と同様に残りのプレイヤーのうち最も小さい ID のプレイヤーが引き継ぐ
+			if (room->masterClientID == playerID)
+			{
+				room->masterClientID = (*std::min_element(room->players.begin(), room->players.end(),
+					[](const Client* a, const Client* b) { return (a->playerID < b->playerID); }))->playerID;
+			}
+
+			for (auto* player : room->players)
+			{
+				Writer writer{ Header{ MessageType::PlayerLeft, Channel::Reliable } };
+				writer.write(playerID);
+				writer.write(room->masterClientID);
+				sendReliable(*player, std::move(writer));
+			}
+		}
+
+		void removeClient(Client& client)
+		{
+			exitRoom(client);
+		}
+
+		void changeGroups(Client& client, Reader& reader)
+		{
+			std::uint8_t count = 0;
+
+			// Photon と同様に、削除を先に行う
+			reader.read(count);
+
+			for (std::uint8_t i = 0; i < count; ++i)
+			{
+				std::uint8_t group = 0;
+				reader.read(group);
+				client.groups.erase(std::remove(client.groups.begin(), client.groups.end(), group), client.groups.end());
+			}
+
+			reader.read(count);
+
+			for (std::uint8_t i = 0; i < count; ++i)
+			{
+				std::uint8_t group = 0;
+				reader.read(group);
+
+				if (std::find(client.groups.begin(), client.groups.end(), group) == client.groups.end())
+				{
+					client.groups.push_back(group);
+				}
+			}
+		}
+
+		void raiseEvent(Client& sender, Reader& reader)
+		{
+			std::uint8_t eventCode = 0, format = 0, reliable = 0, receiverGroup = 0, interestGroup = 0, numTargets = 0;
+			reader.read(eventCode);
+			reader.read(format);
+			reader.read(reliable);
+			reader.read(receiverGroup);
+			reader.read(interestGroup);
+			reader.read(numTargets);
+
+			std::vector<std::int32_t> targets(numTargets);
+
+			for (auto& target : targets)
+			{
+				reader.read(target);
+			}
+
+			if (reader.failed())
+			{
+				return;
+			}
+
+			Room* room = findRoom(sender.roomName);
+
+			if (not room)
+			{
+				return;
+			}
+
+			// unreliable の場合は同じデータグラムを全員に送る
+			const Channel channel = (reliable ? Channel::Reliable : Channel::Unreliable);
+			Writer unreliable{ Header{ MessageType::Event, channel } };
+			unreliable.write(sender.playerID);
+			unreliable.write(eventCode);
+			unreliable.write(format);
+			unreliable.writeBytes(reader.rest(), reader.restSize());
+
+			for (auto* player : room->players)
+			{
+				const std::int32_t playerID = player->playerID;
+
+				if (not targets.empty())
+				{
+					if (std::find(targets.begin(), targets.end(), playerID) == targets.end())
+					{
+						continue;
+					}
+				}
+				else
+				{
+					// 0: Others, 1: All, 2: MasterClient (NetworkSystem::ReceiverGroup と同じ値)
+					if (((receiverGroup == 0) && (player == &sender))
+						|| ((receiverGroup == 2) && (playerID != room->masterClientID)))
+					{
+						continue;
+					}
+
+					if (interestGroup && (std::find(player->groups.begin(), player->groups.end(), interestGroup) == player->groups.end()))
+					{
+						continue;
+					}
+				}
+
+				if (reliable)
+				{
+					Writer writer;
+					writer.data() = unreliable.data();
+					sendReliable(*player, std::move(writer));
+				}
+				else
+				{
+					sendTo(*player, unreliable.data());
+				}
+			}
+		}
+
+		void setRoomFlag(Client& client, Reader& reader)
+		{
+			RoomFlag flag{};
+			std::uint8_t value = 0;
+
+			if ((not reader.read(flag)) || (not reader.read(value)))
+			{
+				return;
+			}
+
+			Room* room = findRoom(client.roomName);
+
+			if (not room)
+			{
+				return;
+			}
+
+			if (flag == RoomFlag::IsOpen)
+			{
+				room->isOpen = (value != 0);
+			}
+			else
+			{
+				room->isVisible = (value != 0);
+			}
+
+			for (auto* player : room->players)
+			{
+				Writer writer{ Header{ MessageType::RoomFlags, Channel::Reliable } };
+				writer.write(static_cast<std::uint8_t>(room->isOpen));
+				writer.write(static_cast<std::uint8_t>(room->isVisible));
+				sendReliable(*player, std::move(writer));
+			}
+		}
+
+		void sendPong(Client& client, const std::uint64_t clientTime)
+		{
+			std::size_t playersIngame = 0;
+			std::vector<const Room*> visibleRooms;
+
+			for (const auto& [name, room] : m_rooms)
+			{
+				playersIngame += room.players.size();
+
+				if (room.isVisible)
+				{
+					visibleRooms.push_back(&room);
+				}
+			}
+
+			std::sort(visibleRooms.begin(), visibleRooms.end(), [](const Room* a, const Room* b) { return (a->serial < b->serial); });
+
+			Writer writer{ Header{ MessageType::Pong, Channel::Unreliable } };
+			writer.write(clientTime);
+			writer.write(static_cast<std::uint32_t>(now()));
+			writer.write(static_cast<std::int32_t>(m_rooms.size()));
+			writer.write(static_cast<std::int32_t>(playersIngame));
+			writer.write(static_cast<std::int32_t>(m_clients.size()));
+
+			// ルーム名の一覧は 1 つのデータグラムに収まる分だけ送る
+			std::uint16_t count = 0;
+			std::size_t bytes = 0;
+
+			for (const auto* room : visibleRooms)
+			{
+				if (MaxRoomListBytes < (bytes + room->name.size() + sizeof(std::uint16_t)))
+				{
+					break;
+				}
+
+				bytes += (room->name.size() + sizeof(std::uint16_t));
+				++count;
+			}
+
+			writer.write(count);
+
+			for (std::uint16_t i = 0; i < count; ++i)
+			{
+				writer.writeString(visibleRooms[i]->name);
+			}
+
+			sendTo(client, writer.data());
+		}
+
+		void tick()
+		{
+			const std::uint64_t nowMillisec = now();
+
+			for (auto it = m_clients.begin(); it != m_clients.end();)
+			{
+				Client& client = *it->second;
+
+				if ((client.lastReceivedMillisec + TimeoutMillisec) < nowMillisec)
+				{
+					removeClient(client);
+					it = m_clients.erase(it);
+					continue;
+				}
+
+				m_stats.resent += client.channel.resend(nowMillisec, [&](const Datagram& datagram) { sendTo(client, datagram); });
+				++it;
+			}
+		}
+	};
+}
+
+int main(int argc, char* argv[])
+{
+	std::uint16_t port = DefaultPort;
+	bool printStats = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+
+		if (arg == "--stats")
+		{
+			printStats = true;
+		}
+		else
+		{
+			port = static_cast<std::uint16_t>(std::strtoul(argv[i], nullptr, 10));
+		}
+	}
+
+	std::signal(SIGINT, [](int) { Running = 0; });
+	std::signal(SIGTERM, [](int) { Running = 0; });
+
+	RelayServer server;
+
+	if (not server.open(port))
+	{
+		return 1;
+	}
+
+	std::printf("RelayServer: listening on UDP port %u\n", static_cast<unsigned>(port));
+	std::fflush(stdout);
+
+	server.run(printStats);
+	return 0;
+}